@@ -1113,6 +1113,7 @@ gst_deinit (void)
   gst_object_unref (clock);
   gst_object_unref (clock);
 
+  _priv_gst_type_find_factory_cleanup ();
   _priv_gst_registry_cleanup ();
   _priv_gst_allocator_cleanup ();
 
@@ -134,10 +134,16 @@ G_GNUC_INTERNAL  void  _priv_gst_date_time_initialize (void);
 G_GNUC_INTERNAL  void  _priv_gst_allocator_cleanup (void);
 G_GNUC_INTERNAL  void  _priv_gst_caps_features_cleanup (void);
 G_GNUC_INTERNAL  void  _priv_gst_caps_cleanup (void);
+G_GNUC_INTERNAL  void  _priv_gst_type_find_factory_cleanup (void);
 
 /* called from gst_task_cleanup_all(). */
 G_GNUC_INTERNAL  void  _priv_gst_element_cleanup (void);
 
+/* Parses a typefind magic sequence declaration */
+G_GNUC_INTERNAL
+gboolean _priv_gst_type_find_magic_parse (const gchar * magic,
+    guint64 * offset, guint8 ** bytes, gsize * size);
+
 /* Private registry functions */
 G_GNUC_INTERNAL
 gboolean _priv_gst_registry_remove_cache_plugins (GstRegistry *registry);
@@ -411,6 +417,7 @@ struct _GstTypeFindFactory {
   GstTypeFindFunction           function;
   gchar **                      extensions;
   GstCaps *                     caps;
+  gchar **                      magic;
 
   gpointer                      user_data;
   GDestroyNotify                user_data_notify;
@@ -35,6 +35,16 @@
  *
  * The #GstAtomicQueue object implements a queue that can be used from multiple
  * threads without performing any blocking operations.
+ *
+ * A queue created with gst_atomic_queue_new() grows as needed. A queue created
+ * with gst_atomic_queue_new_bounded() uses a preallocated ring of a fixed
+ * capacity instead, it never allocates memory after its creation and
+ * gst_atomic_queue_try_push() fails when it is full. When the queue is known
+ * to have only one producer and one consumer thread, the
+ * #GstAtomicQueueFlags can be used to select a cheaper implementation.
+ *
+ * gst_atomic_queue_push_many() and gst_atomic_queue_pop_many() move several
+ * items with a single atomic operation on a bounded queue.
  */
 
 G_DEFINE_BOXED_TYPE (GstAtomicQueue, gst_atomic_queue,
@@ -101,6 +111,230 @@ free_queue_mem (GstAQueueMem * mem)
   g_free (mem);
 }
 
+/* The bounded queue is a ring of cells. In the multi-producer/multi-consumer
+ * case every cell carries a sequence number that tells for which position it
+ * is ready to be written (seq == pos) or read (seq == pos + 1). Producers and
+ * consumers claim positions by moving tail and head with a compare-and-swap and
+ * publish the cell by updating its sequence number. With a single producer and
+ * a single consumer the head and tail positions are enough and each side only
+ * writes its own counter. */
+#define AQUEUE_CACHE_LINE 64
+
+typedef struct _GstAQueueCell GstAQueueCell;
+typedef struct _GstAQueueRing GstAQueueRing;
+
+struct _GstAQueueCell
+{
+  volatile gint seq;
+  gpointer data;
+};
+
+struct _GstAQueueRing
+{
+  /* written by the consumers */
+  volatile gint head;
+  gint cached_tail;             /* single consumer only */
+  guint8 pad0[AQUEUE_CACHE_LINE - 2 * sizeof (gint)];
+
+  /* written by the producers */
+  volatile gint tail;
+  gint cached_head;             /* single producer only */
+  guint8 pad1[AQUEUE_CACHE_LINE - 2 * sizeof (gint)];
+
+  guint mask;
+  gboolean spsc;
+  GstAQueueCell *cells;
+};
+
+static GstAQueueRing *
+new_queue_ring (guint capacity, gboolean spsc)
+{
+  GstAQueueRing *ring;
+  guint i;
+
+  ring = g_new0 (GstAQueueRing, 1);
+
+  ring->mask = clp2 (MAX (capacity, 2)) - 1;
+  ring->spsc = spsc;
+  ring->cells = g_new0 (GstAQueueCell, ring->mask + 1);
+  for (i = 0; i <= ring->mask; i++)
+    ring->cells[i].seq = i;
+
+  return ring;
+}
+
+static void
+free_queue_ring (GstAQueueRing * ring)
+{
+  g_free (ring->cells);
+  g_free (ring);
+}
+
+/* push up to @n items, returns the number of items pushed */
+static guint
+ring_push (GstAQueueRing * ring, gpointer * data, guint n)
+{
+  GstAQueueCell *cell;
+  guint pos, i;
+
+  if (ring->spsc) {
+    guint avail;
+
+    pos = ring->tail;
+    avail = ring->mask + 1 - (pos - (guint) ring->cached_head);
+    if (avail < n) {
+      ring->cached_head = g_atomic_int_get (&ring->head);
+      avail = ring->mask + 1 - (pos - (guint) ring->cached_head);
+    }
+    n = MIN (n, avail);
+
+    for (i = 0; i < n; i++)
+      ring->cells[(pos + i) & ring->mask].data = data[i];
+
+    /* publishes the items to the consumer */
+    g_atomic_int_set (&ring->tail, pos + n);
+
+    return n;
+  }
+
+  pos = g_atomic_int_get (&ring->tail);
+  while (TRUE) {
+    gint diff = 0;
+
+    /* find how many consecutive cells are free for this round of the ring */
+    for (i = 0; i < n; i++) {
+      cell = &ring->cells[(pos + i) & ring->mask];
+      diff = (gint) ((guint) g_atomic_int_get (&cell->seq) - (pos + i));
+      if (diff != 0)
+        break;
+    }
+
+    if (i == 0) {
+      /* the cell at tail was not consumed yet, we are full */
+      if (diff < 0)
+        return 0;
+      /* else some other producer moved tail, retry */
+      pos = g_atomic_int_get (&ring->tail);
+      continue;
+    }
+
+    if G_LIKELY
+      (g_atomic_int_compare_and_exchange (&ring->tail, pos, pos + i))
+          break;
+
+    pos = g_atomic_int_get (&ring->tail);
+  }
+  n = i;
+
+  for (i = 0; i < n; i++) {
+    cell = &ring->cells[(pos + i) & ring->mask];
+    cell->data = data[i];
+    g_atomic_int_set (&cell->seq, pos + i + 1);
+  }
+
+  return n;
+}
+
+/* pop up to @n items, returns the number of items popped */
+static guint
+ring_pop (GstAQueueRing * ring, gpointer * data, guint n)
+{
+  GstAQueueCell *cell;
+  guint pos, i;
+
+  if (ring->spsc) {
+    guint avail;
+
+    pos = ring->head;
+    avail = (guint) ring->cached_tail - pos;
+    if (avail < n) {
+      ring->cached_tail = g_atomic_int_get (&ring->tail);
+      avail = (guint) ring->cached_tail - pos;
+    }
+    n = MIN (n, avail);
+
+    for (i = 0; i < n; i++)
+      data[i] = ring->cells[(pos + i) & ring->mask].data;
+
+    /* hands the cells back to the producer */
+    g_atomic_int_set (&ring->head, pos + n);
+
+    return n;
+  }
+
+  pos = g_atomic_int_get (&ring->head);
+  while (TRUE) {
+    gint diff = 0;
+
+    /* find how many consecutive cells were published */
+    for (i = 0; i < n; i++) {
+      cell = &ring->cells[(pos + i) & ring->mask];
+      diff = (gint) ((guint) g_atomic_int_get (&cell->seq) - (pos + i + 1));
+      if (diff != 0)
+        break;
+    }
+
+    if (i == 0) {
+      /* the cell at head was not written yet, we are empty */
+      if (diff < 0)
+        return 0;
+      /* else some other consumer moved head, retry */
+      pos = g_atomic_int_get (&ring->head);
+      continue;
+    }
+
+    if G_LIKELY
+      (g_atomic_int_compare_and_exchange (&ring->head, pos, pos + i))
+          break;
+
+    pos = g_atomic_int_get (&ring->head);
+  }
+  n = i;
+
+  for (i = 0; i < n; i++) {
+    cell = &ring->cells[(pos + i) & ring->mask];
+    data[i] = cell->data;
+    /* make the cell writable for the next round of the ring */
+    g_atomic_int_set (&cell->seq, pos + i + ring->mask + 1);
+  }
+
+  return n;
+}
+
+static gpointer
+ring_peek (GstAQueueRing * ring)
+{
+  GstAQueueCell *cell;
+  guint pos;
+
+  pos = g_atomic_int_get (&ring->head);
+  cell = &ring->cells[pos & ring->mask];
+
+  if (ring->spsc) {
+    if (pos == (guint) g_atomic_int_get (&ring->tail))
+      return NULL;
+  } else if ((guint) g_atomic_int_get (&cell->seq) != pos + 1) {
+    return NULL;
+  }
+
+  return cell->data;
+}
+
+static guint
+ring_length (GstAQueueRing * ring)
+{
+  guint head, tail;
+
+  head = g_atomic_int_get (&ring->head);
+  tail = g_atomic_int_get (&ring->tail);
+
+  /* consumers might have moved head past the tail we read */
+  if ((gint) (tail - head) < 0)
+    return 0;
+
+  return MIN (tail - head, ring->mask + 1);
+}
+
 struct _GstAtomicQueue
 {
   volatile gint refcount;
@@ -110,6 +344,9 @@ struct _GstAtomicQueue
   GstAQueueMem *head_mem;
   GstAQueueMem *tail_mem;
   GstAQueueMem *free_list;
+
+  /* set for bounded queues, the fields above are unused then */
+  GstAQueueRing *ring;
 };
 
 static void
@@ -165,6 +402,48 @@ gst_atomic_queue_new (guint initial_size)
 #endif
   queue->head_mem = queue->tail_mem = new_queue_mem (initial_size, 0);
   queue->free_list = NULL;
+  queue->ring = NULL;
+
+  return queue;
+}
+
+/**
+ * gst_atomic_queue_new_bounded:
+ * @capacity: the maximum number of items in the queue
+ * @flags: #GstAtomicQueueFlags
+ *
+ * Create a new atomic queue instance that can hold at most @capacity items.
+ * @capacity will be rounded up to the nearest power of 2. All memory of the
+ * queue is allocated here.
+ *
+ * Pass %GST_ATOMIC_QUEUE_FLAG_SINGLE_PRODUCER and
+ * %GST_ATOMIC_QUEUE_FLAG_SINGLE_CONSUMER in @flags when only one thread at a
+ * time will push and only one thread at a time will pop.
+ *
+ * Returns: a new #GstAtomicQueue
+ *
+ * Since: 1.16
+ */
+GstAtomicQueue *
+gst_atomic_queue_new_bounded (guint capacity, GstAtomicQueueFlags flags)
+{
+  GstAtomicQueue *queue;
+  gboolean spsc;
+
+  g_return_val_if_fail (capacity <= G_MAXINT / 2 + 1, NULL);
+
+  spsc = (flags & GST_ATOMIC_QUEUE_FLAG_SINGLE_PRODUCER) &&
+      (flags & GST_ATOMIC_QUEUE_FLAG_SINGLE_CONSUMER);
+
+  queue = g_new (GstAtomicQueue, 1);
+
+  queue->refcount = 1;
+#ifdef LOW_MEM
+  queue->num_readers = 0;
+#endif
+  queue->head_mem = queue->tail_mem = NULL;
+  queue->free_list = NULL;
+  queue->ring = new_queue_ring (capacity, spsc);
 
   return queue;
 }
@@ -186,6 +465,12 @@ gst_atomic_queue_ref (GstAtomicQueue * queue)
 static void
 gst_atomic_queue_free (GstAtomicQueue * queue)
 {
+  if (queue->ring) {
+    free_queue_ring (queue->ring);
+    g_free (queue);
+    return;
+  }
+
   free_queue_mem (queue->head_mem);
   if (queue->head_mem != queue->tail_mem)
     free_queue_mem (queue->tail_mem);
@@ -225,6 +510,9 @@ gst_atomic_queue_peek (GstAtomicQueue * queue)
 
   g_return_val_if_fail (queue != NULL, NULL);
 
+  if (queue->ring)
+    return ring_peek (queue->ring);
+
   while (TRUE) {
     GstAQueueMem *next;
 
@@ -276,6 +564,12 @@ gst_atomic_queue_pop (GstAtomicQueue * queue)
 
   g_return_val_if_fail (queue != NULL, NULL);
 
+  if (queue->ring) {
+    if (ring_pop (queue->ring, &ret, 1) == 0)
+      return NULL;
+    return ret;
+  }
+
 #ifdef LOW_MEM
   g_atomic_int_inc (&queue->num_readers);
 #endif
@@ -327,12 +621,106 @@ gst_atomic_queue_pop (GstAtomicQueue * queue)
   return ret;
 }
 
+/**
+ * gst_atomic_queue_pop_many:
+ * @queue: a #GstAtomicQueue
+ * @data: (out caller-allocates) (array length=n_data) (transfer full): array
+ *     to store the items in
+ * @n_data: the size of @data
+ *
+ * Get up to @n_data elements from the head of the queue. On a bounded queue
+ * this claims all items with a single atomic operation.
+ *
+ * Returns: the number of elements stored in @data, 0 when the queue is
+ * empty.
+ *
+ * Since: 1.16
+ */
+guint
+gst_atomic_queue_pop_many (GstAtomicQueue * queue, gpointer * data,
+    guint n_data)
+{
+  guint i;
+
+  g_return_val_if_fail (queue != NULL, 0);
+  g_return_val_if_fail (data != NULL || n_data == 0, 0);
+
+  if (queue->ring)
+    return ring_pop (queue->ring, data, n_data);
+
+  for (i = 0; i < n_data; i++) {
+    if ((data[i] = gst_atomic_queue_pop (queue)) == NULL)
+      break;
+  }
+  return i;
+}
+
+/**
+ * gst_atomic_queue_try_push:
+ * @queue: a #GstAtomicQueue
+ * @data: the data
+ *
+ * Append @data to the tail of the queue unless the queue is bounded and
+ * full.
+ *
+ * Returns: %TRUE when @data was added, %FALSE when the queue was full.
+ *
+ * Since: 1.16
+ */
+gboolean
+gst_atomic_queue_try_push (GstAtomicQueue * queue, gpointer data)
+{
+  g_return_val_if_fail (queue != NULL, FALSE);
+
+  if (queue->ring)
+    return ring_push (queue->ring, &data, 1) == 1;
+
+  gst_atomic_queue_push (queue, data);
+  return TRUE;
+}
+
+/**
+ * gst_atomic_queue_push_many:
+ * @queue: a #GstAtomicQueue
+ * @data: (array length=n_data) (transfer full): the items to add
+ * @n_data: the number of items in @data
+ *
+ * Append the items in @data to the tail of the queue, in order. On a bounded
+ * queue all items are claimed with a single atomic operation and only as many
+ * items as there is room for are added.
+ *
+ * Returns: the number of items that were added. This is always @n_data for a
+ * queue that is not bounded.
+ *
+ * Since: 1.16
+ */
+guint
+gst_atomic_queue_push_many (GstAtomicQueue * queue, gpointer * data,
+    guint n_data)
+{
+  guint i;
+
+  g_return_val_if_fail (queue != NULL, 0);
+  g_return_val_if_fail (data != NULL || n_data == 0, 0);
+
+  if (queue->ring)
+    return ring_push (queue->ring, data, n_data);
+
+  for (i = 0; i < n_data; i++)
+    gst_atomic_queue_push (queue, data[i]);
+
+  return n_data;
+}
+
 /**
  * gst_atomic_queue_push:
  * @queue: a #GstAtomicQueue
  * @data: the data
  *
  * Append @data to the tail of the queue.
+ *
+ * When the queue is bounded and full, this waits until a consumer made room
+ * for @data. Use gst_atomic_queue_try_push() to avoid that.
  */
 void
 gst_atomic_queue_push (GstAtomicQueue * queue, gpointer data)
@@ -342,6 +730,12 @@ gst_atomic_queue_push (GstAtomicQueue * queue, gpointer data)
 
   g_return_if_fail (queue != NULL);
 
+  if (queue->ring) {
+    while (G_UNLIKELY (ring_push (queue->ring, &data, 1) == 0))
+      g_thread_yield ();
+    return;
+  }
+
   do {
     while (TRUE) {
       GstAQueueMem *mem;
@@ -404,6 +798,9 @@ gst_atomic_queue_length (GstAtomicQueue * queue)
 
   g_return_val_if_fail (queue != NULL, 0);
 
+  if (queue->ring)
+    return ring_length (queue->ring);
+
 #ifdef LOW_MEM
   g_atomic_int_inc (&queue->num_readers);
 #endif
@@ -421,3 +818,24 @@ gst_atomic_queue_length (GstAtomicQueue * queue)
 
   return tail - head;
 }
+
+/**
+ * gst_atomic_queue_get_capacity:
+ * @queue: a #GstAtomicQueue
+ *
+ * Get the maximum number of items a bounded queue can hold.
+ *
+ * Returns: the capacity of @queue or 0 when @queue is not bounded.
+ *
+ * Since: 1.16
+ */
+guint
+gst_atomic_queue_get_capacity (GstAtomicQueue * queue)
+{
+  g_return_val_if_fail (queue != NULL, 0);
+
+  if (queue->ring)
+    return queue->ring->mask + 1;
+
+  return 0;
+}
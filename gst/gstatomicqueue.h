@@ -40,6 +40,26 @@ G_BEGIN_DECLS
  */
 typedef struct _GstAtomicQueue GstAtomicQueue;
 
+/**
+ * GstAtomicQueueFlags:
+ * @GST_ATOMIC_QUEUE_FLAG_NONE: no flags
+ * @GST_ATOMIC_QUEUE_FLAG_SINGLE_PRODUCER: only one thread at a time pushes
+ *     items into the queue
+ * @GST_ATOMIC_QUEUE_FLAG_SINGLE_CONSUMER: only one thread at a time pops or
+ *     peeks items from the queue
+ *
+ * Flags used when creating a bounded queue with
+ * gst_atomic_queue_new_bounded(). A queue with both flags set uses a cheaper
+ * implementation that does not need compare-and-swap operations.
+ *
+ * Since: 1.16
+ */
+typedef enum {
+  GST_ATOMIC_QUEUE_FLAG_NONE            = 0,
+  GST_ATOMIC_QUEUE_FLAG_SINGLE_PRODUCER = (1 << 0),
+  GST_ATOMIC_QUEUE_FLAG_SINGLE_CONSUMER = (1 << 1)
+} GstAtomicQueueFlags;
+
 
 GST_API
 GType              gst_atomic_queue_get_type    (void);
@@ -47,6 +67,10 @@ GType              gst_atomic_queue_get_type    (void);
 GST_API
 GstAtomicQueue *   gst_atomic_queue_new         (guint initial_size) G_GNUC_MALLOC;
 
+GST_API
+GstAtomicQueue *   gst_atomic_queue_new_bounded (guint capacity,
+                                                 GstAtomicQueueFlags flags) G_GNUC_MALLOC;
+
 GST_API
 void               gst_atomic_queue_ref         (GstAtomicQueue * queue);
 
@@ -56,15 +80,29 @@ void               gst_atomic_queue_unref       (GstAtomicQueue * queue);
 GST_API
 void               gst_atomic_queue_push        (GstAtomicQueue* queue, gpointer data);
 
+GST_API
+gboolean           gst_atomic_queue_try_push    (GstAtomicQueue* queue, gpointer data);
+
+GST_API
+guint              gst_atomic_queue_push_many   (GstAtomicQueue* queue, gpointer *data,
+                                                 guint n_data);
+
 GST_API
 gpointer           gst_atomic_queue_pop         (GstAtomicQueue* queue);
 
+GST_API
+guint              gst_atomic_queue_pop_many    (GstAtomicQueue* queue, gpointer *data,
+                                                 guint n_data);
+
 GST_API
 gpointer           gst_atomic_queue_peek        (GstAtomicQueue* queue);
 
 GST_API
 guint              gst_atomic_queue_length      (GstAtomicQueue * queue);
 
+GST_API
+guint              gst_atomic_queue_get_capacity (GstAtomicQueue * queue);
+
 #ifdef G_DEFINE_AUTOPTR_CLEANUP_FUNC
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(GstAtomicQueue, gst_atomic_queue_unref)
 #endif
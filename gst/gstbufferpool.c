@@ -40,7 +40,8 @@
  * A bufferpool can have extra options that can be enabled with
  * gst_buffer_pool_config_add_option(). The available options can be retrieved
  * with gst_buffer_pool_get_options(). Some options allow for additional
- * configuration properties to be set.
+ * configuration properties to be set. Every pool supports
+ * #GST_BUFFER_POOL_OPTION_BOUNDED_QUEUE.
  *
  * After the configuration structure has been configured,
  * gst_buffer_pool_set_config() updates the configuration in the pool. This can
@@ -96,6 +97,7 @@ GST_DEBUG_CATEGORY_STATIC (gst_buffer_pool_debug);
 struct _GstBufferPoolPrivate
 {
   GstAtomicQueue *queue;
+  guint queue_max_buffers;      /* 0 when the queue is not bounded */
   GstPoll *poll;
 
   GRecMutex rec_lock;
@@ -589,6 +591,42 @@ gst_buffer_pool_is_active (GstBufferPool * pool)
   return res;
 }
 
+/* must be called with the lock and without outstanding buffers. Picks a
+ * bounded queue when the config asks for it */
+static void
+update_queue (GstBufferPool * pool)
+{
+  GstBufferPoolPrivate *priv = pool->priv;
+  guint size, min_buffers, max_buffers = 0;
+
+  if (!gst_buffer_pool_config_has_option (priv->config,
+          GST_BUFFER_POOL_OPTION_BOUNDED_QUEUE)
+      || !gst_buffer_pool_config_get_params (priv->config, NULL, &size,
+          &min_buffers, &max_buffers))
+    max_buffers = 0;
+
+  if (max_buffers == priv->queue_max_buffers)
+    return;
+
+  /* the control socket counts the queued buffers, we can only swap an
+   * empty queue */
+  if (gst_atomic_queue_length (priv->queue) != 0) {
+    GST_WARNING_OBJECT (pool, "can't change queue, it still has buffers");
+    return;
+  }
+
+  GST_DEBUG_OBJECT (pool, "using %s queue for %u buffers",
+      max_buffers ? "bounded" : "unbounded", max_buffers);
+
+  gst_atomic_queue_unref (priv->queue);
+  if (max_buffers > 0)
+    priv->queue = gst_atomic_queue_new_bounded (max_buffers,
+        GST_ATOMIC_QUEUE_FLAG_NONE);
+  else
+    priv->queue = gst_atomic_queue_new (16);
+  priv->queue_max_buffers = max_buffers;
+}
+
 static gboolean
 default_set_config (GstBufferPool * pool, GstStructure * config)
 {
@@ -695,6 +733,7 @@ gst_buffer_pool_set_config (GstBufferPool * pool, GstStructure * config)
   if (result) {
     /* now we are configured */
     priv->configured = TRUE;
+    update_queue (pool);
   }
   GST_BUFFER_POOL_UNLOCK (pool);
 
@@ -1292,7 +1331,8 @@ default_release_buffer (GstBufferPool * pool, GstBuffer * buffer)
     goto not_writable;
 
   /* keep it around in our queue */
-  gst_atomic_queue_push (pool->priv->queue, buffer);
+  if (G_UNLIKELY (!gst_atomic_queue_try_push (pool->priv->queue, buffer)))
+    goto queue_full;
   gst_poll_write_control (pool->priv->poll);
 
   return;
@@ -1316,6 +1356,12 @@ not_writable:
         "discarding buffer %p: memory not writable", buffer);
     goto discard;
   }
+queue_full:
+  {
+    GST_CAT_DEBUG_OBJECT (GST_CAT_PERFORMANCE, pool,
+        "discarding buffer %p: queue full", buffer);
+    goto discard;
+  }
 discard:
   {
     do_free_buffer (pool, buffer);
@@ -40,6 +40,18 @@ typedef struct _GstBufferPoolClass GstBufferPoolClass;
 #define GST_BUFFER_POOL_CLASS(klass)         (G_TYPE_CHECK_CLASS_CAST ((klass), GST_TYPE_BUFFER_POOL, GstBufferPoolClass))
 #define GST_BUFFER_POOL_CAST(obj)            ((GstBufferPool *)(obj))
 
+/**
+ * GST_BUFFER_POOL_OPTION_BOUNDED_QUEUE:
+ *
+ * An option that can be enabled on the configuration of any #GstBufferPool.
+ * When the configuration has a maximum number of buffers, the pool keeps its
+ * free buffers in a preallocated lock-free ring of that size instead of in a
+ * queue that allocates memory as it grows.
+ *
+ * Since: 1.16
+ */
+#define GST_BUFFER_POOL_OPTION_BOUNDED_QUEUE "GstBufferPoolOptionBoundedQueue"
+
 /**
  * GstBufferPoolAcquireFlags:
  * @GST_BUFFER_POOL_ACQUIRE_FLAG_NONE: no flags
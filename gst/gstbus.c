@@ -64,6 +64,13 @@
  *
  * Note that a #GstPipeline will set its bus into flushing state when changing
  * from READY to NULL state.
+ *
+ * Under heavy message load, a bus watch can handle several messages per main
+ * loop iteration by setting #GstBus:dispatch-batch-size, and messages that
+ * only report the latest state of their source, like %GST_MESSAGE_QOS or
+ * %GST_MESSAGE_BUFFERING, can be coalesced with #GstBus:coalesce-types.
+ * #GstBus:queue-capacity makes the bus use a preallocated queue of a fixed
+ * size instead of one that grows with the number of pending messages.
  */
 
 #include "gst_private.h"
@@ -97,11 +104,21 @@ enum
 };
 
 #define DEFAULT_ENABLE_ASYNC (TRUE)
+#define DEFAULT_DISPATCH_BATCH_SIZE 1
+#define DEFAULT_COALESCE_TYPES 0
+#define DEFAULT_QUEUE_CAPACITY 0
+
+/* messages that are kept even when the queue-capacity is reached */
+#define ESSENTIAL_MESSAGE_TYPES (GST_MESSAGE_EOS | GST_MESSAGE_ERROR | \
+    GST_MESSAGE_STATE_CHANGED | GST_MESSAGE_ASYNC_DONE)
 
 enum
 {
   PROP_0,
-  PROP_ENABLE_ASYNC
+  PROP_ENABLE_ASYNC,
+  PROP_DISPATCH_BATCH_SIZE,
+  PROP_COALESCE_TYPES,
+  PROP_QUEUE_CAPACITY
 };
 
 static void gst_bus_dispose (GObject * object);
@@ -113,6 +130,13 @@ struct _GstBusPrivate
 {
   GstAtomicQueue *queue;
   GMutex queue_lock;
+  guint queue_capacity;
+
+  /* essential messages that did not fit into a bounded queue, delivered
+   * after the ones in the queue. Only popped with the queue lock */
+  GMutex overflow_lock;
+  GQueue overflow;
+  volatile gint num_overflow;
 
   GstBusSyncHandler sync_handler;
   gpointer sync_handler_data;
@@ -126,6 +150,18 @@ struct _GstBusPrivate
   gboolean enable_async;
   GstPoll *poll;
   GPollFD pollfd;
+
+  /* number of queued messages the control socket was raised for, only the
+   * first message of a burst raises it and the last one releases it */
+  volatile gint num_queued;
+
+  volatile gint dispatch_batch_size;
+
+  /* latest queued message for each message type and source */
+  volatile guint coalesce_types;
+  GMutex coalesce_lock;
+  GHashTable *coalesce_table;
+  volatile gint num_coalesced;
 };
 
 #define gst_bus_parent_class parent_class
@@ -141,6 +177,39 @@ gst_bus_set_property (GObject * object,
     case PROP_ENABLE_ASYNC:
       bus->priv->enable_async = g_value_get_boolean (value);
       break;
+    case PROP_DISPATCH_BATCH_SIZE:
+      g_atomic_int_set (&bus->priv->dispatch_batch_size,
+          g_value_get_uint (value));
+      break;
+    case PROP_COALESCE_TYPES:
+      g_atomic_int_set (&bus->priv->coalesce_types, g_value_get_flags (value));
+      break;
+    case PROP_QUEUE_CAPACITY:
+      bus->priv->queue_capacity = g_value_get_uint (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_bus_get_property (GObject * object,
+    guint prop_id, GValue * value, GParamSpec * pspec)
+{
+  GstBus *bus = GST_BUS_CAST (object);
+
+  switch (prop_id) {
+    case PROP_DISPATCH_BATCH_SIZE:
+      g_value_set_uint (value,
+          g_atomic_int_get (&bus->priv->dispatch_batch_size));
+      break;
+    case PROP_COALESCE_TYPES:
+      g_value_set_flags (value, g_atomic_int_get (&bus->priv->coalesce_types));
+      break;
+    case PROP_QUEUE_CAPACITY:
+      g_value_set_uint (value, bus->priv->queue_capacity);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -152,6 +221,13 @@ gst_bus_constructed (GObject * object)
 {
   GstBus *bus = GST_BUS_CAST (object);
 
+  if (bus->priv->queue_capacity > 0)
+    bus->priv->queue =
+        gst_atomic_queue_new_bounded (bus->priv->queue_capacity,
+        GST_ATOMIC_QUEUE_FLAG_NONE);
+  else
+    bus->priv->queue = gst_atomic_queue_new (32);
+
   if (bus->priv->enable_async) {
     bus->priv->poll = gst_poll_new_timer ();
     gst_poll_get_read_gpollfd (bus->priv->poll, &bus->priv->pollfd);
@@ -168,6 +244,7 @@ gst_bus_class_init (GstBusClass * klass)
   gobject_class->dispose = gst_bus_dispose;
   gobject_class->finalize = gst_bus_finalize;
   gobject_class->set_property = gst_bus_set_property;
+  gobject_class->get_property = gst_bus_get_property;
   gobject_class->constructed = gst_bus_constructed;
 
   /**
@@ -186,6 +263,73 @@ gst_bus_class_init (GstBusClass * klass)
           DEFAULT_ENABLE_ASYNC,
           G_PARAM_CONSTRUCT_ONLY | G_PARAM_WRITABLE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstBus:dispatch-batch-size:
+   *
+   * The maximum number of messages a bus watch handles in one main loop
+   * iteration. Handling more than one message per wakeup helps the main loop
+   * to keep up with a high message rate, at the cost of delaying other
+   * sources of the same priority.
+   *
+   * The batch ends early when the watch callback returns %FALSE or when the
+   * watch was removed.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_DISPATCH_BATCH_SIZE,
+      g_param_spec_uint ("dispatch-batch-size", "Dispatch Batch Size",
+          "Maximum number of messages a bus watch handles per main loop "
+          "iteration", 1, G_MAXUINT, DEFAULT_DISPATCH_BATCH_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstBus:coalesce-types:
+   *
+   * Message types for which a queued message that was not handled yet is
+   * replaced when its source posts a newer message of the same type. The
+   * newer message is delivered in its own position in the queue.
+   *
+   * This is useful for messages that only report the latest state of their
+   * source, like %GST_MESSAGE_QOS, %GST_MESSAGE_BUFFERING or
+   * %GST_MESSAGE_PROGRESS, when the application can't keep up with them.
+   * Extended message types and messages posted with %GST_BUS_ASYNC are never
+   * coalesced.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_COALESCE_TYPES,
+      g_param_spec_flags ("coalesce-types", "Coalesce Types",
+          "Message types for which older unhandled messages of the same "
+          "source are replaced by newer ones", GST_TYPE_MESSAGE_TYPE,
+          DEFAULT_COALESCE_TYPES, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstBus:queue-capacity:
+   *
+   * The maximum number of messages that can be pending on the bus, or 0 for
+   * no limit. The value is rounded up to the nearest power of 2.
+   *
+   * A bus with a limit does not allocate memory when messages are posted
+   * while it is below the limit. Messages that are posted while the limit is
+   * reached are dropped and gst_bus_post() returns %FALSE for them, so the
+   * limit should be chosen well above the number of messages the application
+   * expects to be pending.
+   *
+   * %GST_MESSAGE_EOS, %GST_MESSAGE_ERROR, %GST_MESSAGE_STATE_CHANGED and
+   * %GST_MESSAGE_ASYNC_DONE messages are never dropped, they are kept in
+   * addition to the pending messages and delivered after them. Until they
+   * are popped, other messages are dropped so that the order of the
+   * messages is preserved.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_QUEUE_CAPACITY,
+      g_param_spec_uint ("queue-capacity", "Queue Capacity",
+          "Maximum number of pending messages (0 = unlimited)", 0,
+          G_MAXINT / 2, DEFAULT_QUEUE_CAPACITY,
+          G_PARAM_CONSTRUCT_ONLY | G_PARAM_READWRITE |
+          G_PARAM_STATIC_STRINGS));
+
   /**
    * GstBus::sync-message:
    * @bus: the object which received the signal
@@ -219,13 +363,38 @@ gst_bus_class_init (GstBusClass * klass)
       g_cclosure_marshal_generic, G_TYPE_NONE, 1, GST_TYPE_MESSAGE);
 }
 
+/* coalesced messages are keyed by their type and source */
+static guint
+gst_bus_coalesce_hash (gconstpointer key)
+{
+  const GstMessage *message = key;
+
+  return g_direct_hash (GST_MESSAGE_SRC (message)) ^ GST_MESSAGE_TYPE (message);
+}
+
+static gboolean
+gst_bus_coalesce_equal (gconstpointer a, gconstpointer b)
+{
+  const GstMessage *m1 = a, *m2 = b;
+
+  return GST_MESSAGE_TYPE (m1) == GST_MESSAGE_TYPE (m2) &&
+      GST_MESSAGE_SRC (m1) == GST_MESSAGE_SRC (m2);
+}
+
 static void
 gst_bus_init (GstBus * bus)
 {
   bus->priv = gst_bus_get_instance_private (bus);
   bus->priv->enable_async = DEFAULT_ENABLE_ASYNC;
+  bus->priv->dispatch_batch_size = DEFAULT_DISPATCH_BATCH_SIZE;
+  bus->priv->coalesce_types = DEFAULT_COALESCE_TYPES;
+  bus->priv->queue_capacity = DEFAULT_QUEUE_CAPACITY;
   g_mutex_init (&bus->priv->queue_lock);
-  bus->priv->queue = gst_atomic_queue_new (32);
+  g_mutex_init (&bus->priv->overflow_lock);
+  g_queue_init (&bus->priv->overflow);
+  g_mutex_init (&bus->priv->coalesce_lock);
+  bus->priv->coalesce_table =
+      g_hash_table_new (gst_bus_coalesce_hash, gst_bus_coalesce_equal);
 
   GST_DEBUG_OBJECT (bus, "created");
 }
@@ -246,12 +415,19 @@ gst_bus_dispose (GObject * object)
     } while (message != NULL);
     gst_atomic_queue_unref (bus->priv->queue);
     bus->priv->queue = NULL;
+    g_queue_foreach (&bus->priv->overflow, (GFunc) gst_message_unref, NULL);
+    g_queue_clear (&bus->priv->overflow);
     g_mutex_unlock (&bus->priv->queue_lock);
     g_mutex_clear (&bus->priv->queue_lock);
+    g_mutex_clear (&bus->priv->overflow_lock);
 
     if (bus->priv->poll)
       gst_poll_free (bus->priv->poll);
     bus->priv->poll = NULL;
+
+    g_hash_table_unref (bus->priv->coalesce_table);
+    bus->priv->coalesce_table = NULL;
+    g_mutex_clear (&bus->priv->coalesce_lock);
   }
 
   G_OBJECT_CLASS (parent_class)->dispose (object);
@@ -289,6 +465,147 @@ gst_bus_new (void)
   return result;
 }
 
+/* Pushes @message into the queue, or into the overflow if it is full and
+ * @message must not be dropped. Once there is an overflow all messages go
+ * there or are dropped, so that they are not delivered before it */
+static gboolean
+gst_bus_push_message (GstBus * bus, GstMessage * message)
+{
+  if (G_LIKELY (g_atomic_int_get (&bus->priv->num_overflow) == 0)
+      && gst_atomic_queue_try_push (bus->priv->queue, message))
+    return TRUE;
+
+  if (GST_MESSAGE_TYPE_IS_EXTENDED (message)
+      || (GST_MESSAGE_TYPE (message) & ESSENTIAL_MESSAGE_TYPES) == 0)
+    return FALSE;
+
+  GST_DEBUG_OBJECT (bus, "[msg %p] queue is full, keeping %s message",
+      message, GST_MESSAGE_TYPE_NAME (message));
+
+  g_mutex_lock (&bus->priv->overflow_lock);
+  g_queue_push_tail (&bus->priv->overflow, message);
+  g_atomic_int_set (&bus->priv->num_overflow, bus->priv->overflow.length);
+  g_mutex_unlock (&bus->priv->overflow_lock);
+
+  return TRUE;
+}
+
+/* Pops the next message from the queue or, when it is empty, from the
+ * overflow. Called with the queue lock */
+static GstMessage *
+gst_bus_pop_message (GstBus * bus)
+{
+  GstMessage *message;
+
+  message = gst_atomic_queue_pop (bus->priv->queue);
+  if (G_LIKELY (message != NULL
+          || g_atomic_int_get (&bus->priv->num_overflow) == 0))
+    return message;
+
+  g_mutex_lock (&bus->priv->overflow_lock);
+  message = g_queue_pop_head (&bus->priv->overflow);
+  g_atomic_int_set (&bus->priv->num_overflow, bus->priv->overflow.length);
+  g_mutex_unlock (&bus->priv->overflow_lock);
+
+  return message;
+}
+
+/* Queues @message for async delivery and, if its type is coalesced, makes
+ * it the latest one of its type and source, so that any older queued one is
+ * dropped when it is popped. Returns %FALSE when the queue is full. */
+static gboolean
+gst_bus_queue_message (GstBus * bus, GstMessage * message)
+{
+  guint types = g_atomic_int_get (&bus->priv->coalesce_types);
+  gboolean res;
+
+  if (G_LIKELY ((GST_MESSAGE_TYPE (message) & types) == 0)
+      || GST_MESSAGE_TYPE_IS_EXTENDED (message)
+      || GST_MESSAGE_SRC (message) == NULL)
+    return gst_bus_push_message (bus, message);
+
+  /* the message is only added to the table once it made it into the queue.
+   * Raising the count first makes a reader that pops it right away wait on
+   * the lock until the table is updated */
+  g_mutex_lock (&bus->priv->coalesce_lock);
+  g_atomic_int_set (&bus->priv->num_coalesced,
+      g_hash_table_size (bus->priv->coalesce_table) + 1);
+  res = gst_bus_push_message (bus, message);
+  if (res)
+    g_hash_table_replace (bus->priv->coalesce_table, message, message);
+  g_atomic_int_set (&bus->priv->num_coalesced,
+      g_hash_table_size (bus->priv->coalesce_table));
+  g_mutex_unlock (&bus->priv->coalesce_lock);
+
+  return res;
+}
+
+/* Called for every popped message. Returns %TRUE when a newer message of the
+ * same type and source was queued after @message. */
+static gboolean
+gst_bus_message_is_superseded (GstBus * bus, GstMessage * message)
+{
+  GstMessage *latest;
+  gboolean res = FALSE;
+
+  /* the entry is added before the message is queued */
+  if (G_LIKELY (g_atomic_int_get (&bus->priv->num_coalesced) == 0))
+    return FALSE;
+
+  /* the poster of an async message waits for it to be handled, it is never
+   * coalesced, also not with a newer one that was passed */
+  if (GST_MINI_OBJECT_FLAG_IS_SET (message, GST_MESSAGE_FLAG_ASYNC_DELIVERY))
+    return FALSE;
+
+  g_mutex_lock (&bus->priv->coalesce_lock);
+  latest = g_hash_table_lookup (bus->priv->coalesce_table, message);
+  if (latest == message) {
+    g_hash_table_remove (bus->priv->coalesce_table, message);
+    g_atomic_int_set (&bus->priv->num_coalesced,
+        g_hash_table_size (bus->priv->coalesce_table));
+  } else if (latest != NULL) {
+    res = TRUE;
+  }
+  g_mutex_unlock (&bus->priv->coalesce_lock);
+
+  return res;
+}
+
+/* Only the message that makes the queue non-empty raises the control socket,
+ * so a burst of messages costs a single write. */
+static inline void
+gst_bus_raise_wakeup (GstBus * bus)
+{
+  if (g_atomic_int_add (&bus->priv->num_queued, 1) == 0)
+    gst_poll_write_control (bus->priv->poll);
+}
+
+/* The counterpart of gst_bus_raise_wakeup(), called with the queue lock for
+ * every popped message. */
+static inline void
+gst_bus_release_wakeup (GstBus * bus)
+{
+  if (g_atomic_int_add (&bus->priv->num_queued, -1) != 1)
+    return;
+
+  while (!gst_poll_read_control (bus->priv->poll)) {
+    if (errno == EWOULDBLOCK) {
+      /* Retry, this can happen if pushing to the queue has finished,
+       * popping here succeeded but writing control did not finish
+       * before we got to this line. */
+      /* Give other threads the chance to do something */
+      g_thread_yield ();
+      continue;
+    } else {
+      /* This is a real error and means that either the bus is in an
+       * inconsistent state, or the GstPoll is invalid. GstPoll already
+       * prints a critical warning about this, no need to do that again
+       * ourselves */
+      break;
+    }
+  }
+}
+
 /**
  * gst_bus_post:
  * @bus: a #GstBus to post on
@@ -297,7 +614,8 @@ gst_bus_new (void)
  * Post a message on the given bus. Ownership of the message
  * is taken by the bus.
  *
- * Returns: %TRUE if the message could be posted, %FALSE if the bus is flushing.
+ * Returns: %TRUE if the message could be posted, %FALSE if the bus is flushing
+ * or if its #GstBus:queue-capacity was reached and the message was dropped.
  *
  * MT safe.
  */
@@ -353,8 +671,9 @@ gst_bus_post (GstBus * bus, GstMessage * message)
     case GST_BUS_PASS:
       /* pass the message to the async queue, refcount passed in the queue */
       GST_DEBUG_OBJECT (bus, "[msg %p] pushing on async queue", message);
-      gst_atomic_queue_push (bus->priv->queue, message);
-      gst_poll_write_control (bus->priv->poll);
+      if (!gst_bus_queue_message (bus, message))
+        goto queue_full;
+      gst_bus_raise_wakeup (bus);
       GST_DEBUG_OBJECT (bus, "[msg %p] pushed on async queue", message);
 
       break;
@@ -377,8 +696,14 @@ gst_bus_post (GstBus * bus, GstMessage * message)
        * the cond will be signalled and we can continue */
       g_mutex_lock (lock);
 
-      gst_atomic_queue_push (bus->priv->queue, message);
-      gst_poll_write_control (bus->priv->poll);
+      if (!gst_bus_push_message (bus, message)) {
+        g_mutex_unlock (lock);
+        GST_MINI_OBJECT_FLAG_UNSET (message, GST_MESSAGE_FLAG_ASYNC_DELIVERY);
+        g_mutex_clear (lock);
+        g_cond_clear (cond);
+        goto queue_full;
+      }
+      gst_bus_raise_wakeup (bus);
 
       /* now block till the message is freed */
       g_cond_wait (cond, lock);
@@ -409,6 +734,13 @@ is_flushing:
     GST_OBJECT_UNLOCK (bus);
     gst_message_unref (message);
 
+    return FALSE;
+  }
+queue_full:
+  {
+    GST_WARNING_OBJECT (bus, "[msg %p] dropped, queue is full", message);
+    gst_message_unref (message);
+
     return FALSE;
   }
 }
@@ -433,7 +765,8 @@ gst_bus_have_pending (GstBus * bus)
   g_return_val_if_fail (GST_IS_BUS (bus), FALSE);
 
   /* see if there is a message on the bus */
-  result = gst_atomic_queue_length (bus->priv->queue) != 0;
+  result = gst_atomic_queue_length (bus->priv->queue) != 0
+      || g_atomic_int_get (&bus->priv->num_overflow) != 0;
 
   return result;
 }
@@ -519,24 +852,17 @@ gst_bus_timed_pop_filtered (GstBus * bus, GstClockTime timeout,
     GST_LOG_OBJECT (bus, "have %d messages",
         gst_atomic_queue_length (bus->priv->queue));
 
-    while ((message = gst_atomic_queue_pop (bus->priv->queue))) {
-      if (bus->priv->poll) {
-        while (!gst_poll_read_control (bus->priv->poll)) {
-          if (errno == EWOULDBLOCK) {
-            /* Retry, this can happen if pushing to the queue has finished,
-             * popping here succeeded but writing control did not finish
-             * before we got to this line. */
-            /* Give other threads the chance to do something */
-            g_thread_yield ();
-            continue;
-          } else {
-            /* This is a real error and means that either the bus is in an
-             * inconsistent state, or the GstPoll is invalid. GstPoll already
-             * prints a critical warning about this, no need to do that again
-             * ourselves */
-            break;
-          }
-        }
+    while ((message = gst_bus_pop_message (bus))) {
+      if (bus->priv->poll)
+        gst_bus_release_wakeup (bus);
+
+      if (G_UNLIKELY (gst_bus_message_is_superseded (bus, message))) {
+        GST_DEBUG_OBJECT (bus, "dropping message %p, %s from %s, superseded "
+            "by a newer one", message, GST_MESSAGE_TYPE_NAME (message),
+            GST_MESSAGE_SRC_NAME (message));
+        gst_message_unref (message);
+        message = NULL;
+        continue;
       }
 
       GST_DEBUG_OBJECT (bus, "got message %p, %s from %s, type mask is %u",
@@ -693,6 +1019,11 @@ gst_bus_peek (GstBus * bus)
 
   g_mutex_lock (&bus->priv->queue_lock);
   message = gst_atomic_queue_peek (bus->priv->queue);
+  if (message == NULL && g_atomic_int_get (&bus->priv->num_overflow) != 0) {
+    g_mutex_lock (&bus->priv->overflow_lock);
+    message = g_queue_peek_head (&bus->priv->overflow);
+    g_mutex_unlock (&bus->priv->overflow_lock);
+  }
   if (message)
     gst_message_ref (message);
   g_mutex_unlock (&bus->priv->queue_lock);
@@ -814,8 +1145,9 @@ gst_bus_source_dispatch (GSource * source, GSourceFunc callback,
   GstBusFunc handler = (GstBusFunc) callback;
   GstBusSource *bsource = (GstBusSource *) source;
   GstMessage *message;
-  gboolean keep;
+  gboolean keep = TRUE;
   GstBus *bus;
+  guint i, batch_size;
 
   g_return_val_if_fail (bsource != NULL, FALSE);
 
@@ -823,23 +1155,32 @@ gst_bus_source_dispatch (GSource * source, GSourceFunc callback,
 
   g_return_val_if_fail (GST_IS_BUS (bus), FALSE);
 
-  message = gst_bus_pop (bus);
+  batch_size = g_atomic_int_get (&bus->priv->dispatch_batch_size);
 
-  /* The message queue might be empty if some other thread or callback set
-   * the bus to flushing between check/prepare and dispatch */
-  if (G_UNLIKELY (message == NULL))
-    return TRUE;
+  for (i = 0; i < batch_size; i++) {
+    message = gst_bus_pop (bus);
+
+    /* The message queue might be empty if some other thread or callback set
+     * the bus to flushing between check/prepare and dispatch, or when an
+     * earlier message of this batch was the last one */
+    if (G_UNLIKELY (message == NULL))
+      break;
 
-  if (!handler)
-    goto no_handler;
+    if (!handler)
+      goto no_handler;
 
-  GST_DEBUG_OBJECT (bus, "source %p calling dispatch with %" GST_PTR_FORMAT,
-      source, message);
+    GST_DEBUG_OBJECT (bus, "source %p calling dispatch with %" GST_PTR_FORMAT,
+        source, message);
 
-  keep = handler (bus, message, user_data);
-  gst_message_unref (message);
+    keep = handler (bus, message, user_data);
+    gst_message_unref (message);
 
-  GST_DEBUG_OBJECT (bus, "source %p handler returns %d", source, keep);
+    GST_DEBUG_OBJECT (bus, "source %p handler returns %d", source, keep);
+
+    /* the handler might have removed the watch */
+    if (!keep || g_source_is_destroyed (source))
+      break;
+  }
 
   return keep;
 
@@ -103,6 +103,7 @@
 
 #include "gst_private.h"
 #include <time.h>
+#include <math.h>
 
 #include "gstclock.h"
 #include "gstinfo.h"
@@ -158,9 +159,16 @@ struct _GstClockPrivate
   gint time_index;
   GstClockTime timeout;
   GstClockTime *times;
-  GstClockTime *times_temp;
   GstClockID clockid;
 
+  /* with SLAVE_LOCK, running sums over the observations in times, relative
+   * to (x_origin, y_origin) */
+  GstClockTime x_origin;
+  GstClockTime y_origin;
+  GstClockTime x_max;
+  gdouble sum_x, sum_y;
+  gdouble sum_xx, sum_yy, sum_xy;
+
   gint pre_count;
   gint post_count;
 
@@ -736,8 +744,7 @@ gst_clock_init (GstClock * clock)
   priv->filling = TRUE;
   priv->time_index = 0;
   priv->timeout = DEFAULT_TIMEOUT;
-  priv->times = g_new0 (GstClockTime, 4 * priv->window_size);
-  priv->times_temp = priv->times + 2 * priv->window_size;
+  priv->times = g_new0 (GstClockTime, 2 * priv->window_size);
 }
 
 static void
@@ -767,7 +774,6 @@ gst_clock_finalize (GObject * object)
   }
   g_free (clock->priv->times);
   clock->priv->times = NULL;
-  clock->priv->times_temp = NULL;
   GST_CLOCK_SLAVE_UNLOCK (clock);
 
   g_mutex_clear (&clock->priv->slave_lock);
@@ -1338,6 +1344,106 @@ gst_clock_get_master (GstClock * clock)
   return result;
 }
 
+/* The observations in priv->times are kept as running sums so that every
+ * new observation only costs a constant amount of work instead of a full
+ * regression over the window.
+ *
+ * All values are accumulated as offsets from (x_origin, y_origin), which
+ * keeps them well inside the exact range of a double even with 64 bits
+ * timestamps. Every time the window wraps around the sums are recalculated
+ * from the stored observations against the oldest one, which removes any
+ * rounding drift from the sliding updates and keeps the offsets small.
+ *
+ * with SLAVE_LOCK */
+static inline void
+gst_clock_regression_update (GstClockPrivate * priv, GstClockTime x,
+    GstClockTime y, gdouble sign)
+{
+  gdouble dx, dy;
+
+  dx = (gdouble) GST_CLOCK_DIFF (priv->x_origin, x);
+  dy = (gdouble) GST_CLOCK_DIFF (priv->y_origin, y);
+
+  priv->sum_x += sign * dx;
+  priv->sum_y += sign * dy;
+  priv->sum_xx += sign * dx * dx;
+  priv->sum_yy += sign * dy * dy;
+  priv->sum_xy += sign * dx * dy;
+}
+
+static void
+gst_clock_regression_reset (GstClockPrivate * priv, GstClockTime x,
+    GstClockTime y)
+{
+  priv->x_origin = x;
+  priv->y_origin = y;
+  priv->x_max = x;
+  priv->sum_x = priv->sum_y = 0.0;
+  priv->sum_xx = priv->sum_yy = priv->sum_xy = 0.0;
+}
+
+static void
+gst_clock_regression_recalculate (GstClockPrivate * priv, guint n)
+{
+  guint i;
+
+  gst_clock_regression_reset (priv, priv->times[0], priv->times[1]);
+  for (i = 0; i < n; i++) {
+    priv->x_max = MAX (priv->x_max, priv->times[2 * i]);
+    gst_clock_regression_update (priv, priv->times[2 * i],
+        priv->times[2 * i + 1], 1.0);
+  }
+}
+
+/* Calculates the same line as gst_calculate_linear_regression() from the
+ * running sums over the last @n observations.
+ *
+ * with SLAVE_LOCK */
+static gboolean
+gst_clock_regression_calculate (GstClockPrivate * priv, guint n,
+    GstClockTime * m_num, GstClockTime * m_denom, GstClockTime * b,
+    GstClockTime * xbase, gdouble * r_squared)
+{
+  gdouble sxx, syy, sxy, xbar, ybar, m, boffset;
+  gint exp;
+
+  xbar = priv->sum_x / n;
+  ybar = priv->sum_y / n;
+  sxx = priv->sum_xx - priv->sum_x * xbar;
+  syy = priv->sum_yy - priv->sum_y * ybar;
+  sxy = priv->sum_xy - priv->sum_x * ybar;
+
+  if (G_UNLIKELY (sxx <= 0.0 || sxy <= 0.0))
+    goto invalid;
+
+  /* scale the slope to the largest fraction that fits in 63 bits */
+  frexp (MAX (sxx, sxy), &exp);
+  *m_num = (GstClockTime) (ldexp (sxy, 63 - exp) + 0.5);
+  *m_denom = (GstClockTime) (ldexp (sxx, 63 - exp) + 0.5);
+  if (G_UNLIKELY (*m_num == 0 || *m_denom == 0))
+    goto invalid;
+
+  m = sxy / sxx;
+
+  /* Report base starting from the most recent observation */
+  *xbase = priv->x_max;
+  boffset = ybar + m * ((gdouble) (priv->x_max - priv->x_origin) - xbar);
+  *b = priv->y_origin + (GstClockTimeDiff) floor (boffset + 0.5);
+
+  if (syy > 0.0)
+    *r_squared = (sxy * sxy) / (sxx * syy);
+  else
+    *r_squared = 1.0;
+
+  return TRUE;
+
+invalid:
+  {
+    GST_CAT_DEBUG (GST_CAT_CLOCK, "degenerate observations, regression failed");
+    return FALSE;
+  }
+}
+
 /**
  * gst_clock_add_observation:
  * @clock: a #GstClock
@@ -1418,21 +1524,33 @@ gst_clock_add_observation_unapplied (GstClock * clock, GstClockTime slave,
       "adding observation slave %" GST_TIME_FORMAT ", master %" GST_TIME_FORMAT,
       GST_TIME_ARGS (slave), GST_TIME_ARGS (master));
 
+  if (G_UNLIKELY (priv->filling && priv->time_index == 0)) {
+    /* (re)starting calibration */
+    gst_clock_regression_reset (priv, slave, master);
+  } else if (!priv->filling) {
+    /* drop the oldest observation, which is the one we replace */
+    gst_clock_regression_update (priv, priv->times[(2 * priv->time_index)],
+        priv->times[(2 * priv->time_index) + 1], -1.0);
+  }
+
   priv->times[(2 * priv->time_index)] = slave;
   priv->times[(2 * priv->time_index) + 1] = master;
+  priv->x_max = MAX (priv->x_max, slave);
+  gst_clock_regression_update (priv, slave, master, 1.0);
 
   priv->time_index++;
   if (G_UNLIKELY (priv->time_index == priv->window_size)) {
     priv->filling = FALSE;
     priv->time_index = 0;
+    gst_clock_regression_recalculate (priv, priv->window_size);
   }
 
   if (G_UNLIKELY (priv->filling && priv->time_index < priv->window_threshold))
     goto filling;
 
   n = priv->filling ? priv->time_index : priv->window_size;
-  if (!gst_calculate_linear_regression (priv->times, priv->times_temp, n,
-          &m_num, &m_denom, &b, &xbase, r_squared))
+  if (!gst_clock_regression_calculate (priv, n, &m_num, &m_denom, &b, &xbase,
+          r_squared))
     goto invalid;
 
   GST_CLOCK_SLAVE_UNLOCK (clock);
@@ -1520,8 +1638,7 @@ gst_clock_set_property (GObject * object, guint prop_id,
       GST_CLOCK_SLAVE_LOCK (clock);
       priv->window_size = g_value_get_int (value);
       priv->window_threshold = MIN (priv->window_threshold, priv->window_size);
-      priv->times = g_renew (GstClockTime, priv->times, 4 * priv->window_size);
-      priv->times_temp = priv->times + 2 * priv->window_size;
+      priv->times = g_renew (GstClockTime, priv->times, 2 * priv->window_size);
       /* restart calibration */
       priv->filling = TRUE;
       priv->time_index = 0;
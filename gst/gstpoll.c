@@ -51,6 +51,12 @@
  * descriptor, and gst_poll_fd_can_write() to see if it is possible to
  * write to it.
  *
+ * On Linux, the file descriptors of non-timer sets are watched with epoll,
+ * so that the cost of gst_poll_wait() depends on the number of descriptors
+ * with activity instead of the size of the set. A set falls back to ppoll()
+ * when it contains a descriptor that epoll can't watch, such as a regular
+ * file.
+ *
  */
 
 #ifdef HAVE_CONFIG_H
@@ -83,6 +89,14 @@
 #endif
 #include <sys/time.h>
 #include <sys/socket.h>
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_EPOLL_CREATE1)
+#include <sys/epoll.h>
+#define USE_EPOLL 1
+#endif
+#if defined(HAVE_SYS_EVENTFD_H) && defined(HAVE_EVENTFD)
+#include <sys/eventfd.h>
+#define USE_EVENTFD 1
+#endif
 #endif
 
 #ifdef G_OS_WIN32
@@ -124,9 +138,22 @@ typedef enum
   GST_POLL_MODE_PSELECT,
   GST_POLL_MODE_POLL,
   GST_POLL_MODE_PPOLL,
+  GST_POLL_MODE_EPOLL,
   GST_POLL_MODE_WINDOWS
 } GstPollMode;
 
+#ifdef USE_EPOLL
+typedef struct _EpollFd EpollFd;
+
+struct _EpollFd
+{
+  /* index in active_fds or -1 */
+  gint idx;
+  /* events registered with epoll or -1 */
+  gint events;
+};
+#endif
+
 struct _GstPoll
 {
   GstPollMode mode;
@@ -142,6 +169,15 @@ struct _GstPoll
 #ifndef G_OS_WIN32
   GstPollFD control_read_fd;
   GstPollFD control_write_fd;
+#ifdef USE_EPOLL
+  gint epoll_fd;
+  /* array of EpollFd indexed by fd, with lock */
+  GArray *epoll_fds;
+  /* indexes in active_fds with revents from the last wait, with lock */
+  GArray *epoll_ready;
+  /* array of struct epoll_event, only used from the waiting thread */
+  GArray *epoll_events;
+#endif
 #else
   GArray *active_fds_ignored;
   GArray *events;
@@ -174,10 +210,29 @@ static gboolean gst_poll_add_fd_unlocked (GstPoll * set, GstPollFD * fd);
 
 #ifndef G_OS_WIN32
 
+/* an eventfd is used for both ends of the control socket */
+#define IS_EVENTFD_CONTROL(s) ((s)->control_read_fd.fd == (s)->control_write_fd.fd)
+
 static gboolean
 wake_event (GstPoll * set)
 {
   ssize_t num_written;
+
+#ifdef USE_EVENTFD
+  if (IS_EVENTFD_CONTROL (set)) {
+    guint64 val = 1;
+
+    while ((num_written = write (set->control_write_fd.fd, &val,
+                sizeof (val))) != sizeof (val)) {
+      if (num_written == -1 && errno != EAGAIN && errno != EINTR) {
+        g_critical ("%p: failed to wake event: %s", set, strerror (errno));
+        return FALSE;
+      }
+    }
+    return TRUE;
+  }
+#endif
+
   while ((num_written = write (set->control_write_fd.fd, "W", 1)) != 1) {
     if (num_written == -1 && errno != EAGAIN && errno != EINTR) {
       g_critical ("%p: failed to wake event: %s", set, strerror (errno));
@@ -192,6 +247,23 @@ release_event (GstPoll * set)
 {
   gchar buf[1] = { '\0' };
   ssize_t num_read;
+
+#ifdef USE_EVENTFD
+  if (IS_EVENTFD_CONTROL (set)) {
+    guint64 val;
+
+    /* reading resets the counter, which is never more than 1 */
+    while ((num_read = read (set->control_read_fd.fd, &val,
+                sizeof (val))) != sizeof (val)) {
+      if (num_read == -1 && errno != EAGAIN && errno != EINTR) {
+        g_critical ("%p: failed to release event: %s", set, strerror (errno));
+        return FALSE;
+      }
+    }
+    return TRUE;
+  }
+#endif
+
   while ((num_read = read (set->control_read_fd.fd, buf, 1)) != 1) {
     if (num_read == -1 && errno != EAGAIN && errno != EINTR) {
       g_critical ("%p: failed to release event: %s", set, strerror (errno));
@@ -392,6 +464,181 @@ find_index (GArray * array, GstPollFD * fd)
   return fd->idx;
 }
 
+#ifdef USE_EPOLL
+static gint
+pollfd_events_to_epoll (gshort events)
+{
+  gint res = 0;
+
+  if (events & POLLIN)
+    res |= EPOLLIN;
+  if (events & POLLOUT)
+    res |= EPOLLOUT;
+  if (events & POLLPRI)
+    res |= EPOLLPRI;
+
+  return res;
+}
+
+static gshort
+epoll_events_to_pollfd (guint32 events)
+{
+  gshort res = 0;
+
+  if (events & EPOLLIN)
+    res |= POLLIN;
+  if (events & EPOLLOUT)
+    res |= POLLOUT;
+  if (events & EPOLLPRI)
+    res |= POLLPRI;
+  if (events & EPOLLERR)
+    res |= POLLERR;
+  if (events & EPOLLHUP)
+    res |= POLLHUP;
+
+  return res;
+}
+
+/* Unregister @fd from epoll right away, the caller might close it and the
+ * number could be reused before the next rebuild.
+ *
+ * with LOCK */
+static void
+gst_poll_epoll_remove (GstPoll * set, gint fd)
+{
+  EpollFd *efd;
+
+  if (set->mode != GST_POLL_MODE_EPOLL || fd >= set->epoll_fds->len)
+    return;
+
+  efd = &g_array_index (set->epoll_fds, EpollFd, fd);
+  if (efd->events >= 0) {
+    /* fails when the fd was already closed, the kernel dropped it then */
+    epoll_ctl (set->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    efd->events = -1;
+  }
+  efd->idx = -1;
+}
+
+/* Called from the waiting thread after active_fds was rebuilt. Registers the
+ * added fds and the changed events with epoll, so that like with poll() any
+ * changes only take effect for the next wait. Falls back to poll() when epoll
+ * can't watch one of the fds, like regular files (EPERM) or invalid fds that
+ * poll() would report with POLLNVAL (EBADF).
+ *
+ * with LOCK */
+static void
+gst_poll_epoll_rebuild (GstPoll * set)
+{
+  struct epoll_event ev;
+  gint max_fd = -1;
+  guint i;
+
+  for (i = 0; i < set->active_fds->len; i++) {
+    struct pollfd *pfd = &g_array_index (set->active_fds, struct pollfd, i);
+
+    max_fd = MAX (max_fd, pfd->fd);
+  }
+
+  if (max_fd >= (gint) set->epoll_fds->len) {
+    i = set->epoll_fds->len;
+    g_array_set_size (set->epoll_fds, max_fd + 1);
+    for (; i < set->epoll_fds->len; i++) {
+      g_array_index (set->epoll_fds, EpollFd, i).idx = -1;
+      g_array_index (set->epoll_fds, EpollFd, i).events = -1;
+    }
+  }
+
+  for (i = 0; i < set->active_fds->len; i++) {
+    struct pollfd *pfd = &g_array_index (set->active_fds, struct pollfd, i);
+    EpollFd *efd = &g_array_index (set->epoll_fds, EpollFd, pfd->fd);
+    gint events = pollfd_events_to_epoll (pfd->events);
+
+    efd->idx = i;
+    if (efd->events == events)
+      continue;
+
+    memset (&ev, 0, sizeof (ev));
+    ev.events = events;
+    ev.data.fd = pfd->fd;
+
+    if (epoll_ctl (set->epoll_fd,
+            efd->events < 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, pfd->fd,
+            &ev) < 0)
+      goto epoll_failed;
+
+    efd->events = events;
+  }
+
+  /* active_fds was copied with all revents cleared */
+  g_array_set_size (set->epoll_ready, 0);
+  g_array_set_size (set->epoll_events, MAX (set->active_fds->len, 1));
+  return;
+
+epoll_failed:
+  {
+    GST_INFO ("%p: can't use epoll for fd %d: %s, falling back to poll", set,
+        ev.data.fd, g_strerror (errno));
+    set->mode = GST_POLL_MODE_AUTO;
+    return;
+  }
+}
+
+/* Clear the results of the previous wait and store the @n_events results of
+ * the last epoll_wait() in active_fds, so only fds with activity are touched.
+ *
+ * with LOCK */
+static gint
+gst_poll_epoll_collect (GstPoll * set, gint n_events)
+{
+  gint i, res = 0;
+
+  for (i = 0; i < set->epoll_ready->len; i++) {
+    gint idx = g_array_index (set->epoll_ready, gint, i);
+
+    if (idx < set->active_fds->len)
+      g_array_index (set->active_fds, struct pollfd, idx).revents = 0;
+  }
+  g_array_set_size (set->epoll_ready, 0);
+
+  for (i = 0; i < n_events; i++) {
+    struct epoll_event *ev =
+        &g_array_index (set->epoll_events, struct epoll_event, i);
+    gint idx;
+
+    /* skip fds that were removed in the meantime */
+    if (ev->data.fd >= set->epoll_fds->len)
+      continue;
+    idx = g_array_index (set->epoll_fds, EpollFd, ev->data.fd).idx;
+    if (idx < 0 || idx >= set->active_fds->len)
+      continue;
+
+    g_array_index (set->active_fds, struct pollfd, idx).revents =
+        epoll_events_to_pollfd (ev->events);
+    g_array_append_val (set->epoll_ready, idx);
+    res++;
+  }
+
+  return n_events < 0 ? n_events : res;
+}
+
+static void
+gst_poll_epoll_free (GstPoll * set)
+{
+  if (set->epoll_fd >= 0)
+    close (set->epoll_fd);
+  set->epoll_fd = -1;
+
+  if (set->epoll_fds)
+    g_array_free (set->epoll_fds, TRUE);
+  if (set->epoll_ready)
+    g_array_free (set->epoll_ready, TRUE);
+  if (set->epoll_events)
+    g_array_free (set->epoll_events, TRUE);
+  set->epoll_fds = set->epoll_ready = set->epoll_events = NULL;
+}
+#endif
+
 #if !defined(HAVE_PPOLL) && defined(HAVE_POLL)
 /* check if all file descriptors will fit in an fd_set */
 static gboolean
@@ -686,14 +933,33 @@ gst_poll_new (gboolean controllable)
   nset->active_fds = g_array_new (FALSE, FALSE, sizeof (struct pollfd));
   nset->control_read_fd.fd = -1;
   nset->control_write_fd.fd = -1;
+#ifdef USE_EPOLL
+  nset->epoll_fd = epoll_create1 (EPOLL_CLOEXEC);
+  if (nset->epoll_fd >= 0) {
+    nset->mode = GST_POLL_MODE_EPOLL;
+    nset->epoll_fds = g_array_new (FALSE, FALSE, sizeof (EpollFd));
+    nset->epoll_ready = g_array_new (FALSE, FALSE, sizeof (gint));
+    nset->epoll_events =
+        g_array_new (FALSE, FALSE, sizeof (struct epoll_event));
+  } else {
+    GST_INFO ("%p: can't create epoll fd: %s", nset, g_strerror (errno));
+  }
+#endif
   {
-    gint control_sock[2];
+#ifdef USE_EVENTFD
+    nset->control_read_fd.fd = eventfd (0, EFD_CLOEXEC);
+    nset->control_write_fd.fd = nset->control_read_fd.fd;
+#endif
 
-    if (socketpair (PF_UNIX, SOCK_STREAM, 0, control_sock) < 0)
-      goto no_socket_pair;
+    if (nset->control_read_fd.fd < 0) {
+      gint control_sock[2];
 
-    nset->control_read_fd.fd = control_sock[0];
-    nset->control_write_fd.fd = control_sock[1];
+      if (socketpair (PF_UNIX, SOCK_STREAM, 0, control_sock) < 0)
+        goto no_socket_pair;
+
+      nset->control_read_fd.fd = control_sock[0];
+      nset->control_write_fd.fd = control_sock[1];
+    }
 
     gst_poll_add_fd_unlocked (nset, &nset->control_read_fd);
     gst_poll_fd_ctl_read_unlocked (nset, &nset->control_read_fd, TRUE);
@@ -754,6 +1020,15 @@ gst_poll_new_timer (void)
   /* we are a timer */
   poll->timer = TRUE;
 
+#ifdef USE_EPOLL
+  /* timers only watch the control socket and can be waited on from multiple
+   * threads, plain poll is the better fit for them */
+  g_mutex_lock (&poll->lock);
+  gst_poll_epoll_free (poll);
+  poll->mode = GST_POLL_MODE_AUTO;
+  g_mutex_unlock (&poll->lock);
+#endif
+
 done:
   return poll;
 }
@@ -772,10 +1047,13 @@ gst_poll_free (GstPoll * set)
   GST_DEBUG ("%p: freeing", set);
 
 #ifndef G_OS_WIN32
-  if (set->control_write_fd.fd >= 0)
+  if (set->control_write_fd.fd >= 0 && !IS_EVENTFD_CONTROL (set))
     close (set->control_write_fd.fd);
   if (set->control_read_fd.fd >= 0)
     close (set->control_read_fd.fd);
+#ifdef USE_EPOLL
+  gst_poll_epoll_free (set);
+#endif
 #else
   CloseHandle (set->wakeup_event);
 
@@ -938,6 +1216,8 @@ gst_poll_remove_fd (GstPoll * set, GstPollFD * fd)
 #ifdef G_OS_WIN32
     gst_poll_free_winsock_event (set, idx);
     g_array_remove_index_fast (set->events, idx);
+#elif defined(USE_EPOLL)
+    gst_poll_epoll_remove (set, fd->fd);
 #endif
 
     /* remove the fd at index, we use _remove_index_fast, which copies the last
@@ -1430,14 +1710,16 @@ gst_poll_wait (GstPoll * set, GstClockTime timeout)
     res = -1;
     restarting = FALSE;
 
-    mode = choose_mode (set, timeout);
-
     if (TEST_REBUILD (set)) {
       g_mutex_lock (&set->lock);
 #ifndef G_OS_WIN32
       g_array_set_size (set->active_fds, set->fds->len);
       memcpy (set->active_fds->data, set->fds->data,
           set->fds->len * sizeof (struct pollfd));
+#ifdef USE_EPOLL
+      if (set->mode == GST_POLL_MODE_EPOLL)
+        gst_poll_epoll_rebuild (set);
+#endif
 #else
       if (!gst_poll_prepare_winsock_active_sets (set))
         goto winsock_error;
@@ -1445,6 +1727,9 @@ gst_poll_wait (GstPoll * set, GstClockTime timeout)
       g_mutex_unlock (&set->lock);
     }
 
+    /* after the rebuild, which can make an epoll set fall back to poll */
+    mode = choose_mode (set, timeout);
+
     switch (mode) {
       case GST_POLL_MODE_AUTO:
         g_assert_not_reached ();
@@ -1488,6 +1773,62 @@ gst_poll_wait (GstPoll * set, GstClockTime timeout)
 #else
         g_assert_not_reached ();
         errno = ENOSYS;
+#endif
+        break;
+      }
+      case GST_POLL_MODE_EPOLL:
+      {
+#ifdef USE_EPOLL
+        gint t, err;
+        gboolean waited = FALSE;
+#ifdef HAVE_EPOLL_PWAIT2
+        static gboolean have_pwait2 = TRUE;
+        struct timespec ts;
+        struct timespec *tsptr;
+
+        /* nanosecond timeouts, when the kernel supports them */
+        if (have_pwait2) {
+          if (timeout != GST_CLOCK_TIME_NONE) {
+            GST_TIME_TO_TIMESPEC (timeout, ts);
+            tsptr = &ts;
+          } else {
+            tsptr = NULL;
+          }
+
+          res = epoll_pwait2 (set->epoll_fd,
+              (struct epoll_event *) set->epoll_events->data,
+              set->epoll_events->len, tsptr, NULL);
+          if (res >= 0 || errno != ENOSYS)
+            waited = TRUE;
+          else
+            have_pwait2 = FALSE;
+        }
+#endif
+
+        if (!waited) {
+          /* round up to the next millisecond, a truncated timeout would
+           * return before it expired and make the callers spin */
+          if (timeout == GST_CLOCK_TIME_NONE) {
+            t = -1;
+          } else if (timeout >= (GstClockTime) G_MAXINT * GST_MSECOND) {
+            t = G_MAXINT;
+          } else {
+            t = GST_TIME_AS_MSECONDS (timeout + GST_MSECOND - 1);
+          }
+
+          res = epoll_wait (set->epoll_fd,
+              (struct epoll_event *) set->epoll_events->data,
+              set->epoll_events->len, t);
+        }
+        err = errno;
+
+        g_mutex_lock (&set->lock);
+        res = gst_poll_epoll_collect (set, res);
+        g_mutex_unlock (&set->lock);
+        errno = err;
+#else
+        g_assert_not_reached ();
+        errno = ENOSYS;
 #endif
         break;
       }
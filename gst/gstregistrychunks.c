@@ -312,6 +312,15 @@ gst_registry_chunks_save_feature (GList ** list, GstPluginFeature * feature)
       }
     }
     GST_DEBUG_OBJECT (feature, "saved %d extensions", tff->nextensions);
+    /* save magic sequences */
+    tff->nmagic = 0;
+    if (factory->magic) {
+      while (factory->magic[tff->nmagic]) {
+        gst_registry_chunks_save_const_string (list,
+            factory->magic[tff->nmagic++]);
+      }
+    }
+    GST_DEBUG_OBJECT (feature, "saved %d magic sequences", tff->nmagic);
     /* save caps */
     if (factory->caps) {
       GstCaps *fcaps = gst_caps_ref (factory->caps);
@@ -664,6 +673,18 @@ gst_registry_chunks_load_feature (GstRegistry * registry, gchar ** in,
     else
       factory->caps = NULL;
 
+    /* load magic sequences */
+    if (tff->nmagic) {
+      GST_DEBUG ("Reading %d Typefind magic sequences at address %p",
+          tff->nmagic, *in);
+      factory->magic = g_new0 (gchar *, tff->nmagic + 1);
+      /* unpack in reverse order to maintain the correct order */
+      for (i = tff->nmagic; i > 0; i--) {
+        unpack_string (*in, str, end, fail);
+        factory->magic[i - 1] = str;
+      }
+    }
+
     /* load extensions */
     if (tff->nextensions) {
       GST_DEBUG ("Reading %d Typefind extensions at address %p",
@@ -121,6 +121,7 @@ typedef struct _GstRegistryChunkElementFactory
 /*
  * GstRegistryChunkTypeFindFactory:
  * @nextensions: stores the number of typefind extensions
+ * @nmagic: stores the number of typefind magic sequences
  *
  * A structure containing the type find factory fields
  */
@@ -129,6 +130,7 @@ typedef struct _GstRegistryChunkTypeFindFactory
   GstRegistryChunkPluginFeature plugin_feature;
 
   guint nextensions;
+  guint nmagic;
 } GstRegistryChunkTypeFindFactory;
 
 /*
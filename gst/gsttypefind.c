@@ -64,11 +64,63 @@ gboolean
 gst_type_find_register (GstPlugin * plugin, const gchar * name, guint rank,
     GstTypeFindFunction func, const gchar * extensions,
     GstCaps * possible_caps, gpointer data, GDestroyNotify data_notify)
+{
+  return gst_type_find_register_with_magic (plugin, name, rank, func,
+      extensions, NULL, possible_caps, data, data_notify);
+}
+
+/**
+ * gst_type_find_register_with_magic:
+ * @plugin: (allow-none): A #GstPlugin, or %NULL for a static typefind function
+ * @name: The name for registering
+ * @rank: The rank (or importance) of this typefind function
+ * @func: The #GstTypeFindFunction to use
+ * @extensions: (allow-none): Optional comma-separated list of extensions
+ *     that could belong to this type
+ * @magic: (allow-none): Optional comma-separated list of magic sequences
+ *     that the type starts with
+ * @possible_caps: Optionally the caps that could be returned when typefinding
+ *                 succeeds
+ * @data: Optional user data. This user data must be available until the plugin
+ *        is unloaded.
+ * @data_notify: a #GDestroyNotify that will be called on @data when the plugin
+ *        is unloaded.
+ *
+ * Like gst_type_find_register(), but additionally declares the magic
+ * sequences of the type. Each sequence is written as hexadecimal bytes,
+ * optionally prefixed by a decimal byte offset and a colon, for example
+ * "1a45dfa3" or "4:66747970".
+ *
+ * The magic sequences are stored in the registry and used to skip @func
+ * for data that has none of them at their offsets, without loading
+ * @plugin. They must therefore only be declared if @func never suggests
+ * any caps when none of the sequences match.
+ *
+ * Returns: %TRUE on success, %FALSE otherwise
+ *
+ * Since: 1.16
+ */
+gboolean
+gst_type_find_register_with_magic (GstPlugin * plugin, const gchar * name,
+    guint rank, GstTypeFindFunction func, const gchar * extensions,
+    const gchar * magic, GstCaps * possible_caps, gpointer data,
+    GDestroyNotify data_notify)
 {
   GstTypeFindFactory *factory;
+  gchar **magic_list = NULL;
 
   g_return_val_if_fail (name != NULL, FALSE);
 
+  if (magic) {
+    guint i;
+
+    magic_list = g_strsplit (magic, ",", -1);
+    for (i = 0; magic_list[i]; i++) {
+      if (!_priv_gst_type_find_magic_parse (magic_list[i], NULL, NULL, NULL))
+        goto invalid_magic;
+    }
+  }
+
   GST_INFO ("registering typefind function for %s", name);
 
   factory = g_object_new (GST_TYPE_TYPE_FIND_FACTORY, NULL);
@@ -79,6 +131,7 @@ gst_type_find_register (GstPlugin * plugin, const gchar * name, guint rank,
 
   if (extensions)
     factory->extensions = g_strsplit (extensions, ",", -1);
+  factory->magic = magic_list;
 
   gst_caps_replace (&factory->caps, possible_caps);
   factory->function = func;
@@ -99,6 +152,15 @@ gst_type_find_register (GstPlugin * plugin, const gchar * name, guint rank,
       GST_PLUGIN_FEATURE_CAST (factory));
 
   return TRUE;
+
+  /* ERRORS */
+invalid_magic:
+  {
+    g_warning ("invalid magic sequence '%s' for typefind function %s",
+        magic, name);
+    g_strfreev (magic_list);
+    return FALSE;
+  }
 }
 
 /*** typefind function interface **********************************************/
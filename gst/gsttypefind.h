@@ -124,6 +124,17 @@ gboolean  gst_type_find_register   (GstPlugin            * plugin,
                                     gpointer               data,
                                     GDestroyNotify         data_notify);
 
+GST_API
+gboolean  gst_type_find_register_with_magic (GstPlugin            * plugin,
+                                             const gchar          * name,
+                                             guint                  rank,
+                                             GstTypeFindFunction    func,
+                                             const gchar          * extensions,
+                                             const gchar          * magic,
+                                             GstCaps              * possible_caps,
+                                             gpointer               data,
+                                             GDestroyNotify         data_notify);
+
 G_END_DECLS
 
 #endif /* __GST_TYPE_FIND_H__ */
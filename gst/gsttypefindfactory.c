@@ -81,9 +81,41 @@
 #include "gsttypefindfactory.h"
 #include "gstregistry.h"
 
+#include <string.h>
+
 GST_DEBUG_CATEGORY (type_find_debug);
 #define GST_CAT_DEFAULT type_find_debug
 
+/* A byte trie of the magic sequences declared at one offset. Every node
+ * keeps the factories whose sequence ends at it. */
+typedef struct _GstTypeFindMagicNode GstTypeFindMagicNode;
+
+struct _GstTypeFindMagicNode
+{
+  guint8 byte;
+  GstTypeFindMagicNode *child;
+  GstTypeFindMagicNode *next;
+  GSList *factories;
+};
+
+typedef struct
+{
+  guint64 offset;
+  GstTypeFindMagicNode *root;
+} GstTypeFindMagicTrie;
+
+/* Index of all typefind factories, rebuilt when the registry changes */
+typedef struct
+{
+  guint32 cookie;
+  GList *factories;             /* sorted by rank, then name */
+  GHashTable *indexed;          /* factories with at least one magic sequence */
+  GArray *tries;                /* GstTypeFindMagicTrie, one per offset */
+} GstTypeFindIndex;
+
+static GMutex index_lock;
+static GstTypeFindIndex *type_find_index = NULL;
+
 static void gst_type_find_factory_dispose (GObject * object);
 
 #define _do_init \
@@ -124,6 +156,10 @@ gst_type_find_factory_dispose (GObject * object)
     g_strfreev (factory->extensions);
     factory->extensions = NULL;
   }
+  if (factory->magic) {
+    g_strfreev (factory->magic);
+    factory->magic = NULL;
+  }
   if (factory->user_data_notify && factory->user_data) {
     factory->user_data_notify (factory->user_data);
     factory->user_data = NULL;
@@ -153,6 +189,310 @@ gst_type_find_factory_get_list (void)
       GST_TYPE_TYPE_FIND_FACTORY);
 }
 
+/*
+ * _priv_gst_type_find_magic_parse:
+ * @magic: a magic sequence declaration, "[offset:]hexbytes"
+ * @offset: (out) (allow-none): the offset of the sequence
+ * @bytes: (out) (allow-none): the bytes of the sequence, free with g_free()
+ * @size: (out) (allow-none): the number of bytes
+ *
+ * Returns: %TRUE if @magic is a valid declaration
+ */
+gboolean
+_priv_gst_type_find_magic_parse (const gchar * magic, guint64 * offset,
+    guint8 ** bytes, gsize * size)
+{
+  const gchar *hex;
+  gchar *end;
+  guint64 off = 0;
+  gsize len, i;
+  guint8 *data;
+
+  if ((hex = strchr (magic, ':'))) {
+    off = g_ascii_strtoull (magic, &end, 10);
+    if (end == magic || end != hex)
+      return FALSE;
+    hex++;
+  } else {
+    hex = magic;
+  }
+
+  len = strlen (hex);
+  if (len == 0 || len % 2 != 0)
+    return FALSE;
+
+  data = g_malloc (len / 2);
+  for (i = 0; i < len / 2; i++) {
+    gint high = g_ascii_xdigit_value (hex[2 * i]);
+    gint low = g_ascii_xdigit_value (hex[2 * i + 1]);
+
+    if (high < 0 || low < 0) {
+      g_free (data);
+      return FALSE;
+    }
+    data[i] = (high << 4) | low;
+  }
+
+  if (offset)
+    *offset = off;
+  if (size)
+    *size = len / 2;
+  if (bytes)
+    *bytes = data;
+  else
+    g_free (data);
+
+  return TRUE;
+}
+
+static void
+gst_type_find_magic_node_free (GstTypeFindMagicNode * node)
+{
+  while (node) {
+    GstTypeFindMagicNode *next = node->next;
+
+    gst_type_find_magic_node_free (node->child);
+    g_slist_free (node->factories);
+    g_slice_free (GstTypeFindMagicNode, node);
+    node = next;
+  }
+}
+
+static void
+gst_type_find_index_add_magic (GstTypeFindIndex * index,
+    GstTypeFindFactory * factory, guint64 offset, const guint8 * bytes,
+    gsize size)
+{
+  GstTypeFindMagicTrie *trie = NULL;
+  GstTypeFindMagicNode *node, **link;
+  guint i;
+
+  for (i = 0; i < index->tries->len; i++) {
+    GstTypeFindMagicTrie *t =
+        &g_array_index (index->tries, GstTypeFindMagicTrie, i);
+
+    if (t->offset == offset) {
+      trie = t;
+      break;
+    }
+  }
+  if (trie == NULL) {
+    GstTypeFindMagicTrie new_trie = { offset, NULL };
+
+    new_trie.root = g_slice_new0 (GstTypeFindMagicNode);
+    g_array_append_val (index->tries, new_trie);
+    trie = &g_array_index (index->tries, GstTypeFindMagicTrie,
+        index->tries->len - 1);
+  }
+
+  node = trie->root;
+  for (i = 0; i < size; i++) {
+    for (link = &node->child; *link; link = &(*link)->next) {
+      if ((*link)->byte == bytes[i])
+        break;
+    }
+    if (*link == NULL) {
+      *link = g_slice_new0 (GstTypeFindMagicNode);
+      (*link)->byte = bytes[i];
+    }
+    node = *link;
+  }
+  node->factories = g_slist_prepend (node->factories, factory);
+}
+
+static void
+gst_type_find_index_free (GstTypeFindIndex * index)
+{
+  guint i;
+
+  for (i = 0; i < index->tries->len; i++)
+    gst_type_find_magic_node_free (g_array_index (index->tries,
+            GstTypeFindMagicTrie, i).root);
+  g_array_free (index->tries, TRUE);
+  g_hash_table_unref (index->indexed);
+  gst_plugin_feature_list_free (index->factories);
+  g_slice_free (GstTypeFindIndex, index);
+}
+
+static GstTypeFindIndex *
+gst_type_find_index_new (guint32 cookie)
+{
+  GstTypeFindIndex *index;
+  GList *l;
+
+  index = g_slice_new0 (GstTypeFindIndex);
+  index->cookie = cookie;
+  index->factories = gst_type_find_factory_get_list ();
+  index->indexed = g_hash_table_new (NULL, NULL);
+  index->tries = g_array_new (FALSE, FALSE, sizeof (GstTypeFindMagicTrie));
+
+  for (l = index->factories; l; l = l->next) {
+    GstTypeFindFactory *factory = l->data;
+    gchar **magic;
+
+    if (factory->magic == NULL)
+      continue;
+
+    for (magic = factory->magic; *magic; magic++) {
+      guint64 offset;
+      guint8 *bytes;
+      gsize size;
+
+      /* the registry may hold broken strings, the factory is then always
+       * tried */
+      if (!_priv_gst_type_find_magic_parse (*magic, &offset, &bytes, &size)) {
+        GST_WARNING_OBJECT (factory, "invalid magic '%s'", *magic);
+        continue;
+      }
+      gst_type_find_index_add_magic (index, factory, offset, bytes, size);
+      g_hash_table_add (index->indexed, factory);
+      g_free (bytes);
+    }
+  }
+
+  GST_DEBUG ("indexed %u of %u typefind factories at %u offsets",
+      g_hash_table_size (index->indexed), g_list_length (index->factories),
+      index->tries->len);
+
+  return index;
+}
+
+/* adds the factories of @node and everything below it */
+static void
+gst_type_find_index_add_all (GstTypeFindMagicNode * node, GHashTable * matched)
+{
+  for (; node; node = node->next) {
+    GSList *walk;
+
+    for (walk = node->factories; walk; walk = walk->next)
+      g_hash_table_add (matched, walk->data);
+    gst_type_find_index_add_all (node->child, matched);
+  }
+}
+
+static void
+gst_type_find_index_match (GstTypeFindMagicTrie * trie, const guint8 * data,
+    gsize size, GHashTable * matched)
+{
+  GstTypeFindMagicNode *node = trie->root;
+  guint64 pos = trie->offset;
+
+  while (node) {
+    GstTypeFindMagicNode *child;
+    GSList *walk;
+
+    for (walk = node->factories; walk; walk = walk->next)
+      g_hash_table_add (matched, walk->data);
+
+    /* the data ends before the sequence does, so it can't be ruled out */
+    if (pos >= size) {
+      gst_type_find_index_add_all (node->child, matched);
+      break;
+    }
+
+    for (child = node->child; child; child = child->next) {
+      if (child->byte == data[pos])
+        break;
+    }
+    node = child;
+    pos++;
+  }
+}
+
+static gboolean
+gst_type_find_factory_has_extension (GstTypeFindFactory * factory,
+    const gchar * extension)
+{
+  gchar **ext;
+
+  if (factory->extensions == NULL)
+    return FALSE;
+
+  for (ext = factory->extensions; *ext; ext++) {
+    if (strcmp (*ext, extension) == 0)
+      return TRUE;
+  }
+  return FALSE;
+}
+
+/**
+ * gst_type_find_factory_get_list_for_data:
+ * @data: (array length=size) (allow-none): the first bytes of the stream
+ * @size: the size of @data
+ * @extension: (allow-none): the extension of the stream, or %NULL
+ *
+ * Gets the typefind factories that can possibly identify a stream starting
+ * with @data. Factories that declared magic sequences are left out when
+ * @data contains none of them, all other factories are returned. The
+ * factories for @extension are always returned and come first, then the
+ * others sorted like in gst_type_find_factory_get_list().
+ *
+ * The magic sequences of all factories are kept in an index that is only
+ * rebuilt when the registry changes, so this is considerably cheaper than
+ * calling every typefind function. You must free the list using
+ * gst_plugin_feature_list_free().
+ *
+ * Free-function: gst_plugin_feature_list_free
+ *
+ * Returns: (transfer full) (element-type Gst.TypeFindFactory): the list of
+ *     candidate #GstTypeFindFactory.
+ *
+ * Since: 1.16
+ */
+GList *
+gst_type_find_factory_get_list_for_data (const guint8 * data, gsize size,
+    const gchar * extension)
+{
+  GstTypeFindIndex *index;
+  GHashTable *matched;
+  GList *l, *head = NULL, *tail = NULL;
+  guint32 cookie;
+  guint i;
+
+  g_return_val_if_fail (data != NULL || size == 0, NULL);
+
+  cookie = gst_registry_get_feature_list_cookie (gst_registry_get ());
+
+  g_mutex_lock (&index_lock);
+  if (type_find_index == NULL || type_find_index->cookie != cookie) {
+    if (type_find_index)
+      gst_type_find_index_free (type_find_index);
+    type_find_index = gst_type_find_index_new (cookie);
+  }
+  index = type_find_index;
+
+  matched = g_hash_table_new (NULL, NULL);
+  for (i = 0; i < index->tries->len; i++)
+    gst_type_find_index_match (&g_array_index (index->tries,
+            GstTypeFindMagicTrie, i), data, size, matched);
+
+  for (l = index->factories; l; l = l->next) {
+    GstTypeFindFactory *factory = l->data;
+
+    if (extension && gst_type_find_factory_has_extension (factory, extension))
+      head = g_list_prepend (head, gst_object_ref (factory));
+    else if (!g_hash_table_contains (index->indexed, factory) ||
+        g_hash_table_contains (matched, factory))
+      tail = g_list_prepend (tail, gst_object_ref (factory));
+  }
+  g_mutex_unlock (&index_lock);
+
+  g_hash_table_unref (matched);
+
+  return g_list_concat (g_list_reverse (head), g_list_reverse (tail));
+}
+
+void
+_priv_gst_type_find_factory_cleanup (void)
+{
+  g_mutex_lock (&index_lock);
+  if (type_find_index) {
+    gst_type_find_index_free (type_find_index);
+    type_find_index = NULL;
+  }
+  g_mutex_unlock (&index_lock);
+}
+
 /**
  * gst_type_find_factory_get_caps:
  * @factory: A #GstTypeFindFactory
@@ -189,6 +529,27 @@ gst_type_find_factory_get_extensions (GstTypeFindFactory * factory)
   return (const gchar * const *) factory->extensions;
 }
 
+/**
+ * gst_type_find_factory_get_magic:
+ * @factory: A #GstTypeFindFactory
+ *
+ * Gets the magic sequences declared by a #GstTypeFindFactory, see
+ * gst_type_find_register_with_magic(). This function may return %NULL to
+ * indicate a 0-length list.
+ *
+ * Returns: (transfer none) (array zero-terminated=1) (element-type utf8) (nullable):
+ *     a %NULL-terminated array of magic sequences of this factory
+ *
+ * Since: 1.16
+ */
+const gchar *const *
+gst_type_find_factory_get_magic (GstTypeFindFactory * factory)
+{
+  g_return_val_if_fail (GST_IS_TYPE_FIND_FACTORY (factory), NULL);
+
+  return (const gchar * const *) factory->magic;
+}
+
 /**
  * gst_type_find_factory_call_function:
  * @factory: A #GstTypeFindFactory
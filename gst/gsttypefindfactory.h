@@ -52,9 +52,17 @@ GType           gst_type_find_factory_get_type          (void);
 GST_API
 GList *         gst_type_find_factory_get_list          (void);
 
+GST_API
+GList *         gst_type_find_factory_get_list_for_data (const guint8 *data,
+                                                         gsize size,
+                                                         const gchar *extension);
+
 GST_API
 const gchar * const * gst_type_find_factory_get_extensions (GstTypeFindFactory *factory);
 
+GST_API
+const gchar * const * gst_type_find_factory_get_magic   (GstTypeFindFactory *factory);
+
 GST_API
 GstCaps *       gst_type_find_factory_get_caps          (GstTypeFindFactory *factory);
 
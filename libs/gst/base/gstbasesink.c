@@ -154,6 +154,9 @@ GST_DEBUG_CATEGORY_STATIC (gst_base_sink_debug);
 
 #define GST_FLOW_STEP GST_FLOW_CUSTOM_ERROR
 
+/* log2 buckets of the sync error histogram */
+#define SYNC_HISTOGRAM_SIZE 64
+
 typedef struct
 {
   gboolean valid;               /* if this info is valid */
@@ -220,11 +223,14 @@ struct _GstBaseSinkPrivate
   /* when we are prerolled and able to report latency */
   gboolean have_latency;
 
-  /* the last buffer we prerolled or rendered. Useful for making snapshots */
+  /* the last buffer or buffer list we prerolled or rendered. Useful for
+   * making snapshots. The streaming thread swaps it without taking a lock
+   * as long as the caps don't change, everybody else only touches it with
+   * the OBJECT_LOCK. last_caps are only changed with the OBJECT_LOCK, along
+   * with the object. */
   gint enable_last_sample;      /* atomic */
-  GstBuffer *last_buffer;
+  GstMiniObject *last_object;   /* ATOMIC */
   GstCaps *last_caps;
-  GstBufferList *last_buffer_list;
 
   /* negotiated caps */
   GstCaps *caps;
@@ -257,6 +263,23 @@ struct _GstBaseSinkPrivate
   GstClockTime rc_next;
   gsize rc_accumulated;
 
+  /* for syncing buffer lists once */
+  GstClockTime max_list_span;
+
+  /* for busy-polling the clock before the sync time */
+  GstClockTime spin_time;
+  guint spin_budget;
+  GstClockTime spin_window_start;
+  GstClockTime spin_window_used;
+
+  /* sync precision, written by the streaming thread only */
+  guint64 sync_count;
+  GstClockTime sync_error_sum;
+  GstClockTime sync_error_max;
+  GstClockTime spin_total;
+  guint64 spin_skipped;
+  gint sync_error_histogram[SYNC_HISTOGRAM_SIZE];       /* ATOMIC */
+
   gboolean drop_out_of_segment;
 
   gboolean reset_stime;
@@ -288,6 +311,9 @@ struct _GstBaseSinkPrivate
 #define DEFAULT_ENABLE_LAST_SAMPLE  TRUE
 #define DEFAULT_THROTTLE_TIME       0
 #define DEFAULT_MAX_BITRATE         0
+#define DEFAULT_MAX_LIST_SPAN       0
+#define DEFAULT_SPIN_TIME           0
+#define DEFAULT_SPIN_BUDGET         10
 #define DEFAULT_DROP_OUT_OF_SEGMENT TRUE
 
 enum
@@ -304,6 +330,10 @@ enum
   PROP_RENDER_DELAY,
   PROP_THROTTLE_TIME,
   PROP_MAX_BITRATE,
+  PROP_MAX_LIST_SPAN,
+  PROP_SPIN_TIME,
+  PROP_SPIN_BUDGET,
+  PROP_SYNC_STATS,
   PROP_LAST
 };
 
@@ -538,6 +568,71 @@ gst_base_sink_class_init (GstBaseSinkClass * klass)
           "The maximum bits per second to render (0 = disabled)", 0,
           G_MAXUINT64, DEFAULT_MAX_BITRATE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstBaseSink:max-list-span:
+   *
+   * Sync a buffer list on the clock once, on its first buffer, and render it
+   * with a single call, as long as the timestamps of its buffers are at most
+   * this far apart. Longer lists are split in parts that each stay within
+   * this time. Subclasses without #GstBaseSinkClass.render_list() get each
+   * buffer of a part rendered right after the other.
+   *
+   * With the default of 0, lists are synced once only when the subclass
+   * implements #GstBaseSinkClass.render_list(), however far apart their
+   * timestamps are, and every buffer is synced otherwise.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_LIST_SPAN,
+      g_param_spec_uint64 ("max-list-span", "Max list span",
+          "The maximum time between the buffers of a list that is synced "
+          "once (0 = disabled)", 0, G_MAXUINT64, DEFAULT_MAX_LIST_SPAN,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstBaseSink:spin-time:
+   *
+   * Wait on the clock until this long before the sync time and busy-poll the
+   * clock for the rest of the time, instead of relying on the wakeup of the
+   * scheduler. This trades CPU time for precision and only works with
+   * the #GstSystemClock itself, other clocks are waited on as usual.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_SPIN_TIME,
+      g_param_spec_uint64 ("spin-time", "Spin time",
+          "The time before the sync time to busy-poll the clock "
+          "(0 = disabled)", 0, G_MAXUINT64, DEFAULT_SPIN_TIME,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstBaseSink:spin-budget:
+   *
+   * The maximum percentage of every second the sink spends busy-polling the
+   * clock with #GstBaseSink:spin-time. When the budget is used up, the sink
+   * waits on the clock only until the next second starts.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_SPIN_BUDGET,
+      g_param_spec_uint ("spin-budget", "Spin budget",
+          "The maximum percentage of time to spend busy-polling the clock",
+          1, 100, DEFAULT_SPIN_BUDGET,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstBaseSink:sync-stats:
+   *
+   * Statistics about how precisely the sink synced on the clock: the number
+   * of syncs, the average, maximum, median and 99th percentile error, the
+   * total time spent busy-polling and the number of times the spin budget
+   * was used up. The "error-histogram" array counts the syncs in log2
+   * buckets, bucket n counting errors between 2^(n-1) and 2^n - 1
+   * nanoseconds.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_SYNC_STATS,
+      g_param_spec_boxed ("sync-stats", "Sync statistics",
+          "Statistics about the clock sync precision", GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_base_sink_change_state);
@@ -669,6 +764,9 @@ gst_base_sink_init (GstBaseSink * basesink, gpointer g_class)
   g_atomic_int_set (&priv->enable_last_sample, DEFAULT_ENABLE_LAST_SAMPLE);
   priv->throttle_time = DEFAULT_THROTTLE_TIME;
   priv->max_bitrate = DEFAULT_MAX_BITRATE;
+  priv->max_list_span = DEFAULT_MAX_LIST_SPAN;
+  priv->spin_time = DEFAULT_SPIN_TIME;
+  priv->spin_budget = DEFAULT_SPIN_BUDGET;
 
   priv->drop_out_of_segment = DEFAULT_DROP_OUT_OF_SEGMENT;
   priv->reset_stime = FALSE;
@@ -718,8 +816,9 @@ gst_base_sink_set_sync (GstBaseSink * sink, gboolean sync)
 {
   g_return_if_fail (GST_IS_BASE_SINK (sink));
 
+  /* read without the lock in the streaming thread */
   GST_OBJECT_LOCK (sink);
-  sink->sync = sync;
+  g_atomic_int_set (&sink->sync, sync);
   GST_OBJECT_UNLOCK (sink);
 }
 
@@ -735,15 +834,9 @@ gst_base_sink_set_sync (GstBaseSink * sink, gboolean sync)
 gboolean
 gst_base_sink_get_sync (GstBaseSink * sink)
 {
-  gboolean res;
-
   g_return_val_if_fail (GST_IS_BASE_SINK (sink), FALSE);
 
-  GST_OBJECT_LOCK (sink);
-  res = sink->sync;
-  GST_OBJECT_UNLOCK (sink);
-
-  return res;
+  return g_atomic_int_get (&sink->sync);
 }
 
 /**
@@ -960,6 +1053,94 @@ gst_base_sink_get_ts_offset (GstBaseSink * sink)
   return res;
 }
 
+/* replace the last object with @obj, taking ownership of @obj and returning
+ * the previous one */
+static GstMiniObject *
+gst_base_sink_swap_last_object (GstBaseSink * sink, GstMiniObject * obj)
+{
+  GstMiniObject *old;
+
+  do {
+    old = g_atomic_pointer_get (&sink->priv->last_object);
+  } while (!g_atomic_pointer_compare_and_exchange (&sink->priv->last_object,
+          old, obj));
+
+  return old;
+}
+
+/* with OBJECT_LOCK. Get a ref to the last object. The object is taken out
+ * while it is reffed so that the streaming thread can't unref it in the
+ * meantime, the lock keeps other readers out. */
+static GstMiniObject *
+gst_base_sink_get_last_object (GstBaseSink * sink)
+{
+  GstMiniObject *obj;
+
+  if (!(obj = gst_base_sink_swap_last_object (sink, NULL)))
+    return NULL;
+
+  gst_mini_object_ref (obj);
+  /* drop it when a newer object was set in the meantime */
+  if (!g_atomic_pointer_compare_and_exchange (&sink->priv->last_object, NULL,
+          obj))
+    gst_mini_object_unref (obj);
+
+  return obj;
+}
+
+/* set @obj, a buffer or a buffer list, as the last object without taking the
+ * OBJECT_LOCK, except when the caps changed */
+static void
+gst_base_sink_set_last_object (GstBaseSink * sink, GstMiniObject * obj)
+{
+  GstBaseSinkPrivate *priv = sink->priv;
+  GstMiniObject *old;
+
+  if (!g_atomic_int_get (&priv->enable_last_sample))
+    return;
+
+  if (G_UNLIKELY (g_atomic_pointer_get (&priv->last_object) == obj))
+    return;
+
+  GST_LOG_OBJECT (sink, "setting last object to %p", obj);
+
+  /* last_caps is only ever changed by the streaming thread or cleared, so we
+   * can check without the lock. When they change, the caps and the object
+   * are replaced together with the lock so that readers, which pair them
+   * with the lock, never see the new object with the old caps or the other
+   * way around */
+  if (G_UNLIKELY (priv->last_caps != priv->caps)) {
+    GST_OBJECT_LOCK (sink);
+    gst_caps_replace (&priv->last_caps, priv->caps);
+    old = gst_base_sink_swap_last_object (sink, gst_mini_object_ref (obj));
+    GST_OBJECT_UNLOCK (sink);
+  } else {
+    old = gst_base_sink_swap_last_object (sink, gst_mini_object_ref (obj));
+  }
+
+  if (old)
+    gst_mini_object_unref (old);
+}
+
+static void
+gst_base_sink_clear_last_object (GstBaseSink * sink)
+{
+  GstMiniObject *old;
+
+  /* take the lock so that a concurrent reader can't put the object back */
+  GST_OBJECT_LOCK (sink);
+  old = gst_base_sink_swap_last_object (sink, NULL);
+  gst_caps_replace (&sink->priv->last_caps, NULL);
+  GST_OBJECT_UNLOCK (sink);
+
+  /* avoid unreffing with the lock because cleanup code might want to take the
+   * lock too */
+  if (old) {
+    GST_DEBUG_OBJECT (sink, "cleared last object %p", old);
+    gst_mini_object_unref (old);
+  }
+}
+
 /**
  * gst_base_sink_get_last_sample:
  * @sink: the sink
@@ -978,105 +1159,30 @@ gst_base_sink_get_ts_offset (GstBaseSink * sink)
 GstSample *
 gst_base_sink_get_last_sample (GstBaseSink * sink)
 {
+  GstMiniObject *obj;
   GstSample *res = NULL;
 
   g_return_val_if_fail (GST_IS_BASE_SINK (sink), NULL);
 
   GST_OBJECT_LOCK (sink);
-  if (sink->priv->last_buffer_list) {
-    GstBuffer *first_buffer = NULL;
+  obj = gst_base_sink_get_last_object (sink);
+  if (obj && GST_IS_BUFFER_LIST (obj)) {
+    GstBufferList *list = GST_BUFFER_LIST_CAST (obj);
 
     /* Set the first buffer in the list to last sample's buffer */
-    first_buffer = gst_buffer_list_get (sink->priv->last_buffer_list, 0);
-    res =
-        gst_sample_new (first_buffer, sink->priv->last_caps, &sink->segment,
-        NULL);
-    gst_sample_set_buffer_list (res, sink->priv->last_buffer_list);
-  } else if (sink->priv->last_buffer) {
-    res = gst_sample_new (sink->priv->last_buffer,
+    res = gst_sample_new (gst_buffer_list_get (list, 0),
         sink->priv->last_caps, &sink->segment, NULL);
+    gst_sample_set_buffer_list (res, list);
+  } else if (obj) {
+    res = gst_sample_new (GST_BUFFER_CAST (obj), sink->priv->last_caps,
+        &sink->segment, NULL);
   }
   GST_OBJECT_UNLOCK (sink);
 
-  return res;
-}
-
-/* with OBJECT_LOCK */
-static void
-gst_base_sink_set_last_buffer_unlocked (GstBaseSink * sink, GstBuffer * buffer)
-{
-  GstBuffer *old;
-
-  old = sink->priv->last_buffer;
-  if (G_LIKELY (old != buffer)) {
-    GST_DEBUG_OBJECT (sink, "setting last buffer to %p", buffer);
-    if (G_LIKELY (buffer))
-      gst_buffer_ref (buffer);
-    sink->priv->last_buffer = buffer;
-    if (buffer)
-      /* copy over the caps */
-      gst_caps_replace (&sink->priv->last_caps, sink->priv->caps);
-    else
-      gst_caps_replace (&sink->priv->last_caps, NULL);
-  } else {
-    old = NULL;
-  }
-  /* avoid unreffing with the lock because cleanup code might want to take the
-   * lock too */
-  if (G_LIKELY (old)) {
-    GST_OBJECT_UNLOCK (sink);
-    gst_buffer_unref (old);
-    GST_OBJECT_LOCK (sink);
-  }
-}
-
-/* with OBJECT_LOCK */
-static void
-gst_base_sink_set_last_buffer_list_unlocked (GstBaseSink * sink,
-    GstBufferList * buffer_list)
-{
-  GstBufferList *old;
-
-  old = sink->priv->last_buffer_list;
-  if (G_LIKELY (old != buffer_list)) {
-    GST_DEBUG_OBJECT (sink, "setting last buffer list to %p", buffer_list);
-    if (G_LIKELY (buffer_list))
-      gst_mini_object_ref (GST_MINI_OBJECT_CAST (buffer_list));
-    sink->priv->last_buffer_list = buffer_list;
-  } else {
-    old = NULL;
-  }
-
-  /* avoid unreffing with the lock because cleanup code might want to take the
-   * lock too */
-  if (G_LIKELY (old)) {
-    GST_OBJECT_UNLOCK (sink);
-    gst_mini_object_unref (GST_MINI_OBJECT_CAST (old));
-    GST_OBJECT_LOCK (sink);
-  }
-}
-
-static void
-gst_base_sink_set_last_buffer (GstBaseSink * sink, GstBuffer * buffer)
-{
-  if (!g_atomic_int_get (&sink->priv->enable_last_sample))
-    return;
-
-  GST_OBJECT_LOCK (sink);
-  gst_base_sink_set_last_buffer_unlocked (sink, buffer);
-  GST_OBJECT_UNLOCK (sink);
-}
-
-static void
-gst_base_sink_set_last_buffer_list (GstBaseSink * sink,
-    GstBufferList * buffer_list)
-{
-  if (!g_atomic_int_get (&sink->priv->enable_last_sample))
-    return;
+  if (obj)
+    gst_mini_object_unref (obj);
 
-  GST_OBJECT_LOCK (sink);
-  gst_base_sink_set_last_buffer_list_unlocked (sink, buffer_list);
-  GST_OBJECT_UNLOCK (sink);
+  return res;
 }
 
 /**
@@ -1094,12 +1200,8 @@ gst_base_sink_set_last_sample_enabled (GstBaseSink * sink, gboolean enabled)
 
   /* Only take lock if we change the value */
   if (g_atomic_int_compare_and_exchange (&sink->priv->enable_last_sample,
-          !enabled, enabled) && !enabled) {
-    GST_OBJECT_LOCK (sink);
-    gst_base_sink_set_last_buffer_unlocked (sink, NULL);
-    gst_base_sink_set_last_buffer_list_unlocked (sink, NULL);
-    GST_OBJECT_UNLOCK (sink);
-  }
+          !enabled, enabled) && !enabled)
+    gst_base_sink_clear_last_object (sink);
 }
 
 /**
@@ -1429,6 +1531,254 @@ gst_base_sink_get_max_bitrate (GstBaseSink * sink)
   return res;
 }
 
+/**
+ * gst_base_sink_set_max_list_span:
+ * @sink: a #GstBaseSink
+ * @max_span: the maximum time between the buffers of a list, 0 to disable
+ *
+ * Set the maximum time between the first and the last buffer of a buffer
+ * list that @sink syncs once and renders with a single call.
+ *
+ * Since: 1.16
+ */
+void
+gst_base_sink_set_max_list_span (GstBaseSink * sink, GstClockTime max_span)
+{
+  g_return_if_fail (GST_IS_BASE_SINK (sink));
+
+  GST_OBJECT_LOCK (sink);
+  sink->priv->max_list_span = max_span;
+  GST_LOG_OBJECT (sink, "set max_list_span to %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (max_span));
+  GST_OBJECT_UNLOCK (sink);
+}
+
+/**
+ * gst_base_sink_get_max_list_span:
+ * @sink: a #GstBaseSink
+ *
+ * Get the maximum time between the first and the last buffer of a buffer
+ * list that @sink syncs once.
+ *
+ * Returns: the maximum time between the buffers of a list, 0 when disabled.
+ *
+ * Since: 1.16
+ */
+GstClockTime
+gst_base_sink_get_max_list_span (GstBaseSink * sink)
+{
+  GstClockTime res;
+
+  g_return_val_if_fail (GST_IS_BASE_SINK (sink), 0);
+
+  GST_OBJECT_LOCK (sink);
+  res = sink->priv->max_list_span;
+  GST_OBJECT_UNLOCK (sink);
+
+  return res;
+}
+
+/**
+ * gst_base_sink_set_spin_time:
+ * @sink: a #GstBaseSink
+ * @spin_time: the time to busy-poll the clock, 0 to disable
+ *
+ * Make @sink wait on the clock until @spin_time before the sync time and
+ * busy-poll the clock from there on.
+ *
+ * Since: 1.16
+ */
+void
+gst_base_sink_set_spin_time (GstBaseSink * sink, GstClockTime spin_time)
+{
+  g_return_if_fail (GST_IS_BASE_SINK (sink));
+
+  GST_OBJECT_LOCK (sink);
+  sink->priv->spin_time = spin_time;
+  GST_LOG_OBJECT (sink, "set spin_time to %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (spin_time));
+  GST_OBJECT_UNLOCK (sink);
+}
+
+/**
+ * gst_base_sink_get_spin_time:
+ * @sink: a #GstBaseSink
+ *
+ * Get the time before the sync time that @sink busy-polls the clock.
+ *
+ * Returns: the time to busy-poll the clock, 0 when disabled.
+ *
+ * Since: 1.16
+ */
+GstClockTime
+gst_base_sink_get_spin_time (GstBaseSink * sink)
+{
+  GstClockTime res;
+
+  g_return_val_if_fail (GST_IS_BASE_SINK (sink), 0);
+
+  GST_OBJECT_LOCK (sink);
+  res = sink->priv->spin_time;
+  GST_OBJECT_UNLOCK (sink);
+
+  return res;
+}
+
+/**
+ * gst_base_sink_set_spin_budget:
+ * @sink: a #GstBaseSink
+ * @percent: the maximum percentage of time to busy-poll, between 1 and 100
+ *
+ * Set the maximum percentage of every second @sink spends busy-polling the
+ * clock.
+ *
+ * Since: 1.16
+ */
+void
+gst_base_sink_set_spin_budget (GstBaseSink * sink, guint percent)
+{
+  g_return_if_fail (GST_IS_BASE_SINK (sink));
+  g_return_if_fail (percent > 0 && percent <= 100);
+
+  GST_OBJECT_LOCK (sink);
+  sink->priv->spin_budget = percent;
+  GST_OBJECT_UNLOCK (sink);
+}
+
+/**
+ * gst_base_sink_get_spin_budget:
+ * @sink: a #GstBaseSink
+ *
+ * Get the maximum percentage of every second @sink spends busy-polling the
+ * clock.
+ *
+ * Returns: the maximum percentage of time to busy-poll.
+ *
+ * Since: 1.16
+ */
+guint
+gst_base_sink_get_spin_budget (GstBaseSink * sink)
+{
+  guint res;
+
+  g_return_val_if_fail (GST_IS_BASE_SINK (sink), 0);
+
+  GST_OBJECT_LOCK (sink);
+  res = sink->priv->spin_budget;
+  GST_OBJECT_UNLOCK (sink);
+
+  return res;
+}
+
+/* index of the log2 bucket for @value nanoseconds */
+static inline guint
+gst_base_sink_histogram_bucket (guint64 value)
+{
+  guint bucket;
+
+  if (value >> 32)
+    bucket = 32 + g_bit_storage ((gulong) (value >> 32));
+  else if (value)
+    bucket = g_bit_storage ((gulong) value);
+  else
+    bucket = 0;
+
+  return MIN (bucket, SYNC_HISTOGRAM_SIZE - 1);
+}
+
+/* upper bound of the bucket that contains @percent percent of the values */
+static GstClockTime
+gst_base_sink_histogram_percentile (gint * histogram, guint64 count,
+    guint percent)
+{
+  guint64 target, sum = 0;
+  guint i;
+
+  if (count == 0)
+    return GST_CLOCK_TIME_NONE;
+
+  target = (count * percent + 99) / 100;
+  for (i = 0; i < SYNC_HISTOGRAM_SIZE - 1; i++) {
+    sum += g_atomic_int_get (&histogram[i]);
+    if (sum >= target)
+      break;
+  }
+
+  return (G_GUINT64_CONSTANT (1) << i) - 1;
+}
+
+static void
+gst_base_sink_reset_sync_stats (GstBaseSink * sink)
+{
+  GstBaseSinkPrivate *priv = sink->priv;
+  gint i;
+
+  priv->spin_window_start = GST_CLOCK_TIME_NONE;
+  priv->spin_window_used = 0;
+  priv->sync_count = 0;
+  priv->sync_error_sum = 0;
+  priv->sync_error_max = 0;
+  priv->spin_total = 0;
+  priv->spin_skipped = 0;
+  for (i = 0; i < SYNC_HISTOGRAM_SIZE; i++)
+    g_atomic_int_set (&priv->sync_error_histogram[i], 0);
+}
+
+/**
+ * gst_base_sink_get_sync_stats:
+ * @sink: a #GstBaseSink
+ *
+ * Get statistics about how precisely @sink synced on the clock since it last
+ * went to PAUSED. See the #GstBaseSink:sync-stats property for the fields.
+ *
+ * The counters are updated by the streaming thread without a lock, so they
+ * can be slightly out of sync with each other while data is flowing.
+ *
+ * Returns: (transfer full): the sync statistics in a #GstStructure
+ *
+ * Since: 1.16
+ */
+GstStructure *
+gst_base_sink_get_sync_stats (GstBaseSink * sink)
+{
+  GstBaseSinkPrivate *priv;
+  GValue array = G_VALUE_INIT;
+  GValue value = G_VALUE_INIT;
+  GstStructure *s;
+  guint64 count;
+  gint i;
+
+  g_return_val_if_fail (GST_IS_BASE_SINK (sink), NULL);
+
+  priv = sink->priv;
+  count = priv->sync_count;
+
+  s = gst_structure_new ("application/x-basesink-sync-stats",
+      "syncs", G_TYPE_UINT64, count,
+      "error-average", G_TYPE_UINT64,
+      count > 0 ? priv->sync_error_sum / count : GST_CLOCK_TIME_NONE,
+      "error-max", G_TYPE_UINT64,
+      count > 0 ? priv->sync_error_max : GST_CLOCK_TIME_NONE,
+      "error-p50", G_TYPE_UINT64,
+      gst_base_sink_histogram_percentile (priv->sync_error_histogram, count,
+          50),
+      "error-p99", G_TYPE_UINT64,
+      gst_base_sink_histogram_percentile (priv->sync_error_histogram, count,
+          99),
+      "spin-time", G_TYPE_UINT64, priv->spin_total,
+      "spin-skipped", G_TYPE_UINT64, priv->spin_skipped, NULL);
+
+  g_value_init (&array, GST_TYPE_ARRAY);
+  for (i = 0; i < SYNC_HISTOGRAM_SIZE; i++) {
+    g_value_init (&value, G_TYPE_INT);
+    g_value_set_int (&value, g_atomic_int_get (&priv->sync_error_histogram[i]));
+    gst_value_array_append_and_take_value (&array, &value);
+  }
+  gst_structure_take_value (s, "error-histogram", &array);
+
+  return s;
+}
+
 static void
 gst_base_sink_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
@@ -1466,6 +1816,15 @@ gst_base_sink_set_property (GObject * object, guint prop_id,
     case PROP_MAX_BITRATE:
       gst_base_sink_set_max_bitrate (sink, g_value_get_uint64 (value));
       break;
+    case PROP_MAX_LIST_SPAN:
+      gst_base_sink_set_max_list_span (sink, g_value_get_uint64 (value));
+      break;
+    case PROP_SPIN_TIME:
+      gst_base_sink_set_spin_time (sink, g_value_get_uint64 (value));
+      break;
+    case PROP_SPIN_BUDGET:
+      gst_base_sink_set_spin_budget (sink, g_value_get_uint (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1512,6 +1871,18 @@ gst_base_sink_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_MAX_BITRATE:
       g_value_set_uint64 (value, gst_base_sink_get_max_bitrate (sink));
       break;
+    case PROP_MAX_LIST_SPAN:
+      g_value_set_uint64 (value, gst_base_sink_get_max_list_span (sink));
+      break;
+    case PROP_SPIN_TIME:
+      g_value_set_uint64 (value, gst_base_sink_get_spin_time (sink));
+      break;
+    case PROP_SPIN_BUDGET:
+      g_value_set_uint (value, gst_base_sink_get_spin_budget (sink));
+      break;
+    case PROP_SYNC_STATS:
+      g_value_take_boxed (value, gst_base_sink_get_sync_stats (sink));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -2147,6 +2518,85 @@ gst_base_sink_adjust_time (GstBaseSink * basesink, GstClockTime time)
   return time;
 }
 
+/* with OBJECT_LOCK. Get the time before @time to start busy-polling, 0 when
+ * the sink should simply wait on the clock. Never more than what is left of
+ * the spin budget. */
+static GstClockTime
+gst_base_sink_get_spin_start (GstBaseSink * sink, GstClock * clock,
+    GstClockTime time)
+{
+  GstBaseSinkPrivate *priv = sink->priv;
+  GstClockTime now, budget;
+
+  /* the spinning is timed with the monotonic system time, which only runs
+   * at the rate of the system clock itself. Subclasses, like audio, net or
+   * test clocks, are driven by something else. */
+  if (G_OBJECT_TYPE (clock) != GST_TYPE_SYSTEM_CLOCK
+      || time <= priv->spin_time)
+    return 0;
+
+  now = gst_util_get_timestamp ();
+  if (!GST_CLOCK_TIME_IS_VALID (priv->spin_window_start)
+      || now - priv->spin_window_start >= GST_SECOND) {
+    priv->spin_window_start = now;
+    priv->spin_window_used = 0;
+  }
+  budget = gst_util_uint64_scale_int (GST_SECOND, priv->spin_budget, 100);
+  if (priv->spin_window_used >= budget) {
+    GST_LOG_OBJECT (sink, "spin budget used up, not spinning");
+    priv->spin_skipped++;
+    return 0;
+  }
+
+  return MIN (priv->spin_time, budget - priv->spin_window_used);
+}
+
+/* busy-wait until @clock reaches @time, for at most @max_spin, or until @id
+ * is unscheduled. The clock is read once, the rest is timed with the
+ * monotonic system time, which is cheaper to read. */
+static GstClockReturn
+gst_base_sink_spin (GstBaseSink * sink, GstClock * clock, GstClockID id,
+    GstClockTime time, GstClockTime max_spin)
+{
+  GstBaseSinkPrivate *priv = sink->priv;
+  GstClockReturn ret = GST_CLOCK_OK;
+  GstClockTime start, now, end, spent;
+
+  now = gst_clock_get_time (clock);
+  if (now >= time)
+    return GST_CLOCK_OK;
+
+  start = gst_util_get_timestamp ();
+  end = start + MIN (time - now, max_spin);
+  while (gst_util_get_timestamp () < end) {
+    /* unlock() unschedules the entry even when it is not waiting anymore */
+    if (G_UNLIKELY (GST_CLOCK_ENTRY_STATUS ((GstClockEntry *) id) ==
+            GST_CLOCK_UNSCHEDULED)) {
+      ret = GST_CLOCK_UNSCHEDULED;
+      break;
+    }
+  }
+  spent = gst_util_get_timestamp () - start;
+
+  priv->spin_window_used += spent;
+  priv->spin_total += spent;
+
+  return ret;
+}
+
+static void
+gst_base_sink_record_sync_error (GstBaseSink * sink, GstClockTime error)
+{
+  GstBaseSinkPrivate *priv = sink->priv;
+
+  priv->sync_count++;
+  priv->sync_error_sum += error;
+  if (error > priv->sync_error_max)
+    priv->sync_error_max = error;
+  g_atomic_int_inc (&priv->sync_error_histogram[gst_base_sink_histogram_bucket
+          (error)]);
+}
+
 /**
  * gst_base_sink_wait_clock:
  * @sink: the sink
@@ -2177,16 +2627,20 @@ gst_base_sink_wait_clock (GstBaseSink * sink, GstClockTime time,
 {
   GstClockReturn ret;
   GstClock *clock;
-  GstClockTime base_time;
+  GstClockTime base_time, spin_time = 0, now;
+  GstClockTimeDiff wait_jitter;
+  gboolean spun = FALSE;
   GstBaseSinkPrivate *priv = gst_base_sink_get_instance_private (sink);
 
   if (G_UNLIKELY (!GST_CLOCK_TIME_IS_VALID (time)))
     goto invalid_time;
 
-  GST_OBJECT_LOCK (sink);
-  if (G_UNLIKELY (!sink->sync))
+  /* don't take the lock when not syncing */
+  if (G_UNLIKELY (!g_atomic_int_get (&sink->sync)))
     goto no_sync;
 
+  GST_OBJECT_LOCK (sink);
+
   if (G_UNLIKELY ((clock = GST_ELEMENT_CLOCK (sink)) == NULL))
     goto no_clock;
 
@@ -2204,6 +2658,10 @@ gst_base_sink_wait_clock (GstBaseSink * sink, GstClockTime time,
   /* add base_time to running_time to get the time against the clock */
   time += base_time;
 
+  /* wait until a bit before the time and busy-poll the clock for the rest */
+  if (G_UNLIKELY (priv->spin_time > 0))
+    spin_time = gst_base_sink_get_spin_start (sink, clock, time);
+
   /* Re-use existing clockid if available */
   /* FIXME: Casting to GstClockEntry only works because the types
    * are the same */
@@ -2211,15 +2669,19 @@ gst_base_sink_wait_clock (GstBaseSink * sink, GstClockTime time,
           && GST_CLOCK_ENTRY_CLOCK ((GstClockEntry *) sink->
               priv->cached_clock_id) == clock)) {
     if (!gst_clock_single_shot_id_reinit (clock, sink->priv->cached_clock_id,
-            time)) {
+            time - spin_time)) {
       gst_clock_id_unref (sink->priv->cached_clock_id);
-      sink->priv->cached_clock_id = gst_clock_new_single_shot_id (clock, time);
+      sink->priv->cached_clock_id =
+          gst_clock_new_single_shot_id (clock, time - spin_time);
     }
   } else {
     if (sink->priv->cached_clock_id != NULL)
       gst_clock_id_unref (sink->priv->cached_clock_id);
-    sink->priv->cached_clock_id = gst_clock_new_single_shot_id (clock, time);
+    sink->priv->cached_clock_id =
+        gst_clock_new_single_shot_id (clock, time - spin_time);
   }
+  /* keep the clock alive to measure the sync error after the wait */
+  gst_object_ref (clock);
   GST_OBJECT_UNLOCK (sink);
 
   /* A blocking wait is performed on the clock. We save the ClockID
@@ -2230,7 +2692,29 @@ gst_base_sink_wait_clock (GstBaseSink * sink, GstClockTime time,
   /* release the preroll lock while waiting */
   GST_BASE_SINK_PREROLL_UNLOCK (sink);
 
-  ret = gst_clock_id_wait (sink->priv->cached_clock_id, jitter);
+  ret = gst_clock_id_wait (sink->priv->cached_clock_id, &wait_jitter);
+
+  if (G_UNLIKELY (spin_time > 0)) {
+    /* make the jitter relative to the requested time again */
+    wait_jitter -= spin_time;
+    if (ret == GST_CLOCK_OK || (ret == GST_CLOCK_EARLY && wait_jitter < 0)) {
+      ret = gst_base_sink_spin (sink, clock, sink->priv->cached_clock_id, time,
+          spin_time);
+      spun = TRUE;
+    }
+  }
+  if (ret == GST_CLOCK_OK) {
+    now = gst_clock_get_time (clock);
+    gst_base_sink_record_sync_error (sink,
+        now > time ? now - time : time - now);
+    /* report the jitter a full wait on the clock would have reported */
+    if (spun)
+      wait_jitter = GST_CLOCK_DIFF (time, now);
+  }
+  gst_object_unref (clock);
+
+  if (jitter)
+    *jitter = wait_jitter;
 
   GST_BASE_SINK_PREROLL_LOCK (sink);
   sink->clock_id = NULL;
@@ -2246,7 +2730,6 @@ invalid_time:
 no_sync:
   {
     GST_DEBUG_OBJECT (sink, "sync disabled");
-    GST_OBJECT_UNLOCK (sink);
     return GST_CLOCK_BADTIME;
   }
 no_clock:
@@ -2343,14 +2826,11 @@ gst_base_sink_do_preroll (GstBaseSink * sink, GstMiniObject * obj)
 
       if (GST_IS_BUFFER_LIST (obj)) {
         buf = gst_buffer_list_get (GST_BUFFER_LIST_CAST (obj), 0);
-        gst_base_sink_set_last_buffer (sink, buf);
-        gst_base_sink_set_last_buffer_list (sink, GST_BUFFER_LIST_CAST (obj));
+        gst_base_sink_set_last_object (sink, obj);
         g_assert (NULL != buf);
       } else if (GST_IS_BUFFER (obj)) {
         buf = GST_BUFFER_CAST (obj);
-        /* For buffer lists do not set last buffer for now */
-        gst_base_sink_set_last_buffer (sink, buf);
-        gst_base_sink_set_last_buffer_list (sink, NULL);
+        gst_base_sink_set_last_object (sink, obj);
       } else {
         buf = NULL;
       }
@@ -3037,8 +3517,7 @@ gst_base_sink_flush_start (GstBaseSink * basesink, GstPad * pad)
     gst_element_set_start_time (GST_ELEMENT_CAST (basesink), 0);
     basesink->priv->have_latency = TRUE;
   }
-  gst_base_sink_set_last_buffer (basesink, NULL);
-  gst_base_sink_set_last_buffer_list (basesink, NULL);
+  gst_base_sink_clear_last_object (basesink);
 
   GST_BASE_SINK_SEAMLESS_LOCK (basesink);
   if (basesink->doing_chainfunc) {
@@ -3547,10 +4026,23 @@ gst_base_sink_chain_unlocked (GstBaseSink * basesink, GstPad * pad,
           goto prepare_failed;
       }
     } else {
+      GstBufferList *buffer_list = GST_BUFFER_LIST_CAST (obj);
+
       if (bclass->prepare_list) {
-        ret = bclass->prepare_list (basesink, GST_BUFFER_LIST_CAST (obj));
+        ret = bclass->prepare_list (basesink, buffer_list);
         if (G_UNLIKELY (ret != GST_FLOW_OK))
           goto prepare_failed;
+      } else if (!bclass->render_list && bclass->prepare) {
+        guint i, len = gst_buffer_list_length (buffer_list);
+
+        /* the list is synced once, but rendered one buffer at a time */
+        for (i = 0; i < len; i++) {
+          GstBuffer *buffer = gst_buffer_list_get (buffer_list, i);
+
+          ret = bclass->prepare (basesink, buffer);
+          if (G_UNLIKELY (ret != GST_FLOW_OK))
+            goto prepare_failed;
+        }
       }
     }
 
@@ -3591,21 +4083,24 @@ again:
   GST_DEBUG_OBJECT (basesink, "rendering object %p", obj);
 
   if (!is_list) {
-    /* For buffer lists do not set last buffer for now. */
-    gst_base_sink_set_last_buffer (basesink, GST_BUFFER_CAST (obj));
-    gst_base_sink_set_last_buffer_list (basesink, NULL);
+    gst_base_sink_set_last_object (basesink, obj);
 
     if (bclass->render)
       ret = bclass->render (basesink, GST_BUFFER_CAST (obj));
   } else {
     GstBufferList *buffer_list = GST_BUFFER_LIST_CAST (obj);
 
-    if (bclass->render_list)
+    if (bclass->render_list) {
       ret = bclass->render_list (basesink, buffer_list);
+    } else if (bclass->render) {
+      guint i, len = gst_buffer_list_length (buffer_list);
 
-    /* Set the first buffer and buffer list to be included in last sample */
-    gst_base_sink_set_last_buffer (basesink, sync_buf);
-    gst_base_sink_set_last_buffer_list (basesink, buffer_list);
+      for (i = 0; i < len && ret == GST_FLOW_OK; i++)
+        ret = bclass->render (basesink, gst_buffer_list_get (buffer_list, i));
+    }
+
+    /* the first buffer and the list are included in the last sample */
+    gst_base_sink_set_last_object (basesink, obj);
   }
 
   if (ret == GST_FLOW_STEP)
@@ -3754,6 +4249,55 @@ gst_base_sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
   return gst_base_sink_chain_main (basesink, pad, buf, FALSE);
 }
 
+/* chain the buffers of @list in parts whose timestamps are at most
+ * @max_span apart, so that each part is synced once */
+static GstFlowReturn
+gst_base_sink_chain_list_spans (GstBaseSink * basesink, GstPad * pad,
+    GstBufferList * list, GstClockTime max_span)
+{
+  GstFlowReturn result = GST_FLOW_OK;
+  GstClockTime first_ts, ts;
+  guint i, j, start, len;
+
+  len = gst_buffer_list_length (list);
+
+  for (start = 0; start < len && result == GST_FLOW_OK; start = i) {
+    first_ts = GST_BUFFER_DTS_OR_PTS (gst_buffer_list_get (list, start));
+
+    for (i = start + 1; i < len; i++) {
+      ts = GST_BUFFER_DTS_OR_PTS (gst_buffer_list_get (list, i));
+
+      if (GST_CLOCK_TIME_IS_VALID (first_ts) && GST_CLOCK_TIME_IS_VALID (ts)
+          && (ts < first_ts || ts - first_ts > max_span))
+        break;
+    }
+
+    if (start == 0 && i == len) {
+      result = gst_base_sink_chain_main (basesink, pad,
+          gst_buffer_list_ref (list), TRUE);
+    } else if (i - start == 1) {
+      result = gst_base_sink_chain_main (basesink, pad,
+          gst_buffer_ref (gst_buffer_list_get (list, start)), FALSE);
+    } else {
+      GstBufferList *part;
+
+      GST_LOG_OBJECT (basesink, "chaining buffers %u to %u of list", start,
+          i - 1);
+
+      part = gst_buffer_list_new_sized (i - start);
+      for (j = start; j < i; j++) {
+        GstBuffer *buffer = gst_buffer_list_get (list, j);
+
+        gst_buffer_list_add (part, gst_buffer_ref (buffer));
+      }
+      result = gst_base_sink_chain_main (basesink, pad, part, TRUE);
+    }
+  }
+  gst_buffer_list_unref (list);
+
+  return result;
+}
+
 static GstFlowReturn
 gst_base_sink_chain_list (GstPad * pad, GstObject * parent,
     GstBufferList * list)
@@ -3761,11 +4305,18 @@ gst_base_sink_chain_list (GstPad * pad, GstObject * parent,
   GstBaseSink *basesink;
   GstBaseSinkClass *bclass;
   GstFlowReturn result;
+  GstClockTime max_span;
 
   basesink = GST_BASE_SINK (parent);
   bclass = GST_BASE_SINK_GET_CLASS (basesink);
 
-  if (G_LIKELY (bclass->render_list)) {
+  GST_OBJECT_LOCK (basesink);
+  max_span = basesink->priv->max_list_span;
+  GST_OBJECT_UNLOCK (basesink);
+
+  if (G_UNLIKELY (max_span > 0)) {
+    result = gst_base_sink_chain_list_spans (basesink, pad, list, max_span);
+  } else if (G_LIKELY (bclass->render_list)) {
     result = gst_base_sink_chain_main (basesink, pad, list, TRUE);
   } else {
     guint i, len;
@@ -4154,8 +4705,7 @@ gst_base_sink_perform_step (GstBaseSink * sink, GstPad * pad, GstEvent * event)
     priv->current_sstop = GST_CLOCK_TIME_NONE;
     priv->eos_rtime = GST_CLOCK_TIME_NONE;
     priv->call_preroll = TRUE;
-    gst_base_sink_set_last_buffer (sink, NULL);
-    gst_base_sink_set_last_buffer_list (sink, NULL);
+    gst_base_sink_clear_last_object (sink);
     gst_base_sink_reset_qos (sink);
 
     if (sink->clock_id) {
@@ -5155,21 +5705,29 @@ default_element_query (GstElement * element, GstQuery * query)
 static void
 gst_base_sink_drain (GstBaseSink * basesink, gboolean release_non_mappable)
 {
-  GstBuffer *old;
-  GstBufferList *old_list;
+  GstMiniObject *old, *copy = NULL;
 
   GST_OBJECT_LOCK (basesink);
-  if ((old = basesink->priv->last_buffer) && !release_non_mappable)
-    basesink->priv->last_buffer = gst_buffer_copy_deep (old);
+  old = gst_base_sink_swap_last_object (basesink, NULL);
+  if (old && !release_non_mappable) {
+    if (GST_IS_BUFFER_LIST (old))
+      copy = GST_MINI_OBJECT_CAST (gst_buffer_list_copy_deep
+          (GST_BUFFER_LIST_CAST (old)));
+    else
+      copy = GST_MINI_OBJECT_CAST (gst_buffer_copy_deep (GST_BUFFER_CAST
+              (old)));
 
-  if ((old_list = basesink->priv->last_buffer_list) && !release_non_mappable)
-    basesink->priv->last_buffer_list = gst_buffer_list_copy_deep (old_list);
+    /* keep the newer object when one was rendered in the meantime */
+    if (g_atomic_pointer_compare_and_exchange (&basesink->priv->last_object,
+            NULL, copy))
+      copy = NULL;
+  }
   GST_OBJECT_UNLOCK (basesink);
 
   if (old)
-    gst_buffer_unref (old);
-  if (old_list)
-    gst_mini_object_unref (GST_MINI_OBJECT_CAST (old_list));
+    gst_mini_object_unref (old);
+  if (copy)
+    gst_mini_object_unref (copy);
 }
 
 static gboolean
@@ -5296,6 +5854,7 @@ gst_base_sink_change_state (GstElement * element, GstStateChange transition)
       basesink->eos = FALSE;
       priv->received_eos = FALSE;
       gst_base_sink_reset_qos (basesink);
+      gst_base_sink_reset_sync_stats (basesink);
       priv->rc_next = -1;
       priv->commited = FALSE;
       priv->call_preroll = TRUE;
@@ -5449,8 +6008,7 @@ gst_base_sink_change_state (GstElement * element, GstStateChange transition)
       gst_caps_replace (&basesink->priv->caps, NULL);
       GST_OBJECT_UNLOCK (basesink);
 
-      gst_base_sink_set_last_buffer (basesink, NULL);
-      gst_base_sink_set_last_buffer_list (basesink, NULL);
+      gst_base_sink_clear_last_object (basesink);
       priv->call_preroll = FALSE;
 
       if (!priv->commited) {
@@ -5477,8 +6035,7 @@ gst_base_sink_change_state (GstElement * element, GstStateChange transition)
           GST_WARNING_OBJECT (basesink, "failed to stop");
         }
       }
-      gst_base_sink_set_last_buffer (basesink, NULL);
-      gst_base_sink_set_last_buffer_list (basesink, NULL);
+      gst_base_sink_clear_last_object (basesink);
       priv->call_preroll = FALSE;
       break;
     default:
@@ -388,6 +388,35 @@ void            gst_base_sink_set_max_bitrate   (GstBaseSink *sink, guint64 max_
 GST_BASE_API
 guint64         gst_base_sink_get_max_bitrate   (GstBaseSink *sink);
 
+/* max-list-span */
+
+GST_BASE_API
+void            gst_base_sink_set_max_list_span (GstBaseSink *sink, GstClockTime max_span);
+
+GST_BASE_API
+GstClockTime    gst_base_sink_get_max_list_span (GstBaseSink *sink);
+
+/* spin-time */
+
+GST_BASE_API
+void            gst_base_sink_set_spin_time     (GstBaseSink *sink, GstClockTime spin_time);
+
+GST_BASE_API
+GstClockTime    gst_base_sink_get_spin_time     (GstBaseSink *sink);
+
+/* spin-budget */
+
+GST_BASE_API
+void            gst_base_sink_set_spin_budget   (GstBaseSink *sink, guint percent);
+
+GST_BASE_API
+guint           gst_base_sink_get_spin_budget   (GstBaseSink *sink);
+
+/* sync-stats */
+
+GST_BASE_API
+GstStructure *  gst_base_sink_get_sync_stats    (GstBaseSink *sink);
+
 GST_BASE_API
 GstClockReturn  gst_base_sink_wait_clock        (GstBaseSink *sink, GstClockTime time,
                                                  GstClockTimeDiff * jitter);
@@ -99,6 +99,13 @@
  * Subclasses should override the query function when this behaviour is not
  * acceptable.
  *
+ * Sources that can produce several buffers at once, such as packet sources,
+ * can implement #GstBaseSrcClass.create_list(). In push mode it is then called
+ * instead of #GstBaseSrcClass.create() for up to #GstBaseSrc:max-list-size
+ * buffers, which are pushed downstream in a single #GstBufferList. The clock
+ * sync is done for the first buffer of the list; timestamps generated for it
+ * are applied to the other buffers that have none.
+ *
  * There is only support in #GstBaseSrc for exactly one source pad, which
  * should be named "src". A source implementation (subclass of #GstBaseSrc)
  * should install a pad template in its class_init function, like so:
@@ -189,6 +196,7 @@ enum
 #define DEFAULT_BLOCKSIZE       4096
 #define DEFAULT_NUM_BUFFERS     -1
 #define DEFAULT_DO_TIMESTAMP    FALSE
+#define DEFAULT_MAX_LIST_SIZE   1
 
 enum
 {
@@ -199,6 +207,7 @@ enum
   PROP_TYPEFIND,
 #endif
   PROP_DO_TIMESTAMP,
+  PROP_MAX_LIST_SIZE,
   PROP_SMART_PROPERTIES
 };
 
@@ -239,6 +248,7 @@ struct _GstBaseSrcPrivate
   GstClockTimeDiff ts_offset;   /* OBJECT_LOCK */
 
   gboolean do_timestamp;        /* OBJECT_LOCK */
+  guint max_list_size;          /* OBJECT_LOCK */
   volatile gint dynamic_size;   /* atomic */
   volatile gint automatic_eos;  /* atomic */
 
@@ -260,7 +270,7 @@ struct _GstBaseSrcPrivate
 
   GCond async_cond;             /* OBJECT_LOCK */
 
-  /* for _submit_buffer_list() */
+  /* for _submit_buffer_list() and create_list() */
   GstBufferList *pending_bufferlist;
 };
 
@@ -404,6 +414,21 @@ gst_base_src_class_init (GstBaseSrcClass * klass)
       g_param_spec_boolean ("do-timestamp", "Do timestamp",
           "Apply current stream time to buffers", DEFAULT_DO_TIMESTAMP,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstBaseSrc:max-list-size:
+   *
+   * Maximum number of buffers to push downstream in one #GstBufferList. When
+   * it is bigger than one and the subclass implements
+   * #GstBaseSrcClass.create_list(), buffers are produced and pushed in lists
+   * of up to this many buffers.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_LIST_SIZE,
+      g_param_spec_uint ("max-list-size", "Max list size",
+          "Maximum number of buffers to push in one buffer list", 1,
+          G_MAXUINT16, DEFAULT_MAX_LIST_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
   g_object_class_install_property (gobject_class, PROP_SMART_PROPERTIES,
       g_param_spec_boxed ("smart-properties", "Smart Properties",
           "Hold various property values for reply custom query",
@@ -474,6 +499,7 @@ gst_base_src_init (GstBaseSrc * basesrc, gpointer g_class)
   /* we operate in BYTES by default */
   gst_base_src_set_format (basesrc, GST_FORMAT_BYTES);
   basesrc->priv->do_timestamp = DEFAULT_DO_TIMESTAMP;
+  basesrc->priv->max_list_size = DEFAULT_MAX_LIST_SIZE;
   g_atomic_int_set (&basesrc->priv->have_events, FALSE);
 
   g_cond_init (&basesrc->priv->async_cond);
@@ -855,6 +881,54 @@ gst_base_src_get_do_timestamp (GstBaseSrc * src)
   return res;
 }
 
+/**
+ * gst_base_src_set_max_list_size:
+ * @src: the source
+ * @max_list_size: the maximum number of buffers in a list
+ *
+ * Set the maximum number of buffers @src pushes downstream in one
+ * #GstBufferList when the subclass implements #GstBaseSrcClass.create_list().
+ * Subclasses can use this to change the default of the
+ * #GstBaseSrc:max-list-size property.
+ *
+ * Since: 1.16
+ */
+void
+gst_base_src_set_max_list_size (GstBaseSrc * src, guint max_list_size)
+{
+  g_return_if_fail (GST_IS_BASE_SRC (src));
+  g_return_if_fail (max_list_size > 0);
+
+  GST_OBJECT_LOCK (src);
+  src->priv->max_list_size = max_list_size;
+  GST_OBJECT_UNLOCK (src);
+}
+
+/**
+ * gst_base_src_get_max_list_size:
+ * @src: the source
+ *
+ * Get the maximum number of buffers @src pushes downstream in one
+ * #GstBufferList.
+ *
+ * Returns: the maximum number of buffers in a list
+ *
+ * Since: 1.16
+ */
+guint
+gst_base_src_get_max_list_size (GstBaseSrc * src)
+{
+  guint res;
+
+  g_return_val_if_fail (GST_IS_BASE_SRC (src), 1);
+
+  GST_OBJECT_LOCK (src);
+  res = src->priv->max_list_size;
+  GST_OBJECT_UNLOCK (src);
+
+  return res;
+}
+
 /**
  * gst_base_src_new_seamless_segment:
  * @src: The source
@@ -2247,6 +2321,9 @@ gst_base_src_set_property (GObject * object, guint prop_id,
     case PROP_DO_TIMESTAMP:
       gst_base_src_set_do_timestamp (src, g_value_get_boolean (value));
       break;
+    case PROP_MAX_LIST_SIZE:
+      gst_base_src_set_max_list_size (src, g_value_get_uint (value));
+      break;
     case PROP_SMART_PROPERTIES:
     {
       const GstStructure *s = gst_value_get_structure (value);
@@ -2291,6 +2368,9 @@ gst_base_src_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_DO_TIMESTAMP:
       g_value_set_boolean (value, gst_base_src_get_do_timestamp (src));
       break;
+    case PROP_MAX_LIST_SIZE:
+      g_value_set_uint (value, gst_base_src_get_max_list_size (src));
+      break;
     case PROP_SMART_PROPERTIES:
       gst_value_set_structure (value, src->smart_prop);
       break;
@@ -2322,7 +2402,33 @@ gst_base_src_wait (GstBaseSrc * basesrc, GstClock * clock, GstClockTime time)
   return ret;
 }
 
-/* perform synchronisation on a buffer.
+/* give the other buffers of a pending buffer list the same timestamp offset
+ * as its first buffer. Like with create(), only the first buffer gets a
+ * timestamp when it has none, the others are left without.
+ * with STREAM_LOCK.
+ */
+static void
+gst_base_src_timestamp_list (GstBaseSrc * basesrc, GstClockTimeDiff ts_offset)
+{
+  GstBufferList *list = basesrc->priv->pending_bufferlist;
+  guint i, len;
+
+  if (list == NULL || ts_offset == 0)
+    return;
+
+  len = gst_buffer_list_length (list);
+  for (i = 1; i < len; i++) {
+    GstBuffer *buffer = gst_buffer_list_get_writable (list, i);
+
+    if (GST_BUFFER_PTS_IS_VALID (buffer))
+      GST_BUFFER_PTS (buffer) += ts_offset;
+    if (GST_BUFFER_DTS_IS_VALID (buffer))
+      GST_BUFFER_DTS (buffer) += ts_offset;
+  }
+}
+
+/* perform synchronisation on a buffer, or on the first buffer of the pending
+ * buffer list.
  * with STREAM_LOCK.
  */
 static GstClockReturn
@@ -2474,6 +2580,7 @@ gst_base_src_do_sync (GstBaseSrc * basesrc, GstBuffer * buffer)
     if (GST_CLOCK_TIME_IS_VALID (dts))
       GST_BUFFER_DTS (buffer) += basesrc->priv->ts_offset;
     start += basesrc->priv->ts_offset;
+    gst_base_src_timestamp_list (basesrc, basesrc->priv->ts_offset);
   }
 
   GST_LOG_OBJECT (basesrc,
@@ -2595,6 +2702,33 @@ unexpected_length:
   }
 }
 
+/* keep the list from create_list() as the pending buffer list, or a single
+ * buffer as @buf. Buffers the subclass didn't create are not counted.
+ * must be called with LIVE_LOCK */
+static void
+gst_base_src_take_list (GstBaseSrc * src, GstBufferList * list,
+    guint max_buffers, GstBuffer ** buf)
+{
+  guint len;
+
+  len = list ? gst_buffer_list_length (list) : 0;
+
+  GST_LOG_OBJECT (src, "created list of %u buffers, max %u", len,
+      max_buffers);
+
+  if (src->num_buffers_left >= 0 && len < max_buffers)
+    src->num_buffers_left += max_buffers - MAX (len, 1);
+
+  if (len == 1) {
+    /* no need to push a list */
+    *buf = gst_buffer_ref (gst_buffer_list_get (list, 0));
+    gst_buffer_list_unref (list);
+  } else if (list != NULL) {
+    /* an empty list fails like an empty submitted list */
+    src->priv->pending_bufferlist = list;
+  }
+}
+
 /* must be called with LIVE_LOCK */
 static GstFlowReturn
 gst_base_src_get_range (GstBaseSrc * src, guint64 offset, guint length,
@@ -2606,6 +2740,7 @@ gst_base_src_get_range (GstBaseSrc * src, guint64 offset, guint length,
   GstBuffer *res_buf;
   GstBuffer *in_buf;
   gboolean own_res_buf;
+  guint max_buffers, total;
 
   bclass = GST_BASE_SRC_GET_CLASS (src);
 
@@ -2625,8 +2760,29 @@ again:
   if (G_UNLIKELY (!bclass->create))
     goto no_function;
 
-  if (G_UNLIKELY (!gst_base_src_update_length (src, offset, &length, FALSE)))
+  /* see how many buffers the subclass can create in one go, lists can only
+   * be pushed */
+  max_buffers = 1;
+  if (bclass->create_list && *buf == NULL
+      && GST_PAD_MODE (src->srcpad) == GST_PAD_MODE_PUSH) {
+    GST_OBJECT_LOCK (src);
+    max_buffers = src->priv->max_list_size;
+    GST_OBJECT_UNLOCK (src);
+
+    if (src->num_buffers_left > 0)
+      max_buffers = MIN (max_buffers, src->num_buffers_left);
+    if (length > 0)
+      max_buffers = MIN (max_buffers, G_MAXUINT / length);
+  }
+
+  /* clip the size of the whole list */
+  total = length * max_buffers;
+  if (G_UNLIKELY (!gst_base_src_update_length (src, offset, &total, FALSE)))
     goto unexpected_length;
+  if (length > 0) {
+    max_buffers = (total + length - 1) / length;
+    length = MIN (length, total);
+  }
 
   /* track position */
   GST_OBJECT_LOCK (src);
@@ -2639,7 +2795,7 @@ again:
     if (src->num_buffers_left == 0)
       goto reached_num_buffers;
     else
-      src->num_buffers_left--;
+      src->num_buffers_left -= max_buffers;
   }
 
   /* don't enter the create function if a pending EOS event was set. For the
@@ -2656,9 +2812,20 @@ again:
   res_buf = in_buf = *buf;
   own_res_buf = (*buf == NULL);
 
-  GST_LIVE_UNLOCK (src);
-  ret = bclass->create (src, offset, length, &res_buf);
-  GST_LIVE_LOCK (src);
+  if (max_buffers > 1) {
+    GstBufferList *list = NULL;
+
+    GST_LIVE_UNLOCK (src);
+    ret = bclass->create_list (src, offset, length, max_buffers, &list);
+    GST_LIVE_LOCK (src);
+
+    if (ret == GST_FLOW_OK)
+      gst_base_src_take_list (src, list, max_buffers, &res_buf);
+  } else {
+    GST_LIVE_UNLOCK (src);
+    ret = bclass->create (src, offset, length, &res_buf);
+    GST_LIVE_LOCK (src);
+  }
 
   /* As we released the LIVE_LOCK, the state may have changed */
   if (src->is_live) {
@@ -2762,6 +2929,10 @@ again:
          * pause and playing. We try to produce a new buffer */
         GST_DEBUG_OBJECT (src,
             "clock was unscheduled (%d), but we are running", status);
+        if (src->priv->pending_bufferlist != NULL) {
+          gst_buffer_list_unref (src->priv->pending_bufferlist);
+          src->priv->pending_bufferlist = NULL;
+        }
         goto again;
       }
       break;
@@ -2903,7 +3074,7 @@ static void
 gst_base_src_loop (GstPad * pad)
 {
   GstBaseSrc *src;
-  GstBuffer *buf = NULL;
+  GstBuffer *buf = NULL, *last;
   GstFlowReturn ret;
   gint64 position;
   gboolean eos;
@@ -2991,8 +3162,9 @@ gst_base_src_loop (GstPad * pad)
   }
 
   /* Note: at this point buf might be a single buf returned which we own or
-   * the first buf of a pending buffer list submitted via submit_buffer_list(),
-   * in which case the buffer is owned by the pending buffer list and not us. */
+   * the first buf of a pending buffer list submitted via submit_buffer_list()
+   * or created with create_list(), in which case the buffer is owned by the
+   * pending buffer list and not us. */
   g_assert (buf != NULL);
 
   /* push events to close/start our segment before we push the buffer. */
@@ -3023,11 +3195,25 @@ gst_base_src_loop (GstPad * pad)
     g_list_free (pending_events);
   }
 
+  /* the position moves past all buffers of a list */
+  last = buf;
+  if (src->priv->pending_bufferlist != NULL && src->segment.rate >= 0.0) {
+    GstBufferList *list = src->priv->pending_bufferlist;
+
+    last = gst_buffer_list_get (list, gst_buffer_list_length (list) - 1);
+  }
+
   /* figure out the new position */
   switch (src->segment.format) {
     case GST_FORMAT_BYTES:
     {
-      guint bufsize = gst_buffer_get_size (buf);
+      gsize bufsize;
+
+      if (src->priv->pending_bufferlist != NULL)
+        bufsize =
+            gst_buffer_list_calculate_size (src->priv->pending_bufferlist);
+      else
+        bufsize = gst_buffer_get_size (buf);
 
       /* we subtracted above for negative rates */
       if (src->segment.rate >= 0.0)
@@ -3038,8 +3224,8 @@ gst_base_src_loop (GstPad * pad)
     {
       GstClockTime start, duration;
 
-      start = GST_BUFFER_TIMESTAMP (buf);
-      duration = GST_BUFFER_DURATION (buf);
+      start = GST_BUFFER_TIMESTAMP (last);
+      duration = GST_BUFFER_DURATION (last);
 
       if (GST_CLOCK_TIME_IS_VALID (start))
         position = start;
@@ -3058,7 +3244,7 @@ gst_base_src_loop (GstPad * pad)
     }
     case GST_FORMAT_DEFAULT:
       if (src->segment.rate >= 0.0)
-        position = GST_BUFFER_OFFSET_END (buf);
+        position = GST_BUFFER_OFFSET_END (last);
       else
         position = GST_BUFFER_OFFSET (buf);
       break;
@@ -3092,7 +3278,10 @@ gst_base_src_loop (GstPad * pad)
 
   if (G_UNLIKELY (src->priv->discont)) {
     GST_INFO_OBJECT (src, "marking pending DISCONT");
-    buf = gst_buffer_make_writable (buf);
+    if (src->priv->pending_bufferlist != NULL)
+      buf = gst_buffer_list_get_writable (src->priv->pending_bufferlist, 0);
+    else
+      buf = gst_buffer_make_writable (buf);
     GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DISCONT);
     src->priv->discont = FALSE;
   }
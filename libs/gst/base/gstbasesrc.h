@@ -166,6 +166,11 @@ struct _GstBaseSrc {
  *   default implementation will create a new buffer from the negotiated allocator.
  * @fill: Ask the subclass to fill the buffer with data for offset and size. The
  *   passed buffer is guaranteed to hold the requested amount of bytes.
+ * @create_list: Ask the subclass to create a list of at most max_buffers
+ *   buffers of size bytes each, starting at offset. The list can hold fewer
+ *   buffers when less data is available, but never none when the subclass
+ *   returns GST_FLOW_OK. Only used in push mode when #GstBaseSrc:max-list-size
+ *   is bigger than one, #GstBaseSrcClass.create() is used otherwise.
  *
  * Subclasses can override any of the available virtual methods or not, as
  * needed. At the minimum, the @create method should be overridden to produce
@@ -247,8 +252,20 @@ struct _GstBaseSrcClass {
   GstFlowReturn (*fill)         (GstBaseSrc *src, guint64 offset, guint size,
                                  GstBuffer *buf);
 
+  /**
+   * GstBaseSrcClass::create_list:
+   * @list: (out):
+   *
+   * Ask the subclass to create a list of up to @max_buffers buffers of @size
+   * bytes each, starting at @offset.
+   *
+   * Since: 1.16
+   */
+  GstFlowReturn (*create_list)  (GstBaseSrc *src, guint64 offset, guint size,
+                                 guint max_buffers, GstBufferList **list);
+
   /*< private >*/
-  gpointer       _gst_reserved[GST_PADDING_LARGE];
+  gpointer       _gst_reserved[GST_PADDING_LARGE - 1];
 };
 
 GST_BASE_API
@@ -294,6 +311,12 @@ void            gst_base_src_set_blocksize    (GstBaseSrc *src, guint blocksize)
 GST_BASE_API
 guint           gst_base_src_get_blocksize    (GstBaseSrc *src);
 
+GST_BASE_API
+void            gst_base_src_set_max_list_size (GstBaseSrc *src, guint max_list_size);
+
+GST_BASE_API
+guint           gst_base_src_get_max_list_size (GstBaseSrc *src);
+
 GST_BASE_API
 void            gst_base_src_set_do_timestamp (GstBaseSrc *src, gboolean timestamp);
 
@@ -118,6 +118,18 @@
  *   * Example elements:
  *     * efence
  *
+ * ## Sliced processing
+ *   * Elements whose buffers can be split into independent parts, like
+ *     ranges of rows of a video frame, can implement transform_slice and/or
+ *     transform_ip_slice next to transform and/or transform_ip.
+ *   * The base class then calls the slice function for every slice from a
+ *     shared pool of worker threads and the streaming thread, and waits for
+ *     all slices before pushing the buffer. The number of slices is set
+ *     with gst_base_transform_set_max_slices().
+ *   * Passthrough buffers are never sliced.
+ *   * Example elements:
+ *     * videoconvert, videoscale
+ *
  * # Sub-class settable flags on GstBaseTransform
  *
  * * passthrough
@@ -200,8 +212,31 @@ struct _GstBaseTransformPrivate
   GstAllocator *allocator;
   GstAllocationParams params;
   GstQuery *query;
+
+  /* the number of slices to split buffers in, 0 for one per processor */
+  guint max_slices;
 };
 
+/* the slices of one buffer, shared between the streaming thread and the
+ * workers of the slice pool */
+typedef struct
+{
+  gint refcount;                /* ATOMIC */
+
+  GstBaseTransform *trans;
+  GstBuffer *inbuf;             /* NULL when transforming in place */
+  GstBuffer *outbuf;
+  gint n_slices;
+  gint next_slice;              /* ATOMIC */
+
+  GMutex lock;
+  GCond cond;
+  gint done;                    /* with lock */
+  GstFlowReturn ret;            /* with lock */
+} GstBaseTransformSlices;
+
+static guint n_processors = 1;
+
 
 static GstElementClass *parent_class = NULL;
 static gint private_offset = 0;
@@ -334,6 +369,8 @@ gst_base_transform_class_init (GstBaseTransformClass * klass)
 
   parent_class = g_type_class_peek_parent (klass);
 
+  n_processors = g_get_num_processors ();
+
   gobject_class->set_property = gst_base_transform_set_property;
   gobject_class->get_property = gst_base_transform_get_property;
 
@@ -431,6 +468,7 @@ gst_base_transform_init (GstBaseTransform * trans,
 
   priv->processed = 0;
   priv->dropped = 0;
+  priv->max_slices = 1;
 }
 
 static GstCaps *
@@ -2083,6 +2121,160 @@ not_negotiated:
   }
 }
 
+static void
+gst_base_transform_slices_unref (GstBaseTransformSlices * slices)
+{
+  if (g_atomic_int_dec_and_test (&slices->refcount)) {
+    g_mutex_clear (&slices->lock);
+    g_cond_clear (&slices->cond);
+    g_slice_free (GstBaseTransformSlices, slices);
+  }
+}
+
+/* run slices until there are none left, called from the streaming thread and
+ * the workers */
+static void
+gst_base_transform_run_slices (GstBaseTransformSlices * slices)
+{
+  GstBaseTransformClass *bclass = GST_BASE_TRANSFORM_GET_CLASS (slices->trans);
+  GstFlowReturn ret;
+  gint slice;
+
+  while ((slice = g_atomic_int_add (&slices->next_slice, 1)) <
+      slices->n_slices) {
+    if (slices->inbuf)
+      ret = bclass->transform_slice (slices->trans, slices->inbuf,
+          slices->outbuf, slice, slices->n_slices);
+    else
+      ret = bclass->transform_ip_slice (slices->trans, slices->outbuf, slice,
+          slices->n_slices);
+
+    g_mutex_lock (&slices->lock);
+    if (ret != GST_FLOW_OK && slices->ret == GST_FLOW_OK)
+      slices->ret = ret;
+    if (++slices->done == slices->n_slices)
+      g_cond_signal (&slices->cond);
+    g_mutex_unlock (&slices->lock);
+  }
+}
+
+static void
+gst_base_transform_slice_worker (gpointer data, gpointer user_data)
+{
+  GstBaseTransformSlices *slices = data;
+
+  gst_base_transform_run_slices (slices);
+  gst_base_transform_slices_unref (slices);
+}
+
+static gpointer
+gst_base_transform_create_slice_pool (gpointer data)
+{
+  /* the streaming threads work on their own slices too */
+  if (n_processors < 2)
+    return NULL;
+
+  return g_thread_pool_new (gst_base_transform_slice_worker, NULL,
+      n_processors - 1, TRUE, NULL);
+}
+
+static guint
+gst_base_transform_get_n_slices (GstBaseTransform * trans, gpointer func)
+{
+  guint n_slices;
+
+  if (func == NULL)
+    return 1;
+
+  GST_OBJECT_LOCK (trans);
+  n_slices = trans->priv->max_slices;
+  GST_OBJECT_UNLOCK (trans);
+  if (n_slices == 0)
+    n_slices = n_processors;
+
+  return MIN (n_slices, G_MAXINT);
+}
+
+/* transform @outbuf in @n_slices slices, from @inbuf or in place when @inbuf
+ * is NULL, and wait for all of them */
+static GstFlowReturn
+gst_base_transform_transform_slices (GstBaseTransform * trans,
+    GstBuffer * inbuf, GstBuffer * outbuf, guint n_slices)
+{
+  static GOnce slice_pool_once = G_ONCE_INIT;
+  GstBaseTransformClass *bclass = GST_BASE_TRANSFORM_GET_CLASS (trans);
+  GstBaseTransformSlices *slices;
+  GThreadPool *pool;
+  GstMapInfo inmap, outmap;
+  GstFlowReturn ret;
+  guint i, n_workers = 0;
+
+  /* map the buffers while the slices run, so that the slices can map them
+   * again from several threads without merging memory. The output is mapped
+   * READWRITE so that the slices can map it with any flags, a WRITE mapping
+   * would make READ and READWRITE mappings fail */
+  if (inbuf && !gst_buffer_map (inbuf, &inmap, GST_MAP_READ))
+    goto map_failed;
+  if (!gst_buffer_map (outbuf, &outmap, GST_MAP_READWRITE)) {
+    if (inbuf)
+      gst_buffer_unmap (inbuf, &inmap);
+    goto map_failed;
+  }
+
+  slices = g_slice_new0 (GstBaseTransformSlices);
+  slices->refcount = 1;
+  slices->trans = trans;
+  slices->inbuf = inbuf;
+  slices->outbuf = outbuf;
+  slices->n_slices = n_slices;
+  g_mutex_init (&slices->lock);
+  g_cond_init (&slices->cond);
+  slices->ret = GST_FLOW_OK;
+
+  pool = g_once (&slice_pool_once, gst_base_transform_create_slice_pool, NULL);
+  if (pool)
+    n_workers = MIN (n_slices, n_processors) - 1;
+
+  GST_LOG_OBJECT (trans, "transforming %u slices with %u workers", n_slices,
+      n_workers);
+
+  for (i = 0; i < n_workers; i++) {
+    g_atomic_int_inc (&slices->refcount);
+    if (!g_thread_pool_push (pool, slices, NULL)) {
+      /* the remaining slices are done by the streaming thread */
+      g_atomic_int_add (&slices->refcount, -1);
+      break;
+    }
+  }
+
+  gst_base_transform_run_slices (slices);
+
+  g_mutex_lock (&slices->lock);
+  while (slices->done < slices->n_slices)
+    g_cond_wait (&slices->cond, &slices->lock);
+  ret = slices->ret;
+  g_mutex_unlock (&slices->lock);
+
+  /* workers that did not get a slice may still hold a ref */
+  gst_base_transform_slices_unref (slices);
+
+  gst_buffer_unmap (outbuf, &outmap);
+  if (inbuf)
+    gst_buffer_unmap (inbuf, &inmap);
+
+  return ret;
+
+  /* ERRORS */
+map_failed:
+  {
+    GST_DEBUG_OBJECT (trans, "could not map buffers, not slicing");
+    if (inbuf)
+      return bclass->transform (trans, inbuf, outbuf);
+    else
+      return bclass->transform_ip (trans, outbuf);
+  }
+}
+
 static GstFlowReturn
 default_generate_output (GstBaseTransform * trans, GstBuffer ** outbuf)
 {
@@ -2091,6 +2283,7 @@ default_generate_output (GstBaseTransform * trans, GstBuffer ** outbuf)
   GstFlowReturn ret = GST_FLOW_OK;
   GstBuffer *inbuf;
   gboolean want_in_place;
+  guint n_slices;
 
   /* Retrieve stashed input buffer, if the default submit_input_buffer
    * was run. Takes ownership back from there */
@@ -2133,11 +2326,22 @@ default_generate_output (GstBaseTransform * trans, GstBuffer ** outbuf)
 
     if (want_in_place) {
       GST_DEBUG_OBJECT (trans, "doing inplace transform");
-      ret = bclass->transform_ip (trans, *outbuf);
+      n_slices =
+          gst_base_transform_get_n_slices (trans, bclass->transform_ip_slice);
+      if (n_slices > 1)
+        ret = gst_base_transform_transform_slices (trans, NULL, *outbuf,
+            n_slices);
+      else
+        ret = bclass->transform_ip (trans, *outbuf);
     } else {
       GST_DEBUG_OBJECT (trans, "doing non-inplace transform");
 
-      if (bclass->transform)
+      n_slices =
+          gst_base_transform_get_n_slices (trans, bclass->transform_slice);
+      if (bclass->transform && n_slices > 1)
+        ret = gst_base_transform_transform_slices (trans, inbuf, *outbuf,
+            n_slices);
+      else if (bclass->transform)
         ret = bclass->transform (trans, inbuf, *outbuf);
       else
         ret = GST_FLOW_NOT_SUPPORTED;
@@ -2871,3 +3075,55 @@ gst_base_transform_update_src_caps (GstBaseTransform * trans,
 
   return FALSE;
 }
+
+/**
+ * gst_base_transform_set_max_slices:
+ * @trans: a #GstBaseTransform
+ * @max_slices: the number of slices, or 0 for one slice per processor
+ *
+ * Set the number of slices that the #GstBaseTransformClass.transform_slice()
+ * and #GstBaseTransformClass.transform_ip_slice() methods split every buffer
+ * in. The slices of a buffer are processed in parallel. With 1, the default,
+ * buffers are not split and #GstBaseTransformClass.transform() or
+ * #GstBaseTransformClass.transform_ip() are called instead.
+ *
+ * MT safe.
+ *
+ * Since: 1.16
+ */
+void
+gst_base_transform_set_max_slices (GstBaseTransform * trans, guint max_slices)
+{
+  g_return_if_fail (GST_IS_BASE_TRANSFORM (trans));
+
+  GST_OBJECT_LOCK (trans);
+  trans->priv->max_slices = max_slices;
+  GST_DEBUG_OBJECT (trans, "set max slices %u", max_slices);
+  GST_OBJECT_UNLOCK (trans);
+}
+
+/**
+ * gst_base_transform_get_max_slices:
+ * @trans: a #GstBaseTransform
+ *
+ * Get the number of slices that buffers are split in.
+ *
+ * Returns: the number of slices, 0 for one slice per processor.
+ *
+ * MT safe.
+ *
+ * Since: 1.16
+ */
+guint
+gst_base_transform_get_max_slices (GstBaseTransform * trans)
+{
+  guint result;
+
+  g_return_val_if_fail (GST_IS_BASE_TRANSFORM (trans), 0);
+
+  GST_OBJECT_LOCK (trans);
+  result = trans->priv->max_slices;
+  GST_OBJECT_UNLOCK (trans);
+
+  return result;
+}
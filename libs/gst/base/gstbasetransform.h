@@ -209,11 +209,25 @@ struct _GstBaseTransform {
  *                   do 1-to-1 transformations on input to output buffers can either
  *                   return GST_BASE_TRANSFORM_FLOW_DROPPED or simply not generate
  *                   an output buffer until they are ready to do so. (Since 1.6)
+ * @transform_slice: Optional. Transforms part @slice of @n_slices independent
+ *                   parts of one incoming buffer to the outgoing buffer. Called
+ *                   instead of @transform from several threads at once when
+ *                   gst_base_transform_set_max_slices() was used. (Since 1.16)
+ * @transform_ip_slice: Optional. Transforms part @slice of @n_slices
+ *                   independent parts of the buffer in-place. Called instead
+ *                   of @transform_ip from several threads at once when
+ *                   gst_base_transform_set_max_slices() was used. (Since 1.16)
  *
  * Subclasses can override any of the available virtual methods or not, as
  * needed. At minimum either @transform or @transform_ip need to be overridden.
  * If the element can overwrite the input data with the results (data is of the
  * same type and quantity) it should provide @transform_ip.
+ *
+ * @transform_slice and @transform_ip_slice can only be used next to
+ * @transform and @transform_ip respectively, which are still called when a
+ * buffer is not split. The buffers are mapped by the base class while the
+ * slices run, the input buffer for reading and the output buffer for reading
+ * and writing, so mapping them again in a slice is cheap.
  */
 struct _GstBaseTransformClass {
   GstElementClass parent_class;
@@ -297,8 +311,15 @@ struct _GstBaseTransformClass {
    */
   GstFlowReturn (*generate_output) (GstBaseTransform *trans, GstBuffer **outbuf);
 
+  /* sliced transform */
+  GstFlowReturn (*transform_slice)    (GstBaseTransform *trans, GstBuffer *inbuf,
+                                       GstBuffer *outbuf, guint slice,
+                                       guint n_slices);
+  GstFlowReturn (*transform_ip_slice) (GstBaseTransform *trans, GstBuffer *buf,
+                                       guint slice, guint n_slices);
+
   /*< private >*/
-  gpointer       _gst_reserved[GST_PADDING_LARGE - 2];
+  gpointer       _gst_reserved[GST_PADDING_LARGE - 4];
 };
 
 GST_BASE_API
@@ -333,6 +354,12 @@ void            gst_base_transform_set_gap_aware    (GstBaseTransform *trans,
 GST_BASE_API
 void            gst_base_transform_set_prefer_passthrough (GstBaseTransform *trans,
                                                            gboolean prefer_passthrough);
+GST_BASE_API
+void            gst_base_transform_set_max_slices   (GstBaseTransform *trans,
+                                                     guint max_slices);
+GST_BASE_API
+guint           gst_base_transform_get_max_slices   (GstBaseTransform *trans);
+
 GST_BASE_API
 GstBufferPool * gst_base_transform_get_buffer_pool  (GstBaseTransform *trans);
 
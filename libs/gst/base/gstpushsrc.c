@@ -43,6 +43,10 @@
  * The subclass should extend the methods from the baseclass in
  * addition to the ::create method.
  *
+ * Subclasses that can read several buffers at once can implement the
+ * ::create_list method, which is used instead of ::create when the
+ * #GstBaseSrc:max-list-size property is bigger than one.
+ *
  * Seeking, flushing, scheduling and sync is all handled by this
  * base class.
  */
@@ -74,6 +78,8 @@ static GstFlowReturn gst_push_src_alloc (GstBaseSrc * bsrc, guint64 offset,
     guint length, GstBuffer ** ret);
 static GstFlowReturn gst_push_src_fill (GstBaseSrc * bsrc, guint64 offset,
     guint length, GstBuffer * ret);
+static GstFlowReturn gst_push_src_create_list (GstBaseSrc * bsrc,
+    guint64 offset, guint length, guint max_buffers, GstBufferList ** ret);
 
 static void
 gst_push_src_class_init (GstPushSrcClass * klass)
@@ -83,6 +89,7 @@ gst_push_src_class_init (GstPushSrcClass * klass)
   gstbasesrc_class->create = GST_DEBUG_FUNCPTR (gst_push_src_create);
   gstbasesrc_class->alloc = GST_DEBUG_FUNCPTR (gst_push_src_alloc);
   gstbasesrc_class->fill = GST_DEBUG_FUNCPTR (gst_push_src_fill);
+  gstbasesrc_class->create_list = GST_DEBUG_FUNCPTR (gst_push_src_create_list);
   gstbasesrc_class->query = GST_DEBUG_FUNCPTR (gst_push_src_query);
 }
 
@@ -181,3 +188,29 @@ gst_push_src_fill (GstBaseSrc * bsrc, guint64 offset, guint length,
 
   return fret;
 }
+
+static GstFlowReturn
+gst_push_src_create_list (GstBaseSrc * bsrc, guint64 offset, guint length,
+    guint max_buffers, GstBufferList ** ret)
+{
+  GstFlowReturn fret;
+  GstPushSrc *src;
+  GstPushSrcClass *pclass;
+  GstBuffer *buf = NULL;
+
+  src = GST_PUSH_SRC (bsrc);
+  pclass = GST_PUSH_SRC_GET_CLASS (src);
+  if (pclass->create_list)
+    return pclass->create_list (src, max_buffers, ret);
+
+  /* calling create again could block until more data arrives, so only
+   * create one buffer. Go through the class, subclasses can override the
+   * GstBaseSrc create function too */
+  fret = GST_BASE_SRC_GET_CLASS (bsrc)->create (bsrc, offset, length, &buf);
+  if (fret == GST_FLOW_OK && buf != NULL) {
+    *ret = gst_buffer_list_new_sized (1);
+    gst_buffer_list_add (*ret, buf);
+  }
+
+  return fret;
+}
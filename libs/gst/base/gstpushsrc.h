@@ -62,6 +62,10 @@ struct _GstPushSrc {
  *         size this buffer should be. The default implementation will create
  *         a new buffer from the negotiated allocator.
  * @fill: Ask the subclass to fill the buffer with data.
+ * @create_list: Ask the subclass to create a list of at most max_buffers
+ *          buffers in one go, refer to #GstBaseSrc<!-- -->.create_list() for
+ *          more details. If this method is not implemented, @create is
+ *          called once and the list holds a single buffer.
  *
  * Subclasses can override any of the available virtual methods or not, as
  * needed. At the minimum, the @fill method should be overridden to produce
@@ -78,8 +82,19 @@ struct _GstPushSrcClass {
   /* ask the subclass to fill a buffer */
   GstFlowReturn (*fill)   (GstPushSrc *src, GstBuffer *buf);
 
+  /**
+   * GstPushSrcClass::create_list:
+   * @list: (out):
+   *
+   * Ask the subclass to create a list of up to @max_buffers buffers.
+   *
+   * Since: 1.16
+   */
+  GstFlowReturn (*create_list) (GstPushSrc *src, guint max_buffers,
+                                GstBufferList **list);
+
   /*< private >*/
-  gpointer _gst_reserved[GST_PADDING];
+  gpointer _gst_reserved[GST_PADDING - 1];
 };
 
 GST_BASE_API
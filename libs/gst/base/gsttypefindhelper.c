@@ -43,6 +43,10 @@
 
 /* ********************** typefinding in pull mode ************************ */
 
+/* the number of bytes at the start of the stream that are checked against
+ * the magic sequences of the typefinders before running any of them */
+#define MAGIC_PEEK_SIZE 4096
+
 static void
 helper_find_suggest (gpointer data, guint probability, GstCaps * caps);
 
@@ -95,7 +99,8 @@ helper_find_peek (gpointer data, gint64 offset, guint size)
   helper = (GstTypeFindHelper *) data;
 
   GST_LOG_OBJECT (helper->obj, "'%s' called peek (%" G_GINT64_FORMAT
-      ", %u)", GST_OBJECT_NAME (helper->factory), offset, size);
+      ", %u)", helper->factory ? GST_OBJECT_NAME (helper->factory) : "index",
+      offset, size);
 
   if (size == 0)
     return NULL;
@@ -331,7 +336,8 @@ gst_type_find_helper_get_range_full (GstObject * obj, GstObject * parent,
   GSList *walk;
   GList *l, *type_list;
   GstCaps *result = NULL;
-  gint pos = 0;
+  const guint8 *data;
+  guint peek_size;
 
   g_return_val_if_fail (GST_IS_OBJECT (obj), GST_FLOW_ERROR);
   g_return_val_if_fail (func != NULL, GST_FLOW_ERROR);
@@ -359,49 +365,22 @@ gst_type_find_helper_get_range_full (GstObject * obj, GstObject * parent,
     find.get_length = helper_find_get_length;
   }
 
-  type_list = gst_type_find_factory_get_list ();
+  /* only run the typefinders whose magic can match the start of the stream,
+   * the ones for the extension first. The idea is that when one of them
+   * returns MAX we don't need to search further as there is a very high
+   * chance we got the right type. */
+  helper.factory = NULL;
+  peek_size = (size == 0 || size == (guint64) - 1) ? MAGIC_PEEK_SIZE :
+      MIN (size, MAGIC_PEEK_SIZE);
+  data = helper_find_peek (&helper, 0, peek_size);
+  if (data == NULL)
+    peek_size = 0;
+  helper.flow_ret = GST_FLOW_OK;
 
-  /* move the typefinders for the extension first in the list. The idea is that
-   * when one of them returns MAX we don't need to search further as there is a
-   * very high chance we got the right type. */
-  if (extension) {
-    GList *next;
-
-    GST_LOG_OBJECT (obj, "sorting typefind for extension %s to head",
-        extension);
-
-    for (l = type_list; l; l = next) {
-      const gchar *const *ext;
-      GstTypeFindFactory *factory;
-
-      next = l->next;
-
-      factory = GST_TYPE_FIND_FACTORY (l->data);
-
-      ext = gst_type_find_factory_get_extensions (factory);
-      if (ext == NULL)
-        continue;
-
-      GST_LOG_OBJECT (obj, "testing factory %s for extension %s",
-          GST_OBJECT_NAME (factory), extension);
-
-      while (*ext != NULL) {
-        if (strcmp (*ext, extension) == 0) {
-          /* found extension, move in front */
-          GST_LOG_OBJECT (obj, "moving typefind for extension %s to head",
-              extension);
-          /* remove entry from list */
-          type_list = g_list_delete_link (type_list, l);
-          /* insert at the position */
-          type_list = g_list_insert (type_list, factory, pos);
-          /* next element will be inserted after this one */
-          pos++;
-          break;
-        }
-        ++ext;
-      }
-    }
-  }
+  type_list =
+      gst_type_find_factory_get_list_for_data (data, peek_size, extension);
+
+  GST_LOG_OBJECT (obj, "trying %u typefinders", g_list_length (type_list));
 
   for (l = type_list; l; l = l->next) {
     helper.factory = GST_TYPE_FIND_FACTORY (l->data);
@@ -607,7 +586,7 @@ gst_type_find_helper_for_data (GstObject * obj, const guint8 * data, gsize size,
   find.suggest = buf_helper_find_suggest;
   find.get_length = NULL;
 
-  type_list = gst_type_find_factory_get_list ();
+  type_list = gst_type_find_factory_get_list_for_data (data, size, NULL);
 
   for (l = type_list; l; l = l->next) {
     helper.factory = GST_TYPE_FIND_FACTORY (l->data);
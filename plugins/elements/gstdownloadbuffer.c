@@ -72,8 +72,10 @@
 #include <unistd.h>
 #endif
 
-#ifdef __BIONIC__
 #include <fcntl.h>
+
+#ifndef O_BINARY
+#define O_BINARY 0
 #endif
 
 static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
@@ -103,6 +105,7 @@ enum
 #define DEFAULT_LOW_PERCENT        10
 #define DEFAULT_HIGH_PERCENT       99
 #define DEFAULT_TEMP_REMOVE        TRUE
+#define DEFAULT_TEMP_RESUME        FALSE
 
 enum
 {
@@ -114,6 +117,7 @@ enum
   PROP_TEMP_TEMPLATE,
   PROP_TEMP_LOCATION,
   PROP_TEMP_REMOVE,
+  PROP_TEMP_RESUME,
   PROP_LAST
 };
 
@@ -266,6 +270,22 @@ gst_download_buffer_class_init (GstDownloadBufferClass * klass)
           "Remove the temp-location after use",
           DEFAULT_TEMP_REMOVE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstDownloadBuffer:temp-resume
+   *
+   * Save the index of the downloaded ranges next to temp-location, with a
+   * ".index" suffix, when going to READY. When temp-template names a file
+   * without XXXXXX, that file and its index are reused so that an
+   * interrupted download of the same stream continues without fetching the
+   * cached ranges again. Only has an effect when temp-remove is %FALSE.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_TEMP_RESUME,
+      g_param_spec_boolean ("temp-resume", "Resume the Temporary File",
+          "Keep the downloaded ranges of temp-location across runs",
+          DEFAULT_TEMP_RESUME, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /* set several parent class virtual functions */
   gobject_class->finalize = gst_download_buffer_finalize;
 
@@ -331,6 +351,7 @@ gst_download_buffer_init (GstDownloadBuffer * dlbuf)
   dlbuf->temp_template = NULL;
   dlbuf->temp_location = NULL;
   dlbuf->temp_remove = DEFAULT_TEMP_REMOVE;
+  dlbuf->temp_resume = DEFAULT_TEMP_RESUME;
 }
 
 /* called only once, as opposed to dispose */
@@ -864,6 +885,50 @@ read_error:
   }
 }
 
+/* resuming needs a fixed file name, so it's only done when temp-template
+ * has no XXXXXX to fill in */
+static gboolean
+gst_download_buffer_can_resume (GstDownloadBuffer * dlbuf)
+{
+  return dlbuf->temp_resume && !dlbuf->temp_remove &&
+      strstr (dlbuf->temp_template, "XXXXXX") == NULL;
+}
+
+static void
+gst_download_buffer_load_index (GstDownloadBuffer * dlbuf, const gchar * name)
+{
+  GError *error = NULL;
+  gchar *index;
+
+  index = g_strconcat (name, ".index", NULL);
+  if (!g_file_test (index, G_FILE_TEST_EXISTS)) {
+    GST_DEBUG_OBJECT (dlbuf, "no index %s, starting from scratch", index);
+  } else if (!gst_sparse_file_load_index (dlbuf->file, index, &error)) {
+    GST_WARNING_OBJECT (dlbuf, "failed to load index %s: %s", index,
+        error->message);
+    g_clear_error (&error);
+  } else {
+    GST_DEBUG_OBJECT (dlbuf, "resuming with %u ranges from %s",
+        gst_sparse_file_n_ranges (dlbuf->file), index);
+  }
+  g_free (index);
+}
+
+static void
+gst_download_buffer_save_index (GstDownloadBuffer * dlbuf)
+{
+  GError *error = NULL;
+  gchar *index;
+
+  index = g_strconcat (dlbuf->temp_location, ".index", NULL);
+  if (!gst_sparse_file_save_index (dlbuf->file, index, &error)) {
+    GST_WARNING_OBJECT (dlbuf, "failed to save index %s: %s", index,
+        error->message);
+    g_clear_error (&error);
+  }
+  g_free (index);
+}
+
 /* must be called with MUTEX_LOCK. Will briefly release the lock when notifying
  * the temp filename. */
 static gboolean
@@ -885,19 +950,27 @@ gst_download_buffer_open_temp_location_file (GstDownloadBuffer * dlbuf)
 
   /* make copy of the template, we don't want to change this */
   name = g_strdup (dlbuf->temp_template);
+  if (gst_download_buffer_can_resume (dlbuf)) {
+    /* a fixed name, reuse what a previous run left there */
+    fd = g_open (name, O_RDWR | O_CREAT | O_BINARY, 0600);
+    if (fd == -1)
+      goto open_failed;
+  } else {
 #ifdef __BIONIC__
-  fd = g_mkstemp_full (name, O_RDWR | O_LARGEFILE, S_IRUSR | S_IWUSR);
+    fd = g_mkstemp_full (name, O_RDWR | O_LARGEFILE, S_IRUSR | S_IWUSR);
 #else
-  fd = g_mkstemp (name);
+    fd = g_mkstemp (name);
 #endif
-  if (fd == -1)
-    goto mkstemp_failed;
+    if (fd == -1)
+      goto mkstemp_failed;
+  }
 
   /* open the file for update/writing */
   dlbuf->file = gst_sparse_file_new ();
-  /* error creating file */
-  if (!gst_sparse_file_set_fd (dlbuf->file, fd))
-    goto open_failed;
+  gst_sparse_file_set_fd (dlbuf->file, fd);
+
+  if (gst_download_buffer_can_resume (dlbuf))
+    gst_download_buffer_load_index (dlbuf, name);
 
   g_free (dlbuf->temp_location);
   dlbuf->temp_location = name;
@@ -940,8 +1013,6 @@ open_failed:
     GST_ELEMENT_ERROR (dlbuf, RESOURCE, OPEN_READ,
         (_("Could not open file \"%s\" for reading."), name), GST_ERROR_SYSTEM);
     g_free (name);
-    if (fd != -1)
-      close (fd);
     return FALSE;
   }
 }
@@ -960,9 +1031,11 @@ gst_download_buffer_close_temp_location_file (GstDownloadBuffer * dlbuf)
       GST_WARNING_OBJECT (dlbuf, "Failed to remove temporary file %s: %s",
           dlbuf->temp_location, g_strerror (errno));
     }
+  } else if (dlbuf->temp_resume) {
+    gst_download_buffer_save_index (dlbuf);
   }
+  /* this also closes temp_fd */
   gst_sparse_file_free (dlbuf->file);
-  close (dlbuf->temp_fd);
   dlbuf->file = NULL;
 }
 
@@ -1911,6 +1984,9 @@ gst_download_buffer_set_property (GObject * object,
     case PROP_TEMP_REMOVE:
       dlbuf->temp_remove = g_value_get_boolean (value);
       break;
+    case PROP_TEMP_RESUME:
+      dlbuf->temp_resume = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1953,6 +2029,9 @@ gst_download_buffer_get_property (GObject * object,
     case PROP_TEMP_REMOVE:
       g_value_set_boolean (value, dlbuf->temp_remove);
       break;
+    case PROP_TEMP_RESUME:
+      g_value_set_boolean (value, dlbuf->temp_resume);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
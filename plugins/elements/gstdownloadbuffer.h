@@ -107,6 +107,7 @@ struct _GstDownloadBuffer
   gboolean temp_location_set;
   gchar *temp_location;
   gboolean temp_remove;
+  gboolean temp_resume;
   gint temp_fd;
   gboolean seeking;
 
@@ -350,3 +350,62 @@ write_error:
     goto out;
   }
 }
+
+/* Buffers handed out by element pools are often trimmed to the data that was
+ * actually read. Restore their full size on release, the default pool would
+ * discard them otherwise. */
+typedef GstBufferPool GstElementsResizePool;
+typedef GstBufferPoolClass GstElementsResizePoolClass;
+
+static GType gst_elements_resize_pool_get_type (void);
+G_DEFINE_TYPE (GstElementsResizePool, gst_elements_resize_pool,
+    GST_TYPE_BUFFER_POOL);
+
+static void
+gst_elements_resize_pool_reset_buffer (GstBufferPool * pool,
+    GstBuffer * buffer)
+{
+  gsize offset, maxsize;
+
+  gst_buffer_get_sizes (buffer, &offset, &maxsize);
+  gst_buffer_resize (buffer, -offset, maxsize);
+
+  GST_BUFFER_POOL_CLASS (gst_elements_resize_pool_parent_class)->reset_buffer
+      (pool, buffer);
+}
+
+static void
+gst_elements_resize_pool_class_init (GstElementsResizePoolClass * klass)
+{
+  klass->reset_buffer = gst_elements_resize_pool_reset_buffer;
+}
+
+static void
+gst_elements_resize_pool_init (GstElementsResizePool * pool)
+{
+}
+
+/* Returns an active pool of @size bytes buffers, which may be resized while
+ * in use, or %NULL. */
+GstBufferPool *
+gst_elements_resize_pool_new (guint size, guint min_buffers,
+    const GstAllocationParams * params)
+{
+  GstBufferPool *pool;
+  GstStructure *config;
+
+  pool = g_object_new (gst_elements_resize_pool_get_type (), NULL);
+  gst_object_ref_sink (pool);
+
+  config = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (config, NULL, size, min_buffers, 0);
+  gst_buffer_pool_config_set_allocator (config, NULL, params);
+
+  if (!gst_buffer_pool_set_config (pool, config) ||
+      !gst_buffer_pool_set_active (pool, TRUE)) {
+    gst_object_unref (pool);
+    return NULL;
+  }
+
+  return pool;
+}
@@ -39,6 +39,10 @@ GstFlowReturn  gst_writev_buffers (GstObject * sink, gint fd, GstPoll * fdset,
                                    guint8 * mem_nums, guint total_mem_num,
                                    guint64 * bytes_written, guint64 skip);
 
+G_GNUC_INTERNAL
+GstBufferPool * gst_elements_resize_pool_new (guint size, guint min_buffers,
+                                              const GstAllocationParams * params);
+
 G_END_DECLS
 
 #endif /* __GST_ELEMENTS_PRIVATE_H__ */
@@ -31,6 +31,10 @@
  * gst-launch-1.0 audiotestsrc num-buffers=1000 ! fakesink sync=false
  * ]| Render 1000 audio buffers (of default size) as fast as possible.
  *
+ * |[
+ * gst-launch-1.0 fakesrc num-buffers=100000 ! fakesink measure=true
+ * ]| Print the throughput and the buffer inter-arrival times at EOS.
+ *
  */
 
 #ifdef HAVE_CONFIG_H
@@ -69,6 +73,7 @@ enum
 #define DEFAULT_CAN_ACTIVATE_PUSH TRUE
 #define DEFAULT_CAN_ACTIVATE_PULL FALSE
 #define DEFAULT_NUM_BUFFERS -1
+#define DEFAULT_MEASURE FALSE
 
 enum
 {
@@ -81,7 +86,9 @@ enum
   PROP_LAST_MESSAGE,
   PROP_CAN_ACTIVATE_PUSH,
   PROP_CAN_ACTIVATE_PULL,
-  PROP_NUM_BUFFERS
+  PROP_NUM_BUFFERS,
+  PROP_MEASURE,
+  PROP_STATS
 };
 
 #define GST_TYPE_FAKE_SINK_STATE_ERROR (gst_fake_sink_state_error_get_type())
@@ -124,6 +131,7 @@ static void gst_fake_sink_set_property (GObject * object, guint prop_id,
 static void gst_fake_sink_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
 static void gst_fake_sink_finalize (GObject * obj);
+static void gst_fake_sink_reset_stats (GstFakeSink * sink);
 
 static GstStateChangeReturn gst_fake_sink_change_state (GstElement * element,
     GstStateChange transition);
@@ -195,6 +203,37 @@ gst_fake_sink_class_init (GstFakeSinkClass * klass)
       g_param_spec_int ("num-buffers", "num-buffers",
           "Number of buffers to accept going EOS", -1, G_MAXINT,
           DEFAULT_NUM_BUFFERS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstFakeSink:measure:
+   *
+   * Measure the throughput, the buffer inter-arrival times and the latency
+   * of the rendered buffers, and print a summary at EOS. The latency is the
+   * difference between the clock time when a buffer is rendered and the
+   * clock time that corresponds to its timestamp.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_MEASURE,
+      g_param_spec_boolean ("measure", "Measure",
+          "Measure throughput and latency and print them at EOS",
+          DEFAULT_MEASURE,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+          G_PARAM_STATIC_STRINGS));
+  /**
+   * GstFakeSink:stats:
+   *
+   * The measurements collected when #GstFakeSink:measure is enabled. The
+   * structure contains the number of buffers and bytes, the rates, the
+   * minimum, average and maximum latency with approximate 50th and 99th
+   * percentiles, and the inter-arrival and latency histograms. Bucket n of
+   * a histogram counts the times between 2^(n-1) and 2^n - 1 nanoseconds.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Throughput and latency measurements", GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
   /**
    * GstFakeSink::handoff:
@@ -252,6 +291,8 @@ gst_fake_sink_init (GstFakeSink * fakesink)
   fakesink->state_error = DEFAULT_STATE_ERROR;
   fakesink->signal_handoffs = DEFAULT_SIGNAL_HANDOFFS;
   fakesink->num_buffers = DEFAULT_NUM_BUFFERS;
+  fakesink->measure = DEFAULT_MEASURE;
+  gst_fake_sink_reset_stats (fakesink);
 
   gst_base_sink_set_sync (GST_BASE_SINK (fakesink), DEFAULT_SYNC);
   gst_base_sink_set_drop_out_of_segment (GST_BASE_SINK (fakesink),
@@ -298,12 +339,217 @@ gst_fake_sink_set_property (GObject * object, guint prop_id,
     case PROP_NUM_BUFFERS:
       sink->num_buffers = g_value_get_int (value);
       break;
+    case PROP_MEASURE:
+      sink->measure = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
+static void
+gst_fake_sink_reset_stats (GstFakeSink * sink)
+{
+  gint i;
+
+  sink->stats_buffers = 0;
+  sink->stats_bytes = 0;
+  sink->stats_first = GST_CLOCK_TIME_NONE;
+  sink->stats_last = GST_CLOCK_TIME_NONE;
+  sink->stats_latencies = 0;
+  sink->stats_latency_sum = 0;
+  sink->stats_latency_min = GST_CLOCK_TIME_NONE;
+  sink->stats_latency_max = 0;
+  for (i = 0; i < FAKE_SINK_HISTOGRAM_SIZE; i++) {
+    g_atomic_int_set (&sink->interval_histogram[i], 0);
+    g_atomic_int_set (&sink->latency_histogram[i], 0);
+  }
+}
+
+/* index of the log2 bucket for @value nanoseconds */
+static inline guint
+gst_fake_sink_histogram_bucket (guint64 value)
+{
+  guint bucket;
+
+  if (value >> 32)
+    bucket = 32 + g_bit_storage ((gulong) (value >> 32));
+  else if (value)
+    bucket = g_bit_storage ((gulong) value);
+  else
+    bucket = 0;
+
+  return MIN (bucket, FAKE_SINK_HISTOGRAM_SIZE - 1);
+}
+
+/* upper bound of the bucket that contains @percent percent of the values */
+static GstClockTime
+gst_fake_sink_histogram_percentile (gint * histogram, guint64 count,
+    guint percent)
+{
+  guint64 target, sum = 0;
+  guint i;
+
+  if (count == 0)
+    return GST_CLOCK_TIME_NONE;
+
+  target = (count * percent + 99) / 100;
+  for (i = 0; i < FAKE_SINK_HISTOGRAM_SIZE - 1; i++) {
+    sum += g_atomic_int_get (&histogram[i]);
+    if (sum >= target)
+      break;
+  }
+
+  return (G_GUINT64_CONSTANT (1) << i) - 1;
+}
+
+/* Called from the streaming thread only. The counters are not protected by
+ * a lock, so a concurrent reader of the stats property may see them
+ * slightly out of sync with each other. */
+static void
+gst_fake_sink_measure (GstFakeSink * sink, GstBuffer * buf)
+{
+  GstBaseSink *bsink = GST_BASE_SINK_CAST (sink);
+  GstClockTime now, running_time, latency;
+  GstClock *clock;
+
+  now = gst_util_get_timestamp ();
+  if (GST_CLOCK_TIME_IS_VALID (sink->stats_last)) {
+    g_atomic_int_inc (&sink->interval_histogram
+        [gst_fake_sink_histogram_bucket (now - sink->stats_last)]);
+  } else {
+    sink->stats_first = now;
+  }
+  sink->stats_last = now;
+  sink->stats_buffers++;
+  sink->stats_bytes += gst_buffer_get_size (buf);
+
+  /* the latency needs a timestamp and a clock to compare it with */
+  if (bsink->segment.format != GST_FORMAT_TIME
+      || !GST_BUFFER_PTS_IS_VALID (buf))
+    return;
+
+  running_time = gst_segment_to_running_time (&bsink->segment,
+      GST_FORMAT_TIME, GST_BUFFER_PTS (buf));
+  if (!GST_CLOCK_TIME_IS_VALID (running_time))
+    return;
+
+  if ((clock = gst_element_get_clock (GST_ELEMENT_CAST (sink))) == NULL)
+    return;
+
+  now = gst_clock_get_time (clock) -
+      gst_element_get_base_time (GST_ELEMENT_CAST (sink));
+  gst_object_unref (clock);
+
+  latency = now > running_time ? now - running_time : 0;
+
+  g_atomic_int_inc (&sink->latency_histogram
+      [gst_fake_sink_histogram_bucket (latency)]);
+  sink->stats_latencies++;
+  sink->stats_latency_sum += latency;
+  sink->stats_latency_min = MIN (sink->stats_latency_min, latency);
+  sink->stats_latency_max = MAX (sink->stats_latency_max, latency);
+}
+
+static void
+gst_fake_sink_set_histogram (GstStructure * s, const gchar * field,
+    gint * histogram)
+{
+  GValue array = G_VALUE_INIT;
+  GValue value = G_VALUE_INIT;
+  gint i;
+
+  g_value_init (&array, GST_TYPE_ARRAY);
+  for (i = 0; i < FAKE_SINK_HISTOGRAM_SIZE; i++) {
+    g_value_init (&value, G_TYPE_INT);
+    g_value_set_int (&value, g_atomic_int_get (&histogram[i]));
+    gst_value_array_append_and_take_value (&array, &value);
+  }
+  gst_structure_take_value (s, field, &array);
+}
+
+static GstStructure *
+gst_fake_sink_get_stats (GstFakeSink * sink)
+{
+  GstStructure *s;
+  GstClockTime duration = 0, latency_avg = GST_CLOCK_TIME_NONE;
+  gdouble buffer_rate = 0.0, byte_rate = 0.0;
+  guint64 buffers, bytes, latencies;
+
+  buffers = sink->stats_buffers;
+  bytes = sink->stats_bytes;
+  latencies = sink->stats_latencies;
+
+  if (GST_CLOCK_TIME_IS_VALID (sink->stats_first))
+    duration = sink->stats_last - sink->stats_first;
+  if (duration > 0) {
+    buffer_rate = (gdouble) buffers * GST_SECOND / duration;
+    byte_rate = (gdouble) bytes * GST_SECOND / duration;
+  }
+  if (latencies > 0)
+    latency_avg = sink->stats_latency_sum / latencies;
+
+  s = gst_structure_new ("application/x-fakesink-stats",
+      "buffers", G_TYPE_UINT64, buffers,
+      "bytes", G_TYPE_UINT64, bytes,
+      "duration", G_TYPE_UINT64, duration,
+      "buffer-rate", G_TYPE_DOUBLE, buffer_rate,
+      "byte-rate", G_TYPE_DOUBLE, byte_rate,
+      "latency-min", G_TYPE_UINT64,
+      latencies > 0 ? sink->stats_latency_min : GST_CLOCK_TIME_NONE,
+      "latency-average", G_TYPE_UINT64, latency_avg,
+      "latency-max", G_TYPE_UINT64,
+      latencies > 0 ? sink->stats_latency_max : GST_CLOCK_TIME_NONE,
+      "latency-p50", G_TYPE_UINT64,
+      gst_fake_sink_histogram_percentile (sink->latency_histogram,
+          latencies, 50),
+      "latency-p99", G_TYPE_UINT64,
+      gst_fake_sink_histogram_percentile (sink->latency_histogram,
+          latencies, 99), NULL);
+
+  gst_fake_sink_set_histogram (s, "interval-histogram",
+      sink->interval_histogram);
+  gst_fake_sink_set_histogram (s, "latency-histogram",
+      sink->latency_histogram);
+
+  return s;
+}
+
+static void
+gst_fake_sink_print_stats (GstFakeSink * sink)
+{
+  GstStructure *s;
+  GstClockTime duration, min, avg, max, p50, p99;
+  guint64 buffers, bytes;
+  gdouble buffer_rate, byte_rate;
+
+  s = gst_fake_sink_get_stats (sink);
+  gst_structure_get (s, "buffers", G_TYPE_UINT64, &buffers,
+      "bytes", G_TYPE_UINT64, &bytes,
+      "duration", G_TYPE_UINT64, &duration,
+      "buffer-rate", G_TYPE_DOUBLE, &buffer_rate,
+      "byte-rate", G_TYPE_DOUBLE, &byte_rate,
+      "latency-min", G_TYPE_UINT64, &min,
+      "latency-average", G_TYPE_UINT64, &avg,
+      "latency-max", G_TYPE_UINT64, &max,
+      "latency-p50", G_TYPE_UINT64, &p50,
+      "latency-p99", G_TYPE_UINT64, &p99, NULL);
+  gst_structure_free (s);
+
+  gst_println ("%s: %" G_GUINT64_FORMAT " buffers, %" G_GUINT64_FORMAT
+      " bytes in %" GST_TIME_FORMAT " - %.0f buffers/s, %.3f MB/s",
+      GST_OBJECT_NAME (sink), buffers, bytes, GST_TIME_ARGS (duration),
+      buffer_rate, byte_rate / (1024 * 1024));
+  if (GST_CLOCK_TIME_IS_VALID (avg)) {
+    gst_println ("%s: latency min %" GST_TIME_FORMAT ", average %"
+        GST_TIME_FORMAT ", max %" GST_TIME_FORMAT ", p50 < %" GST_TIME_FORMAT
+        ", p99 < %" GST_TIME_FORMAT, GST_OBJECT_NAME (sink),
+        GST_TIME_ARGS (min), GST_TIME_ARGS (avg), GST_TIME_ARGS (max),
+        GST_TIME_ARGS (p50 + 1), GST_TIME_ARGS (p99 + 1));
+  }
+}
+
 static void
 gst_fake_sink_get_property (GObject * object, guint prop_id, GValue * value,
     GParamSpec * pspec)
@@ -343,6 +589,12 @@ gst_fake_sink_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_NUM_BUFFERS:
       g_value_set_int (value, sink->num_buffers);
       break;
+    case PROP_MEASURE:
+      g_value_set_boolean (value, sink->measure);
+      break;
+    case PROP_STATS:
+      g_value_take_boxed (value, gst_fake_sink_get_stats (sink));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -400,6 +652,9 @@ gst_fake_sink_event (GstBaseSink * bsink, GstEvent * event)
     gst_fake_sink_notify_last_message (sink);
   }
 
+  if (GST_EVENT_TYPE (event) == GST_EVENT_EOS && sink->measure)
+    gst_fake_sink_print_stats (sink);
+
   return GST_BASE_SINK_CLASS (parent_class)->event (bsink, event);
 }
 
@@ -446,6 +701,9 @@ gst_fake_sink_render (GstBaseSink * bsink, GstBuffer * buf)
   if (sink->num_buffers_left != -1)
     sink->num_buffers_left--;
 
+  if (sink->measure)
+    gst_fake_sink_measure (sink, buf);
+
   if (!sink->silent) {
     gchar dts_str[64], pts_str[64], dur_str[64];
     gchar *flag_str, *meta_str;
@@ -555,6 +813,7 @@ gst_fake_sink_change_state (GstElement * element, GstStateChange transition)
       if (fakesink->state_error == FAKE_SINK_STATE_ERROR_READY_PAUSED)
         goto error;
       fakesink->num_buffers_left = fakesink->num_buffers;
+      gst_fake_sink_reset_stats (fakesink);
       break;
     case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
       if (fakesink->state_error == FAKE_SINK_STATE_ERROR_PAUSED_PLAYING)
@@ -64,6 +64,9 @@ typedef enum {
   FAKE_SINK_STATE_ERROR_READY_NULL
 } GstFakeSinkStateError;
 
+/* number of log2 buckets of the measurement histograms */
+#define FAKE_SINK_HISTOGRAM_SIZE 64
+
 typedef struct _GstFakeSink GstFakeSink;
 typedef struct _GstFakeSinkClass GstFakeSinkClass;
 
@@ -82,6 +85,19 @@ struct _GstFakeSink {
   gchar			*last_message;
   gint                  num_buffers;
   gint                  num_buffers_left;
+
+  /* measurements, only written by the streaming thread */
+  gboolean              measure;
+  guint64               stats_buffers;
+  guint64               stats_bytes;
+  GstClockTime          stats_first;
+  GstClockTime          stats_last;
+  guint64               stats_latencies;
+  GstClockTime          stats_latency_sum;
+  GstClockTime          stats_latency_min;
+  GstClockTime          stats_latency_max;
+  gint                  interval_histogram[FAKE_SINK_HISTOGRAM_SIZE];
+  gint                  latency_histogram[FAKE_SINK_HISTOGRAM_SIZE];
 };
 
 struct _GstFakeSinkClass {
@@ -36,6 +36,14 @@
  * ]| This pipeline will push 5 empty buffers to the fakesink element and then
  * sends an EOS.
  *
+ * |[
+ * gst-launch-1.0 fakesrc data=pool sizetype=normal sizemin=500 sizemax=1500 \
+ *     filltype=nothing buffer-rate=100000 list-size=32 sync=true ! \
+ *     fakesink measure=true
+ * ]| This pipeline generates 100000 buffers per second of around 1000 bytes,
+ * recycled from a buffer pool and pushed in lists of 32 buffers, and prints
+ * the throughput and latency measured by the fakesink at EOS.
+ *
  */
 
 /* FIXME: this ignores basesrc::blocksize property, which could be used as an
@@ -46,6 +54,7 @@
 #  include "config.h"
 #endif
 
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -75,6 +84,8 @@ enum
 #define DEFAULT_SIZEMAX         4096
 #define DEFAULT_FILLTYPE        FAKE_SRC_FILLTYPE_ZERO
 #define DEFAULT_DATARATE        0
+#define DEFAULT_BUFFER_RATE     0
+#define DEFAULT_LIST_SIZE       1
 #define DEFAULT_SYNC            FALSE
 #define DEFAULT_PATTERN         NULL
 #define DEFAULT_EOS             FALSE
@@ -108,6 +119,8 @@ enum
   PROP_CAN_ACTIVATE_PUSH,
   PROP_IS_LIVE,
   PROP_FORMAT,
+  PROP_BUFFER_RATE,
+  PROP_LIST_SIZE,
   PROP_LAST,
 };
 
@@ -145,6 +158,7 @@ gst_fake_src_data_get_type (void)
   static const GEnumValue fakesrc_data[] = {
     {FAKE_SRC_DATA_ALLOCATE, "Allocate data", "allocate"},
     {FAKE_SRC_DATA_SUBBUFFER, "Subbuffer data", "subbuffer"},
+    {FAKE_SRC_DATA_POOL, "Buffer pool data", "pool"},
     {0, NULL, NULL},
   };
 
@@ -165,6 +179,11 @@ gst_fake_src_sizetype_get_type (void)
     {FAKE_SRC_SIZETYPE_FIXED, "Fixed size buffers (sizemax sized)", "fixed"},
     {FAKE_SRC_SIZETYPE_RANDOM,
         "Random sized buffers (sizemin <= size <= sizemax)", "random"},
+    {FAKE_SRC_SIZETYPE_NORMAL,
+        "Normal distributed sizes around (sizemin + sizemax) / 2", "normal"},
+    {FAKE_SRC_SIZETYPE_EXPONENTIAL,
+        "Exponential distributed sizes from sizemin up to sizemax",
+        "exponential"},
     {0, NULL, NULL},
   };
 
@@ -276,9 +295,36 @@ gst_fake_src_class_init (GstFakeSrcClass * klass)
           "Timestamps buffers with number of bytes per second (0 = none)", 0,
           G_MAXINT, DEFAULT_DATARATE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstFakeSrc:buffer-rate:
+   *
+   * Timestamps buffers with a fixed number of buffers per second. Every
+   * timestamp is computed from the number of buffers sent so far, so together
+   * with #GstFakeSrc:sync the buffers are paced against the clock without
+   * drift. Takes precedence over #GstFakeSrc:datarate.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_BUFFER_RATE,
+      g_param_spec_uint ("buffer-rate", "Buffer rate",
+          "Timestamps buffers with number of buffers per second (0 = none)", 0,
+          G_MAXINT, DEFAULT_BUFFER_RATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
   g_object_class_install_property (gobject_class, PROP_SYNC,
       g_param_spec_boolean ("sync", "Sync", "Sync to the clock to the datarate",
           DEFAULT_SYNC, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstFakeSrc:list-size:
+   *
+   * Number of buffers to push at once in a #GstBufferList when operating in
+   * push mode. #GstBaseSrc:num-buffers then counts buffer lists.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_LIST_SIZE,
+      g_param_spec_uint ("list-size", "List size",
+          "Number of buffers to push in one buffer list", 1, G_MAXUINT16,
+          DEFAULT_LIST_SIZE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
   /*  FIXME 2.0: Remove unused pattern property. Not implemented */
   g_object_class_install_property (gobject_class, PROP_PATTERN,
       g_param_spec_string ("pattern", "pattern", "Set the pattern (unused)",
@@ -367,8 +413,11 @@ gst_fake_src_init (GstFakeSrc * fakesrc)
   fakesrc->parentsize = DEFAULT_PARENTSIZE;
   fakesrc->last_message = NULL;
   fakesrc->datarate = DEFAULT_DATARATE;
+  fakesrc->buffer_rate = DEFAULT_BUFFER_RATE;
+  fakesrc->list_size = DEFAULT_LIST_SIZE;
   fakesrc->sync = DEFAULT_SYNC;
   fakesrc->format = DEFAULT_FORMAT;
+  fakesrc->rand = g_rand_new ();
 }
 
 static void
@@ -383,6 +432,7 @@ gst_fake_src_finalize (GObject * object)
     gst_buffer_unref (src->parent);
     src->parent = NULL;
   }
+  g_rand_free (src->rand);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -433,6 +483,29 @@ gst_fake_src_alloc_parent (GstFakeSrc * src)
   src->parentoffset = 0;
 }
 
+static void
+gst_fake_src_free_pool (GstFakeSrc * src)
+{
+  if (src->pool) {
+    gst_buffer_pool_set_active (src->pool, FALSE);
+    gst_object_unref (src->pool);
+    src->pool = NULL;
+  }
+}
+
+static gboolean
+gst_fake_src_alloc_pool (GstFakeSrc * src, guint size)
+{
+  gst_fake_src_free_pool (src);
+
+  /* keep enough buffers around for a whole list in flight */
+  src->pool_size = MAX (size, src->sizemax);
+  src->pool = gst_elements_resize_pool_new (src->pool_size, src->list_size,
+      NULL);
+
+  return src->pool != NULL;
+}
+
 static void
 gst_fake_src_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
@@ -478,6 +551,12 @@ gst_fake_src_set_property (GObject * object, guint prop_id,
     case PROP_DATARATE:
       src->datarate = g_value_get_int (value);
       break;
+    case PROP_BUFFER_RATE:
+      src->buffer_rate = g_value_get_uint (value);
+      break;
+    case PROP_LIST_SIZE:
+      src->list_size = g_value_get_uint (value);
+      break;
     case PROP_SYNC:
       src->sync = g_value_get_boolean (value);
       break;
@@ -551,6 +630,12 @@ gst_fake_src_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_DATARATE:
       g_value_set_int (value, src->datarate);
       break;
+    case PROP_BUFFER_RATE:
+      g_value_set_uint (value, src->buffer_rate);
+      break;
+    case PROP_LIST_SIZE:
+      g_value_set_uint (value, src->list_size);
+      break;
     case PROP_SYNC:
       g_value_set_boolean (value, src->sync);
       break;
@@ -604,7 +689,7 @@ gst_fake_src_prepare_buffer (GstFakeSrc * src, guint8 * data, gsize size)
       guint8 *ptr = data;
 
       for (i = size; i; i--) {
-        *ptr++ = g_random_int_range (0, 256);
+        *ptr++ = g_rand_int_range (src->rand, 0, 256);
       }
       break;
     }
@@ -664,14 +749,32 @@ gst_fake_src_alloc_buffer (GstFakeSrc * src, guint size)
 static guint
 gst_fake_src_get_size (GstFakeSrc * src)
 {
+  gdouble range = (gdouble) src->sizemax - src->sizemin;
+  gdouble value;
   guint size;
+  gint i;
 
   switch (src->sizetype) {
     case FAKE_SRC_SIZETYPE_FIXED:
       size = src->sizemax;
       break;
     case FAKE_SRC_SIZETYPE_RANDOM:
-      size = g_random_int_range (src->sizemin, src->sizemax);
+      size = g_rand_int_range (src->rand, src->sizemin, src->sizemax);
+      break;
+    case FAKE_SRC_SIZETYPE_NORMAL:
+      /* the sum of 12 uniform values approximates a normal distribution with
+       * a standard deviation of 1, scale it so that sizemin and sizemax are
+       * 3 standard deviations away from the mean */
+      value = -6.0;
+      for (i = 0; i < 12; i++)
+        value += g_rand_double (src->rand);
+      value = src->sizemin + range / 2 + value * range / 6;
+      size = CLAMP (value, src->sizemin, src->sizemax);
+      break;
+    case FAKE_SRC_SIZETYPE_EXPONENTIAL:
+      /* mean of a tenth of the range above sizemin */
+      value = src->sizemin - log (1.0 - g_rand_double (src->rand)) * range / 10;
+      size = MIN (value, src->sizemax);
       break;
     case FAKE_SRC_SIZETYPE_EMPTY:
     default:
@@ -722,6 +825,23 @@ gst_fake_src_create_buffer (GstFakeSrc * src, gsize * bufsize)
       gst_fake_src_prepare_buffer (src, info.data, info.size);
       gst_buffer_unmap (buf, &info);
       break;
+    case FAKE_SRC_DATA_POOL:
+      if (!src->pool || size > src->pool_size) {
+        if (!gst_fake_src_alloc_pool (src, size))
+          goto buffer_create_fail;
+      }
+      if (gst_buffer_pool_acquire_buffer (src->pool, &buf,
+              NULL) != GST_FLOW_OK)
+        goto buffer_create_fail;
+      gst_buffer_resize (buf, 0, size);
+      /* recycled buffers still hold their old data, only fill when asked to */
+      if (src->filltype != FAKE_SRC_FILLTYPE_NOTHING) {
+        if (!gst_buffer_map (buf, &info, GST_MAP_WRITE))
+          goto buffer_write_fail;
+        gst_fake_src_prepare_buffer (src, info.data, info.size);
+        gst_buffer_unmap (buf, &info);
+      }
+      break;
     default:
       g_warning ("fakesrc: dunno how to allocate buffers !");
       buf = gst_buffer_new ();
@@ -783,24 +903,30 @@ gst_fake_src_get_times (GstBaseSrc * basesrc, GstBuffer * buffer,
   }
 }
 
-static GstFlowReturn
-gst_fake_src_create (GstBaseSrc * basesrc, guint64 offset, guint length,
-    GstBuffer ** ret)
+static void
+gst_fake_src_finish_buffer (GstFakeSrc * src, GstBuffer * buf, guint64 offset,
+    gsize size)
 {
-  GstFakeSrc *src;
-  GstBuffer *buf;
+  GstBaseSrc *basesrc = GST_BASE_SRC_CAST (src);
   GstClockTime time;
-  gsize size;
 
-  src = GST_FAKE_SRC (basesrc);
-
-  buf = gst_fake_src_create_buffer (src, &size);
   GST_BUFFER_OFFSET (buf) = offset;
 
-  if (src->datarate > 0) {
-    time = (src->bytes_sent * GST_SECOND) / src->datarate;
-
-    GST_BUFFER_DURATION (buf) = size * GST_SECOND / src->datarate;
+  if (src->buffer_rate > 0) {
+    /* derive every timestamp from the buffer count so that rounding errors
+     * don't add up */
+    time = gst_util_uint64_scale_int (src->buffers_sent, GST_SECOND,
+        src->buffer_rate);
+
+    GST_BUFFER_DURATION (buf) =
+        gst_util_uint64_scale_int (src->buffers_sent + 1, GST_SECOND,
+        src->buffer_rate) - time;
+  } else if (src->datarate > 0) {
+    time = gst_util_uint64_scale_int (src->bytes_sent, GST_SECOND,
+        src->datarate);
+
+    GST_BUFFER_DURATION (buf) =
+        gst_util_uint64_scale_int (size, GST_SECOND, src->datarate);
   } else if (gst_base_src_is_live (basesrc)) {
     GstClock *clock;
 
@@ -870,9 +996,56 @@ gst_fake_src_create (GstBaseSrc * basesrc, guint64 offset, guint length,
   }
 
   src->bytes_sent += size;
+  src->buffers_sent++;
+}
+
+static GstFlowReturn
+gst_fake_src_create (GstBaseSrc * basesrc, guint64 offset, guint length,
+    GstBuffer ** ret)
+{
+  GstFakeSrc *src;
+  GstBufferList *list;
+  GstBuffer *buf;
+  gsize size;
+  guint i;
+
+  src = GST_FAKE_SRC (basesrc);
+
+  /* buffer lists can only be pushed, pull mode needs a single buffer */
+  if (src->list_size > 1
+      && GST_PAD_MODE (basesrc->srcpad) == GST_PAD_MODE_PUSH) {
+    list = gst_buffer_list_new_sized (src->list_size);
+
+    for (i = 0; i < src->list_size; i++) {
+      buf = gst_fake_src_create_buffer (src, &size);
+      if (buf == NULL)
+        goto list_create_fail;
+
+      gst_fake_src_finish_buffer (src, buf, offset, size);
+      offset += size;
+      gst_buffer_list_add (list, buf);
+    }
+
+    gst_base_src_submit_buffer_list (basesrc, list);
+    *ret = NULL;
+    return GST_FLOW_OK;
+  }
+
+  buf = gst_fake_src_create_buffer (src, &size);
+  if (buf == NULL)
+    return GST_FLOW_ERROR;
+
+  gst_fake_src_finish_buffer (src, buf, offset, size);
 
   *ret = buf;
   return GST_FLOW_OK;
+
+  /* ERRORS */
+list_create_fail:
+  {
+    gst_buffer_list_unref (list);
+    return GST_FLOW_ERROR;
+  }
 }
 
 static gboolean
@@ -884,6 +1057,7 @@ gst_fake_src_start (GstBaseSrc * basesrc)
 
   src->pattern_byte = 0x00;
   src->bytes_sent = 0;
+  src->buffers_sent = 0;
 
   gst_base_src_set_format (basesrc, src->format);
 
@@ -902,6 +1076,7 @@ gst_fake_src_stop (GstBaseSrc * basesrc)
     gst_buffer_unref (src->parent);
     src->parent = NULL;
   }
+  gst_fake_src_free_pool (src);
   g_free (src->last_message);
   src->last_message = NULL;
   GST_OBJECT_UNLOCK (src);
@@ -57,12 +57,14 @@ typedef enum {
  * GstFakeSrcDataType:
  * @FAKE_SRC_DATA_ALLOCATE: allocate buffers
  * @FAKE_SRC_DATA_SUBBUFFER: subbuffer each buffer
+ * @FAKE_SRC_DATA_POOL: acquire buffers from a buffer pool (Since: 1.16)
  *
  * The different ways buffers are allocated.
  */
 typedef enum {
   FAKE_SRC_DATA_ALLOCATE = 1,
-  FAKE_SRC_DATA_SUBBUFFER
+  FAKE_SRC_DATA_SUBBUFFER,
+  FAKE_SRC_DATA_POOL
 } GstFakeSrcDataType;
 
 /**
@@ -70,13 +72,19 @@ typedef enum {
  * @FAKE_SRC_SIZETYPE_EMPTY: create empty buffers
  * @FAKE_SRC_SIZETYPE_FIXED: fixed buffer size (sizemax sized)
  * @FAKE_SRC_SIZETYPE_RANDOM: random buffer size (sizemin <= size <= sizemax)
+ * @FAKE_SRC_SIZETYPE_NORMAL: normally distributed buffer size around the
+ *     middle of sizemin and sizemax (Since: 1.16)
+ * @FAKE_SRC_SIZETYPE_EXPONENTIAL: exponentially distributed buffer size
+ *     starting at sizemin, limited to sizemax (Since: 1.16)
  *
  * The different size of the allocated buffers.
  */
 typedef enum {
   FAKE_SRC_SIZETYPE_EMPTY = 1,
   FAKE_SRC_SIZETYPE_FIXED,
-  FAKE_SRC_SIZETYPE_RANDOM
+  FAKE_SRC_SIZETYPE_RANDOM,
+  FAKE_SRC_SIZETYPE_NORMAL,
+  FAKE_SRC_SIZETYPE_EXPONENTIAL
 } GstFakeSrcSizeType;
 
 /**
@@ -136,6 +144,11 @@ struct _GstFakeSrc {
   guint8	 pattern_byte;
   GList		*patternlist;
   gint		 datarate;
+  guint		 buffer_rate;
+  guint		 list_size;
+  GstBufferPool	*pool;
+  guint		 pool_size;
+  GRand		*rand;
   gboolean	 sync;
   GstClock	*clock;
 
@@ -146,6 +159,7 @@ struct _GstFakeSrc {
   GstFormat      format;
 
   guint64        bytes_sent;
+  guint64        buffers_sent;
 
   gchar		*last_message;
 };
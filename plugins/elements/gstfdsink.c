@@ -30,12 +30,22 @@
  * This element will synchronize on the clock before writing the data on the
  * socket. For file descriptors where this does not make sense (files, ...) the
  * #GstBaseSink:sync property can be used to disable synchronisation.
+ *
+ * With #GstFdSink:zero-copy, data written to a pipe or a TCP socket on Linux
+ * is not copied into the kernel. The kernel reads it directly from the buffer
+ * memory, and the buffers are kept alive until it did.
+ *
+ * With #GstFdSink:io-uring, writes to a regular file are queued with
+ * io_uring and rendering doesn't wait for them to complete.
  */
 
 #ifdef HAVE_CONFIG_H
 #  include "config.h"
 #endif
 
+/* for vmsplice() */
+#define _GNU_SOURCE 1
+
 #include "../../gst/gst-i18n-lib.h"
 
 #include <sys/types.h>
@@ -58,6 +68,20 @@
 #include <errno.h>
 #include <string.h>
 
+#if defined (HAVE_VMSPLICE) && defined (SPLICE_F_NONBLOCK)
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#define USE_VMSPLICE 1
+#endif
+
+#if defined (HAVE_LINUX_ERRQUEUE_H) && defined (HAVE_SYS_SOCKET_H)
+#include <sys/uio.h>
+#include <linux/errqueue.h>
+#if defined (SO_ZEROCOPY) && defined (MSG_ZEROCOPY) && defined (SO_EE_ORIGIN_ZEROCOPY)
+#define USE_MSG_ZEROCOPY 1
+#endif
+#endif
+
 #include "gstfdsink.h"
 #include "gstelements_private.h"
 
@@ -95,9 +119,48 @@ enum
 enum
 {
   ARG_0,
-  ARG_FD
+  ARG_FD,
+  ARG_ZERO_COPY,
+  ARG_ZERO_COPY_PIPE,
+  ARG_IO_URING,
+  ARG_IO_DEPTH
 };
 
+#define DEFAULT_ZERO_COPY FALSE
+#define DEFAULT_ZERO_COPY_PIPE FALSE
+#define DEFAULT_IO_URING FALSE
+#define DEFAULT_IO_DEPTH 4
+
+/* below this size, pinning the pages costs more than copying them */
+#define ZERO_COPY_MIN_SIZE (16 * 1024)
+
+/* how long to wait on stop for the kernel to let go of the memory */
+#define ZERO_COPY_DRAIN_TIMEOUT (G_USEC_PER_SEC)
+
+/* how long to back off when a socket runs out of memory for pinning pages
+ * without any send in flight that could complete */
+#define ZERO_COPY_NOBUFS_TIMEOUT (10 * GST_MSECOND)
+
+#ifndef UIO_MAXIOV
+#define UIO_MAXIOV 512
+#endif
+
+enum
+{
+  ZERO_COPY_NONE,
+  ZERO_COPY_PIPE,
+  ZERO_COPY_SOCKET
+};
+
+/* A buffer or buffer list written without copying. For pipes, @done is the
+ * number of bytes spliced up to its end, for sockets it is the id of the
+ * last send that used its memory. */
+typedef struct
+{
+  GstMiniObject *obj;
+  guint64 done;
+} GstFdSinkPending;
+
 static void gst_fd_sink_uri_handler_init (gpointer g_iface,
     gpointer iface_data);
 
@@ -126,6 +189,12 @@ static gboolean gst_fd_sink_event (GstBaseSink * sink, GstEvent * event);
 
 static gboolean gst_fd_sink_do_seek (GstFdSink * fdsink, guint64 new_offset);
 
+static void gst_fd_sink_setup_zero_copy (GstFdSink * fdsink);
+static void gst_fd_sink_release_pending (GstFdSink * fdsink);
+
+static void gst_fd_sink_setup_uring (GstFdSink * fdsink);
+static gboolean gst_fd_sink_uring_drain (GstFdSink * fdsink);
+
 static void
 gst_fd_sink_class_init (GstFdSinkClass * klass)
 {
@@ -159,6 +228,80 @@ gst_fd_sink_class_init (GstFdSinkClass * klass)
   g_object_class_install_property (gobject_class, ARG_FD,
       g_param_spec_int ("fd", "fd", "An open file descriptor to write to",
           0, G_MAXINT, 1, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstFdSink:zero-copy:
+   *
+   * Let the kernel read buffers of at least 16kB directly from their memory
+   * instead of copying them. Sockets are written with MSG_ZEROCOPY, and
+   * buffers stay referenced until the socket reported the send as
+   * completed. Pipes are only written without copying when
+   * #GstFdSink:zero-copy-pipe is set as well. On other file descriptors,
+   * and where this isn't supported, data is copied as usual.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, ARG_ZERO_COPY,
+      g_param_spec_boolean ("zero-copy", "Zero copy",
+          "Let the kernel read the data from the buffers without copying",
+          DEFAULT_ZERO_COPY, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  /**
+   * GstFdSink:zero-copy-pipe:
+   *
+   * Write pipes with vmsplice() in #GstFdSink:zero-copy mode. The pipe then
+   * holds references to the pages of the buffers instead of a copy, and a
+   * buffer is released once the pipe no longer contains any of its data.
+   *
+   * The sink can't tell what happens to the pages after they left the pipe,
+   * so this is only safe when the reader copies the data out of the pipe
+   * with read() or similar, and nothing else writes to the pipe. A reader
+   * that splice()s or tee()s the data on keeps referencing the pages after
+   * they were released, and sees them change when the memory is reused.
+   *
+   * The reader must also consume the data before the sink is stopped,
+   * buffers that are still in the pipe after a short wait are leaked rather
+   * than reused.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, ARG_ZERO_COPY_PIPE,
+      g_param_spec_boolean ("zero-copy-pipe", "Zero copy pipe",
+          "Splice the data into pipes without copying, only safe when the "
+          "sink is the only writer and the reader copies the data out",
+          DEFAULT_ZERO_COPY_PIPE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  /**
+   * GstFdSink:io-uring:
+   *
+   * Queue writes to a regular file with io_uring and keep up to
+   * #GstFdSink:io-depth of them in flight. Buffers stay referenced until
+   * their write completed, and write errors are reported for a later buffer.
+   * Pipes and sockets, files that are appended to, and file descriptors in
+   * #GstFdSink:zero-copy mode, are written as usual.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, ARG_IO_URING,
+      g_param_spec_boolean ("io-uring", "io_uring",
+          "Queue the writes to regular files with io_uring", DEFAULT_IO_URING,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  /**
+   * GstFdSink:io-depth:
+   *
+   * Number of writes in flight in #GstFdSink:io-uring mode.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, ARG_IO_DEPTH,
+      g_param_spec_uint ("io-depth", "I/O depth",
+          "Number of writes in flight in io-uring mode", 1, 256,
+          DEFAULT_IO_DEPTH, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
 }
 
 static void
@@ -168,6 +311,12 @@ gst_fd_sink_init (GstFdSink * fdsink)
   fdsink->uri = g_strdup_printf ("fd://%d", fdsink->fd);
   fdsink->bytes_written = 0;
   fdsink->current_pos = 0;
+  fdsink->zero_copy = DEFAULT_ZERO_COPY;
+  fdsink->zero_copy_pipe = DEFAULT_ZERO_COPY_PIPE;
+  fdsink->zc_fd = -1;
+  fdsink->io_uring = DEFAULT_IO_URING;
+  fdsink->io_depth = DEFAULT_IO_DEPTH;
+  fdsink->ring_fd = -1;
 
   gst_base_sink_set_sync (GST_BASE_SINK (fdsink), FALSE);
 }
@@ -238,18 +387,395 @@ gst_fd_sink_query (GstBaseSink * bsink, GstQuery * query)
   return res;
 }
 
+#if defined (USE_VMSPLICE) || defined (USE_MSG_ZEROCOPY)
+static void
+gst_fd_sink_pending_clear (GstFdSinkPending * pending)
+{
+  gst_mini_object_unref (pending->obj);
+}
+
+/* pipes: whatever is no longer in the pipe was read, and copied out as
+ * promised by zero-copy-pipe */
+static void
+gst_fd_sink_reclaim_pipe (GstFdSink * sink)
+{
+#ifdef USE_VMSPLICE
+  GstFdSinkPending *pending;
+  gint queued;
+  guint64 consumed;
+
+  if (ioctl (sink->zc_fd, FIONREAD, &queued) < 0)
+    return;
+
+  consumed = sink->zc_sent - MIN (queued, sink->zc_sent);
+  while ((pending = gst_queue_array_peek_head_struct (sink->pending)) &&
+      pending->done <= consumed) {
+    gst_fd_sink_pending_clear (pending);
+    gst_queue_array_pop_head_struct (sink->pending);
+  }
+#endif
+}
+
+#ifdef USE_MSG_ZEROCOPY
+/* Sends [@lo, @hi] completed. Completions normally arrive in order, the ones
+ * that don't are kept until the gap before them is filled. */
+static void
+gst_fd_sink_complete_sends (GstFdSink * sink, guint32 lo, guint32 hi)
+{
+  guint32 range[2] = { lo, hi };
+  gboolean merged;
+  guint i;
+
+  g_array_append_vals (sink->zc_ranges, range, 2);
+
+  do {
+    merged = FALSE;
+    for (i = 0; i < sink->zc_ranges->len / 2; i++) {
+      guint32 *r = &g_array_index (sink->zc_ranges, guint32, 2 * i);
+
+      if ((gint32) (r[0] - sink->zc_completed) > 0)
+        continue;
+      if ((gint32) (r[1] + 1 - sink->zc_completed) > 0)
+        sink->zc_completed = r[1] + 1;
+      g_array_remove_range (sink->zc_ranges, 2 * i, 2);
+      merged = TRUE;
+      break;
+    }
+  } while (merged);
+}
+#endif
+
+/* sockets: read the completion notifications from the error queue */
+static void
+gst_fd_sink_reclaim_socket (GstFdSink * sink)
+{
+#ifdef USE_MSG_ZEROCOPY
+  GstFdSinkPending *pending;
+
+  while (TRUE) {
+    struct msghdr msg = { 0, };
+    gchar control[128];
+    struct cmsghdr *cm;
+
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof (control);
+    if (recvmsg (sink->zc_fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+      break;
+
+    for (cm = CMSG_FIRSTHDR (&msg); cm; cm = CMSG_NXTHDR (&msg, cm)) {
+      struct sock_extended_err *serr;
+
+      serr = (struct sock_extended_err *) CMSG_DATA (cm);
+      if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+        continue;
+      if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+        GST_LOG_OBJECT (sink, "kernel copied sends %u-%u", serr->ee_info,
+            serr->ee_data);
+      gst_fd_sink_complete_sends (sink, serr->ee_info, serr->ee_data);
+    }
+  }
+
+  while ((pending = gst_queue_array_peek_head_struct (sink->pending)) &&
+      (gint32) ((guint32) pending->done - sink->zc_completed) < 0) {
+    gst_fd_sink_pending_clear (pending);
+    gst_queue_array_pop_head_struct (sink->pending);
+  }
+#endif
+}
+
+static void
+gst_fd_sink_reclaim (GstFdSink * sink)
+{
+  if (sink->zero_copy_mode == ZERO_COPY_PIPE)
+    gst_fd_sink_reclaim_pipe (sink);
+  else
+    gst_fd_sink_reclaim_socket (sink);
+}
+
+#ifdef USE_MSG_ZEROCOPY
+/* sockets: wait for the completions of earlier sends to show up on the error
+ * queue, which unpins their pages. Returns FALSE with errno set when the
+ * wait failed or was interrupted. */
+static gboolean
+gst_fd_sink_wait_completions (GstFdSink * sink)
+{
+  GstPollFD fd = GST_POLL_FD_INIT;
+  GstClockTime timeout;
+  gint ret, err;
+
+  /* nothing in flight, so no completion will come, only back off */
+  timeout = gst_queue_array_is_empty (sink->pending) ?
+      ZERO_COPY_NOBUFS_TIMEOUT : GST_CLOCK_TIME_NONE;
+
+  /* errors are always reported, the socket being writable would only wake
+   * us up right away */
+  fd.fd = sink->fd;
+  gst_poll_fd_ctl_write (sink->fdset, &fd, FALSE);
+  do {
+    GST_DEBUG_OBJECT (sink, "waiting for send completions");
+    ret = gst_poll_wait (sink->fdset, timeout);
+  } while (ret == -1 && (errno == EINTR || errno == EAGAIN));
+  err = errno;
+  gst_poll_fd_ctl_write (sink->fdset, &fd, TRUE);
+  errno = err;
+
+  return ret != -1;
+}
+#endif
+
+/* Like gst_writev_buffers(), but the kernel takes the data straight from the
+ * buffer memory. That memory can't change while we hold a reference to @obj,
+ * so @obj is kept in the pending queue until the kernel is done with it. */
+static GstFlowReturn
+gst_fd_sink_write_zero_copy (GstFdSink * sink, GstMiniObject * obj,
+    GstBuffer ** buffers, guint num_buffers, guint total_mems,
+    guint64 * bytes_written, guint64 skip)
+{
+  struct iovec *vecs;
+  GstMapInfo *maps;
+  GstFlowReturn flow_ret = GST_FLOW_OK;
+  gsize left = 0;
+  guint i, j, n_maps = 0, n_vecs;
+  gboolean used = FALSE;
+
+  vecs = g_newa (struct iovec, total_mems);
+  maps = g_newa (GstMapInfo, total_mems);
+
+  for (i = 0; i < num_buffers; i++) {
+    for (j = 0; j < gst_buffer_n_memory (buffers[i]); j++) {
+      GstMemory *mem = gst_buffer_peek_memory (buffers[i], j);
+
+      if (!gst_memory_map (mem, &maps[n_maps], GST_MAP_READ))
+        goto map_failed;
+      vecs[n_maps].iov_base = maps[n_maps].data;
+      vecs[n_maps].iov_len = maps[n_maps].size;
+      left += maps[n_maps].size;
+      n_maps++;
+    }
+  }
+  n_vecs = n_maps;
+
+  while (left > 0) {
+    gssize ret;
+
+    /* skip what was written before we were unlocked */
+    if (skip > 0) {
+      ret = skip;
+      skip = 0;
+      goto advance;
+    }
+
+    do {
+      GST_DEBUG_OBJECT (sink, "going into select, have %" G_GSIZE_FORMAT
+          " bytes to write", left);
+      ret = gst_poll_wait (sink->fdset, GST_CLOCK_TIME_NONE);
+    } while (ret == -1 && (errno == EINTR || errno == EAGAIN));
+
+    if (ret == -1) {
+      if (errno == EBUSY)
+        goto stopped;
+      else
+        goto select_error;
+    }
+
+    if (sink->zero_copy_mode == ZERO_COPY_PIPE) {
+#ifdef USE_VMSPLICE
+      ret = vmsplice (sink->fd, vecs, MIN (n_vecs, UIO_MAXIOV),
+          SPLICE_F_NONBLOCK);
+      if (ret > 0)
+        sink->zc_sent += ret;
+#endif
+    } else {
+#ifdef USE_MSG_ZEROCOPY
+      struct msghdr msg = { 0, };
+
+      msg.msg_iov = vecs;
+      msg.msg_iovlen = MIN (n_vecs, UIO_MAXIOV);
+      ret = sendmsg (sink->fd, &msg, MSG_ZEROCOPY | MSG_DONTWAIT);
+      /* the kernel numbers the sends that queued data */
+      if (ret > 0)
+        sink->zc_sent++;
+#endif
+    }
+
+    if (ret < 0) {
+      if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)
+        continue;
+      /* out of memory for pinning pages until earlier sends complete */
+#ifdef USE_MSG_ZEROCOPY
+      if (errno == ENOBUFS && sink->zero_copy_mode == ZERO_COPY_SOCKET) {
+        gst_fd_sink_reclaim (sink);
+        if (gst_fd_sink_wait_completions (sink))
+          continue;
+        if (errno == EBUSY)
+          goto stopped;
+        goto select_error;
+      }
+#endif
+      goto write_error;
+    }
+
+    used = TRUE;
+    if (bytes_written)
+      *bytes_written += ret;
+
+  advance:
+    left -= ret;
+    /* skip vectors that have been written in full */
+    while (n_vecs > 0 && ret >= vecs[0].iov_len) {
+      ret -= vecs[0].iov_len;
+      ++vecs;
+      --n_vecs;
+    }
+    /* skip partially written vector data */
+    if (ret > 0) {
+      vecs[0].iov_len -= ret;
+      vecs[0].iov_base = ((guint8 *) vecs[0].iov_base) + ret;
+    }
+  }
+
+out:
+  if (used) {
+    GstFdSinkPending pending;
+
+    pending.obj = gst_mini_object_ref (obj);
+    pending.done = sink->zero_copy_mode == ZERO_COPY_PIPE ?
+        sink->zc_sent : sink->zc_sent - 1;
+    gst_queue_array_push_tail_struct (sink->pending, &pending);
+  }
+
+  for (i = 0; i < n_maps; ++i)
+    gst_memory_unmap (maps[i].memory, &maps[i]);
+
+  gst_fd_sink_reclaim (sink);
+
+  return flow_ret;
+
+  /* ERRORS */
+map_failed:
+  {
+    GST_ELEMENT_ERROR (sink, RESOURCE, READ, (NULL),
+        ("Failed to map memory for reading"));
+    flow_ret = GST_FLOW_ERROR;
+    goto out;
+  }
+select_error:
+  {
+    GST_ELEMENT_ERROR (sink, RESOURCE, READ, (NULL),
+        ("select on file descriptor: %s", g_strerror (errno)));
+    GST_DEBUG_OBJECT (sink, "Error during select: %s", g_strerror (errno));
+    flow_ret = GST_FLOW_ERROR;
+    goto out;
+  }
+stopped:
+  {
+    GST_DEBUG_OBJECT (sink, "Select stopped");
+    flow_ret = GST_FLOW_FLUSHING;
+    goto out;
+  }
+write_error:
+  {
+    switch (errno) {
+      case ENOSPC:
+        GST_ELEMENT_ERROR (sink, RESOURCE, NO_SPACE_LEFT, (NULL), (NULL));
+        break;
+      default:{
+        GST_ELEMENT_ERROR (sink, RESOURCE, WRITE, (NULL),
+            ("Error while writing to file descriptor %d: %s",
+                sink->fd, g_strerror (errno)));
+      }
+    }
+    flow_ret = GST_FLOW_ERROR;
+    goto out;
+  }
+}
+#endif
+
+/* Queue @obj behind at most io-depth - 1 other writes. What can't be
+ * queued is written synchronously once the ring is drained. */
 static GstFlowReturn
-gst_fd_sink_render_buffers (GstFdSink * sink, GstBuffer ** buffers,
-    guint num_buffers, guint8 * mem_nums, guint total_mems)
+gst_fd_sink_uring_write (GstFdSink * sink, GstMiniObject * obj,
+    GstBuffer ** buffers, guint num_buffers, guint8 * mem_nums,
+    guint total_mems, gsize size)
+{
+  GstFlowReturn ret;
+  guint64 bytes_written = 0;
+
+  if (!gst_io_uring_complete_writes (sink->ring, sink->ring_depth - 1))
+    goto write_failed;
+
+  if (gst_io_uring_write (sink->ring, sink->fd, obj, sink->current_pos)) {
+    sink->bytes_written += size;
+    sink->current_pos += size;
+    return GST_FLOW_OK;
+  }
+
+  GST_LOG_OBJECT (sink, "could not queue write, writing synchronously");
+  if (!gst_fd_sink_uring_drain (sink))
+    goto write_failed;
+
+  ret = gst_writev_buffers (GST_OBJECT_CAST (sink), sink->fd, sink->fdset,
+      buffers, num_buffers, mem_nums, total_mems, &bytes_written, 0);
+  sink->bytes_written += bytes_written;
+  sink->current_pos += bytes_written;
+
+  return ret;
+
+  /* ERRORS */
+write_failed:
+  {
+    GST_ELEMENT_ERROR (sink, RESOURCE, WRITE, (NULL),
+        ("Error while writing to file descriptor %d: %s", sink->fd,
+            g_strerror (errno)));
+    return GST_FLOW_ERROR;
+  }
+}
+
+static GstFlowReturn
+gst_fd_sink_render_buffers (GstFdSink * sink, GstMiniObject * obj,
+    GstBuffer ** buffers, guint num_buffers, guint8 * mem_nums,
+    guint total_mems, gsize size)
 {
   GstFlowReturn ret;
   guint64 skip = 0;
 
+  /* the fd was changed while running, the kernel may still read from the
+   * buffers written to the old one */
+  if (G_UNLIKELY (sink->zero_copy && sink->zc_fd != sink->fd)) {
+    gst_fd_sink_release_pending (sink);
+    gst_fd_sink_setup_zero_copy (sink);
+  }
+
+  /* same for the writes still queued to the old fd */
+  if (G_UNLIKELY (sink->io_uring && sink->ring_fd != sink->fd)) {
+    if (!gst_fd_sink_uring_drain (sink))
+      GST_WARNING_OBJECT (sink, "writing to file descriptor %d failed: %s",
+          sink->ring_fd, g_strerror (errno));
+    gst_fd_sink_setup_uring (sink);
+  }
+
+  if (sink->ring)
+    return gst_fd_sink_uring_write (sink, obj, buffers, num_buffers, mem_nums,
+        total_mems, size);
+
   for (;;) {
     guint64 bytes_written = 0;
 
+#if defined (USE_VMSPLICE) || defined (USE_MSG_ZEROCOPY)
+    if (sink->zero_copy_mode != ZERO_COPY_NONE && size >= ZERO_COPY_MIN_SIZE) {
+      ret = gst_fd_sink_write_zero_copy (sink, obj, buffers, num_buffers,
+          total_mems, &bytes_written, skip);
+    } else {
+      ret = gst_writev_buffers (GST_OBJECT_CAST (sink), sink->fd, sink->fdset,
+          buffers, num_buffers, mem_nums, total_mems, &bytes_written, skip);
+      /* copied data is in the pipe ahead of what is spliced after it */
+      if (sink->zero_copy_mode == ZERO_COPY_PIPE)
+        sink->zc_sent += bytes_written;
+    }
+#else
     ret = gst_writev_buffers (GST_OBJECT_CAST (sink), sink->fd, sink->fdset,
         buffers, num_buffers, mem_nums, total_mems, &bytes_written, skip);
+#endif
 
     sink->bytes_written += bytes_written;
     sink->current_pos += bytes_written;
@@ -275,6 +801,7 @@ gst_fd_sink_render_list (GstBaseSink * bsink, GstBufferList * buffer_list)
   guint8 *mem_nums;
   guint total_mems;
   guint i, num_buffers;
+  gsize size;
 
   sink = GST_FD_SINK_CAST (bsink);
 
@@ -285,15 +812,16 @@ gst_fd_sink_render_list (GstBaseSink * bsink, GstBufferList * buffer_list)
   /* extract buffers from list and count memories */
   buffers = g_newa (GstBuffer *, num_buffers);
   mem_nums = g_newa (guint8, num_buffers);
-  for (i = 0, total_mems = 0; i < num_buffers; ++i) {
+  for (i = 0, total_mems = 0, size = 0; i < num_buffers; ++i) {
     buffers[i] = gst_buffer_list_get (buffer_list, i);
     mem_nums[i] = gst_buffer_n_memory (buffers[i]);
     total_mems += mem_nums[i];
+    size += gst_buffer_get_size (buffers[i]);
   }
 
   flow =
-      gst_fd_sink_render_buffers (sink, buffers, num_buffers, mem_nums,
-      total_mems);
+      gst_fd_sink_render_buffers (sink, GST_MINI_OBJECT_CAST (buffer_list),
+      buffers, num_buffers, mem_nums, total_mems, size);
 
   return flow;
 
@@ -316,7 +844,8 @@ gst_fd_sink_render (GstBaseSink * bsink, GstBuffer * buffer)
   n_mem = gst_buffer_n_memory (buffer);
 
   if (n_mem > 0)
-    flow = gst_fd_sink_render_buffers (sink, &buffer, 1, &n_mem, n_mem);
+    flow = gst_fd_sink_render_buffers (sink, GST_MINI_OBJECT_CAST (buffer),
+        &buffer, 1, &n_mem, n_mem, gst_buffer_get_size (buffer));
   else
     flow = GST_FLOW_OK;
 
@@ -390,6 +919,9 @@ gst_fd_sink_start (GstBaseSink * basesink)
   fdsink->seekable = gst_fd_sink_do_seek (fdsink, 0);
   GST_INFO_OBJECT (fdsink, "seeking supported: %d", fdsink->seekable);
 
+  gst_fd_sink_setup_zero_copy (fdsink);
+  gst_fd_sink_setup_uring (fdsink);
+
   return TRUE;
 
   /* ERRORS */
@@ -406,6 +938,18 @@ gst_fd_sink_stop (GstBaseSink * basesink)
 {
   GstFdSink *fdsink = GST_FD_SINK (basesink);
 
+  if (!gst_fd_sink_uring_drain (fdsink))
+    GST_ELEMENT_ERROR (fdsink, RESOURCE, WRITE, (NULL),
+        ("Error while writing to file descriptor %d: %s", fdsink->ring_fd,
+            g_strerror (errno)));
+  if (fdsink->ring) {
+    gst_io_uring_free (fdsink->ring);
+    fdsink->ring = NULL;
+  }
+  fdsink->ring_fd = -1;
+
+  gst_fd_sink_release_pending (fdsink);
+
   if (fdsink->fdset) {
     gst_poll_free (fdsink->fdset);
     fdsink->fdset = NULL;
@@ -414,6 +958,173 @@ gst_fd_sink_stop (GstBaseSink * basesink)
   return TRUE;
 }
 
+/* Decide at start how to write the fd without copying, if at all */
+static void
+gst_fd_sink_setup_zero_copy (GstFdSink * fdsink)
+{
+  struct stat stat_results;
+
+  fdsink->zero_copy_mode = ZERO_COPY_NONE;
+  fdsink->zc_fd = fdsink->fd;
+  if (!fdsink->zero_copy || fstat (fdsink->fd, &stat_results) < 0)
+    return;
+
+#ifdef USE_VMSPLICE
+  /* the pages stay shared with the pipe, which is only safe when the reader
+   * copies them out, the application has to tell us */
+  if (S_ISFIFO (stat_results.st_mode)) {
+    if (!fdsink->zero_copy_pipe) {
+      GST_INFO_OBJECT (fdsink, "zero-copy-pipe is not set, copying into "
+          "pipe %d", fdsink->fd);
+      return;
+    }
+    fdsink->zero_copy_mode = ZERO_COPY_PIPE;
+  }
+#endif
+#ifdef USE_MSG_ZEROCOPY
+  if (S_ISSOCK (stat_results.st_mode)) {
+    gint one = 1;
+
+    if (setsockopt (fdsink->fd, SOL_SOCKET, SO_ZEROCOPY, &one,
+            sizeof (one)) == 0)
+      fdsink->zero_copy_mode = ZERO_COPY_SOCKET;
+    else
+      GST_DEBUG_OBJECT (fdsink, "SO_ZEROCOPY failed: %s", g_strerror (errno));
+  }
+#endif
+
+  if (fdsink->zero_copy_mode == ZERO_COPY_NONE) {
+    GST_WARNING_OBJECT (fdsink, "zero-copy is not supported for file "
+        "descriptor %d, copying", fdsink->fd);
+    return;
+  }
+
+  GST_INFO_OBJECT (fdsink, "writing file descriptor %d without copying "
+      "(mode %d)", fdsink->fd, fdsink->zero_copy_mode);
+  fdsink->pending = gst_queue_array_new_for_struct (sizeof (GstFdSinkPending),
+      16);
+  fdsink->zc_ranges = g_array_new (FALSE, FALSE, sizeof (guint32));
+  fdsink->zc_sent = 0;
+  fdsink->zc_completed = 0;
+}
+
+/* Set up the ring for a regular file, and drop the one of the previous fd */
+static void
+gst_fd_sink_setup_uring (GstFdSink * fdsink)
+{
+  struct stat stat_results;
+
+  if (fdsink->ring) {
+    gst_io_uring_free (fdsink->ring);
+    fdsink->ring = NULL;
+  }
+  fdsink->ring_fd = fdsink->fd;
+  if (!fdsink->io_uring)
+    return;
+
+  /* writes to pipes and sockets can block, and only a poll can be
+   * interrupted when flushing */
+  if (fdsink->zero_copy_mode != ZERO_COPY_NONE ||
+      fstat (fdsink->fd, &stat_results) < 0 ||
+      !S_ISREG (stat_results.st_mode)) {
+    GST_WARNING_OBJECT (fdsink, "io-uring is only used for regular files "
+        "without zero-copy, writing file descriptor %d normally", fdsink->fd);
+    return;
+  }
+
+  /* the writes are queued at current_pos, writes at the file position would
+   * have to be done one at a time, and older kernels don't support them. A
+   * file descriptor set while running may be somewhere else entirely. */
+  if (lseek (fdsink->fd, 0, SEEK_CUR) != (off_t) fdsink->current_pos
+#ifdef F_GETFL
+      || (fcntl (fdsink->fd, F_GETFL) & O_APPEND)
+#endif
+      ) {
+    GST_WARNING_OBJECT (fdsink, "io-uring is only used for seekable files "
+        "that are not appended to, writing file descriptor %d normally",
+        fdsink->fd);
+    return;
+  }
+
+  fdsink->ring = gst_io_uring_new (fdsink->io_depth);
+  if (fdsink->ring == NULL) {
+    GST_WARNING_OBJECT (fdsink, "io_uring is not available, writing normally");
+    return;
+  }
+
+  fdsink->ring_depth = fdsink->io_depth;
+
+  GST_INFO_OBJECT (fdsink, "queueing %u writes to file descriptor %d",
+      fdsink->ring_depth, fdsink->fd);
+}
+
+/* Complete the writes in flight and move the file position after them, for
+ * the writes and seeks that don't go through the ring */
+static gboolean
+gst_fd_sink_uring_drain (GstFdSink * fdsink)
+{
+  if (fdsink->ring == NULL)
+    return TRUE;
+
+  if (!gst_io_uring_complete_writes (fdsink->ring, 0))
+    return FALSE;
+
+  if (lseek (fdsink->ring_fd, (off_t) fdsink->current_pos,
+          SEEK_SET) == (off_t) - 1)
+    return FALSE;
+
+  return TRUE;
+}
+
+/* Wait a little for the kernel to let go of the pending buffers. Whatever it
+ * still uses after that is leaked, the memory must not be reused while it can
+ * still be read from. */
+static void
+gst_fd_sink_release_pending (GstFdSink * fdsink)
+{
+#if defined (USE_VMSPLICE) || defined (USE_MSG_ZEROCOPY)
+  GstFdSinkPending *pending;
+  gint64 deadline;
+
+  if (fdsink->pending == NULL)
+    goto done;
+
+  deadline = g_get_monotonic_time () + ZERO_COPY_DRAIN_TIMEOUT;
+  while (TRUE) {
+    gst_fd_sink_reclaim (fdsink);
+    if (gst_queue_array_is_empty (fdsink->pending))
+      break;
+
+    if (fdsink->zero_copy_mode == ZERO_COPY_PIPE) {
+      GPollFD pfd = { fdsink->zc_fd, G_IO_OUT, 0 };
+
+      /* nobody can read the pipe anymore */
+      if (g_poll (&pfd, 1, 0) == 1 && (pfd.revents & G_IO_ERR)) {
+        while ((pending = gst_queue_array_pop_head_struct (fdsink->pending)))
+          gst_fd_sink_pending_clear (pending);
+        break;
+      }
+    }
+
+    if (g_get_monotonic_time () > deadline) {
+      GST_WARNING_OBJECT (fdsink, "leaking %u buffers the kernel may still "
+          "read from", gst_queue_array_get_length (fdsink->pending));
+      break;
+    }
+    g_usleep (G_USEC_PER_SEC / 1000);
+  }
+
+  gst_queue_array_free (fdsink->pending);
+  fdsink->pending = NULL;
+  g_array_free (fdsink->zc_ranges, TRUE);
+  fdsink->zc_ranges = NULL;
+
+done:
+#endif
+  fdsink->zero_copy_mode = ZERO_COPY_NONE;
+  fdsink->zc_fd = -1;
+}
+
 static gboolean
 gst_fd_sink_unlock (GstBaseSink * basesink)
 {
@@ -496,6 +1207,18 @@ gst_fd_sink_set_property (GObject * object, guint prop_id,
       gst_fd_sink_update_fd (fdsink, fd, NULL);
       break;
     }
+    case ARG_ZERO_COPY:
+      fdsink->zero_copy = g_value_get_boolean (value);
+      break;
+    case ARG_ZERO_COPY_PIPE:
+      fdsink->zero_copy_pipe = g_value_get_boolean (value);
+      break;
+    case ARG_IO_URING:
+      fdsink->io_uring = g_value_get_boolean (value);
+      break;
+    case ARG_IO_DEPTH:
+      fdsink->io_depth = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -514,6 +1237,18 @@ gst_fd_sink_get_property (GObject * object, guint prop_id, GValue * value,
     case ARG_FD:
       g_value_set_int (value, fdsink->fd);
       break;
+    case ARG_ZERO_COPY:
+      g_value_set_boolean (value, fdsink->zero_copy);
+      break;
+    case ARG_ZERO_COPY_PIPE:
+      g_value_set_boolean (value, fdsink->zero_copy_pipe);
+      break;
+    case ARG_IO_URING:
+      g_value_set_boolean (value, fdsink->io_uring);
+      break;
+    case ARG_IO_DEPTH:
+      g_value_set_uint (value, fdsink->io_depth);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -525,6 +1260,9 @@ gst_fd_sink_do_seek (GstFdSink * fdsink, guint64 new_offset)
 {
   off_t result;
 
+  if (!gst_fd_sink_uring_drain (fdsink))
+    goto seek_failed;
+
   result = lseek (fdsink->fd, new_offset, SEEK_SET);
 
   if (result == -1)
@@ -581,6 +1319,10 @@ gst_fd_sink_event (GstBaseSink * sink, GstEvent * event)
       }
       break;
     }
+    case GST_EVENT_EOS:
+      if (!gst_fd_sink_uring_drain (fdsink))
+        goto write_failed;
+      break;
     default:
       break;
   }
@@ -595,7 +1337,14 @@ seek_failed:
     gst_event_unref (event);
     return FALSE;
   }
-
+write_failed:
+  {
+    GST_ELEMENT_ERROR (fdsink, RESOURCE, WRITE, (NULL),
+        ("Error while writing to file descriptor %d: %s",
+            fdsink->ring_fd, g_strerror (errno)));
+    gst_event_unref (event);
+    return FALSE;
+  }
 }
 
 /*** GSTURIHANDLER INTERFACE *************************************************/
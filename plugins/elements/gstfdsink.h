@@ -26,6 +26,9 @@
 
 #include <gst/gst.h>
 #include <gst/base/gstbasesink.h>
+#include <gst/base/gstqueuearray.h>
+
+#include "gstiouring.h"
 
 G_BEGIN_DECLS
 
@@ -63,6 +66,21 @@ struct _GstFdSink {
 
   gboolean seekable;
   gboolean unlock; /* OBJECT LOCK */
+
+  gboolean zero_copy;
+  gboolean zero_copy_pipe;
+  gint zero_copy_mode;          /* how the fd is written without copying */
+  gint zc_fd;                   /* the fd zero_copy_mode was picked for */
+  GstQueueArray *pending;       /* buffers the kernel may still read */
+  guint64 zc_sent;              /* bytes spliced, or sends made */
+  guint32 zc_completed;         /* sends before this one are completed */
+  GArray *zc_ranges;            /* completions received out of order */
+
+  gboolean io_uring;
+  guint io_depth;
+  GstIoUring *ring;             /* queues the writes to regular files */
+  gint ring_fd;                 /* the fd the ring was set up for */
+  guint ring_depth;             /* writes in flight */
 };
 
 struct _GstFdSinkClass {
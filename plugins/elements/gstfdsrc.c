@@ -30,6 +30,10 @@
  * To generate data, enter some data on the console followed by enter.
  * The above mentioned pipeline should dump data packets to the console.
  *
+ * With #GstFdSrc:read-buffers, several buffers are filled with a single
+ * readv() or recvmmsg() call whenever data is available, and pushed
+ * downstream together in a #GstBufferList.
+ *
  * If the #GstFdSrc:timeout property is set to a value bigger than 0, fdsrc will
  * generate an element message named <classname>&quot;GstFdSrcTimeout&quot;</classname>
  * if no data was received in the given timeout.
@@ -64,6 +68,9 @@
 #ifdef HAVE_SYS_SOCKET_H
 #include <sys/socket.h>
 #endif
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
 #include <fcntl.h>
 #include <stdio.h>
 #ifdef HAVE_UNISTD_H
@@ -76,9 +83,11 @@
 #define S_ISREG(m)	(((m)&S_IFREG)==S_IFREG)
 #endif
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 
 #include "gstfdsrc.h"
+#include "gstelements_private.h"
 
 #ifdef __BIONIC__               /* Android */
 #if defined(__ANDROID_API__) && __ANDROID_API__ >= 21
@@ -97,6 +106,17 @@ GST_DEBUG_CATEGORY_STATIC (gst_fd_src_debug);
 
 #define DEFAULT_FD              0
 #define DEFAULT_TIMEOUT         0
+#define DEFAULT_READ_BUFFERS    1
+
+/* UIO_MAXIOV is documented in writev(2), but <sys/uio.h> only
+ * declares it on osx/ios if defined(KERNEL) */
+#ifndef UIO_MAXIOV
+#define UIO_MAXIOV 512
+#endif
+
+#if defined (HAVE_RECVMMSG) && defined (HAVE_SYS_SOCKET_H)
+#define USE_RECVMMSG 1
+#endif
 
 enum
 {
@@ -104,6 +124,7 @@ enum
 
   PROP_FD,
   PROP_TIMEOUT,
+  PROP_READ_BUFFERS,
 
   PROP_LAST
 };
@@ -132,6 +153,10 @@ static gboolean gst_fd_src_do_seek (GstBaseSrc * src, GstSegment * segment);
 static gboolean gst_fd_src_query (GstBaseSrc * src, GstQuery * query);
 
 static GstFlowReturn gst_fd_src_create (GstPushSrc * psrc, GstBuffer ** outbuf);
+#ifdef HAVE_SYS_UIO_H
+static GstFlowReturn gst_fd_src_create_list (GstPushSrc * psrc,
+    guint max_buffers, GstBufferList ** list);
+#endif
 
 static void
 gst_fd_src_class_init (GstFdSrcClass * klass)
@@ -163,6 +188,24 @@ gst_fd_src_class_init (GstFdSrcClass * klass)
           "Post a message after timeout microseconds (0 = disabled)", 0,
           G_MAXUINT64, DEFAULT_TIMEOUT,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstFdSrc:read-buffers:
+   *
+   * Number of blocksize buffers to fill with a single read. With more than
+   * one, the buffers come from a pool and are filled with readv(), or with
+   * recvmmsg() on datagram sockets so that every buffer holds one datagram.
+   * The buffers that got data are pushed downstream in a #GstBufferList.
+   *
+   * This is the same as the #GstBaseSrc:max-list-size property, limited to
+   * the number of vectors a single read can fill.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (G_OBJECT_CLASS (klass), PROP_READ_BUFFERS,
+      g_param_spec_uint ("read-buffers", "Read buffers",
+          "Number of buffers to fill with a single read", 1, UIO_MAXIOV,
+          DEFAULT_READ_BUFFERS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
 
   gst_element_class_set_static_metadata (gstelement_class,
       "Filedescriptor Source",
@@ -180,6 +223,9 @@ gst_fd_src_class_init (GstFdSrcClass * klass)
   gstbasesrc_class->query = GST_DEBUG_FUNCPTR (gst_fd_src_query);
 
   gstpush_src_class->create = GST_DEBUG_FUNCPTR (gst_fd_src_create);
+#ifdef HAVE_SYS_UIO_H
+  gstpush_src_class->create_list = GST_DEBUG_FUNCPTR (gst_fd_src_create_list);
+#endif
 }
 
 static void
@@ -205,6 +251,48 @@ gst_fd_src_dispose (GObject * obj)
   G_OBJECT_CLASS (parent_class)->dispose (obj);
 }
 
+/* Find out how the fd is read. Reads of regular files, non-blocking fds
+ * and sockets (with MSG_DONTWAIT) don't block, so poll is only needed when
+ * they have no data. Reads of other fds could only be interrupted through
+ * the poll. */
+static void
+gst_fd_src_check_reads (GstFdSrc * src)
+{
+  struct stat stat_results;
+
+  src->read_first = FALSE;
+  src->is_socket = FALSE;
+  src->is_datagram = FALSE;
+
+  if (fstat (src->fd, &stat_results) == 0 && S_ISREG (stat_results.st_mode))
+    src->read_first = TRUE;
+
+#ifdef HAVE_SYS_SOCKET_H
+  {
+    gint type;
+    socklen_t len = sizeof (type);
+
+    if (getsockopt (src->fd, SOL_SOCKET, SO_TYPE, &type, &len) == 0) {
+      src->is_socket = TRUE;
+      src->is_datagram = type != SOCK_STREAM;
+      src->read_first = TRUE;
+    }
+  }
+#endif
+
+#if defined (F_GETFL) && defined (O_NONBLOCK)
+  {
+    gint flags = fcntl (src->fd, F_GETFL);
+
+    if (flags != -1 && (flags & O_NONBLOCK))
+      src->read_first = TRUE;
+  }
+#endif
+
+  GST_DEBUG_OBJECT (src, "fd %d, read first %d, socket %d, datagrams %d",
+      src->fd, src->read_first, src->is_socket, src->is_datagram);
+}
+
 static void
 gst_fd_src_update_fd (GstFdSrc * src, guint64 size)
 {
@@ -241,6 +329,8 @@ gst_fd_src_update_fd (GstFdSrc * src, guint64 size)
     g_free (src->uri);
     src->uri = g_strdup_printf ("fd://%d", src->fd);
 
+    gst_fd_src_check_reads (src);
+
     if (fstat (src->fd, &stat_results) < 0)
       goto not_seekable;
 
@@ -299,6 +389,12 @@ gst_fd_src_stop (GstBaseSrc * bsrc)
     src->fdset = NULL;
   }
 
+  if (src->pool) {
+    gst_buffer_pool_set_active (src->pool, FALSE);
+    gst_object_unref (src->pool);
+    src->pool = NULL;
+  }
+
   return TRUE;
 }
 
@@ -354,6 +450,10 @@ gst_fd_src_set_property (GObject * object, guint prop_id, const GValue * value,
       GST_DEBUG_OBJECT (src, "poll timeout set to %" GST_TIME_FORMAT,
           GST_TIME_ARGS (src->timeout));
       break;
+    case PROP_READ_BUFFERS:
+      gst_base_src_set_max_list_size (GST_BASE_SRC (src),
+          g_value_get_uint (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -373,30 +473,26 @@ gst_fd_src_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_TIMEOUT:
       g_value_set_uint64 (value, src->timeout);
       break;
+    case PROP_READ_BUFFERS:
+      g_value_set_uint (value,
+          MIN (gst_base_src_get_max_list_size (GST_BASE_SRC (src)),
+              UIO_MAXIOV));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
+/* Wait until the fd is readable */
 static GstFlowReturn
-gst_fd_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
+gst_fd_src_wait (GstFdSrc * src)
 {
-  GstFdSrc *src;
-  GstBuffer *buf;
-  gssize readbytes;
-  guint blocksize;
-  GstMapInfo info;
-
 #ifndef HAVE_WIN32
   GstClockTime timeout;
   gboolean try_again;
   gint retval;
-#endif
 
-  src = GST_FD_SRC (psrc);
-
-#ifndef HAVE_WIN32
   if (src->timeout > 0) {
     timeout = src->timeout * GST_USECOND;
   } else {
@@ -432,6 +528,241 @@ gst_fd_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
   } while (G_UNLIKELY (try_again));     /* retry if interrupted or timeout */
 #endif
 
+  return GST_FLOW_OK;
+
+  /* ERRORS */
+#ifndef HAVE_WIN32
+poll_error:
+  {
+    GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL),
+        ("poll on file descriptor: %s.", g_strerror (errno)));
+    GST_DEBUG_OBJECT (src, "Error during poll");
+    return GST_FLOW_ERROR;
+  }
+stopped:
+  {
+    GST_DEBUG_OBJECT (src, "Poll stopped");
+    return GST_FLOW_FLUSHING;
+  }
+#endif
+}
+
+static gssize
+gst_fd_src_read (GstFdSrc * src, guint8 * data, gsize size)
+{
+  gssize ret;
+
+  do {
+#ifdef HAVE_SYS_SOCKET_H
+    if (src->is_socket)
+      ret = recv (src->fd, data, size, MSG_DONTWAIT);
+    else
+#endif
+      ret = read (src->fd, data, size);
+  } while (ret == -1 && errno == EINTR);        /* retry if interrupted */
+
+  return ret;
+}
+
+#ifdef HAVE_SYS_UIO_H
+/* Fills @vecs with a single call, one datagram per vector on datagram
+ * sockets. Returns the number of vectors that got data with their sizes in
+ * @sizes, 0 at EOS or -1 on error. */
+static gint
+gst_fd_src_read_vectors (GstFdSrc * src, struct iovec *vecs, guint n_vecs,
+    gsize * sizes)
+{
+  gssize ret;
+  guint i;
+
+#ifdef USE_RECVMMSG
+  if (src->is_datagram) {
+    struct mmsghdr *msgs;
+
+    msgs = g_newa (struct mmsghdr, n_vecs);
+    memset (msgs, 0, n_vecs * sizeof (struct mmsghdr));
+    for (i = 0; i < n_vecs; i++) {
+      msgs[i].msg_hdr.msg_iov = &vecs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    do {
+      ret = recvmmsg (src->fd, msgs, n_vecs, MSG_DONTWAIT, NULL);
+    } while (ret == -1 && errno == EINTR);
+
+    if (ret <= 0)
+      return ret;
+
+    for (i = 0; i < ret; i++)
+      sizes[i] = msgs[i].msg_len;
+
+    return ret;
+  }
+#endif
+
+  do {
+#ifdef HAVE_SYS_SOCKET_H
+    if (src->is_socket) {
+      struct msghdr msg = { 0, };
+
+      msg.msg_iov = vecs;
+      msg.msg_iovlen = src->is_datagram ? 1 : n_vecs;
+      ret = recvmsg (src->fd, &msg, MSG_DONTWAIT);
+    } else
+#endif
+      ret = readv (src->fd, vecs, n_vecs);
+  } while (ret == -1 && errno == EINTR);
+
+  if (ret <= 0)
+    return ret;
+
+  for (i = 0; i < n_vecs && ret > 0; i++) {
+    sizes[i] = MIN (ret, vecs[i].iov_len);
+    ret -= sizes[i];
+  }
+
+  return i;
+}
+
+static gboolean
+gst_fd_src_ensure_pool (GstFdSrc * src, guint size, guint min_buffers)
+{
+  if (src->pool != NULL && src->pool_size == size)
+    return TRUE;
+
+  if (src->pool != NULL) {
+    gst_buffer_pool_set_active (src->pool, FALSE);
+    gst_object_unref (src->pool);
+  }
+
+  /* buffers are trimmed to the data read into them */
+  src->pool = gst_elements_resize_pool_new (size, min_buffers, NULL);
+  src->pool_size = size;
+
+  return src->pool != NULL;
+}
+
+static GstFlowReturn
+gst_fd_src_create_list (GstPushSrc * psrc, guint max_buffers,
+    GstBufferList ** list)
+{
+  GstFdSrc *src = GST_FD_SRC (psrc);
+  GstBuffer **buffers;
+  GstMapInfo *maps;
+  struct iovec *vecs;
+  gsize *sizes;
+  GstFlowReturn ret = GST_FLOW_OK;
+  guint i, n_buffers, n_mapped = 0, blocksize;
+  gint n_read = 0;
+
+  blocksize = GST_BASE_SRC (src)->blocksize;
+  n_buffers = MIN (max_buffers, UIO_MAXIOV);
+
+  buffers = g_newa (GstBuffer *, n_buffers);
+  maps = g_newa (GstMapInfo, n_buffers);
+  vecs = g_newa (struct iovec, n_buffers);
+  sizes = g_newa (gsize, n_buffers);
+
+  if (!gst_fd_src_ensure_pool (src, blocksize, n_buffers))
+    goto alloc_failed;
+
+  for (n_mapped = 0; n_mapped < n_buffers; n_mapped++) {
+    if (gst_buffer_pool_acquire_buffer (src->pool, &buffers[n_mapped],
+            NULL) != GST_FLOW_OK)
+      goto alloc_failed;
+    if (!gst_buffer_map (buffers[n_mapped], &maps[n_mapped], GST_MAP_WRITE)) {
+      gst_buffer_unref (buffers[n_mapped]);
+      goto buffer_read_error;
+    }
+    vecs[n_mapped].iov_base = maps[n_mapped].data;
+    vecs[n_mapped].iov_len = maps[n_mapped].size;
+  }
+
+  if (!src->read_first)
+    ret = gst_fd_src_wait (src);
+
+  while (ret == GST_FLOW_OK) {
+    n_read = gst_fd_src_read_vectors (src, vecs, n_buffers, sizes);
+    GST_LOG_OBJECT (src, "read %d buffers", n_read);
+
+    if (n_read == 0) {
+      GST_DEBUG_OBJECT (src, "Read 0 bytes. EOS.");
+      ret = GST_FLOW_EOS;
+    } else if (n_read < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+      GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL),
+          ("read on file descriptor: %s.", g_strerror (errno)));
+      GST_DEBUG_OBJECT (src, "Error reading from fd");
+      ret = GST_FLOW_ERROR;
+    } else if (n_read < 0) {
+      /* nothing available yet */
+      ret = gst_fd_src_wait (src);
+    } else {
+      break;
+    }
+  }
+
+done:
+  for (i = 0; i < n_mapped; i++)
+    gst_buffer_unmap (buffers[i], &maps[i]);
+
+  if (ret != GST_FLOW_OK)
+    n_read = 0;
+  for (i = n_read; i < n_mapped; i++)
+    gst_buffer_unref (buffers[i]);
+
+  if (ret != GST_FLOW_OK)
+    return ret;
+
+  for (i = 0; i < n_read; i++) {
+    gst_buffer_resize (buffers[i], 0, sizes[i]);
+    GST_BUFFER_OFFSET (buffers[i]) = src->curoffset;
+    GST_BUFFER_TIMESTAMP (buffers[i]) = GST_CLOCK_TIME_NONE;
+    src->curoffset += sizes[i];
+  }
+
+  GST_LOG_OBJECT (src, "Read %d buffers", n_read);
+
+  *list = gst_buffer_list_new_sized (n_read);
+  for (i = 0; i < n_read; i++)
+    gst_buffer_list_add (*list, buffers[i]);
+
+  return GST_FLOW_OK;
+
+  /* ERRORS */
+alloc_failed:
+  {
+    GST_ERROR_OBJECT (src, "Failed to allocate %u buffers of %u bytes",
+        n_buffers, blocksize);
+    ret = GST_FLOW_ERROR;
+    goto done;
+  }
+buffer_read_error:
+  {
+    GST_ELEMENT_ERROR (src, RESOURCE, WRITE, (NULL), ("Can't write to buffer"));
+    ret = GST_FLOW_ERROR;
+    goto done;
+  }
+}
+#endif
+
+static GstFlowReturn
+gst_fd_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
+{
+  GstFdSrc *src;
+  GstBuffer *buf;
+  GstFlowReturn ret;
+  gssize readbytes;
+  guint blocksize;
+  GstMapInfo info;
+
+  src = GST_FD_SRC (psrc);
+
+  if (!src->read_first) {
+    ret = gst_fd_src_wait (src);
+    if (ret != GST_FLOW_OK)
+      return ret;
+  }
+
   blocksize = GST_BASE_SRC (src)->blocksize;
 
   /* create the buffer */
@@ -442,10 +773,14 @@ gst_fd_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
   if (!gst_buffer_map (buf, &info, GST_MAP_WRITE))
     goto buffer_read_error;
 
-  do {
-    readbytes = read (src->fd, info.data, blocksize);
-    GST_LOG_OBJECT (src, "read %" G_GSSIZE_FORMAT, readbytes);
-  } while (readbytes == -1 && errno == EINTR);  /* retry if interrupted */
+  while ((readbytes = gst_fd_src_read (src, info.data, blocksize)) < 0 &&
+      (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    /* nothing available yet */
+    ret = gst_fd_src_wait (src);
+    if (ret != GST_FLOW_OK)
+      goto wait_failed;
+  }
+  GST_LOG_OBJECT (src, "read %" G_GSSIZE_FORMAT, readbytes);
 
   if (readbytes < 0)
     goto read_error;
@@ -468,20 +803,6 @@ gst_fd_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
   return GST_FLOW_OK;
 
   /* ERRORS */
-#ifndef HAVE_WIN32
-poll_error:
-  {
-    GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL),
-        ("poll on file descriptor: %s.", g_strerror (errno)));
-    GST_DEBUG_OBJECT (psrc, "Error during poll");
-    return GST_FLOW_ERROR;
-  }
-stopped:
-  {
-    GST_DEBUG_OBJECT (psrc, "Poll stopped");
-    return GST_FLOW_FLUSHING;
-  }
-#endif
 alloc_failed:
   {
     GST_ERROR_OBJECT (src, "Failed to allocate %u bytes", blocksize);
@@ -493,6 +814,12 @@ eos:
     gst_buffer_unref (buf);
     return GST_FLOW_EOS;
   }
+wait_failed:
+  {
+    gst_buffer_unmap (buf, &info);
+    gst_buffer_unref (buf);
+    return ret;
+  }
 read_error:
   {
     GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL),
@@ -71,6 +71,15 @@ struct _GstFdSrc {
   GstPoll *fdset;
 
   gulong curoffset; /* current offset in file */
+
+  /* pool of the buffers filled per read */
+  GstBufferPool *pool;
+  guint pool_size;
+
+  /* reads of fd can't block, so poll only when no data is available */
+  gboolean read_first;
+  gboolean is_socket;
+  gboolean is_datagram;
 };
 
 struct _GstFdSrcClass {
@@ -32,12 +32,27 @@
  * gst-launch-1.0 v4l2src num-buffers=1 ! jpegenc ! filesink location=capture1.jpeg
  * ]| Capture one frame from a v4l2 camera and save as jpeg image.
  *
+ * For recording high bitrate streams, #GstFileSink:async-write moves the
+ * writes to a separate thread so that disk stalls don't block the pipeline,
+ * #GstFileSink:preallocate reserves disk space ahead of the writes,
+ * #GstFileSink:o-direct bypasses the page cache and #GstFileSink:sync-bytes
+ * keeps the amount of unwritten data in the page cache bounded. On Linux,
+ * #GstFileSink:io-uring queues the writes with io_uring instead, so that
+ * rendering returns before they complete.
+ *
+ * |[
+ * gst-launch-1.0 udpsrc port=5000 ! filesink location=dump.ts async-write=true preallocate=67108864 sync-bytes=8388608
+ * ]| Record a network stream without letting disk writes block the receiver.
+ *
  */
 
 #ifdef HAVE_CONFIG_H
 #  include "config.h"
 #endif
 
+/* for O_DIRECT, fallocate() and sync_file_range() */
+#define _GNU_SOURCE 1
+
 #include "../../gst/gst-i18n-lib.h"
 
 #include <gst/gst.h>
@@ -66,10 +81,19 @@
 #endif
 
 #include <sys/stat.h>
+#include <fcntl.h>
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
 
+#if defined (O_DIRECT) && defined (HAVE_PWRITE)
+#define USE_DIRECT 1
+#endif
+
+#if defined (HAVE_FALLOCATE) && defined (FALLOC_FL_KEEP_SIZE)
+#define USE_FALLOCATE 1
+#endif
+
 #include "gstelements_private.h"
 #include "gstfilesink.h"
 
@@ -105,6 +129,16 @@ GST_DEBUG_CATEGORY_STATIC (gst_file_sink_debug);
 #define DEFAULT_BUFFER_MODE 	GST_FILE_SINK_BUFFER_MODE_DEFAULT
 #define DEFAULT_BUFFER_SIZE 	64 * 1024
 #define DEFAULT_APPEND		FALSE
+#define DEFAULT_PREALLOCATE	0
+#define DEFAULT_O_DIRECT	FALSE
+#define DEFAULT_SYNC_BYTES	0
+#define DEFAULT_ASYNC_WRITE	FALSE
+#define DEFAULT_ASYNC_WRITE_MAX_BYTES	(32 * 1024 * 1024)
+#define DEFAULT_IO_URING	FALSE
+#define DEFAULT_IO_DEPTH	4
+
+/* offset, size and memory alignment of O_DIRECT writes */
+#define DIRECT_ALIGN		4096
 
 enum
 {
@@ -113,6 +147,13 @@ enum
   PROP_BUFFER_MODE,
   PROP_BUFFER_SIZE,
   PROP_APPEND,
+  PROP_PREALLOCATE,
+  PROP_O_DIRECT,
+  PROP_SYNC_BYTES,
+  PROP_ASYNC_WRITE,
+  PROP_ASYNC_WRITE_MAX_BYTES,
+  PROP_IO_URING,
+  PROP_IO_DEPTH,
   PROP_LAST
 };
 
@@ -155,6 +196,7 @@ gst_fopen (const gchar * filename, const gchar * mode)
 }
 
 static void gst_file_sink_dispose (GObject * object);
+static void gst_file_sink_finalize (GObject * object);
 
 static void gst_file_sink_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
@@ -166,6 +208,8 @@ static void gst_file_sink_close_file (GstFileSink * sink);
 
 static gboolean gst_file_sink_start (GstBaseSink * sink);
 static gboolean gst_file_sink_stop (GstBaseSink * sink);
+static gboolean gst_file_sink_unlock (GstBaseSink * sink);
+static gboolean gst_file_sink_unlock_stop (GstBaseSink * sink);
 static gboolean gst_file_sink_event (GstBaseSink * sink, GstEvent * event);
 static GstFlowReturn gst_file_sink_render (GstBaseSink * sink,
     GstBuffer * buffer);
@@ -179,6 +223,10 @@ static gboolean gst_file_sink_get_current_offset (GstFileSink * filesink,
 
 static gboolean gst_file_sink_query (GstBaseSink * bsink, GstQuery * query);
 
+static gboolean gst_file_sink_direct_flush (GstFileSink * sink, gboolean all);
+static GstFlowReturn gst_file_sink_writer_drain (GstFileSink * sink,
+    gboolean discard);
+
 static void gst_file_sink_uri_handler_init (gpointer g_iface,
     gpointer iface_data);
 
@@ -197,6 +245,7 @@ gst_file_sink_class_init (GstFileSinkClass * klass)
   GstBaseSinkClass *gstbasesink_class = GST_BASE_SINK_CLASS (klass);
 
   gobject_class->dispose = gst_file_sink_dispose;
+  gobject_class->finalize = gst_file_sink_finalize;
 
   gobject_class->set_property = gst_file_sink_set_property;
   gobject_class->get_property = gst_file_sink_get_property;
@@ -227,6 +276,120 @@ gst_file_sink_class_init (GstFileSinkClass * klass)
           "Append to an already existing file", DEFAULT_APPEND,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstFileSink:preallocate:
+   *
+   * Reserve disk space for this many bytes ahead of the write position,
+   * without changing the file size. This avoids fragmentation and block
+   * allocation in the write path. The unused reservation is released when
+   * the file is closed. Only supported on Linux, and ignored elsewhere.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_PREALLOCATE,
+      g_param_spec_uint64 ("preallocate", "Preallocate",
+          "Bytes of disk space to reserve ahead of the write position "
+          "(0 = disabled)", 0, G_MAXUINT64, DEFAULT_PREALLOCATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  /**
+   * GstFileSink:o-direct:
+   *
+   * Open the file with O_DIRECT and write through an aligned staging buffer
+   * of #GstFileSink:buffer-size bytes, bypassing the page cache. Parts of
+   * the file that don't fill an aligned block are written normally. Ignored
+   * in append mode and where O_DIRECT is not supported.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_O_DIRECT,
+      g_param_spec_boolean ("o-direct", "O_DIRECT",
+          "Bypass the page cache with O_DIRECT writes", DEFAULT_O_DIRECT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  /**
+   * GstFileSink:sync-bytes:
+   *
+   * Start writeback of the data every time this many bytes were written, and
+   * wait for the previous range to reach the disk. This keeps the amount of
+   * dirty pages bounded so that the kernel doesn't stall the writes in large
+   * bursts. Uses sync_file_range() where available and fdatasync()
+   * otherwise.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_SYNC_BYTES,
+      g_param_spec_uint64 ("sync-bytes", "Sync bytes",
+          "Start writeback every this many bytes (0 = leave it to the system)",
+          0, G_MAXUINT64, DEFAULT_SYNC_BYTES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  /**
+   * GstFileSink:async-write:
+   *
+   * Write from a separate thread. Rendering only queues the data, and blocks
+   * when more than #GstFileSink:async-write-max-bytes are waiting to be
+   * written. Write errors are reported for the next buffer after the one
+   * that failed. The position query reports the data written so far.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_ASYNC_WRITE,
+      g_param_spec_boolean ("async-write", "Async write",
+          "Write from a separate thread", DEFAULT_ASYNC_WRITE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  /**
+   * GstFileSink:async-write-max-bytes:
+   *
+   * Maximum number of bytes waiting to be written in
+   * #GstFileSink:async-write mode.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_ASYNC_WRITE_MAX_BYTES,
+      g_param_spec_uint64 ("async-write-max-bytes", "Async write max bytes",
+          "Maximum number of bytes waiting to be written in async-write mode",
+          1, G_MAXUINT64, DEFAULT_ASYNC_WRITE_MAX_BYTES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  /**
+   * GstFileSink:io-uring:
+   *
+   * Queue the writes with io_uring and keep up to #GstFileSink:io-depth of
+   * them in flight. The data of a buffer is written directly from its
+   * memory, which is kept until the write completes. Write errors are
+   * reported for a later buffer. Files that are appended to or can't be
+   * seeked in are written as usual, the writes are queued at explicit
+   * offsets. Ignored together with #GstFileSink:async-write or
+   * #GstFileSink:o-direct, and where io_uring is not available.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_IO_URING,
+      g_param_spec_boolean ("io-uring", "io_uring",
+          "Queue the writes with io_uring", DEFAULT_IO_URING,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  /**
+   * GstFileSink:io-depth:
+   *
+   * Number of writes in flight in #GstFileSink:io-uring mode.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_IO_DEPTH,
+      g_param_spec_uint ("io-depth", "I/O depth",
+          "Number of writes in flight in io-uring mode", 1, 256,
+          DEFAULT_IO_DEPTH, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
   gst_element_class_set_static_metadata (gstelement_class,
       "File Sink",
       "Sink/File", "Write stream to a file",
@@ -235,6 +398,9 @@ gst_file_sink_class_init (GstFileSinkClass * klass)
 
   gstbasesink_class->start = GST_DEBUG_FUNCPTR (gst_file_sink_start);
   gstbasesink_class->stop = GST_DEBUG_FUNCPTR (gst_file_sink_stop);
+  gstbasesink_class->unlock = GST_DEBUG_FUNCPTR (gst_file_sink_unlock);
+  gstbasesink_class->unlock_stop =
+      GST_DEBUG_FUNCPTR (gst_file_sink_unlock_stop);
   gstbasesink_class->query = GST_DEBUG_FUNCPTR (gst_file_sink_query);
   gstbasesink_class->render = GST_DEBUG_FUNCPTR (gst_file_sink_render);
   gstbasesink_class->render_list =
@@ -257,6 +423,16 @@ gst_file_sink_init (GstFileSink * filesink)
   filesink->buffer_size = DEFAULT_BUFFER_SIZE;
   filesink->buffer = NULL;
   filesink->append = FALSE;
+  filesink->preallocate = DEFAULT_PREALLOCATE;
+  filesink->direct = DEFAULT_O_DIRECT;
+  filesink->sync_bytes = DEFAULT_SYNC_BYTES;
+  filesink->async_write = DEFAULT_ASYNC_WRITE;
+  filesink->async_write_max_bytes = DEFAULT_ASYNC_WRITE_MAX_BYTES;
+  filesink->io_uring = DEFAULT_IO_URING;
+  filesink->io_depth = DEFAULT_IO_DEPTH;
+
+  g_mutex_init (&filesink->writer_lock);
+  g_cond_init (&filesink->writer_cond);
 
   gst_base_sink_set_sync (GST_BASE_SINK (filesink), FALSE);
 }
@@ -277,6 +453,17 @@ gst_file_sink_dispose (GObject * object)
   sink->buffer_size = 0;
 }
 
+static void
+gst_file_sink_finalize (GObject * object)
+{
+  GstFileSink *sink = GST_FILE_SINK (object);
+
+  g_mutex_clear (&sink->writer_lock);
+  g_cond_clear (&sink->writer_cond);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static gboolean
 gst_file_sink_set_location (GstFileSink * sink, const gchar * location,
     GError ** error)
@@ -331,6 +518,27 @@ gst_file_sink_set_property (GObject * object, guint prop_id,
     case PROP_APPEND:
       sink->append = g_value_get_boolean (value);
       break;
+    case PROP_PREALLOCATE:
+      sink->preallocate = g_value_get_uint64 (value);
+      break;
+    case PROP_O_DIRECT:
+      sink->direct = g_value_get_boolean (value);
+      break;
+    case PROP_SYNC_BYTES:
+      sink->sync_bytes = g_value_get_uint64 (value);
+      break;
+    case PROP_ASYNC_WRITE:
+      sink->async_write = g_value_get_boolean (value);
+      break;
+    case PROP_ASYNC_WRITE_MAX_BYTES:
+      sink->async_write_max_bytes = g_value_get_uint64 (value);
+      break;
+    case PROP_IO_URING:
+      sink->io_uring = g_value_get_boolean (value);
+      break;
+    case PROP_IO_DEPTH:
+      sink->io_depth = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -356,12 +564,77 @@ gst_file_sink_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_APPEND:
       g_value_set_boolean (value, sink->append);
       break;
+    case PROP_PREALLOCATE:
+      g_value_set_uint64 (value, sink->preallocate);
+      break;
+    case PROP_O_DIRECT:
+      g_value_set_boolean (value, sink->direct);
+      break;
+    case PROP_SYNC_BYTES:
+      g_value_set_uint64 (value, sink->sync_bytes);
+      break;
+    case PROP_ASYNC_WRITE:
+      g_value_set_boolean (value, sink->async_write);
+      break;
+    case PROP_ASYNC_WRITE_MAX_BYTES:
+      g_value_set_uint64 (value, sink->async_write_max_bytes);
+      break;
+    case PROP_IO_URING:
+      g_value_set_boolean (value, sink->io_uring);
+      break;
+    case PROP_IO_DEPTH:
+      g_value_set_uint (value, sink->io_depth);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
+static void
+gst_file_sink_setup_uring (GstFileSink * sink)
+{
+  if (sink->async_write || sink->direct_data) {
+    GST_WARNING_OBJECT (sink, "io-uring can't be used together with "
+        "async-write or o-direct, writing normally");
+    return;
+  }
+
+  /* writes at the file position would have to be done one at a time, and
+   * older kernels don't support them */
+  if (!sink->seekable || sink->append) {
+    GST_WARNING_OBJECT (sink, "io-uring is only used for seekable files "
+        "that are not appended to, writing normally");
+    return;
+  }
+
+  sink->ring = gst_io_uring_new (sink->io_depth);
+  if (sink->ring == NULL) {
+    GST_WARNING_OBJECT (sink, "io_uring is not available, writing normally");
+    return;
+  }
+
+  sink->ring_depth = sink->io_depth;
+}
+
+/* Complete the writes in flight and move the file position after them, for
+ * the writes and seeks that don't go through the ring */
+static gboolean
+gst_file_sink_uring_drain (GstFileSink * sink)
+{
+  if (sink->ring == NULL)
+    return TRUE;
+
+  if (!gst_io_uring_complete_writes (sink->ring, 0))
+    return FALSE;
+
+  if (lseek (fileno (sink->file), (off_t) sink->current_pos,
+          SEEK_SET) == (off_t) - 1)
+    return FALSE;
+
+  return TRUE;
+}
+
 static gboolean
 gst_file_sink_open_file (GstFileSink * sink)
 {
@@ -371,10 +644,28 @@ gst_file_sink_open_file (GstFileSink * sink)
   if (sink->filename == NULL || sink->filename[0] == '\0')
     goto no_filename;
 
-  if (sink->append)
-    sink->file = gst_fopen (sink->filename, "ab");
-  else
-    sink->file = gst_fopen (sink->filename, "wb");
+#ifdef USE_DIRECT
+  if (sink->direct && !sink->append) {
+    gint fd;
+
+    fd = open (sink->filename, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0666);
+    if (fd >= 0) {
+      sink->file = fdopen (fd, "wb");
+      if (sink->file == NULL)
+        close (fd);
+    }
+    if (sink->file == NULL)
+      GST_WARNING_OBJECT (sink, "could not open file with O_DIRECT, writing "
+          "normally: %s", g_strerror (errno));
+  }
+#endif
+
+  if (sink->file == NULL) {
+    if (sink->append)
+      sink->file = gst_fopen (sink->filename, "ab");
+    else
+      sink->file = gst_fopen (sink->filename, "wb");
+  }
   if (sink->file == NULL)
     goto open_failed;
 
@@ -408,10 +699,28 @@ gst_file_sink_open_file (GstFileSink * sink)
     }
   }
 
+#ifdef USE_DIRECT
+  if (fcntl (fileno (sink->file), F_GETFL) & O_DIRECT) {
+    sink->direct_size = GST_ROUND_UP_N (MAX (sink->buffer_size, DIRECT_ALIGN),
+        DIRECT_ALIGN);
+    sink->direct_mem = g_malloc (sink->direct_size + DIRECT_ALIGN - 1);
+    sink->direct_data = (guint8 *) GST_ROUND_UP_N ((guintptr) sink->direct_mem,
+        DIRECT_ALIGN);
+    sink->direct_start = sink->direct_fill = 0;
+    sink->direct_base = 0;
+  }
+#endif
+
+  sink->allocated_end = 0;
+  sink->sync_prev = sink->sync_pos = 0;
+
   sink->current_pos = 0;
   /* try to seek in the file to figure out if it is seekable */
   sink->seekable = gst_file_sink_do_seek (sink, 0);
 
+  if (sink->io_uring)
+    gst_file_sink_setup_uring (sink);
+
   GST_DEBUG_OBJECT (sink, "opened file %s, seekable %d",
       sink->filename, sink->seekable);
 
@@ -437,6 +746,33 @@ static void
 gst_file_sink_close_file (GstFileSink * sink)
 {
   if (sink->file) {
+    if (sink->ring) {
+      if (!gst_io_uring_complete_writes (sink->ring, 0))
+        GST_ELEMENT_ERROR (sink, RESOURCE, WRITE,
+            (_("Error while writing to file \"%s\"."), sink->filename),
+            GST_ERROR_SYSTEM);
+      gst_io_uring_free (sink->ring);
+      sink->ring = NULL;
+    }
+    if (sink->direct_data && !gst_file_sink_direct_flush (sink, TRUE))
+      GST_ELEMENT_ERROR (sink, RESOURCE, WRITE,
+          (_("Error while writing to file \"%s\"."), sink->filename),
+          GST_ERROR_SYSTEM);
+    g_free (sink->direct_mem);
+    sink->direct_mem = sink->direct_data = NULL;
+
+#ifdef USE_FALLOCATE
+    /* give back the part of the reservation we didn't use */
+    if (sink->allocated_end > 0) {
+      struct stat st;
+
+      if (fstat (fileno (sink->file), &st) == 0 &&
+          ftruncate (fileno (sink->file), st.st_size) < 0)
+        GST_WARNING_OBJECT (sink, "could not release preallocated space: %s",
+            g_strerror (errno));
+    }
+#endif
+
     if (fclose (sink->file) != 0)
       GST_ELEMENT_ERROR (sink, RESOURCE, CLOSE,
           (_("Error closing file \"%s\"."), sink->filename), GST_ERROR_SYSTEM);
@@ -465,7 +801,11 @@ gst_file_sink_query (GstBaseSink * bsink, GstQuery * query)
       switch (format) {
         case GST_FORMAT_DEFAULT:
         case GST_FORMAT_BYTES:
-          gst_query_set_position (query, GST_FORMAT_BYTES, self->current_pos);
+          /* the writer thread publishes its position with the lock */
+          g_mutex_lock (&self->writer_lock);
+          gst_query_set_position (query, GST_FORMAT_BYTES,
+              self->writer ? self->writer_pos : self->current_pos);
+          g_mutex_unlock (&self->writer_lock);
           res = TRUE;
           break;
         default:
@@ -515,9 +855,15 @@ gst_file_sink_do_seek (GstFileSink * filesink, guint64 new_offset)
   GST_DEBUG_OBJECT (filesink, "Seeking to offset %" G_GUINT64_FORMAT
       " using " __GST_STDIO_SEEK_FUNCTION, new_offset);
 
+  if (!gst_file_sink_uring_drain (filesink))
+    goto flush_failed;
+
   if (fflush (filesink->file))
     goto flush_failed;
 
+  if (filesink->direct_data && !gst_file_sink_direct_flush (filesink, TRUE))
+    goto flush_failed;
+
 #ifdef HAVE_FSEEKO
   if (fseeko (filesink->file, (off_t) new_offset, SEEK_SET) != 0)
     goto seek_failed;
@@ -534,6 +880,20 @@ gst_file_sink_do_seek (GstFileSink * filesink, guint64 new_offset)
    * presumably this should basically yield new_offset */
   gst_file_sink_get_current_offset (filesink, &filesink->current_pos);
 
+  /* stage the following writes at the new position */
+  if (filesink->direct_data) {
+    filesink->direct_base = filesink->current_pos & ~((guint64) DIRECT_ALIGN
+        - 1);
+    filesink->direct_start = filesink->direct_fill =
+        filesink->current_pos - filesink->direct_base;
+  }
+  filesink->sync_prev = filesink->sync_pos = filesink->current_pos;
+
+  /* the writer thread is idle, it was drained before seeking */
+  g_mutex_lock (&filesink->writer_lock);
+  filesink->writer_pos = filesink->current_pos;
+  g_mutex_unlock (&filesink->writer_lock);
+
   return TRUE;
 
   /* ERRORS */
@@ -568,6 +928,9 @@ gst_file_sink_event (GstBaseSink * sink, GstEvent * event)
       gst_event_parse_segment (event, &segment);
 
       if (segment->format == GST_FORMAT_BYTES) {
+        if (gst_file_sink_writer_drain (filesink, FALSE) != GST_FLOW_OK)
+          goto write_failed;
+
         /* only try to seek and fail when we are going to a different
          * position */
         if (filesink->current_pos != segment->start) {
@@ -588,15 +951,26 @@ gst_file_sink_event (GstBaseSink * sink, GstEvent * event)
       break;
     }
     case GST_EVENT_FLUSH_STOP:
+      /* the queued data is going to be truncated anyway */
+      gst_file_sink_writer_drain (filesink, TRUE);
+      if (filesink->direct_data)
+        filesink->direct_fill = filesink->direct_start;
       if (filesink->current_pos != 0 && filesink->seekable) {
         gst_file_sink_do_seek (filesink, 0);
         if (ftruncate (fileno (filesink->file), 0))
           goto flush_failed;
+        filesink->allocated_end = 0;
       }
       break;
     case GST_EVENT_EOS:
+      if (gst_file_sink_writer_drain (filesink, FALSE) != GST_FLOW_OK)
+        goto write_failed;
+      if (!gst_file_sink_uring_drain (filesink))
+        goto flush_failed;
       if (fflush (filesink->file))
         goto flush_failed;
+      if (filesink->direct_data && !gst_file_sink_direct_flush (filesink, TRUE))
+        goto flush_failed;
       break;
     default:
       break;
@@ -621,6 +995,13 @@ flush_failed:
     gst_event_unref (event);
     return FALSE;
   }
+write_failed:
+  {
+    /* the writer thread posted the error already */
+    GST_DEBUG_OBJECT (filesink, "writing queued data failed");
+    gst_event_unref (event);
+    return FALSE;
+  }
 }
 
 static gboolean
@@ -646,31 +1027,309 @@ gst_file_sink_get_current_offset (GstFileSink * filesink, guint64 * p_pos)
   return (ret != (off_t) - 1);
 }
 
+#ifdef USE_DIRECT
+static gboolean
+gst_file_sink_pwrite_all (gint fd, const guint8 * data, gsize length,
+    guint64 offset)
+{
+  while (length > 0) {
+    gssize res;
+
+    res = pwrite (fd, data, length, (off_t) offset);
+    if (res < 0) {
+      if (errno == EAGAIN || errno == EINTR)
+        continue;
+      return FALSE;
+    }
+    data += res;
+    length -= res;
+    offset += res;
+  }
+  return TRUE;
+}
+
+/* write a range that isn't made of whole aligned blocks, with O_DIRECT
+ * temporarily turned off */
+static gboolean
+gst_file_sink_pwrite_unaligned (gint fd, const guint8 * data, gsize length,
+    guint64 offset)
+{
+  gint flags;
+  gboolean res;
+
+  flags = fcntl (fd, F_GETFL);
+  if (flags < 0 || fcntl (fd, F_SETFL, flags & ~O_DIRECT) < 0)
+    return FALSE;
+  res = gst_file_sink_pwrite_all (fd, data, length, offset);
+  if (fcntl (fd, F_SETFL, flags) < 0)
+    res = FALSE;
+
+  return res;
+}
+#endif
+
+/* Write out the staged data. Whole aligned blocks go straight to the disk,
+ * a block that starts unaligned after a seek is written normally. With @all,
+ * the partial block at the end is written normally too, otherwise it stays
+ * staged until the next writes complete it. */
+static gboolean
+gst_file_sink_direct_flush (GstFileSink * sink, gboolean all)
+{
+#ifdef USE_DIRECT
+  gint fd = fileno (sink->file);
+  gsize start, end, shift;
+
+  start = sink->direct_start;
+
+  if (start % DIRECT_ALIGN) {
+    end = MIN (GST_ROUND_UP_N (start, DIRECT_ALIGN), sink->direct_fill);
+    if (end % DIRECT_ALIGN == 0 || all) {
+      if (!gst_file_sink_pwrite_unaligned (fd, sink->direct_data + start,
+              end - start, sink->direct_base + start))
+        return FALSE;
+      start = end;
+    }
+  }
+
+  if (start % DIRECT_ALIGN == 0) {
+    end = GST_ROUND_DOWN_N (sink->direct_fill, DIRECT_ALIGN);
+    if (end > start) {
+      GST_LOG_OBJECT (sink, "writing %" G_GSIZE_FORMAT " bytes at %"
+          G_GUINT64_FORMAT " with O_DIRECT", end - start,
+          sink->direct_base + start);
+      if (!gst_file_sink_pwrite_all (fd, sink->direct_data + start,
+              end - start, sink->direct_base + start))
+        return FALSE;
+      start = end;
+    }
+    if (all && start < sink->direct_fill) {
+      if (!gst_file_sink_pwrite_unaligned (fd, sink->direct_data + start,
+              sink->direct_fill - start, sink->direct_base + start))
+        return FALSE;
+      start = sink->direct_fill;
+    }
+  }
+
+  /* move the block that is still being filled to the front */
+  shift = GST_ROUND_DOWN_N (start, DIRECT_ALIGN);
+  memmove (sink->direct_data, sink->direct_data + shift,
+      sink->direct_fill - shift);
+  sink->direct_base += shift;
+  sink->direct_start = start - shift;
+  sink->direct_fill -= shift;
+#endif
+
+  return TRUE;
+}
+
 static GstFlowReturn
-gst_file_sink_render_buffers (GstFileSink * sink, GstBuffer ** buffers,
-    guint num_buffers, guint8 * mem_nums, guint total_mems)
+gst_file_sink_direct_write (GstFileSink * sink, GstBuffer ** buffers,
+    guint num_buffers)
 {
+  guint i, j;
+
+  for (i = 0; i < num_buffers; i++) {
+    guint n_mem = gst_buffer_n_memory (buffers[i]);
+
+    for (j = 0; j < n_mem; j++) {
+      GstMemory *mem = gst_buffer_peek_memory (buffers[i], j);
+      GstMapInfo info;
+      gsize done = 0;
+
+      if (!gst_memory_map (mem, &info, GST_MAP_READ))
+        goto map_failed;
+
+      while (done < info.size) {
+        gsize len;
+
+        if (sink->direct_fill == sink->direct_size &&
+            !gst_file_sink_direct_flush (sink, FALSE)) {
+          gst_memory_unmap (mem, &info);
+          goto write_failed;
+        }
+
+        len = MIN (info.size - done, sink->direct_size - sink->direct_fill);
+        memcpy (sink->direct_data + sink->direct_fill, info.data + done, len);
+        sink->direct_fill += len;
+        sink->current_pos += len;
+        done += len;
+      }
+      gst_memory_unmap (mem, &info);
+    }
+  }
+
+  return GST_FLOW_OK;
+
+  /* ERRORS */
+map_failed:
+  {
+    GST_ELEMENT_ERROR (sink, RESOURCE, READ, (NULL),
+        ("Failed to map memory"));
+    return GST_FLOW_ERROR;
+  }
+write_failed:
+  {
+    GST_ELEMENT_ERROR (sink, RESOURCE, WRITE,
+        (_("Error while writing to file \"%s\"."), sink->filename),
+        GST_ERROR_SYSTEM);
+    return GST_FLOW_ERROR;
+  }
+}
+
+/* extend the reserved disk space when the next write goes beyond it */
+static void
+gst_file_sink_preallocate (GstFileSink * sink, guint64 size)
+{
+#ifdef USE_FALLOCATE
+  guint64 start, end;
+
+  if (sink->preallocate == 0 || sink->current_pos + size <= sink->allocated_end)
+    return;
+
+  start = MAX (sink->current_pos, sink->allocated_end);
+  end = sink->current_pos + size + sink->preallocate;
+
+  GST_LOG_OBJECT (sink, "reserving %" G_GUINT64_FORMAT "-%" G_GUINT64_FORMAT,
+      start, end);
+  if (fallocate (fileno (sink->file), FALLOC_FL_KEEP_SIZE, start,
+          end - start) < 0) {
+    GST_WARNING_OBJECT (sink, "could not preallocate: %s", g_strerror (errno));
+    /* don't try again for this file */
+    end = G_MAXUINT64;
+  }
+  sink->allocated_end = end;
+#endif
+}
+
+/* Once sync-bytes were written since the last call, wait for the range
+ * handed to writeback last time and start writeback of the new one. The
+ * kernel then never accumulates much more than twice sync-bytes of dirty
+ * data for this file. */
+static gboolean
+gst_file_sink_writeback (GstFileSink * sink)
+{
+  gint fd;
+
+  if (sink->sync_bytes == 0 ||
+      sink->current_pos < sink->sync_pos + sink->sync_bytes)
+    return TRUE;
+
+  fd = fileno (sink->file);
+
+  GST_LOG_OBJECT (sink, "writeback up to %" G_GUINT64_FORMAT,
+      sink->current_pos);
+#ifdef HAVE_SYNC_FILE_RANGE
+  if (sink->sync_pos > sink->sync_prev &&
+      sync_file_range (fd, sink->sync_prev, sink->sync_pos - sink->sync_prev,
+          SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+          SYNC_FILE_RANGE_WAIT_AFTER) < 0)
+    return FALSE;
+  if (sync_file_range (fd, sink->sync_pos, sink->current_pos - sink->sync_pos,
+          SYNC_FILE_RANGE_WRITE) < 0)
+    return FALSE;
+#elif defined (HAVE_FDATASYNC)
+  if (fdatasync (fd) < 0)
+    return FALSE;
+#else
+  if (fsync (fd) < 0)
+    return FALSE;
+#endif
+
+  sink->sync_prev = sink->sync_pos;
+  sink->sync_pos = sink->current_pos;
+
+  return TRUE;
+}
+
+/* Queue @obj behind at most io-depth - 1 other writes. What can't be
+ * queued is written synchronously once the ring is drained. */
+static GstFlowReturn
+gst_file_sink_uring_write (GstFileSink * sink, GstMiniObject * obj,
+    GstBuffer ** buffers, guint num_buffers, guint8 * mem_nums,
+    guint total_mems, gsize size)
+{
+  if (!gst_io_uring_complete_writes (sink->ring, sink->ring_depth - 1))
+    goto write_failed;
+
+  if (gst_io_uring_write (sink->ring, fileno (sink->file), obj,
+          sink->current_pos)) {
+    sink->current_pos += size;
+    return GST_FLOW_OK;
+  }
+
+  GST_LOG_OBJECT (sink, "could not queue write, writing synchronously");
+  if (!gst_file_sink_uring_drain (sink))
+    goto write_failed;
+
+  return gst_writev_buffers (GST_OBJECT_CAST (sink), fileno (sink->file),
+      NULL, buffers, num_buffers, mem_nums, total_mems, &sink->current_pos, 0);
+
+  /* ERRORS */
+write_failed:
+  {
+    GST_ELEMENT_ERROR (sink, RESOURCE, WRITE,
+        (_("Error while writing to file \"%s\"."), sink->filename),
+        GST_ERROR_SYSTEM);
+    return GST_FLOW_ERROR;
+  }
+}
+
+static GstFlowReturn
+gst_file_sink_render_buffers (GstFileSink * sink, GstMiniObject * obj,
+    GstBuffer ** buffers, guint num_buffers, guint8 * mem_nums,
+    guint total_mems, gsize size)
+{
+  GstFlowReturn flow;
+
   GST_DEBUG_OBJECT (sink,
       "writing %u buffers (%u memories) at position %" G_GUINT64_FORMAT,
       num_buffers, total_mems, sink->current_pos);
 
-  return gst_writev_buffers (GST_OBJECT_CAST (sink), fileno (sink->file), NULL,
-      buffers, num_buffers, mem_nums, total_mems, &sink->current_pos, 0);
+  gst_file_sink_preallocate (sink, size);
+
+  if (sink->ring)
+    flow = gst_file_sink_uring_write (sink, obj, buffers, num_buffers,
+        mem_nums, total_mems, size);
+  else if (sink->direct_data)
+    flow = gst_file_sink_direct_write (sink, buffers, num_buffers);
+  else
+    flow = gst_writev_buffers (GST_OBJECT_CAST (sink), fileno (sink->file),
+        NULL, buffers, num_buffers, mem_nums, total_mems, &sink->current_pos,
+        0);
+
+  if (flow == GST_FLOW_OK && !gst_file_sink_writeback (sink)) {
+    GST_ELEMENT_ERROR (sink, RESOURCE, WRITE,
+        (_("Error while writing to file \"%s\"."), sink->filename),
+        ("%s", g_strerror (errno)));
+    flow = GST_FLOW_ERROR;
+  }
+
+  return flow;
+}
+
+static gboolean
+gst_file_sink_sync (GstFileSink * sink)
+{
+  if (!gst_file_sink_uring_drain (sink))
+    return FALSE;
+  if (fflush (sink->file))
+    return FALSE;
+  if (sink->direct_data && !gst_file_sink_direct_flush (sink, TRUE))
+    return FALSE;
+  return fsync (fileno (sink->file)) == 0;
 }
 
 static GstFlowReturn
-gst_file_sink_render_list (GstBaseSink * bsink, GstBufferList * buffer_list)
+gst_file_sink_write_list (GstFileSink * sink, GstBufferList * buffer_list)
 {
   GstFlowReturn flow;
   GstBuffer **buffers;
-  GstFileSink *sink;
   guint8 *mem_nums;
   guint total_mems;
   guint i, num_buffers;
+  gsize size;
   gboolean sync_after = FALSE;
 
-  sink = GST_FILE_SINK_CAST (bsink);
-
   num_buffers = gst_buffer_list_length (buffer_list);
   if (num_buffers == 0)
     goto no_data;
@@ -678,20 +1337,21 @@ gst_file_sink_render_list (GstBaseSink * bsink, GstBufferList * buffer_list)
   /* extract buffers from list and count memories */
   buffers = g_newa (GstBuffer *, num_buffers);
   mem_nums = g_newa (guint8, num_buffers);
-  for (i = 0, total_mems = 0; i < num_buffers; ++i) {
+  for (i = 0, total_mems = 0, size = 0; i < num_buffers; ++i) {
     buffers[i] = gst_buffer_list_get (buffer_list, i);
     mem_nums[i] = gst_buffer_n_memory (buffers[i]);
     total_mems += mem_nums[i];
+    size += gst_buffer_get_size (buffers[i]);
     if (GST_BUFFER_FLAG_IS_SET (buffers[i], GST_BUFFER_FLAG_SYNC_AFTER))
       sync_after = TRUE;
   }
 
   flow =
-      gst_file_sink_render_buffers (sink, buffers, num_buffers, mem_nums,
-      total_mems);
+      gst_file_sink_render_buffers (sink, GST_MINI_OBJECT_CAST (buffer_list),
+      buffers, num_buffers, mem_nums, total_mems, size);
 
   if (flow == GST_FLOW_OK && sync_after) {
-    if (fflush (sink->file) || fsync (fileno (sink->file))) {
+    if (!gst_file_sink_sync (sink)) {
       GST_ELEMENT_ERROR (sink, RESOURCE, WRITE,
           (_("Error while writing to file \"%s\"."), sink->filename),
           ("%s", g_strerror (errno)));
@@ -709,24 +1369,23 @@ no_data:
 }
 
 static GstFlowReturn
-gst_file_sink_render (GstBaseSink * sink, GstBuffer * buffer)
+gst_file_sink_write_buffer (GstFileSink * filesink, GstBuffer * buffer)
 {
-  GstFileSink *filesink;
   GstFlowReturn flow;
   guint8 n_mem;
 
-  filesink = GST_FILE_SINK_CAST (sink);
-
   n_mem = gst_buffer_n_memory (buffer);
 
   if (n_mem > 0)
-    flow = gst_file_sink_render_buffers (filesink, &buffer, 1, &n_mem, n_mem);
+    flow = gst_file_sink_render_buffers (filesink,
+        GST_MINI_OBJECT_CAST (buffer), &buffer, 1, &n_mem, n_mem,
+        gst_buffer_get_size (buffer));
   else
     flow = GST_FLOW_OK;
 
   if (flow == GST_FLOW_OK &&
       GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_SYNC_AFTER)) {
-    if (fflush (filesink->file) || fsync (fileno (filesink->file))) {
+    if (!gst_file_sink_sync (filesink)) {
       GST_ELEMENT_ERROR (filesink, RESOURCE, WRITE,
           (_("Error while writing to file \"%s\"."), filesink->filename),
           ("%s", g_strerror (errno)));
@@ -737,16 +1396,209 @@ gst_file_sink_render (GstBaseSink * sink, GstBuffer * buffer)
   return flow;
 }
 
+/* The writer thread writes the queued buffers and lists in order. Items are
+ * only removed from the queue after they were written, so an empty queue
+ * means that everything queued so far is in the file. */
+static gpointer
+gst_file_sink_writer_func (gpointer user_data)
+{
+  GstFileSink *sink = user_data;
+
+  g_mutex_lock (&sink->writer_lock);
+  while (TRUE) {
+    GstMiniObject *obj;
+    GstFlowReturn flow = GST_FLOW_OK;
+    gsize size;
+    gboolean skip;
+
+    while (sink->writer_running &&
+        gst_queue_array_is_empty (sink->writer_queue))
+      g_cond_wait (&sink->writer_cond, &sink->writer_lock);
+
+    if (gst_queue_array_is_empty (sink->writer_queue))
+      break;
+
+    obj = gst_queue_array_peek_head (sink->writer_queue);
+    /* after an error, only drain the queue */
+    skip = sink->writer_discard || sink->writer_flow != GST_FLOW_OK;
+    g_mutex_unlock (&sink->writer_lock);
+
+    if (GST_IS_BUFFER (obj)) {
+      size = gst_buffer_get_size (GST_BUFFER_CAST (obj));
+      if (!skip)
+        flow = gst_file_sink_write_buffer (sink, GST_BUFFER_CAST (obj));
+    } else {
+      size = gst_buffer_list_calculate_size (GST_BUFFER_LIST_CAST (obj));
+      if (!skip)
+        flow = gst_file_sink_write_list (sink, GST_BUFFER_LIST_CAST (obj));
+    }
+
+    g_mutex_lock (&sink->writer_lock);
+    gst_queue_array_pop_head (sink->writer_queue);
+    gst_mini_object_unref (obj);
+    sink->writer_queued_bytes -= size;
+    sink->writer_pos = sink->current_pos;
+    if (flow != GST_FLOW_OK && sink->writer_flow == GST_FLOW_OK)
+      sink->writer_flow = flow;
+    g_cond_broadcast (&sink->writer_cond);
+  }
+  g_mutex_unlock (&sink->writer_lock);
+
+  return NULL;
+}
+
+static GstFlowReturn
+gst_file_sink_writer_queue (GstFileSink * sink, GstMiniObject * obj,
+    gsize size)
+{
+  GstFlowReturn flow;
+
+  g_mutex_lock (&sink->writer_lock);
+  while (TRUE) {
+    /* always let one item in, even if it is larger than the limit */
+    while (sink->writer_flow == GST_FLOW_OK && !sink->writer_unlocked &&
+        sink->writer_queued_bytes > 0 &&
+        sink->writer_queued_bytes + size > sink->async_write_max_bytes)
+      g_cond_wait (&sink->writer_cond, &sink->writer_lock);
+
+    flow = sink->writer_flow;
+    if (flow != GST_FLOW_OK || !sink->writer_unlocked)
+      break;
+
+    /* unlocked for a flush or a state change, wait for the preroll like a
+     * blocking write does and try again when going back to PLAYING */
+    g_mutex_unlock (&sink->writer_lock);
+    flow = gst_base_sink_wait_preroll (GST_BASE_SINK (sink));
+    if (flow != GST_FLOW_OK)
+      return flow;
+    g_mutex_lock (&sink->writer_lock);
+  }
+
+  if (flow == GST_FLOW_OK) {
+    gst_queue_array_push_tail (sink->writer_queue, gst_mini_object_ref (obj));
+    sink->writer_queued_bytes += size;
+    g_cond_broadcast (&sink->writer_cond);
+  }
+  g_mutex_unlock (&sink->writer_lock);
+
+  return flow;
+}
+
+/* Wait until the writer thread has written, or with @discard dropped,
+ * everything queued so far. Returns the first error of the writer, which is
+ * cleared when discarding. */
+static GstFlowReturn
+gst_file_sink_writer_drain (GstFileSink * sink, gboolean discard)
+{
+  GstFlowReturn flow;
+
+  if (sink->writer == NULL)
+    return GST_FLOW_OK;
+
+  g_mutex_lock (&sink->writer_lock);
+  sink->writer_discard = discard;
+  while (!gst_queue_array_is_empty (sink->writer_queue))
+    g_cond_wait (&sink->writer_cond, &sink->writer_lock);
+  sink->writer_discard = FALSE;
+  flow = sink->writer_flow;
+  if (discard)
+    sink->writer_flow = GST_FLOW_OK;
+  g_mutex_unlock (&sink->writer_lock);
+
+  return flow;
+}
+
+static GstFlowReturn
+gst_file_sink_render_list (GstBaseSink * bsink, GstBufferList * buffer_list)
+{
+  GstFileSink *sink = GST_FILE_SINK_CAST (bsink);
+
+  if (sink->writer)
+    return gst_file_sink_writer_queue (sink, GST_MINI_OBJECT_CAST (buffer_list),
+        gst_buffer_list_calculate_size (buffer_list));
+
+  return gst_file_sink_write_list (sink, buffer_list);
+}
+
+static GstFlowReturn
+gst_file_sink_render (GstBaseSink * sink, GstBuffer * buffer)
+{
+  GstFileSink *filesink = GST_FILE_SINK_CAST (sink);
+
+  if (filesink->writer)
+    return gst_file_sink_writer_queue (filesink, GST_MINI_OBJECT_CAST (buffer),
+        gst_buffer_get_size (buffer));
+
+  return gst_file_sink_write_buffer (filesink, buffer);
+}
+
+static gboolean
+gst_file_sink_unlock (GstBaseSink * basesink)
+{
+  GstFileSink *sink = GST_FILE_SINK (basesink);
+
+  g_mutex_lock (&sink->writer_lock);
+  sink->writer_unlocked = TRUE;
+  g_cond_broadcast (&sink->writer_cond);
+  g_mutex_unlock (&sink->writer_lock);
+
+  return TRUE;
+}
+
+static gboolean
+gst_file_sink_unlock_stop (GstBaseSink * basesink)
+{
+  GstFileSink *sink = GST_FILE_SINK (basesink);
+
+  g_mutex_lock (&sink->writer_lock);
+  sink->writer_unlocked = FALSE;
+  g_mutex_unlock (&sink->writer_lock);
+
+  return TRUE;
+}
+
 static gboolean
 gst_file_sink_start (GstBaseSink * basesink)
 {
-  return gst_file_sink_open_file (GST_FILE_SINK (basesink));
+  GstFileSink *sink = GST_FILE_SINK (basesink);
+
+  if (!gst_file_sink_open_file (sink))
+    return FALSE;
+
+  if (sink->async_write) {
+    sink->writer_queue = gst_queue_array_new (64);
+    sink->writer_queued_bytes = 0;
+    sink->writer_pos = sink->current_pos;
+    sink->writer_flow = GST_FLOW_OK;
+    sink->writer_discard = FALSE;
+    sink->writer_unlocked = FALSE;
+    sink->writer_running = TRUE;
+    sink->writer = g_thread_new ("filesink-writer", gst_file_sink_writer_func,
+        sink);
+  }
+
+  return TRUE;
 }
 
 static gboolean
 gst_file_sink_stop (GstBaseSink * basesink)
 {
-  gst_file_sink_close_file (GST_FILE_SINK (basesink));
+  GstFileSink *sink = GST_FILE_SINK (basesink);
+
+  /* the writer thread writes out what is still queued before exiting */
+  if (sink->writer) {
+    g_mutex_lock (&sink->writer_lock);
+    sink->writer_running = FALSE;
+    g_cond_broadcast (&sink->writer_cond);
+    g_mutex_unlock (&sink->writer_lock);
+
+    g_thread_join (sink->writer);
+    sink->writer = NULL;
+    gst_queue_array_free (sink->writer_queue);
+    sink->writer_queue = NULL;
+  }
+
+  gst_file_sink_close_file (sink);
   return TRUE;
 }
 
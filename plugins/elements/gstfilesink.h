@@ -28,6 +28,9 @@
 
 #include <gst/gst.h>
 #include <gst/base/gstbasesink.h>
+#include <gst/base/gstqueuearray.h>
+
+#include "gstiouring.h"
 
 G_BEGIN_DECLS
 
@@ -83,6 +86,39 @@ struct _GstFileSink {
   gchar  *buffer;
 
   gboolean append;
+
+  guint64  preallocate;
+  guint64  allocated_end;       /* end of the preallocated range */
+
+  gboolean direct;
+  guint8  *direct_mem;          /* staging buffer for O_DIRECT writes */
+  guint8  *direct_data;         /* aligned start of direct_mem */
+  gsize    direct_size;         /* capacity of direct_data */
+  gsize    direct_start;        /* first staged byte in direct_data */
+  gsize    direct_fill;         /* end of the staged bytes */
+  guint64  direct_base;         /* file offset of direct_data[0] */
+
+  guint64  sync_bytes;
+  guint64  sync_prev;           /* range handed to writeback last time */
+  guint64  sync_pos;
+
+  gboolean async_write;
+  guint64  async_write_max_bytes;
+  GThread *writer;
+  GMutex   writer_lock;
+  GCond    writer_cond;
+  GstQueueArray *writer_queue;  /* buffers and lists not yet written */
+  guint64  writer_queued_bytes;
+  guint64  writer_pos;          /* current_pos for queries */
+  gboolean writer_running;
+  gboolean writer_discard;
+  gboolean writer_unlocked;
+  GstFlowReturn writer_flow;
+
+  gboolean io_uring;
+  guint    io_depth;
+  GstIoUring *ring;             /* queues the writes in io-uring mode */
+  guint    ring_depth;          /* writes in flight */
 };
 
 struct _GstFileSinkClass {
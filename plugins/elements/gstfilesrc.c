@@ -31,14 +31,30 @@
  * gst-launch-1.0 filesrc location=song.ogg ! decodebin ! audioconvert ! audioresample ! autoaudiosink
  * ]| Play song.ogg audio file which must be in the current working directory.
  *
+ * For large local files, #GstFileSrc:read-mode can be set to mmap to hand
+ * out the file pages without copying, or to direct to read with O_DIRECT
+ * into aligned buffers that bypass the page cache.
+ * #GstFileSrc:readahead asks the operating system to read a window of the
+ * file ahead of the current position. On Linux, the uring mode keeps
+ * #GstFileSrc:io-depth reads in flight with io_uring while downstream
+ * processes the data.
+ *
+ * |[
+ * gst-launch-1.0 filesrc location=movie.mkv read-mode=mmap readahead=8388608 ! matroskademux ! fakesink
+ * ]| Demux a file from a read-only mapping, with an 8MB readahead window.
+ *
  */
 
 #ifdef HAVE_CONFIG_H
 #  include "config.h"
 #endif
 
+/* for O_DIRECT */
+#define _GNU_SOURCE 1
+
 #include <gst/gst.h>
 #include "gstfilesrc.h"
+#include "gstelements_private.h"
 
 #include <stdio.h>
 #include <sys/types.h>
@@ -72,6 +88,20 @@
 #endif
 #endif
 
+#if defined (HAVE_SYS_MMAN_H) && !defined (G_OS_WIN32)
+#include <sys/mman.h>
+#define USE_MMAP 1
+#endif
+
+#if defined (O_DIRECT) && defined (HAVE_PREAD)
+#define USE_DIRECT 1
+#endif
+
+#ifdef HAVE_LINUX_IO_URING_H
+#include <sys/uio.h>
+#define USE_URING 1
+#endif
+
 #include <errno.h>
 #include <string.h>
 
@@ -136,13 +166,102 @@ enum
 };
 
 #define DEFAULT_BLOCKSIZE       4*1024
+#define DEFAULT_READ_MODE       GST_FILE_SRC_READ_MODE_READ
+#define DEFAULT_READAHEAD       0
+#define DEFAULT_IO_DEPTH        4
+
+/* offset and size alignment of O_DIRECT reads */
+#define DIRECT_ALIGN            4096
 
 enum
 {
   PROP_0,
-  PROP_LOCATION
+  PROP_LOCATION,
+  PROP_READ_MODE,
+  PROP_READAHEAD,
+  PROP_IO_DEPTH
+};
+
+#define GST_TYPE_FILE_SRC_READ_MODE (gst_file_src_read_mode_get_type())
+static GType
+gst_file_src_read_mode_get_type (void)
+{
+  static GType type = 0;
+  static const GEnumValue data[] = {
+    {GST_FILE_SRC_READ_MODE_READ, "Read into downstream buffers", "read"},
+    {GST_FILE_SRC_READ_MODE_MMAP, "Wrap mapped file pages without copying",
+        "mmap"},
+    {GST_FILE_SRC_READ_MODE_DIRECT,
+        "Read with O_DIRECT into aligned buffers", "direct"},
+    {GST_FILE_SRC_READ_MODE_URING,
+        "Keep several reads in flight with io_uring", "uring"},
+    {0, NULL, NULL},
+  };
+
+  if (!type) {
+    type = g_enum_register_static ("GstFileSrcReadMode", data);
+  }
+  return type;
+}
+
+#ifdef HAVE_PREAD
+#define USE_PREAD(src) ((src)->seekable)
+#else
+#define USE_PREAD(src) FALSE
+#endif
+
+/* A read-only mapping of the whole file, shared by all the memory that
+ * points into it. */
+struct _GstFileSrcMapping
+{
+  gint refcount;
+  gpointer data;
+  gsize size;
 };
 
+#ifdef USE_MMAP
+static GstFileSrcMapping *
+gst_file_src_mapping_new (gint fd, gsize size)
+{
+  GstFileSrcMapping *mapping;
+  gpointer data;
+
+  data = mmap (NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED)
+    return NULL;
+
+  mapping = g_slice_new (GstFileSrcMapping);
+  mapping->refcount = 1;
+  mapping->data = data;
+  mapping->size = size;
+
+  return mapping;
+}
+
+static void
+gst_file_src_mapping_unref (GstFileSrcMapping * mapping)
+{
+  if (g_atomic_int_dec_and_test (&mapping->refcount)) {
+    munmap (mapping->data, mapping->size);
+    g_slice_free (GstFileSrcMapping, mapping);
+  }
+}
+#endif
+
+#ifdef USE_URING
+/* A read queued on the ring in uring mode */
+typedef struct
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+  struct iovec vec;
+  guint64 offset;
+  guint size;
+  gint res;
+  gboolean done;
+} GstFileSrcUringRead;
+#endif
+
 static void gst_file_src_finalize (GObject * object);
 
 static void gst_file_src_set_property (GObject * object, guint prop_id,
@@ -155,6 +274,8 @@ static gboolean gst_file_src_stop (GstBaseSrc * basesrc);
 
 static gboolean gst_file_src_is_seekable (GstBaseSrc * src);
 static gboolean gst_file_src_get_size (GstBaseSrc * src, guint64 * size);
+static GstFlowReturn gst_file_src_create (GstBaseSrc * src, guint64 offset,
+    guint length, GstBuffer ** buffer);
 static GstFlowReturn gst_file_src_fill (GstBaseSrc * src, guint64 offset,
     guint length, GstBuffer * buf);
 
@@ -187,6 +308,57 @@ gst_file_src_class_init (GstFileSrcClass * klass)
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
           GST_PARAM_MUTABLE_READY));
 
+  /**
+   * GstFileSrc:read-mode:
+   *
+   * How to read the file. In mmap mode, buffers point into a read-only
+   * mapping of the file and no data is copied. The file must not be truncated
+   * while it is mapped, accessing the lost pages crashes the process. In
+   * direct mode, the file is read with O_DIRECT into aligned buffers from an
+   * internal pool. In uring mode, the reads after the current position are
+   * queued on an io_uring ahead of time, into buffers registered with the
+   * kernel when possible. These modes only apply when filesrc allocates the
+   * buffers, and fall back to read mode if they can't be used for the file.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_READ_MODE,
+      g_param_spec_enum ("read-mode", "Read mode",
+          "How to read the file", GST_TYPE_FILE_SRC_READ_MODE,
+          DEFAULT_READ_MODE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  /**
+   * GstFileSrc:readahead:
+   *
+   * Size of the window after the current position that the operating system
+   * is asked to read ahead, or 0 to leave it to the operating system. The
+   * hint is renewed every half window. It has no effect in direct mode, which
+   * does not go through the page cache.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_READAHEAD,
+      g_param_spec_uint64 ("readahead", "Readahead",
+          "Bytes to read ahead of the current position (0 = system default)",
+          0, G_MAXUINT64, DEFAULT_READAHEAD,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  /**
+   * GstFileSrc:io-depth:
+   *
+   * Number of reads kept in flight in uring read mode. Reads are only queued
+   * ahead while downstream asks for consecutive blocks of the same size.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_IO_DEPTH,
+      g_param_spec_uint ("io-depth", "I/O depth",
+          "Number of reads in flight in uring read mode", 1, 256,
+          DEFAULT_IO_DEPTH, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
   gobject_class->finalize = gst_file_src_finalize;
 
   gst_element_class_set_static_metadata (gstelement_class,
@@ -200,6 +372,7 @@ gst_file_src_class_init (GstFileSrcClass * klass)
   gstbasesrc_class->stop = GST_DEBUG_FUNCPTR (gst_file_src_stop);
   gstbasesrc_class->is_seekable = GST_DEBUG_FUNCPTR (gst_file_src_is_seekable);
   gstbasesrc_class->get_size = GST_DEBUG_FUNCPTR (gst_file_src_get_size);
+  gstbasesrc_class->create = GST_DEBUG_FUNCPTR (gst_file_src_create);
   gstbasesrc_class->fill = GST_DEBUG_FUNCPTR (gst_file_src_fill);
 
   if (sizeof (off_t) < 8) {
@@ -217,6 +390,11 @@ gst_file_src_init (GstFileSrc * src)
 
   src->is_regular = FALSE;
 
+  src->read_mode = DEFAULT_READ_MODE;
+  src->readahead = DEFAULT_READAHEAD;
+  src->io_depth = DEFAULT_IO_DEPTH;
+  src->direct_fd = -1;
+
   gst_base_src_set_blocksize (GST_BASE_SRC (src), DEFAULT_BLOCKSIZE);
 }
 
@@ -294,6 +472,15 @@ gst_file_src_set_property (GObject * object, guint prop_id,
     case PROP_LOCATION:
       gst_file_src_set_location (src, g_value_get_string (value), NULL);
       break;
+    case PROP_READ_MODE:
+      src->read_mode = g_value_get_enum (value);
+      break;
+    case PROP_READAHEAD:
+      src->readahead = g_value_get_uint64 (value);
+      break;
+    case PROP_IO_DEPTH:
+      src->io_depth = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -314,6 +501,15 @@ gst_file_src_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_LOCATION:
       g_value_set_string (value, src->filename);
       break;
+    case PROP_READ_MODE:
+      g_value_set_enum (value, src->read_mode);
+      break;
+    case PROP_READAHEAD:
+      g_value_set_uint64 (value, src->readahead);
+      break;
+    case PROP_IO_DEPTH:
+      g_value_set_uint (value, src->io_depth);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -330,6 +526,387 @@ gst_file_src_get_property (GObject * object, guint prop_id, GValue * value,
  * the sort of attitude we want to be advertising.  No sir.
  *
  */
+
+/* Ask the kernel to read the window after @offset ahead of time. The hint is
+ * only renewed when less than half a window is left, or after a seek. */
+static void
+gst_file_src_readahead (GstFileSrc * src, guint64 offset)
+{
+#ifdef HAVE_POSIX_FADVISE
+  guint64 start, end;
+
+  if (src->readahead == 0)
+    return;
+
+  end = offset + src->readahead;
+  if (offset <= src->readahead_end && src->readahead_end <= end) {
+    if (src->readahead_end - offset >= src->readahead / 2)
+      return;
+    start = src->readahead_end;
+  } else {
+    start = offset;
+  }
+
+  GST_LOG_OBJECT (src, "readahead %" G_GUINT64_FORMAT "-%" G_GUINT64_FORMAT,
+      start, end);
+  posix_fadvise (src->fd, start, end - start, POSIX_FADV_WILLNEED);
+  src->readahead_end = end;
+#endif
+}
+
+#ifdef USE_MMAP
+static GstFlowReturn
+gst_file_src_create_mapped (GstFileSrc * src, guint64 offset, guint length,
+    GstBuffer ** buffer)
+{
+  GstFileSrcMapping *mapping = src->mapping;
+  GstBuffer *buf;
+  gsize size;
+
+  size = MIN (length, mapping->size - offset);
+
+  GST_LOG_OBJECT (src, "Mapping %" G_GSIZE_FORMAT " bytes at offset 0x%"
+      G_GINT64_MODIFIER "x", size, offset);
+  gst_file_src_readahead (src, offset);
+
+  g_atomic_int_inc (&mapping->refcount);
+  buf = gst_buffer_new ();
+  gst_buffer_append_memory (buf,
+      gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY,
+          (guint8 *) mapping->data + offset, size, 0, size, mapping,
+          (GDestroyNotify) gst_file_src_mapping_unref));
+
+  GST_BUFFER_OFFSET (buf) = offset;
+  GST_BUFFER_OFFSET_END (buf) = offset + size;
+  *buffer = buf;
+
+  return GST_FLOW_OK;
+}
+#endif
+
+#ifdef USE_DIRECT
+static gboolean
+gst_file_src_ensure_direct_pool (GstFileSrc * src, guint size)
+{
+  GstAllocationParams params;
+
+  if (src->direct_pool != NULL && src->direct_pool_size >= size)
+    return TRUE;
+
+  if (src->direct_pool != NULL) {
+    gst_buffer_pool_set_active (src->direct_pool, FALSE);
+    gst_object_unref (src->direct_pool);
+    src->direct_pool = NULL;
+  }
+
+  /* buffers are trimmed to the requested range after reading */
+  gst_allocation_params_init (&params);
+  params.align = DIRECT_ALIGN - 1;
+  src->direct_pool = gst_elements_resize_pool_new (size, 2, &params);
+  if (src->direct_pool == NULL)
+    return FALSE;
+
+  src->direct_pool_size = size;
+
+  return TRUE;
+}
+
+/* O_DIRECT needs the file offset, the size and the memory to be aligned, so
+ * read the aligned range around the request and trim the buffer */
+static GstFlowReturn
+gst_file_src_create_direct (GstFileSrc * src, guint64 offset, guint length,
+    GstBuffer ** buffer)
+{
+  GstBuffer *buf = NULL;
+  GstMapInfo info;
+  GstFlowReturn ret;
+  guint64 start;
+  guint size, skip, bytes_read;
+  gssize res;
+
+  start = offset & ~((guint64) DIRECT_ALIGN - 1);
+  skip = offset - start;
+  /* read at least one block so that an empty request at the end of the
+   * file doesn't look like EOS */
+  size = GST_ROUND_UP_N (skip + MAX (length, 1), DIRECT_ALIGN);
+
+  if (!gst_file_src_ensure_direct_pool (src, size))
+    goto no_pool;
+
+  ret = gst_buffer_pool_acquire_buffer (src->direct_pool, &buf, NULL);
+  if (G_UNLIKELY (ret != GST_FLOW_OK))
+    return ret;
+
+  if (!gst_buffer_map (buf, &info, GST_MAP_WRITE))
+    goto buffer_write_fail;
+
+  bytes_read = 0;
+  while (bytes_read < size) {
+    GST_LOG_OBJECT (src, "Reading %u bytes at offset 0x%" G_GINT64_MODIFIER
+        "x with O_DIRECT", size - bytes_read, start + bytes_read);
+    res = pread (src->direct_fd, info.data + bytes_read, size - bytes_read,
+        start + bytes_read);
+    if (G_UNLIKELY (res < 0)) {
+      if (errno == EAGAIN || errno == EINTR)
+        continue;
+      goto could_not_read;
+    }
+
+    bytes_read += res;
+
+    /* a short read that ends unaligned is the end of the file */
+    if (res == 0 || (res % DIRECT_ALIGN) != 0)
+      break;
+  }
+  gst_buffer_unmap (buf, &info);
+
+  if (G_UNLIKELY (bytes_read <= skip))
+    goto eos;
+
+  gst_buffer_resize (buf, skip, MIN (bytes_read - skip, length));
+
+  GST_BUFFER_OFFSET (buf) = offset;
+  GST_BUFFER_OFFSET_END (buf) = offset + gst_buffer_get_size (buf);
+  *buffer = buf;
+
+  return GST_FLOW_OK;
+
+  /* ERROR */
+no_pool:
+  {
+    GST_ELEMENT_ERROR (src, RESOURCE, FAILED, (NULL),
+        ("Could not set up a pool of %u byte aligned buffers", size));
+    return GST_FLOW_ERROR;
+  }
+buffer_write_fail:
+  {
+    GST_ELEMENT_ERROR (src, RESOURCE, WRITE, (NULL), ("Can't write to buffer"));
+    gst_buffer_unref (buf);
+    return GST_FLOW_ERROR;
+  }
+could_not_read:
+  {
+    GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL), GST_ERROR_SYSTEM);
+    gst_buffer_unmap (buf, &info);
+    gst_buffer_unref (buf);
+    return GST_FLOW_ERROR;
+  }
+eos:
+  {
+    GST_DEBUG ("EOS");
+    gst_buffer_unref (buf);
+    return GST_FLOW_EOS;
+  }
+}
+#endif
+
+#ifdef USE_URING
+static void
+gst_file_src_uring_read_free (GstFileSrcUringRead * read)
+{
+  gst_buffer_unmap (read->buffer, &read->map);
+  gst_buffer_unref (read->buffer);
+  g_slice_free (GstFileSrcUringRead, read);
+}
+
+/* Wait until @read is done. Completions come in any order, the reads queued
+ * before @read may complete on the way. */
+static gboolean
+gst_file_src_uring_complete (GstFileSrc * src, GstFileSrcUringRead * read)
+{
+  while (!read->done) {
+    GstFileSrcUringRead *r;
+    gpointer data;
+    gint res;
+
+    if (!gst_io_uring_wait (src->ring, &data, &res))
+      return FALSE;
+
+    r = data;
+    r->res = res;
+    r->done = TRUE;
+  }
+
+  return TRUE;
+}
+
+/* Drop the reads in flight, their buffers can only be freed once the kernel
+ * is done with them */
+static void
+gst_file_src_uring_flush (GstFileSrc * src)
+{
+  GstFileSrcUringRead *read;
+
+  while ((read = gst_queue_array_pop_head (src->uring_reads))) {
+    if (gst_file_src_uring_complete (src, read)) {
+      gst_file_src_uring_read_free (read);
+    } else {
+      GST_WARNING_OBJECT (src, "could not complete read at offset %"
+          G_GUINT64_FORMAT ", leaking its buffer", read->offset);
+    }
+  }
+}
+
+static gboolean
+gst_file_src_uring_queue (GstFileSrc * src, guint64 offset, guint size)
+{
+  GstFileSrcUringRead *read;
+  gint index = -1;
+
+  read = g_slice_new0 (GstFileSrcUringRead);
+  read->offset = offset;
+  read->size = size;
+
+  /* registered buffers have the blocksize at start, larger requests are read
+   * into normal memory */
+  read->buffer = gst_io_uring_acquire_buffer (src->ring, &index);
+  if (read->buffer != NULL && gst_buffer_get_size (read->buffer) < size) {
+    gst_buffer_unref (read->buffer);
+    read->buffer = NULL;
+    index = -1;
+  }
+  if (read->buffer == NULL)
+    read->buffer = gst_buffer_new_allocate (NULL, size, NULL);
+
+  if (!gst_buffer_map (read->buffer, &read->map, GST_MAP_WRITE)) {
+    gst_buffer_unref (read->buffer);
+    g_slice_free (GstFileSrcUringRead, read);
+    return FALSE;
+  }
+  read->vec.iov_base = read->map.data;
+  read->vec.iov_len = size;
+
+  if (!gst_io_uring_readv (src->ring, src->fd, &read->vec, offset, index,
+          read)) {
+    gst_file_src_uring_read_free (read);
+    return FALSE;
+  }
+
+  GST_LOG_OBJECT (src, "Queued read of %u bytes at offset 0x%"
+      G_GINT64_MODIFIER "x%s", size, offset, index >= 0 ? " (fixed)" : "");
+  gst_queue_array_push_tail (src->uring_reads, read);
+
+  return TRUE;
+}
+
+/* Return the read at @offset and queue the ones after it, as long as
+ * downstream asks for consecutive blocks. Anything else, like a seek or a
+ * different size, drops the reads in flight. */
+static GstFlowReturn
+gst_file_src_create_uring (GstFileSrc * src, guint64 offset, guint length,
+    GstBuffer ** buffer)
+{
+  GstFileSrcUringRead *read;
+  GstBuffer *buf;
+  gboolean sequential;
+  guint64 next;
+  gint res;
+
+  read = gst_queue_array_peek_head (src->uring_reads);
+  if (read != NULL && (read->offset != offset || read->size != length)) {
+    GST_DEBUG_OBJECT (src, "read at offset %" G_GUINT64_FORMAT " was not "
+        "expected, dropping %u reads in flight", offset,
+        gst_queue_array_get_length (src->uring_reads));
+    gst_file_src_uring_flush (src);
+  }
+
+  sequential = (offset == src->uring_next);
+  src->uring_next = offset + length;
+
+  read = gst_queue_array_peek_tail (src->uring_reads);
+  next = read ? read->offset + read->size : offset;
+  while (gst_queue_array_is_empty (src->uring_reads) || (sequential &&
+          gst_queue_array_get_length (src->uring_reads) < src->io_depth &&
+          next < src->uring_size)) {
+    if (!gst_file_src_uring_queue (src, next, length))
+      break;
+    next += length;
+  }
+  if (gst_queue_array_is_empty (src->uring_reads))
+    goto queue_failed;
+
+  /* a failed submission is retried when waiting */
+  gst_io_uring_submit (src->ring);
+
+  read = gst_queue_array_pop_head (src->uring_reads);
+  if (!gst_file_src_uring_complete (src, read))
+    goto wait_failed;
+
+  res = read->res;
+  gst_buffer_unmap (read->buffer, &read->map);
+  buf = read->buffer;
+  g_slice_free (GstFileSrcUringRead, read);
+
+  if (G_UNLIKELY (res < 0))
+    goto could_not_read;
+  if (G_UNLIKELY (res == 0))
+    goto eos;
+
+  if (res != gst_buffer_get_size (buf))
+    gst_buffer_resize (buf, 0, res);
+
+  GST_BUFFER_OFFSET (buf) = offset;
+  GST_BUFFER_OFFSET_END (buf) = offset + res;
+  *buffer = buf;
+
+  return GST_FLOW_OK;
+
+  /* ERRORS */
+queue_failed:
+  {
+    GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL),
+        ("Could not queue a read of %u bytes", length));
+    return GST_FLOW_ERROR;
+  }
+wait_failed:
+  {
+    GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL), GST_ERROR_SYSTEM);
+    /* the kernel may still write into the buffer, leak it */
+    return GST_FLOW_ERROR;
+  }
+could_not_read:
+  {
+    errno = -res;
+    GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL), GST_ERROR_SYSTEM);
+    gst_buffer_unref (buf);
+    return GST_FLOW_ERROR;
+  }
+eos:
+  {
+    GST_DEBUG ("EOS");
+    gst_buffer_unref (buf);
+    return GST_FLOW_EOS;
+  }
+}
+#endif
+
+static GstFlowReturn
+gst_file_src_create (GstBaseSrc * basesrc, guint64 offset, guint length,
+    GstBuffer ** buffer)
+{
+  GstFileSrc *src = GST_FILE_SRC_CAST (basesrc);
+
+  /* downstream provided the memory to read into, use the fill path */
+  if (*buffer == NULL) {
+#ifdef USE_MMAP
+    /* data appended after the mapping was made is read normally */
+    if (src->mapping != NULL && offset < src->mapping->size)
+      return gst_file_src_create_mapped (src, offset, length, buffer);
+#endif
+#ifdef USE_DIRECT
+    if (src->direct_fd >= 0)
+      return gst_file_src_create_direct (src, offset, length, buffer);
+#endif
+#ifdef USE_URING
+    if (src->ring != NULL)
+      return gst_file_src_create_uring (src, offset, length, buffer);
+#endif
+  }
+
+  return GST_BASE_SRC_CLASS (parent_class)->create (basesrc, offset, length,
+      buffer);
+}
+
 static GstFlowReturn
 gst_file_src_fill (GstBaseSrc * basesrc, guint64 offset, guint length,
     GstBuffer * buf)
@@ -342,7 +919,9 @@ gst_file_src_fill (GstBaseSrc * basesrc, guint64 offset, guint length,
 
   src = GST_FILE_SRC_CAST (basesrc);
 
-  if (G_UNLIKELY (offset != -1 && src->read_position != offset)) {
+  /* with positional reads, the file offset is never moved */
+  if (G_UNLIKELY (!USE_PREAD (src) && offset != -1
+          && src->read_position != offset)) {
     off_t res;
 
     res = lseek (src->fd, offset, SEEK_SET);
@@ -352,6 +931,9 @@ gst_file_src_fill (GstBaseSrc * basesrc, guint64 offset, guint length,
     src->read_position = offset;
   }
 
+  if (src->seekable)
+    gst_file_src_readahead (src, offset);
+
   if (!gst_buffer_map (buf, &info, GST_MAP_WRITE))
     goto buffer_write_fail;
   data = info.data;
@@ -362,7 +944,12 @@ gst_file_src_fill (GstBaseSrc * basesrc, guint64 offset, guint length,
     GST_LOG_OBJECT (src, "Reading %d bytes at offset 0x%" G_GINT64_MODIFIER "x",
         to_read, offset + bytes_read);
     errno = 0;
-    ret = read (src->fd, data + bytes_read, to_read);
+#ifdef HAVE_PREAD
+    if (USE_PREAD (src))
+      ret = pread (src->fd, data + bytes_read, to_read, offset + bytes_read);
+    else
+#endif
+      ret = read (src->fd, data + bytes_read, to_read);
     if (G_UNLIKELY (ret < 0)) {
       if (errno == EAGAIN || errno == EINTR)
         continue;
@@ -455,6 +1042,67 @@ could_not_stat:
   }
 }
 
+/* Set up the mmap, direct or uring read mode. When the mode can't be used for this
+ * file, we log why and read normally. */
+static void
+gst_file_src_setup_read_mode (GstFileSrc * src, guint64 size)
+{
+  if (!src->seekable) {
+    GST_WARNING_OBJECT (src, "not a seekable regular file, ignoring read-mode");
+    return;
+  }
+
+  switch (src->read_mode) {
+    case GST_FILE_SRC_READ_MODE_MMAP:
+#ifdef USE_MMAP
+      if (size == 0 || size > G_MAXSIZE) {
+        GST_WARNING_OBJECT (src, "can't map a file of %" G_GUINT64_FORMAT
+            " bytes, reading instead", size);
+        break;
+      }
+      src->mapping = gst_file_src_mapping_new (src->fd, size);
+      if (src->mapping == NULL)
+        GST_WARNING_OBJECT (src, "could not map file, reading instead: %s",
+            g_strerror (errno));
+#else
+      GST_WARNING_OBJECT (src, "mmap is not supported, reading instead");
+#endif
+      break;
+    case GST_FILE_SRC_READ_MODE_DIRECT:
+#ifdef USE_DIRECT
+      src->direct_fd = gst_open (src->filename, O_RDONLY | O_BINARY | O_DIRECT,
+          0);
+      if (src->direct_fd < 0)
+        GST_WARNING_OBJECT (src, "could not open file with O_DIRECT, reading "
+            "instead: %s", g_strerror (errno));
+#else
+      GST_WARNING_OBJECT (src, "O_DIRECT is not supported, reading instead");
+#endif
+      break;
+    case GST_FILE_SRC_READ_MODE_URING:
+#ifdef USE_URING
+      src->ring = gst_io_uring_new (src->io_depth);
+      if (src->ring == NULL) {
+        GST_WARNING_OBJECT (src, "io_uring is not available, reading instead");
+        break;
+      }
+      /* downstream can hold on to a few blocks while the next ones are read */
+      if (!gst_io_uring_register_buffers (src->ring, 2 * src->io_depth,
+              GST_BASE_SRC (src)->blocksize))
+        GST_INFO_OBJECT (src, "could not register buffers, reading into "
+            "normal memory");
+      src->uring_reads = gst_queue_array_new (src->io_depth);
+      src->uring_size = size;
+      src->uring_next = -1;
+#else
+      GST_WARNING_OBJECT (src, "io_uring is not supported, reading instead");
+#endif
+      break;
+    default:
+      break;
+  }
+}
+
 /* open the file, necessary to go to READY state */
 static gboolean
 gst_file_src_start (GstBaseSrc * basesrc)
@@ -516,6 +1164,10 @@ gst_file_src_start (GstBaseSrc * basesrc)
 
   gst_base_src_set_dynamic_size (basesrc, src->seekable);
 
+  src->readahead_end = 0;
+  if (src->read_mode != GST_FILE_SRC_READ_MODE_READ)
+    gst_file_src_setup_read_mode (src, stat_results.st_size);
+
   return TRUE;
 
   /* ERROR */
@@ -577,6 +1229,34 @@ gst_file_src_stop (GstBaseSrc * basesrc)
 {
   GstFileSrc *src = GST_FILE_SRC (basesrc);
 
+#ifdef USE_MMAP
+  /* buffers still holding on to the pages keep the mapping alive */
+  if (src->mapping) {
+    gst_file_src_mapping_unref (src->mapping);
+    src->mapping = NULL;
+  }
+#endif
+#ifdef USE_DIRECT
+  if (src->direct_pool) {
+    gst_buffer_pool_set_active (src->direct_pool, FALSE);
+    gst_object_unref (src->direct_pool);
+    src->direct_pool = NULL;
+  }
+  if (src->direct_fd >= 0) {
+    close (src->direct_fd);
+    src->direct_fd = -1;
+  }
+#endif
+#ifdef USE_URING
+  if (src->ring) {
+    gst_file_src_uring_flush (src);
+    gst_queue_array_free (src->uring_reads);
+    src->uring_reads = NULL;
+    gst_io_uring_free (src->ring);
+    src->ring = NULL;
+  }
+#endif
+
   /* close the file */
   close (src->fd);
 
@@ -28,6 +28,9 @@
 
 #include <gst/gst.h>
 #include <gst/base/gstbasesrc.h>
+#include <gst/base/gstqueuearray.h>
+
+#include "gstiouring.h"
 
 G_BEGIN_DECLS
 
@@ -45,6 +48,28 @@ G_BEGIN_DECLS
 
 typedef struct _GstFileSrc GstFileSrc;
 typedef struct _GstFileSrcClass GstFileSrcClass;
+typedef struct _GstFileSrcMapping GstFileSrcMapping;
+
+/**
+ * GstFileSrcReadMode:
+ * @GST_FILE_SRC_READ_MODE_READ: Read into buffers allocated downstream.
+ * @GST_FILE_SRC_READ_MODE_MMAP: Map the file and wrap its pages in read-only
+ *   memory without copying.
+ * @GST_FILE_SRC_READ_MODE_DIRECT: Read with O_DIRECT into aligned buffers
+ *   from a pool, bypassing the page cache.
+ * @GST_FILE_SRC_READ_MODE_URING: Keep several reads after the current
+ *   position in flight with io_uring.
+ *
+ * How filesrc gets the data out of the file.
+ *
+ * Since: 1.16
+ */
+typedef enum {
+  GST_FILE_SRC_READ_MODE_READ,
+  GST_FILE_SRC_READ_MODE_MMAP,
+  GST_FILE_SRC_READ_MODE_DIRECT,
+  GST_FILE_SRC_READ_MODE_URING
+} GstFileSrcReadMode;
 
 /**
  * GstFileSrc:
@@ -63,6 +88,21 @@ struct _GstFileSrc {
   gboolean seekable;                    /* whether the file is seekable */
   gboolean is_regular;                  /* whether it's a (symlink to a)
                                            regular file */
+
+  GstFileSrcReadMode read_mode;         /* requested read mode */
+  guint64 readahead;                    /* readahead window in bytes */
+  guint64 readahead_end;                /* end of the last readahead hint */
+
+  GstFileSrcMapping *mapping;           /* file mapping in mmap mode */
+  gint direct_fd;                       /* O_DIRECT descriptor in direct mode */
+  GstBufferPool *direct_pool;           /* aligned buffers for direct mode */
+  guint direct_pool_size;               /* buffer size of direct_pool */
+
+  guint io_depth;                       /* reads in flight in uring mode */
+  GstIoUring *ring;                     /* io_uring in uring mode */
+  GstQueueArray *uring_reads;           /* reads in flight, in file order */
+  guint64 uring_size;                   /* file size when the ring was set up */
+  guint64 uring_next;                   /* offset after the last request */
 };
 
 struct _GstFileSrcClass {
@@ -71,6 +71,10 @@ struct _GstFunnelPad
   GstTagList *tags;             /* last tags received on the pad */
 
   gboolean seen_buffer;
+
+  /* the sticky_version of the funnel when the sticky events on the srcpad
+   * last matched the ones on this pad, 0 when unknown */
+  guint sticky_version;
 };
 
 struct _GstFunnelPadClass
@@ -115,6 +119,7 @@ gst_funnel_pad_init (GstFunnelPad * pad)
 {
   pad->got_eos = FALSE;
   pad->seen_buffer = FALSE;
+  pad->sticky_version = 0;
 }
 
 static void
@@ -268,6 +273,7 @@ gst_funnel_init (GstFunnel * funnel)
   gst_element_add_pad (GST_ELEMENT (funnel), funnel->srcpad);
 
   funnel->forward_sticky_events = DEFAULT_FORWARD_STICKY_EVENTS;
+  funnel->sticky_version = 1;
 }
 
 static GstPad *
@@ -355,17 +361,93 @@ gst_funnel_release_pad (GstElement * element, GstPad * pad)
       GST_WARNING_OBJECT (funnel, "Failure pushing EOS");
 }
 
+/* check if @event would not change anything when it replaces @current */
+static gboolean
+sticky_event_equal (GstEvent * current, GstEvent * event)
+{
+  if (current == event)
+    return TRUE;
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_CAPS:
+    {
+      GstCaps *caps1, *caps2;
+
+      gst_event_parse_caps (current, &caps1);
+      gst_event_parse_caps (event, &caps2);
+      return gst_caps_is_equal (caps1, caps2);
+    }
+    case GST_EVENT_SEGMENT:
+    {
+      const GstSegment *segment1, *segment2;
+
+      gst_event_parse_segment (current, &segment1);
+      gst_event_parse_segment (event, &segment2);
+      return gst_segment_is_equal (segment1, segment2);
+    }
+    case GST_EVENT_STREAM_START:
+      return gst_structure_is_equal (gst_event_get_structure (current),
+          gst_event_get_structure (event));
+    default:
+      return FALSE;
+  }
+}
+
+typedef struct
+{
+  GstFunnel *funnel;
+  gboolean ok;
+} ForwardEventsData;
+
 static gboolean
 forward_events (GstPad * pad, GstEvent ** event, gpointer user_data)
 {
-  GstPad *srcpad = user_data;
+  ForwardEventsData *data = user_data;
+  GstFunnel *funnel = data->funnel;
+  GstEventType type = GST_EVENT_TYPE (*event);
+  GstEvent *current;
+
+  if (type == GST_EVENT_EOS)
+    return TRUE;
+
+  /* inputs usually share caps and segment, don't send those again */
+  if (!(gst_event_type_get_flags (type) & GST_EVENT_TYPE_STICKY_MULTI)) {
+    current = gst_pad_get_sticky_event (funnel->srcpad, type, 0);
+    if (current) {
+      gboolean equal = sticky_event_equal (current, *event);
+
+      gst_event_unref (current);
+      if (equal)
+        return TRUE;
+    }
+  }
 
-  if (GST_EVENT_TYPE (*event) != GST_EVENT_EOS)
-    gst_pad_push_event (srcpad, gst_event_ref (*event));
+  if (!gst_pad_push_event (funnel->srcpad, gst_event_ref (*event)))
+    data->ok = FALSE;
+  funnel->sticky_version++;
 
   return TRUE;
 }
 
+/* must be called with the srcpad stream lock. Makes the sticky events on the
+ * srcpad match the ones on @fpad, which is free when nothing changed since
+ * the last time they matched. */
+static void
+gst_funnel_forward_sticky_events (GstFunnel * funnel, GstFunnelPad * fpad)
+{
+  ForwardEventsData data = { funnel, TRUE };
+
+  if (fpad->sticky_version == funnel->sticky_version) {
+    GST_LOG_OBJECT (fpad, "Sticky events already forwarded");
+    return;
+  }
+
+  GST_DEBUG_OBJECT (fpad, "Forwarding sticky events");
+  gst_pad_sticky_events_foreach (GST_PAD_CAST (fpad), forward_events, &data);
+
+  fpad->sticky_version = data.ok ? funnel->sticky_version : 0;
+}
+
 static GstFlowReturn
 gst_funnel_sink_chain_object (GstPad * pad, GstFunnel * funnel,
     gboolean is_list, GstMiniObject * obj)
@@ -383,9 +465,7 @@ gst_funnel_sink_chain_object (GstPad * pad, GstFunnel * funnel,
           && (funnel->last_sinkpad != pad))) {
     gst_object_replace ((GstObject **) & funnel->last_sinkpad,
         GST_OBJECT (pad));
-
-    GST_DEBUG_OBJECT (pad, "Forwarding sticky events");
-    gst_pad_sticky_events_foreach (pad, forward_events, funnel->srcpad);
+    gst_funnel_forward_sticky_events (funnel, fpad);
   }
 
   if (is_list)
@@ -476,10 +556,19 @@ gst_funnel_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
                 && (funnel->last_sinkpad != pad)))) {
       gst_object_replace ((GstObject **) & funnel->last_sinkpad,
           GST_OBJECT (pad));
-      gst_pad_sticky_events_foreach (pad, forward_events, funnel->srcpad);
+      gst_funnel_forward_sticky_events (funnel, fpad);
     }
   }
 
+  /* the sticky events on the pad change, and on the srcpad too when we
+   * forward. This is protected by the stream lock we took above. */
+  if (GST_EVENT_IS_STICKY (event)
+      || GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP) {
+    fpad->sticky_version = 0;
+    if (forward)
+      funnel->sticky_version++;
+  }
+
   if (GST_EVENT_TYPE (event) == GST_EVENT_TAG) {
     GstTagList *tags, *oldtags, *newtags;
 
@@ -521,6 +610,7 @@ reset_pad (const GValue * data, gpointer user_data)
 
   GST_OBJECT_LOCK (funnel);
   fpad->got_eos = FALSE;
+  fpad->sticky_version = 0;
   if (fpad->tags) {
     gst_tag_list_unref (fpad->tags);
     fpad->tags = NULL;
@@ -58,6 +58,9 @@ struct _GstFunnel {
 
   GstPad *last_sinkpad;
   gboolean forward_sticky_events;
+
+  /* changes every time the sticky events on srcpad change */
+  guint sticky_version;
 };
 
 struct _GstFunnelClass {
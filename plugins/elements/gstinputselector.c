@@ -1010,6 +1010,28 @@ gst_selector_pad_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
       "entering chain for buf %p with timestamp %" GST_TIME_FORMAT, buf,
       GST_TIME_ARGS (GST_BUFFER_PTS (buf)));
 
+  /* With many inputs most buffers arrive on pads that are not active. When
+   * they are simply dropped, do that without taking the selector lock. The
+   * active pad is only compared against, never dereferenced. */
+  if (!sel->sync_streams && !sel->flushing) {
+    GstPad *active = g_atomic_pointer_get (&sel->active_sinkpad);
+
+    if (active != NULL && active != pad) {
+      GST_OBJECT_LOCK (selpad);
+      if (selpad->always_ok) {
+        if (GST_BUFFER_PTS_IS_VALID (buf))
+          selpad->segment.position = GST_BUFFER_PTS (buf);
+        GST_OBJECT_UNLOCK (selpad);
+
+        GST_DEBUG_OBJECT (pad, "Pad not active, discard buffer %p", buf);
+        selpad->discont = TRUE;
+        gst_buffer_unref (buf);
+        return GST_FLOW_OK;
+      }
+      GST_OBJECT_UNLOCK (selpad);
+    }
+  }
+
   GST_INPUT_SELECTOR_LOCK (sel);
 
   if (sel->flushing) {
@@ -1355,7 +1377,7 @@ gst_input_selector_dispose (GObject * object)
 
   if (sel->active_sinkpad) {
     gst_object_unref (sel->active_sinkpad);
-    sel->active_sinkpad = NULL;
+    g_atomic_pointer_set (&sel->active_sinkpad, NULL);
   }
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
@@ -1808,7 +1830,8 @@ gst_input_selector_get_active_sinkpad (GstInputSelector * sel)
       /* If no pad is currently selected, we return the first usable pad to
        * guarantee consistency */
 
-      active_sinkpad = sel->active_sinkpad = g_value_dup_object (&item);
+      active_sinkpad = g_value_dup_object (&item);
+      g_atomic_pointer_set (&sel->active_sinkpad, active_sinkpad);
       g_value_reset (&item);
       GST_DEBUG_OBJECT (sel, "Activating pad %s:%s",
           GST_DEBUG_PAD_NAME (active_sinkpad));
@@ -1873,7 +1896,7 @@ gst_input_selector_release_pad (GstElement * element, GstPad * pad)
   if (sel->active_sinkpad == pad) {
     GST_DEBUG_OBJECT (sel, "Deactivating pad %s:%s", GST_DEBUG_PAD_NAME (pad));
     gst_object_unref (sel->active_sinkpad);
-    sel->active_sinkpad = NULL;
+    g_atomic_pointer_set (&sel->active_sinkpad, NULL);
   }
   sel->n_pads--;
   GST_INPUT_SELECTOR_UNLOCK (sel);
@@ -1891,7 +1914,7 @@ gst_input_selector_reset (GstInputSelector * sel)
   /* clear active pad */
   if (sel->active_sinkpad) {
     gst_object_unref (sel->active_sinkpad);
-    sel->active_sinkpad = NULL;
+    g_atomic_pointer_set (&sel->active_sinkpad, NULL);
   }
   sel->eos_sent = FALSE;
 
@@ -0,0 +1,704 @@
+/* GStreamer
+ * Copyright (C) 2018 GStreamer developers
+ *
+ * gstiouring.c: io_uring based I/O for the core file and fd elements
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* The elements use io_uring to keep several reads or writes in flight from
+ * their streaming thread. The ring is set up with the raw system calls, so
+ * there is no dependency on liburing. gst_io_uring_new() returns %NULL when
+ * the kernel, or a seccomp policy, doesn't allow io_uring, and the elements
+ * then do their I/O synchronously as before.
+ *
+ * A ring can register a set of buffers with the kernel. Reads into them use
+ * IORING_OP_READ_FIXED and skip pinning the pages for every request. Buffers
+ * that are still in use downstream keep the registered memory alive after
+ * the ring is freed. */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "gstiouring.h"
+
+#ifdef HAVE_LINUX_IO_URING_H
+#include <sys/syscall.h>
+#if defined (__NR_io_uring_setup) && defined (__NR_io_uring_enter) && \
+    defined (__NR_io_uring_register)
+#define USE_IO_URING 1
+#endif
+#endif
+
+#ifdef USE_IO_URING
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#include <gst/gstatomicqueue.h>
+
+GST_DEBUG_CATEGORY_STATIC (gst_io_uring_debug);
+#define GST_CAT_DEFAULT gst_io_uring_debug
+
+#ifndef UIO_MAXIOV
+#define UIO_MAXIOV 512
+#endif
+
+typedef struct _GstIoUringBuffers GstIoUringBuffers;
+typedef struct _GstIoUringSlot GstIoUringSlot;
+
+struct _GstIoUringSlot
+{
+  GstIoUringBuffers *buffers;
+  guint index;
+};
+
+/* The registered memory, split into equally sized slots. Every slot that is
+ * wrapped in a buffer holds a reference. */
+struct _GstIoUringBuffers
+{
+  gint refcount;
+  guint8 *data;
+  gsize mapped_size;
+  gsize size;
+  guint n_buffers;
+  GstIoUringSlot *slots;
+  GstAtomicQueue *free;         /* index + 1 of the unused slots */
+};
+
+struct _GstIoUring
+{
+  gint fd;
+
+  /* submission queue, shared with the kernel */
+  guint *sq_head;
+  guint *sq_tail;
+  guint *sq_array;
+  guint sq_mask;
+  guint sq_entries;
+  struct io_uring_sqe *sqes;
+  guint sqe_tail;               /* next entry to fill */
+  guint submitted;              /* entries handed to the kernel */
+
+  /* completion queue, shared with the kernel */
+  guint *cq_head;
+  guint *cq_tail;
+  guint cq_mask;
+  struct io_uring_cqe *cqes;
+
+  gpointer sq_ring;
+  gsize sq_ring_size;
+  gpointer cq_ring;
+  gsize cq_ring_size;
+  gsize sqes_size;
+
+  guint in_flight;              /* submitted and not completed */
+  gboolean cur_pos;             /* an offset of -1 is the file position */
+
+  GstIoUringBuffers *buffers;
+};
+
+/* A buffer or buffer list written with IORING_OP_WRITEV. The memory stays
+ * mapped and referenced until the write completes. */
+typedef struct
+{
+  GstMiniObject *obj;
+  gint fd;
+  guint64 offset;
+  gsize size;
+  guint n_maps;
+  GstMapInfo *maps;
+  struct iovec *vecs;
+} GstIoUringWrite;
+
+static void
+gst_io_uring_buffers_unref (GstIoUringBuffers * buffers)
+{
+  if (g_atomic_int_dec_and_test (&buffers->refcount)) {
+    munmap (buffers->data, buffers->mapped_size);
+    gst_atomic_queue_unref (buffers->free);
+    g_free (buffers->slots);
+    g_slice_free (GstIoUringBuffers, buffers);
+  }
+}
+
+static void
+gst_io_uring_slot_release (gpointer data)
+{
+  GstIoUringSlot *slot = data;
+
+  gst_atomic_queue_push (slot->buffers->free,
+      GUINT_TO_POINTER (slot->index + 1));
+  gst_io_uring_buffers_unref (slot->buffers);
+}
+
+static gpointer
+gst_io_uring_map (gint fd, gsize size, off_t offset)
+{
+  gpointer data;
+
+  data = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+      fd, offset);
+
+  return data == MAP_FAILED ? NULL : data;
+}
+
+GstIoUring *
+gst_io_uring_new (guint entries)
+{
+  static gsize debug_init = 0;
+  struct io_uring_params p;
+  GstIoUring *ring;
+  gint fd;
+
+  if (g_once_init_enter (&debug_init)) {
+    GST_DEBUG_CATEGORY_INIT (gst_io_uring_debug, "iouring", 0,
+        "io_uring I/O of the core elements");
+    g_once_init_leave (&debug_init, 1);
+  }
+
+  memset (&p, 0, sizeof (p));
+  fd = syscall (__NR_io_uring_setup, MAX (entries, 1), &p);
+  if (fd < 0) {
+    GST_INFO ("io_uring is not available: %s", g_strerror (errno));
+    return NULL;
+  }
+
+  ring = g_slice_new0 (GstIoUring);
+  ring->fd = fd;
+#ifdef IORING_FEAT_RW_CUR_POS
+  ring->cur_pos = (p.features & IORING_FEAT_RW_CUR_POS) != 0;
+#endif
+
+  ring->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof (guint);
+  ring->cq_ring_size = p.cq_off.cqes +
+      p.cq_entries * sizeof (struct io_uring_cqe);
+#ifdef IORING_FEAT_SINGLE_MMAP
+  /* both queues live in the same mapping */
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    ring->sq_ring_size = MAX (ring->sq_ring_size, ring->cq_ring_size);
+    ring->sq_ring = gst_io_uring_map (fd, ring->sq_ring_size,
+        IORING_OFF_SQ_RING);
+    ring->cq_ring = ring->sq_ring;
+    ring->cq_ring_size = 0;
+  } else
+#endif
+  {
+    ring->sq_ring = gst_io_uring_map (fd, ring->sq_ring_size,
+        IORING_OFF_SQ_RING);
+    ring->cq_ring = gst_io_uring_map (fd, ring->cq_ring_size,
+        IORING_OFF_CQ_RING);
+  }
+  ring->sqes_size = p.sq_entries * sizeof (struct io_uring_sqe);
+  ring->sqes = gst_io_uring_map (fd, ring->sqes_size, IORING_OFF_SQES);
+
+  if (ring->sq_ring == NULL || ring->cq_ring == NULL || ring->sqes == NULL)
+    goto map_failed;
+
+  ring->sq_head = (guint *) ((guint8 *) ring->sq_ring + p.sq_off.head);
+  ring->sq_tail = (guint *) ((guint8 *) ring->sq_ring + p.sq_off.tail);
+  ring->sq_array = (guint *) ((guint8 *) ring->sq_ring + p.sq_off.array);
+  ring->sq_mask = *(guint *) ((guint8 *) ring->sq_ring + p.sq_off.ring_mask);
+  ring->sq_entries = p.sq_entries;
+  ring->sqe_tail = ring->submitted = *ring->sq_tail;
+
+  ring->cq_head = (guint *) ((guint8 *) ring->cq_ring + p.cq_off.head);
+  ring->cq_tail = (guint *) ((guint8 *) ring->cq_ring + p.cq_off.tail);
+  ring->cq_mask = *(guint *) ((guint8 *) ring->cq_ring + p.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *) ((guint8 *) ring->cq_ring +
+      p.cq_off.cqes);
+
+  GST_DEBUG ("created ring %d with %u entries", fd, p.sq_entries);
+
+  return ring;
+
+  /* ERRORS */
+map_failed:
+  {
+    GST_WARNING ("could not map the io_uring queues: %s", g_strerror (errno));
+    gst_io_uring_free (ring);
+    return NULL;
+  }
+}
+
+void
+gst_io_uring_free (GstIoUring * ring)
+{
+  if (ring->sqes)
+    munmap (ring->sqes, ring->sqes_size);
+  if (ring->cq_ring && ring->cq_ring_size > 0)
+    munmap (ring->cq_ring, ring->cq_ring_size);
+  if (ring->sq_ring)
+    munmap (ring->sq_ring, ring->sq_ring_size);
+  /* also unregisters the buffers, reads that are still running complete */
+  close (ring->fd);
+
+  if (ring->buffers)
+    gst_io_uring_buffers_unref (ring->buffers);
+
+  g_slice_free (GstIoUring, ring);
+}
+
+guint
+gst_io_uring_get_in_flight (GstIoUring * ring)
+{
+  return ring->in_flight + (ring->sqe_tail - ring->submitted);
+}
+
+/* Register @n_buffers buffers of @size bytes with the kernel. They are handed
+ * out by gst_io_uring_acquire_buffer(). */
+gboolean
+gst_io_uring_register_buffers (GstIoUring * ring, guint n_buffers, gsize size)
+{
+  GstIoUringBuffers *buffers;
+  struct iovec *vecs;
+  gpointer data;
+  gsize mapped_size;
+  guint i;
+  gint ret;
+
+  g_return_val_if_fail (ring->buffers == NULL, FALSE);
+
+  mapped_size = n_buffers * size;
+  data = mmap (NULL, mapped_size, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (data == MAP_FAILED)
+    return FALSE;
+
+  vecs = g_newa (struct iovec, n_buffers);
+  for (i = 0; i < n_buffers; i++) {
+    vecs[i].iov_base = (guint8 *) data + i * size;
+    vecs[i].iov_len = size;
+  }
+
+  ret = syscall (__NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS,
+      vecs, n_buffers);
+  if (ret < 0) {
+    /* usually RLIMIT_MEMLOCK */
+    GST_INFO ("could not register %u buffers of %" G_GSIZE_FORMAT " bytes: %s",
+        n_buffers, size, g_strerror (errno));
+    munmap (data, mapped_size);
+    return FALSE;
+  }
+
+  buffers = g_slice_new (GstIoUringBuffers);
+  buffers->refcount = 1;
+  buffers->data = data;
+  buffers->mapped_size = mapped_size;
+  buffers->size = size;
+  buffers->n_buffers = n_buffers;
+  buffers->slots = g_new (GstIoUringSlot, n_buffers);
+  buffers->free = gst_atomic_queue_new (n_buffers);
+  for (i = 0; i < n_buffers; i++) {
+    buffers->slots[i].buffers = buffers;
+    buffers->slots[i].index = i;
+    gst_atomic_queue_push (buffers->free, GUINT_TO_POINTER (i + 1));
+  }
+  ring->buffers = buffers;
+
+  return TRUE;
+}
+
+/* Returns a buffer in registered memory and its @index, or %NULL when all of
+ * them are in use */
+GstBuffer *
+gst_io_uring_acquire_buffer (GstIoUring * ring, gint * index)
+{
+  GstIoUringBuffers *buffers = ring->buffers;
+  GstBuffer *buf;
+  guint i;
+
+  if (buffers == NULL)
+    return NULL;
+
+  i = GPOINTER_TO_UINT (gst_atomic_queue_pop (buffers->free));
+  if (i == 0)
+    return NULL;
+  i--;
+
+  g_atomic_int_inc (&buffers->refcount);
+  buf = gst_buffer_new ();
+  gst_buffer_append_memory (buf, gst_memory_new_wrapped (0,
+          buffers->data + i * buffers->size, buffers->size, 0, buffers->size,
+          &buffers->slots[i], gst_io_uring_slot_release));
+  *index = i;
+
+  return buf;
+}
+
+static struct io_uring_sqe *
+gst_io_uring_get_sqe (GstIoUring * ring)
+{
+  struct io_uring_sqe *sqe;
+  guint head, idx;
+
+  head = g_atomic_int_get ((gint *) ring->sq_head);
+  if (ring->sqe_tail - head >= ring->sq_entries)
+    return NULL;
+
+  idx = ring->sqe_tail & ring->sq_mask;
+  sqe = &ring->sqes[idx];
+  memset (sqe, 0, sizeof (*sqe));
+  ring->sq_array[idx] = idx;
+  ring->sqe_tail++;
+
+  return sqe;
+}
+
+/* Hand the prepared entries to the kernel and, with @min_complete, wait for
+ * that many completions */
+static gboolean
+gst_io_uring_enter (GstIoUring * ring, guint min_complete)
+{
+  guint to_submit, flags;
+  gint ret;
+
+  to_submit = ring->sqe_tail - ring->submitted;
+  if (to_submit == 0 && min_complete == 0)
+    return TRUE;
+
+  g_atomic_int_set ((gint *) ring->sq_tail, ring->sqe_tail);
+  flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+
+  do {
+    ret = syscall (__NR_io_uring_enter, ring->fd, to_submit, min_complete,
+        flags, NULL, 0);
+  } while (ret < 0 && errno == EINTR);
+
+  if (ret < 0) {
+    GST_WARNING ("io_uring_enter failed: %s", g_strerror (errno));
+    return FALSE;
+  }
+
+  ring->submitted += ret;
+  ring->in_flight += ret;
+
+  return TRUE;
+}
+
+/* Queue a read of @vec at @offset. With @index >= 0, @vec must point into
+ * the registered buffer @index. Otherwise @vec must stay valid until the
+ * read completes. */
+gboolean
+gst_io_uring_readv (GstIoUring * ring, gint fd, struct iovec * vec,
+    guint64 offset, gint index, gpointer user_data)
+{
+  struct io_uring_sqe *sqe;
+
+  sqe = gst_io_uring_get_sqe (ring);
+  if (sqe == NULL)
+    return FALSE;
+
+  if (index >= 0) {
+    sqe->opcode = IORING_OP_READ_FIXED;
+    sqe->addr = (guintptr) vec->iov_base;
+    sqe->len = vec->iov_len;
+    sqe->buf_index = index;
+  } else {
+    sqe->opcode = IORING_OP_READV;
+    sqe->addr = (guintptr) vec;
+    sqe->len = 1;
+  }
+  sqe->fd = fd;
+  sqe->off = offset;
+  sqe->user_data = (guintptr) user_data;
+
+  return TRUE;
+}
+
+gboolean
+gst_io_uring_submit (GstIoUring * ring)
+{
+  return gst_io_uring_enter (ring, 0);
+}
+
+/* Wait for the next completion. Returns %FALSE when nothing is in flight or
+ * waiting failed. @res is the result of the system call, or -errno. */
+gboolean
+gst_io_uring_wait (GstIoUring * ring, gpointer * user_data, gint * res)
+{
+  while (TRUE) {
+    struct io_uring_cqe *cqe;
+    guint head, tail;
+
+    head = *ring->cq_head;
+    tail = g_atomic_int_get ((gint *) ring->cq_tail);
+    if (head != tail) {
+      cqe = &ring->cqes[head & ring->cq_mask];
+      *user_data = (gpointer) (guintptr) cqe->user_data;
+      *res = cqe->res;
+      g_atomic_int_set ((gint *) ring->cq_head, head + 1);
+      ring->in_flight--;
+      return TRUE;
+    }
+
+    if (gst_io_uring_get_in_flight (ring) == 0)
+      return FALSE;
+
+    if (!gst_io_uring_enter (ring, 1))
+      return FALSE;
+  }
+}
+
+static void
+gst_io_uring_write_free (GstIoUringWrite * w)
+{
+  guint i;
+
+  for (i = 0; i < w->n_maps; i++)
+    gst_memory_unmap (w->maps[i].memory, &w->maps[i]);
+  gst_mini_object_unref (w->obj);
+  g_free (w->maps);
+  g_free (w->vecs);
+  g_slice_free (GstIoUringWrite, w);
+}
+
+/* Queue a write of the buffer or buffer list @obj at @offset, or at the
+ * current position for G_MAXUINT64 where the kernel supports that (Linux 5.6),
+ * and submit it. Returns %FALSE when @obj can't be written this way, the
+ * caller then writes it synchronously after completing the writes in
+ * flight. */
+gboolean
+gst_io_uring_write (GstIoUring * ring, gint fd, GstMiniObject * obj,
+    guint64 offset)
+{
+  struct io_uring_sqe *sqe;
+  GstIoUringWrite *w;
+  GstBuffer **buffers;
+  guint i, j, num_buffers, n_mems = 0;
+
+  /* older kernels fail the write, or take -1 as a position */
+  if (offset == G_MAXUINT64 && !ring->cur_pos)
+    return FALSE;
+
+  if (GST_IS_BUFFER (obj)) {
+    buffers = (GstBuffer **) & obj;
+    num_buffers = 1;
+  } else {
+    num_buffers = gst_buffer_list_length (GST_BUFFER_LIST_CAST (obj));
+    buffers = g_newa (GstBuffer *, num_buffers);
+    for (i = 0; i < num_buffers; i++)
+      buffers[i] = gst_buffer_list_get (GST_BUFFER_LIST_CAST (obj), i);
+  }
+
+  for (i = 0; i < num_buffers; i++)
+    n_mems += gst_buffer_n_memory (buffers[i]);
+  if (n_mems == 0 || n_mems > UIO_MAXIOV)
+    return FALSE;
+
+  sqe = gst_io_uring_get_sqe (ring);
+  if (sqe == NULL)
+    return FALSE;
+
+  w = g_slice_new0 (GstIoUringWrite);
+  w->obj = gst_mini_object_ref (obj);
+  w->fd = fd;
+  w->offset = offset;
+  w->maps = g_new (GstMapInfo, n_mems);
+  w->vecs = g_new (struct iovec, n_mems);
+
+  for (i = 0; i < num_buffers; i++) {
+    for (j = 0; j < gst_buffer_n_memory (buffers[i]); j++) {
+      GstMemory *mem = gst_buffer_peek_memory (buffers[i], j);
+
+      if (!gst_memory_map (mem, &w->maps[w->n_maps], GST_MAP_READ))
+        goto map_failed;
+      w->vecs[w->n_maps].iov_base = w->maps[w->n_maps].data;
+      w->vecs[w->n_maps].iov_len = w->maps[w->n_maps].size;
+      w->size += w->maps[w->n_maps].size;
+      w->n_maps++;
+    }
+  }
+
+  sqe->opcode = IORING_OP_WRITEV;
+  sqe->fd = fd;
+  sqe->addr = (guintptr) w->vecs;
+  sqe->len = w->n_maps;
+  /* an offset of -1 writes at the file position, the offset is ignored for
+   * pipes and files opened for appending */
+  sqe->off = offset;
+  sqe->user_data = (guintptr) w;
+
+  /* a failed submission is retried with the next one */
+  gst_io_uring_submit (ring);
+
+  return TRUE;
+
+  /* ERRORS */
+map_failed:
+  {
+    /* give the entry back, it was not submitted yet */
+    ring->sqe_tail--;
+    gst_io_uring_write_free (w);
+    return FALSE;
+  }
+}
+
+/* Write what the kernel left over after a short write of @done bytes */
+static gboolean
+gst_io_uring_write_rest (GstIoUringWrite * w, gsize done)
+{
+  guint64 pos = 0;
+  guint i;
+
+  for (i = 0; i < w->n_maps; i++) {
+    const guint8 *data = w->vecs[i].iov_base;
+    gsize len = w->vecs[i].iov_len;
+
+    if (done >= len) {
+      done -= len;
+      pos += len;
+      continue;
+    }
+    data += done;
+    len -= done;
+    pos += done;
+    done = 0;
+
+    while (len > 0) {
+      gssize ret;
+
+      if (w->offset == G_MAXUINT64)
+        ret = write (w->fd, data, len);
+      else
+        ret = pwrite (w->fd, data, len, w->offset + pos);
+      if (ret < 0) {
+        if (errno == EINTR || errno == EAGAIN)
+          continue;
+        return FALSE;
+      }
+      data += ret;
+      len -= ret;
+      pos += ret;
+    }
+  }
+
+  return TRUE;
+}
+
+/* Complete writes until at most @max_in_flight are left. Returns %FALSE with
+ * errno set when a write failed. */
+gboolean
+gst_io_uring_complete_writes (GstIoUring * ring, guint max_in_flight)
+{
+  gboolean ret = TRUE;
+  gint error = 0;
+
+  while (gst_io_uring_get_in_flight (ring) > max_in_flight) {
+    GstIoUringWrite *w;
+    gpointer data;
+    gint res;
+
+    if (!gst_io_uring_wait (ring, &data, &res)) {
+      error = errno;
+      ret = FALSE;
+      break;
+    }
+
+    w = data;
+    /* nothing could be written without blocking */
+    if (res == -EAGAIN)
+      res = 0;
+
+    if (res < 0) {
+      if (ret)
+        error = -res;
+      ret = FALSE;
+    } else if (res < w->size && ret) {
+      GST_DEBUG ("short write of %d/%" G_GSIZE_FORMAT " bytes", res, w->size);
+      if (!gst_io_uring_write_rest (w, res)) {
+        error = errno;
+        ret = FALSE;
+      }
+    }
+    gst_io_uring_write_free (w);
+  }
+
+  if (!ret)
+    errno = error;
+
+  return ret;
+}
+
+#else /* !USE_IO_URING */
+
+GstIoUring *
+gst_io_uring_new (guint entries)
+{
+  return NULL;
+}
+
+void
+gst_io_uring_free (GstIoUring * ring)
+{
+}
+
+guint
+gst_io_uring_get_in_flight (GstIoUring * ring)
+{
+  return 0;
+}
+
+gboolean
+gst_io_uring_register_buffers (GstIoUring * ring, guint n_buffers, gsize size)
+{
+  return FALSE;
+}
+
+GstBuffer *
+gst_io_uring_acquire_buffer (GstIoUring * ring, gint * index)
+{
+  return NULL;
+}
+
+gboolean
+gst_io_uring_readv (GstIoUring * ring, gint fd, struct iovec * vec,
+    guint64 offset, gint index, gpointer user_data)
+{
+  return FALSE;
+}
+
+gboolean
+gst_io_uring_submit (GstIoUring * ring)
+{
+  return FALSE;
+}
+
+gboolean
+gst_io_uring_wait (GstIoUring * ring, gpointer * user_data, gint * res)
+{
+  return FALSE;
+}
+
+gboolean
+gst_io_uring_write (GstIoUring * ring, gint fd, GstMiniObject * obj,
+    guint64 offset)
+{
+  return FALSE;
+}
+
+gboolean
+gst_io_uring_complete_writes (GstIoUring * ring, guint max_in_flight)
+{
+  return TRUE;
+}
+
+#endif /* USE_IO_URING */
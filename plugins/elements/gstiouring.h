@@ -0,0 +1,80 @@
+/* GStreamer
+ * Copyright (C) 2018 GStreamer developers
+ *
+ * gstiouring.h: io_uring based I/O for the core file and fd elements
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_IO_URING_H__
+#define __GST_IO_URING_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+struct iovec;
+
+/* A submission and completion queue pair. A ring is not thread-safe, it is
+ * used from the streaming thread of a single element. */
+typedef struct _GstIoUring GstIoUring;
+
+G_GNUC_INTERNAL
+GstIoUring *  gst_io_uring_new                (guint entries);
+
+G_GNUC_INTERNAL
+void          gst_io_uring_free               (GstIoUring * ring);
+
+G_GNUC_INTERNAL
+guint         gst_io_uring_get_in_flight      (GstIoUring * ring);
+
+/* reads */
+
+G_GNUC_INTERNAL
+gboolean      gst_io_uring_register_buffers   (GstIoUring * ring,
+                                               guint n_buffers, gsize size);
+
+G_GNUC_INTERNAL
+GstBuffer *   gst_io_uring_acquire_buffer     (GstIoUring * ring, gint * index);
+
+G_GNUC_INTERNAL
+gboolean      gst_io_uring_readv              (GstIoUring * ring, gint fd,
+                                               struct iovec * vec,
+                                               guint64 offset, gint index,
+                                               gpointer user_data);
+
+G_GNUC_INTERNAL
+gboolean      gst_io_uring_submit             (GstIoUring * ring);
+
+G_GNUC_INTERNAL
+gboolean      gst_io_uring_wait               (GstIoUring * ring,
+                                               gpointer * user_data,
+                                               gint * res);
+
+/* writes */
+
+G_GNUC_INTERNAL
+gboolean      gst_io_uring_write              (GstIoUring * ring, gint fd,
+                                               GstMiniObject * obj,
+                                               guint64 offset);
+
+G_GNUC_INTERNAL
+gboolean      gst_io_uring_complete_writes    (GstIoUring * ring,
+                                               guint max_in_flight);
+
+G_END_DECLS
+
+#endif /* __GST_IO_URING_H__ */
@@ -108,6 +108,32 @@
  * a single queue.
  */
 typedef struct _GstSingleQueue GstSingleQueue;
+typedef struct _GstMultiQueueGroup GstMultiQueueGroup;
+
+/* The heaps a singlequeue can be in. The first ones are global and live in
+ * GstMultiQueue::heaps, the next two are per group and the last one is
+ * GstMultiQueue::ready. */
+enum
+{
+  HEAP_WAITING_ID,              /* not-linked and waiting, min. nextid */
+  HEAP_LINKED_ID,               /* linked and not EOS, max. oldid */
+  HEAP_WAITING_TIME,            /* not-linked and waiting, min. next_time */
+  HEAP_LINKED_TIME,             /* linked and not EOS, max. last_time */
+  HEAP_GROUP_WAITING_TIME,
+  HEAP_GROUP_LINKED_TIME,
+  HEAP_READY,                   /* has work for a worker, min. last_time */
+  N_HEAPS
+};
+
+#define HEAP_INDEX_NONE G_MAXUINT
+
+struct _GstMultiQueueGroup
+{
+  guint id;
+  guint n_queues;
+  GstClockTimeDiff high_time;
+  GPtrArray *heaps[2];          /* HEAP_GROUP_WAITING_TIME, HEAP_GROUP_LINKED_TIME */
+};
 
 struct _GstSingleQueue
 {
@@ -115,7 +141,7 @@ struct _GstSingleQueue
   guint id;
   /* group of streams to which this queue belongs to */
   guint groupid;
-  GstClockTimeDiff group_high_time;
+  GstMultiQueueGroup *group;
 
   GstMultiQueue *mqueue;
 
@@ -174,8 +200,22 @@ struct _GstSingleQueue
   GstClockTime interleave;      /* Calculated interleve within the thread */
 
   gint buffering_level;
+  gboolean above_high;          /* counted in n_high_buffering */
 
   GstStreamType stream_type;
+
+  /* Protected by global lock, position and key in each of the heaps */
+  guint heap_index[N_HEAPS];
+  gint64 heap_key[N_HEAPS];
+
+  /* Protected by global lock, only used with worker threads */
+  gboolean scheduled;           /* may be picked up by a worker */
+  gboolean busy;                /* a worker is running the loop for it */
+  GThread *busy_thread;
+  GstMiniObject *parked_object; /* object waiting for a not-linked wakeup */
+  guint32 parked_id;
+  gboolean woken;               /* parked object may be retried */
+  gboolean dropping;            /* EOS drop state between two loop runs */
 };
 
 
@@ -200,7 +240,19 @@ static void gst_single_queue_free (GstSingleQueue * squeue);
 
 static void wake_up_next_non_linked (GstMultiQueue * mq);
 static void compute_high_id (GstMultiQueue * mq);
-static void compute_high_time (GstMultiQueue * mq, guint groupid);
+static void compute_high_time (GstMultiQueue * mq, GstSingleQueue * sq);
+static void gst_single_queue_update_order (GstMultiQueue * mq,
+    GstSingleQueue * sq);
+static void gst_single_queue_remove_order (GstMultiQueue * mq,
+    GstSingleQueue * sq);
+static void gst_multi_queue_group_free (GstMultiQueueGroup * group);
+static void gst_single_queue_set_ready (GstMultiQueue * mq,
+    GstSingleQueue * sq);
+static void gst_single_queue_wake_up (GstMultiQueue * mq, GstSingleQueue * sq);
+static void gst_single_queue_unschedule (GstMultiQueue * mq,
+    GstSingleQueue * sq);
+static void gst_multi_queue_start_workers (GstMultiQueue * mq);
+static void gst_multi_queue_stop_workers (GstMultiQueue * mq);
 static void single_queue_overrun_cb (GstDataQueue * dq, GstSingleQueue * sq);
 static void single_queue_underrun_cb (GstDataQueue * dq, GstSingleQueue * sq);
 
@@ -276,6 +328,11 @@ enum
 
 #define DEFAULT_INTERLEAVE_BY_SERIALIZED_EVENT FALSE
 
+#define DEFAULT_BATCH_PUSH FALSE
+#define DEFAULT_BATCH_PUSH_MAX_BYTES 0
+#define DEFAULT_BATCH_PUSH_MAX_TIME 0
+#define DEFAULT_WORKER_THREADS 0
+
 enum
 {
   PROP_0,
@@ -302,6 +359,10 @@ enum
   PROP_CUR_LEVEL_TIME_VIDEO,
   PROP_EOS,
   PROP_INTERLEAVE_BY_SERIALIZED_EVENT,
+  PROP_BATCH_PUSH,
+  PROP_BATCH_PUSH_MAX_BYTES,
+  PROP_BATCH_PUSH_MAX_TIME,
+  PROP_WORKER_THREADS,
   PROP_LAST
 };
 
@@ -725,6 +786,72 @@ gst_multi_queue_class_init (GstMultiQueueClass * klass)
           DEFAULT_INTERLEAVE_BY_SERIALIZED_EVENT,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstMultiQueue:batch-push
+   *
+   * Push the buffers that directly follow each other in a singlequeue
+   * downstream as one #GstBufferList. Events and queries end a batch, and on
+   * not-linked pads also data that arrived on other pads in between.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_BATCH_PUSH,
+      g_param_spec_boolean ("batch-push", "Batch push",
+          "Push consecutive queued buffers downstream as buffer lists",
+          DEFAULT_BATCH_PUSH, G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+          G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMultiQueue:batch-push-max-bytes
+   *
+   * Maximum number of bytes in a buffer list pushed in batch-push mode,
+   * 0 for no limit.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_BATCH_PUSH_MAX_BYTES,
+      g_param_spec_uint ("batch-push-max-bytes", "Batch push max. bytes",
+          "Max. amount of data in a pushed buffer list (bytes, 0=disable)",
+          0, G_MAXUINT, DEFAULT_BATCH_PUSH_MAX_BYTES,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+          G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMultiQueue:batch-push-max-time
+   *
+   * Maximum timestamp difference between the first and the last buffer of a
+   * buffer list pushed in batch-push mode, 0 for no limit.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_BATCH_PUSH_MAX_TIME,
+      g_param_spec_uint64 ("batch-push-max-time", "Batch push max. time (ns)",
+          "Max. duration of a pushed buffer list (in ns, 0=disable)",
+          0, G_MAXUINT64, DEFAULT_BATCH_PUSH_MAX_TIME,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+          G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMultiQueue:worker-threads
+   *
+   * Number of threads shared by all source pads. When 0, every source pad
+   * gets its own streaming thread. Otherwise the source pads are serviced by
+   * this many worker threads, which always pick the queue that has data and
+   * the lowest running time. This saves threads with many streams, but a
+   * worker is occupied for as long as downstream blocks, so there should be
+   * at least as many workers as streams that can block downstream at the
+   * same time, such as prerolling sinks.
+   *
+   * Can only be changed in the NULL state.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_WORKER_THREADS,
+      g_param_spec_uint ("worker-threads", "Worker threads",
+          "Number of threads shared by the source pads (0 = one per pad)",
+          0, G_MAXUINT, DEFAULT_WORKER_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gobject_class->finalize = gst_multi_queue_finalize;
 
   gst_element_class_set_static_metadata (gstelement_class,
@@ -776,6 +903,22 @@ gst_multi_queue_init (GstMultiQueue * mqueue)
   mqueue->interleave_by_serialized_event =
       DEFAULT_INTERLEAVE_BY_SERIALIZED_EVENT;
 
+  mqueue->heaps[HEAP_WAITING_ID] = g_ptr_array_new ();
+  mqueue->heaps[HEAP_LINKED_ID] = g_ptr_array_new ();
+  mqueue->heaps[HEAP_WAITING_TIME] = g_ptr_array_new ();
+  mqueue->heaps[HEAP_LINKED_TIME] = g_ptr_array_new ();
+  mqueue->groups = g_hash_table_new_full (NULL, NULL, NULL,
+      (GDestroyNotify) gst_multi_queue_group_free);
+
+  mqueue->batch_push = DEFAULT_BATCH_PUSH;
+  mqueue->batch_push_max_bytes = DEFAULT_BATCH_PUSH_MAX_BYTES;
+  mqueue->batch_push_max_time = DEFAULT_BATCH_PUSH_MAX_TIME;
+
+  mqueue->worker_threads = DEFAULT_WORKER_THREADS;
+  mqueue->ready = g_ptr_array_new ();
+  g_cond_init (&mqueue->worker_cond);
+  g_cond_init (&mqueue->worker_done_cond);
+
   mqueue->counter = 1;
   mqueue->highid = -1;
   mqueue->high_time = GST_CLOCK_STIME_NONE;
@@ -797,7 +940,16 @@ gst_multi_queue_finalize (GObject * object)
   mqueue->queues = NULL;
   mqueue->queues_cookie++;
 
+  g_ptr_array_unref (mqueue->heaps[HEAP_WAITING_ID]);
+  g_ptr_array_unref (mqueue->heaps[HEAP_LINKED_ID]);
+  g_ptr_array_unref (mqueue->heaps[HEAP_WAITING_TIME]);
+  g_ptr_array_unref (mqueue->heaps[HEAP_LINKED_TIME]);
+  g_hash_table_unref (mqueue->groups);
+  g_ptr_array_unref (mqueue->ready);
+
   /* free/unref instance data */
+  g_cond_clear (&mqueue->worker_cond);
+  g_cond_clear (&mqueue->worker_done_cond);
   g_mutex_clear (&mqueue->qlock);
   g_mutex_clear (&mqueue->buffering_post_lock);
 
@@ -974,6 +1126,31 @@ gst_multi_queue_set_property (GObject * object, guint prop_id,
       GST_INFO_OBJECT (mq, "Set interleave-by-serialized-event %d",
           mq->interleave_by_serialized_event);
       break;
+    case PROP_BATCH_PUSH:
+      GST_MULTI_QUEUE_MUTEX_LOCK (mq);
+      mq->batch_push = g_value_get_boolean (value);
+      GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
+      break;
+    case PROP_BATCH_PUSH_MAX_BYTES:
+      GST_MULTI_QUEUE_MUTEX_LOCK (mq);
+      mq->batch_push_max_bytes = g_value_get_uint (value);
+      GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
+      break;
+    case PROP_BATCH_PUSH_MAX_TIME:
+      GST_MULTI_QUEUE_MUTEX_LOCK (mq);
+      mq->batch_push_max_time = g_value_get_uint64 (value);
+      GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
+      break;
+    case PROP_WORKER_THREADS:
+      GST_OBJECT_LOCK (mq);
+      if (GST_STATE (mq) == GST_STATE_NULL) {
+        mq->worker_threads = g_value_get_uint (value);
+      } else {
+        GST_WARNING_OBJECT (mq, "worker-threads can only be changed in the "
+            "NULL state");
+      }
+      GST_OBJECT_UNLOCK (mq);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1075,6 +1252,18 @@ gst_multi_queue_get_property (GObject * object, guint prop_id,
     case PROP_INTERLEAVE_BY_SERIALIZED_EVENT:
       g_value_set_boolean (value, mq->interleave_by_serialized_event);
       break;
+    case PROP_BATCH_PUSH:
+      g_value_set_boolean (value, mq->batch_push);
+      break;
+    case PROP_BATCH_PUSH_MAX_BYTES:
+      g_value_set_uint (value, mq->batch_push_max_bytes);
+      break;
+    case PROP_BATCH_PUSH_MAX_TIME:
+      g_value_set_uint64 (value, mq->batch_push_max_time);
+      break;
+    case PROP_WORKER_THREADS:
+      g_value_set_uint (value, mq->worker_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1185,6 +1374,12 @@ gst_multi_queue_release_pad (GstElement * element, GstPad * pad)
 
   gst_pad_set_active (sq->srcpad, FALSE);
   gst_pad_set_active (sq->sinkpad, FALSE);
+
+  /* the streaming threads are stopped now, nothing will put it back */
+  GST_MULTI_QUEUE_MUTEX_LOCK (mqueue);
+  gst_single_queue_remove_order (mqueue, sq);
+  GST_MULTI_QUEUE_MUTEX_UNLOCK (mqueue);
+
   gst_pad_set_element_private (sq->srcpad, NULL);
   gst_pad_set_element_private (sq->sinkpad, NULL);
   gst_element_remove_pad (element, sq->srcpad);
@@ -1216,6 +1411,8 @@ gst_multi_queue_change_state (GstElement * element, GstStateChange transition)
       GST_MULTI_QUEUE_MUTEX_UNLOCK (mqueue);
       gst_multi_queue_post_buffering (mqueue);
 
+      /* before the pads get activated and scheduled */
+      gst_multi_queue_start_workers (mqueue);
       break;
     }
     case GST_STATE_CHANGE_PAUSED_TO_READY:{
@@ -1226,7 +1423,7 @@ gst_multi_queue_change_state (GstElement * element, GstStateChange transition)
       for (tmp = mqueue->queues; tmp; tmp = g_list_next (tmp)) {
         sq = (GstSingleQueue *) tmp->data;
         sq->flushing = TRUE;
-        g_cond_signal (&sq->turn);
+        gst_single_queue_wake_up (mqueue, sq);
 
         sq->last_query = FALSE;
         g_cond_signal (&sq->query_handled);
@@ -1243,6 +1440,10 @@ gst_multi_queue_change_state (GstElement * element, GstStateChange transition)
   result = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
 
   switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      /* all pads are stopped now */
+      gst_multi_queue_stop_workers (mqueue);
+      break;
     default:
       break;
   }
@@ -1329,6 +1530,15 @@ gst_multi_queue_send_event (GstElement * element, GstEvent * event)
 static gboolean
 gst_single_queue_start (GstMultiQueue * mq, GstSingleQueue * sq)
 {
+  if (mq->worker_threads > 0) {
+    GST_LOG_OBJECT (mq, "SingleQueue %d : scheduling on workers", sq->id);
+    GST_MULTI_QUEUE_MUTEX_LOCK (mq);
+    sq->scheduled = TRUE;
+    gst_single_queue_set_ready (mq, sq);
+    GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
+    return TRUE;
+  }
+
   GST_LOG_OBJECT (mq, "SingleQueue %d : starting task", sq->id);
   return gst_pad_start_task (sq->srcpad,
       (GstTaskFunction) gst_multi_queue_loop, sq->srcpad, NULL);
@@ -1340,7 +1550,12 @@ gst_single_queue_pause (GstMultiQueue * mq, GstSingleQueue * sq)
   gboolean result;
 
   GST_SYS_DEBUG_OBJECT (mq, "SingleQueue %d : pausing task", sq->id);
-  result = gst_pad_pause_task (sq->srcpad);
+  if (mq->worker_threads > 0) {
+    gst_single_queue_unschedule (mq, sq);
+    result = TRUE;
+  } else {
+    result = gst_pad_pause_task (sq->srcpad);
+  }
   GST_SYS_DEBUG_OBJECT (mq, "SingleQueue %d : paused task", sq->id);
   sq->sink_tainted = sq->src_tainted = TRUE;
   return result;
@@ -1352,7 +1567,12 @@ gst_single_queue_stop (GstMultiQueue * mq, GstSingleQueue * sq)
   gboolean result;
 
   GST_LOG_OBJECT (mq, "SingleQueue %d : stopping task", sq->id);
-  result = gst_pad_stop_task (sq->srcpad);
+  if (mq->worker_threads > 0) {
+    gst_single_queue_unschedule (mq, sq);
+    result = TRUE;
+  } else {
+    result = gst_pad_stop_task (sq->srcpad);
+  }
   sq->sink_tainted = sq->src_tainted = TRUE;
   return result;
 }
@@ -1367,6 +1587,7 @@ gst_single_queue_flush (GstMultiQueue * mq, GstSingleQueue * sq, gboolean flush,
   if (flush) {
     GST_MULTI_QUEUE_MUTEX_LOCK (mq);
     sq->srcresult = GST_FLOW_FLUSHING;
+    gst_single_queue_update_order (mq, sq);
     gst_data_queue_set_flushing (sq->queue, TRUE);
 
     sq->flushing = TRUE;
@@ -1374,7 +1595,7 @@ gst_single_queue_flush (GstMultiQueue * mq, GstSingleQueue * sq, gboolean flush,
     /* wake up non-linked task */
     GST_LOG_OBJECT (mq, "SingleQueue %d : waking up eventually waiting task",
         sq->id);
-    g_cond_signal (&sq->turn);
+    gst_single_queue_wake_up (mq, sq);
     sq->last_query = FALSE;
     g_cond_signal (&sq->query_handled);
     GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
@@ -1399,7 +1620,8 @@ gst_single_queue_flush (GstMultiQueue * mq, GstSingleQueue * sq, gboolean flush,
     sq->next_time = GST_CLOCK_STIME_NONE;
     sq->last_time = GST_CLOCK_STIME_NONE;
     sq->cached_sinktime = GST_CLOCK_STIME_NONE;
-    sq->group_high_time = GST_CLOCK_STIME_NONE;
+    gst_single_queue_update_order (mq, sq);
+    sq->group->high_time = GST_CLOCK_STIME_NONE;
     gst_data_queue_set_flushing (sq->queue, FALSE);
 
     /* We will become active again on the next buffer/gap */
@@ -1617,6 +1839,14 @@ update_buffering (GstMultiQueue * mq, GstSingleQueue * sq)
     buffering_level = get_buffering_level (sq);
   sq->buffering_level = buffering_level;
 
+  if (sq->above_high != (buffering_level >= mq->high_watermark)) {
+    sq->above_high = !sq->above_high;
+    if (sq->above_high)
+      mq->n_high_buffering++;
+    else
+      mq->n_high_buffering--;
+  }
+
   if (mq->use_min_buffered) {
     update_buffering_by_minimum (mq, sq);
     return;
@@ -1646,7 +1876,10 @@ update_buffering (GstMultiQueue * mq, GstSingleQueue * sq)
     GList *iter;
     gboolean is_buffering = TRUE;
 
-    for (iter = mq->queues; iter; iter = g_list_next (iter)) {
+    /* only look for the queue that is above the high watermark if there
+     * can be one */
+    iter = mq->n_high_buffering > 0 ? mq->queues : NULL;
+    for (; iter; iter = g_list_next (iter)) {
       GstSingleQueue *oq = (GstSingleQueue *) iter->data;
 
       /* ignore the sparse stream */
@@ -1926,6 +2159,16 @@ recheck_buffering_status (GstMultiQueue * mq)
     old_perc = mq->buffering_percent;
     mq->buffering_percent = 0;
 
+    /* the high watermark might have changed */
+    mq->n_high_buffering = 0;
+    for (tmp = mq->queues; tmp; tmp = g_list_next (tmp)) {
+      GstSingleQueue *q = (GstSingleQueue *) tmp->data;
+
+      q->above_high = q->buffering_level >= mq->high_watermark;
+      if (q->above_high)
+        mq->n_high_buffering++;
+    }
+
     tmp = mq->queues;
     while (tmp) {
       GstSingleQueue *q = (GstSingleQueue *) tmp->data;
@@ -2068,6 +2311,7 @@ update_time_level (GstMultiQueue * mq, GstSingleQueue * sq)
        * In order for the high_time computation to be as efficient as possible,
        * we set the last_time */
       sq->last_time = sink_time;
+      gst_single_queue_update_order (mq, sq);
     }
     if (G_UNLIKELY (sink_time != GST_CLOCK_STIME_NONE)) {
       /* if we have a time, we become untainted and use the time */
@@ -2322,6 +2566,45 @@ gst_single_queue_push_one (GstMultiQueue * mq, GstSingleQueue * sq,
           sq->id, buffer, GST_TIME_ARGS (timestamp));
       result = gst_pad_push (sq->srcpad, buffer);
     }
+  } else if (GST_IS_BUFFER_LIST (object)) {
+    GstBufferList *buffer_list;
+    GstBuffer *buffer;
+    GstClockTime timestamp, position;
+    guint i, n;
+
+    buffer_list = GST_BUFFER_LIST_CAST (object);
+
+    /* calculate the position after the last buffer like apply_buffer() would
+     * do for each of them, so we only update the time level once */
+    GST_MULTI_QUEUE_MUTEX_LOCK (mq);
+    position = sq->src_segment.position;
+    GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
+    n = gst_buffer_list_length (buffer_list);
+    for (i = 0; i < n; i++) {
+      buffer = gst_buffer_list_get (buffer_list, i);
+      timestamp = GST_BUFFER_DTS_OR_PTS (buffer);
+      if (timestamp == GST_CLOCK_TIME_NONE)
+        timestamp = position;
+      if (GST_BUFFER_DURATION_IS_VALID (buffer))
+        timestamp += GST_BUFFER_DURATION (buffer);
+      position = timestamp;
+    }
+
+    apply_buffer (mq, sq, position, GST_CLOCK_TIME_NONE, &sq->src_segment);
+
+    /* Applying the buffers may have made the queue non-full again, unblock it if needed */
+    gst_data_queue_limits_changed (sq->queue);
+
+    if (G_UNLIKELY (*allow_drop)) {
+      GST_DEBUG_OBJECT (mq,
+          "SingleQueue %d : Dropping EOS buffer list %p", sq->id, buffer_list);
+      gst_buffer_list_unref (buffer_list);
+    } else {
+      GST_DEBUG_OBJECT (mq,
+          "SingleQueue %d : Pushing buffer list %p of %u buffers", sq->id,
+          buffer_list, n);
+      result = gst_pad_push_list (sq->srcpad, buffer_list);
+    }
   } else if (GST_IS_EVENT (object)) {
     GstEvent *event;
 
@@ -2456,6 +2739,79 @@ gst_multi_queue_mo_item_new (GstMiniObject * object, guint32 curid)
   return item;
 }
 
+/* In batch-push mode, take the buffers that directly follow @buffer out of
+ * the singlequeue. While @linked, all consecutive buffers of the singlequeue
+ * are taken, linked pads don't wait for the other pads anyway. Otherwise only
+ * items with consecutive ids up to the high id are taken, so that nothing
+ * that arrived on another pad in between is overtaken. Updates @lastid to the
+ * id of the last buffer taken. Returns @buffer or a new buffer list. */
+static GstMiniObject *
+gst_single_queue_take_buffer_list (GstMultiQueue * mq, GstSingleQueue * sq,
+    GstBuffer * buffer, gboolean linked, guint32 * lastid)
+{
+  GstBufferList *buffer_list = NULL;
+  GstDataQueueItem *sitem;
+  GstMultiQueueItem *item;
+  GstBuffer *next;
+  GstClockTime first_ts, ts, max_time;
+  guint64 bytes;
+  guint max_bytes;
+  guint32 highid;
+
+  GST_MULTI_QUEUE_MUTEX_LOCK (mq);
+  max_bytes = mq->batch_push_max_bytes;
+  max_time = mq->batch_push_max_time;
+  highid = mq->highid;
+  GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
+
+  first_ts = GST_BUFFER_DTS_OR_PTS (buffer);
+  bytes = gst_buffer_get_size (buffer);
+
+  /* we are the only one popping, so the queue can't become empty between
+   * the check and the peek, and peeking won't block */
+  while (!gst_data_queue_is_empty (sq->queue)
+      && gst_data_queue_peek (sq->queue, &sitem)) {
+    item = (GstMultiQueueItem *) sitem;
+
+    if (item->is_query || !GST_IS_BUFFER (item->object))
+      break;
+
+    if (!linked && (item->posid != *lastid + 1 || item->posid > highid))
+      break;
+
+    if (max_bytes > 0 && bytes + item->size > max_bytes)
+      break;
+
+    ts = GST_BUFFER_DTS_OR_PTS (item->object);
+    if (max_time > 0 && GST_CLOCK_TIME_IS_VALID (first_ts)
+        && GST_CLOCK_TIME_IS_VALID (ts) && ts >= first_ts
+        && ts - first_ts >= max_time)
+      break;
+
+    if (!gst_data_queue_pop (sq->queue, &sitem))
+      break;
+
+    *lastid = item->posid;
+    bytes += item->size;
+    next = GST_BUFFER_CAST (gst_multi_queue_item_steal_object (item));
+    gst_multi_queue_item_destroy (item);
+
+    if (buffer_list == NULL) {
+      buffer_list = gst_buffer_list_new ();
+      gst_buffer_list_add (buffer_list, buffer);
+    }
+    gst_buffer_list_add (buffer_list, next);
+  }
+
+  if (buffer_list == NULL)
+    return GST_MINI_OBJECT_CAST (buffer);
+
+  GST_LOG_OBJECT (mq, "SingleQueue %d : batched %u buffers up to id %u",
+      sq->id, gst_buffer_list_length (buffer_list), *lastid);
+
+  return GST_MINI_OBJECT_CAST (buffer_list);
+}
+
 /* Each main loop attempts to push buffers until the return value
  * is not-linked. not-linked pads are not allowed to push data beyond
  * any linked pads, so they don't 'rush ahead of the pack'.
@@ -2474,27 +2830,59 @@ gst_multi_queue_loop (GstPad * pad)
   gboolean is_buffer;
   gboolean do_update_buffering = FALSE;
   gboolean dropping = FALSE;
+  gboolean use_workers, resumed;
 
   sq = (GstSingleQueue *) gst_pad_get_element_private (pad);
   mq = sq->mqueue;
 
+  /* with worker threads, this runs once per object and the state that is
+   * otherwise kept on the stack is kept in the singlequeue */
+  use_workers = mq->worker_threads > 0;
+  if (use_workers) {
+    GST_MULTI_QUEUE_MUTEX_LOCK (mq);
+    dropping = sq->dropping;
+    sq->dropping = FALSE;
+    GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
+  }
+
 next:
   GST_DEBUG_OBJECT (mq, "SingleQueue %d : trying to pop an object", sq->id);
 
   if (sq->flushing)
     goto out_flushing;
 
-  /* Get something from the queue, blocking until that happens, or we get
-   * flushed */
-  if (!(gst_data_queue_pop (sq->queue, &sitem)))
-    goto out_flushing;
+  resumed = FALSE;
+  if (use_workers) {
+    /* retry the object we were waiting with */
+    GST_MULTI_QUEUE_MUTEX_LOCK (mq);
+    if (sq->parked_object) {
+      object = sq->parked_object;
+      newid = sq->parked_id;
+      sq->parked_object = NULL;
+      sq->woken = FALSE;
+      mq->numwaiting--;
+      resumed = TRUE;
+    }
+    GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
+
+    /* workers never block on an empty queue */
+    if (!resumed && gst_data_queue_is_empty (sq->queue))
+      goto out_empty;
+  }
 
-  item = (GstMultiQueueItem *) sitem;
-  newid = item->posid;
+  if (!resumed) {
+    /* Get something from the queue, blocking until that happens, or we get
+     * flushed */
+    if (!(gst_data_queue_pop (sq->queue, &sitem)))
+      goto out_flushing;
 
-  /* steal the object and destroy the item */
-  object = gst_multi_queue_item_steal_object (item);
-  gst_multi_queue_item_destroy (item);
+    item = (GstMultiQueueItem *) sitem;
+    newid = item->posid;
+
+    /* steal the object and destroy the item */
+    object = gst_multi_queue_item_steal_object (item);
+    gst_multi_queue_item_destroy (item);
+  }
 
   is_buffer = GST_IS_BUFFER (object);
 
@@ -2510,7 +2898,7 @@ next:
    * we might need to wake some sleeping pad up, so there's extra work
    * there too */
   GST_MULTI_QUEUE_MUTEX_LOCK (mq);
-  if (sq->srcresult == GST_FLOW_NOT_LINKED
+  if (resumed || sq->srcresult == GST_FLOW_NOT_LINKED
       || (sq->last_oldid == G_MAXUINT32) || (newid != (sq->last_oldid + 1))
       || sq->last_oldid > mq->highid) {
     GST_LOG_OBJECT (mq, "CHECKING sq->srcresult: %s",
@@ -2534,6 +2922,8 @@ next:
     if (sq->last_oldid != G_MAXUINT32)
       sq->oldid = sq->last_oldid;
 
+    gst_single_queue_update_order (mq, sq);
+
     if (sq->srcresult == GST_FLOW_NOT_LINKED) {
       gboolean should_wait;
       /* Go to sleep until it's time to push this buffer */
@@ -2541,21 +2931,21 @@ next:
       /* Recompute the highid */
       compute_high_id (mq);
       /* Recompute the high time */
-      compute_high_time (mq, sq->groupid);
+      compute_high_time (mq, sq);
 
       GST_DEBUG_OBJECT (mq,
           "groupid %d high_time %" GST_STIME_FORMAT " next_time %"
-          GST_STIME_FORMAT, sq->groupid, GST_STIME_ARGS (sq->group_high_time),
+          GST_STIME_FORMAT, sq->groupid, GST_STIME_ARGS (sq->group->high_time),
           GST_STIME_ARGS (next_time));
 
       if (mq->sync_by_running_time) {
-        if (sq->group_high_time == GST_CLOCK_STIME_NONE) {
+        if (sq->group->high_time == GST_CLOCK_STIME_NONE) {
           should_wait = GST_CLOCK_STIME_IS_VALID (next_time) &&
               (mq->high_time == GST_CLOCK_STIME_NONE
               || next_time > mq->high_time);
         } else {
           should_wait = GST_CLOCK_STIME_IS_VALID (next_time) &&
-              next_time > sq->group_high_time;
+              next_time > sq->group->high_time;
         }
       } else
         should_wait = newid > mq->highid;
@@ -2566,11 +2956,22 @@ next:
             "queue %d sleeping for not-linked wakeup with "
             "newid %u, highid %u, next_time %" GST_STIME_FORMAT
             ", high_time %" GST_STIME_FORMAT, sq->id, newid, mq->highid,
-            GST_STIME_ARGS (next_time), GST_STIME_ARGS (sq->group_high_time));
+            GST_STIME_ARGS (next_time), GST_STIME_ARGS (sq->group->high_time));
 
         /* Wake up all non-linked pads before we sleep */
         wake_up_next_non_linked (mq);
 
+        if (use_workers) {
+          /* don't hold up the worker, keep the object until we're woken up */
+          sq->parked_object = object;
+          sq->parked_id = newid;
+          sq->woken = FALSE;
+          sq->dropping = dropping;
+          mq->numwaiting++;
+          GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
+          return;
+        }
+
         mq->numwaiting++;
         g_cond_wait (&sq->turn, &mq->qlock);
         mq->numwaiting--;
@@ -2581,24 +2982,24 @@ next:
         }
 
         /* Recompute the high time and ID */
-        compute_high_time (mq, sq->groupid);
+        compute_high_time (mq, sq);
         compute_high_id (mq);
 
         GST_DEBUG_OBJECT (mq, "queue %d woken from sleeping for not-linked "
             "wakeup with newid %u, highid %u, next_time %" GST_STIME_FORMAT
             ", high_time %" GST_STIME_FORMAT " mq high_time %" GST_STIME_FORMAT,
             sq->id, newid, mq->highid,
-            GST_STIME_ARGS (next_time), GST_STIME_ARGS (sq->group_high_time),
+            GST_STIME_ARGS (next_time), GST_STIME_ARGS (sq->group->high_time),
             GST_STIME_ARGS (mq->high_time));
 
         if (mq->sync_by_running_time) {
-          if (sq->group_high_time == GST_CLOCK_STIME_NONE) {
+          if (sq->group->high_time == GST_CLOCK_STIME_NONE) {
             should_wait = GST_CLOCK_STIME_IS_VALID (next_time) &&
                 (mq->high_time == GST_CLOCK_STIME_NONE
                 || next_time > mq->high_time);
           } else {
             should_wait = GST_CLOCK_STIME_IS_VALID (next_time) &&
-                next_time > sq->group_high_time;
+                next_time > sq->group->high_time;
           }
         } else
           should_wait = newid > mq->highid;
@@ -2606,16 +3007,17 @@ next:
 
       /* Re-compute the high_id in case someone else pushed */
       compute_high_id (mq);
-      compute_high_time (mq, sq->groupid);
+      compute_high_time (mq, sq);
     } else {
       compute_high_id (mq);
-      compute_high_time (mq, sq->groupid);
+      compute_high_time (mq, sq);
       /* Wake up all non-linked pads */
       wake_up_next_non_linked (mq);
     }
     /* We're done waiting, we can clear the nextid and nexttime */
     sq->nextid = 0;
     sq->next_time = GST_CLOCK_STIME_NONE;
+    gst_single_queue_update_order (mq, sq);
   }
   GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
 
@@ -2625,12 +3027,21 @@ next:
   GST_LOG_OBJECT (mq, "sq:%d BEFORE PUSHING sq->srcresult: %s", sq->id,
       gst_flow_get_name (sq->srcresult));
 
+  /* Take the buffers queued right behind this one along */
+  if (mq->batch_push && is_buffer && !dropping
+      && (sq->srcresult == GST_FLOW_OK
+          || sq->srcresult == GST_FLOW_NOT_LINKED))
+    object = gst_single_queue_take_buffer_list (mq, sq,
+        GST_BUFFER_CAST (object), sq->srcresult == GST_FLOW_OK, &newid);
+
   /* Update time stats */
   GST_MULTI_QUEUE_MUTEX_LOCK (mq);
   next_time = get_running_time (&sq->src_segment, object, TRUE);
   if (GST_CLOCK_STIME_IS_VALID (next_time)) {
-    if (sq->last_time == GST_CLOCK_STIME_NONE || sq->last_time < next_time)
+    if (sq->last_time == GST_CLOCK_STIME_NONE || sq->last_time < next_time) {
       sq->last_time = next_time;
+      gst_single_queue_update_order (mq, sq);
+    }
     if (mq->high_time == GST_CLOCK_STIME_NONE || mq->high_time <= next_time) {
       /* Wake up all non-linked pads now that we advanced the high time */
       mq->high_time = next_time;
@@ -2660,7 +3071,7 @@ next:
         sq->id);
 
     compute_high_id (mq);
-    compute_high_time (mq, sq->groupid);
+    compute_high_time (mq, sq);
     do_update_buffering = TRUE;
 
     /* maybe no-one is waiting */
@@ -2673,7 +3084,8 @@ next:
           GST_LOG_OBJECT (mq, "Waking up singlequeue %d", sq2->id);
           sq2->pushed = FALSE;
           sq2->srcresult = GST_FLOW_OK;
-          g_cond_signal (&sq2->turn);
+          gst_single_queue_update_order (mq, sq2);
+          gst_single_queue_wake_up (mq, sq2);
         }
       }
     }
@@ -2702,6 +3114,8 @@ next:
   }
   sq->srcresult = result;
   sq->last_oldid = newid;
+  /* also picks up the EOS flag of the srcpad */
+  gst_single_queue_update_order (mq, sq);
 
   if (do_update_buffering)
     update_buffering (mq, sq);
@@ -2716,7 +3130,7 @@ next:
   GST_MULTI_QUEUE_MUTEX_LOCK (mq);
   if (mq->numwaiting > 0 && (GST_PAD_IS_EOS (sq->srcpad)
           || sq->srcresult == GST_FLOW_EOS)) {
-    compute_high_time (mq, sq->groupid);
+    compute_high_time (mq, sq);
     compute_high_id (mq);
     wake_up_next_non_linked (mq);
   }
@@ -2729,8 +3143,22 @@ next:
       && result != GST_FLOW_EOS)
     goto out_flushing;
 
+  /* signal the underrun like a blocking pop would */
+  if (use_workers && gst_data_queue_is_empty (sq->queue))
+    goto out_empty;
+
   return;
 
+out_empty:
+  {
+    GST_MULTI_QUEUE_MUTEX_LOCK (mq);
+    sq->dropping = dropping;
+    GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
+
+    single_queue_underrun_cb (sq->queue, sq);
+    return;
+  }
+
 out_flushing:
   {
     if (object)
@@ -2759,7 +3187,10 @@ out_flushing:
     gst_single_queue_flush_queue (sq, FALSE);
     single_queue_underrun_cb (sq->queue, sq);
     gst_data_queue_set_flushing (sq->queue, TRUE);
-    gst_pad_pause_task (sq->srcpad);
+    if (use_workers)
+      gst_single_queue_unschedule (mq, sq);
+    else
+      gst_pad_pause_task (sq->srcpad);
     GST_CAT_LOG_OBJECT (multi_queue_debug, mq,
         "SingleQueue[%d] task paused, reason:%s",
         sq->id, gst_flow_get_name (sq->srcresult));
@@ -2767,6 +3198,23 @@ out_flushing:
   }
 }
 
+/* Push @item in the queue of @sq and let a worker pick up the queue if it
+ * was idle. Returns FALSE when flushing. */
+static gboolean
+gst_single_queue_push_item (GstMultiQueue * mq, GstSingleQueue * sq,
+    GstMultiQueueItem * item)
+{
+  if (!gst_data_queue_push (sq->queue, (GstDataQueueItem *) item))
+    return FALSE;
+
+  if (mq->worker_threads > 0) {
+    GST_MULTI_QUEUE_MUTEX_LOCK (mq);
+    gst_single_queue_set_ready (mq, sq);
+    GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
+  }
+  return TRUE;
+}
+
 /**
  * gst_multi_queue_chain:
  *
@@ -2829,7 +3277,7 @@ gst_multi_queue_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
     GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
   }
 
-  if (!(gst_data_queue_push (sq->queue, (GstDataQueueItem *) item)))
+  if (!gst_single_queue_push_item (mq, sq, item))
     goto flushing;
 
   /* update time level, we must do this after pushing the data in the queue so
@@ -2905,6 +3353,7 @@ gst_multi_queue_sink_activate_mode (GstPad * pad, GstObject * parent,
   }
 
   if (mq) {
+    gst_single_queue_update_order (mq, sq);
     GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
     gst_object_unref (mq);
   }
@@ -3058,7 +3507,7 @@ gst_multi_queue_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
       "SingleQueue %d : Enqueuing event %p of type %s with id %d",
       sq->id, event, GST_EVENT_TYPE_NAME (event), curid);
 
-  if (!gst_data_queue_push (sq->queue, (GstDataQueueItem *) item))
+  if (!gst_single_queue_push_item (mq, sq, item))
     goto flushing;
 
   GST_LOG_OBJECT (mq,
@@ -3115,8 +3564,10 @@ gst_multi_queue_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
       /* a new segment allows us to accept more buffers if we got EOS
        * from downstream */
       GST_MULTI_QUEUE_MUTEX_LOCK (mq);
-      if (sq->srcresult == GST_FLOW_EOS)
+      if (sq->srcresult == GST_FLOW_EOS) {
         sq->srcresult = GST_FLOW_OK;
+        gst_single_queue_update_order (mq, sq);
+      }
       GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
       break;
     case GST_EVENT_GAP:
@@ -3188,7 +3639,7 @@ gst_multi_queue_sink_query (GstPad * pad, GstObject * parent, GstQuery * query)
               "SingleQueue %d : Enqueuing query %p of type %s with id %d",
               sq->id, query, GST_QUERY_TYPE_NAME (query), curid);
           GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
-          res = gst_data_queue_push (sq->queue, (GstDataQueueItem *) item);
+          res = gst_single_queue_push_item (mq, sq, item);
           GST_MULTI_QUEUE_MUTEX_LOCK (mq);
           if (!res || sq->flushing)
             goto out_flushing;
@@ -3267,7 +3718,8 @@ gst_multi_queue_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
       GST_MULTI_QUEUE_MUTEX_LOCK (mq);
       if (sq->srcresult == GST_FLOW_NOT_LINKED) {
         sq->srcresult = GST_FLOW_OK;
-        g_cond_signal (&sq->turn);
+        gst_single_queue_update_order (mq, sq);
+        gst_single_queue_wake_up (mq, sq);
       }
       GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
 
@@ -3300,46 +3752,392 @@ gst_multi_queue_src_query (GstPad * pad, GstObject * parent, GstQuery * query)
  * Next-non-linked functions
  */
 
+/* Binary heaps of singlequeues. The heap a singlequeue is in is identified
+ * by @slot, which selects the position and key stored in the singlequeue
+ * and whether the heap has the highest or the lowest key on top. */
+#define HEAP_IS_MAX(slot) ((slot) == HEAP_LINKED_ID || \
+    (slot) == HEAP_LINKED_TIME || (slot) == HEAP_GROUP_LINKED_TIME)
+
+static inline gboolean
+sq_heap_before (GstSingleQueue * a, GstSingleQueue * b, guint slot)
+{
+  if (HEAP_IS_MAX (slot))
+    return a->heap_key[slot] > b->heap_key[slot];
+  return a->heap_key[slot] < b->heap_key[slot];
+}
+
+static inline void
+sq_heap_set (GPtrArray * heap, guint i, GstSingleQueue * sq, guint slot)
+{
+  g_ptr_array_index (heap, i) = sq;
+  sq->heap_index[slot] = i;
+}
+
+static void
+sq_heap_sift_up (GPtrArray * heap, guint i, guint slot)
+{
+  GstSingleQueue *sq = g_ptr_array_index (heap, i);
+
+  while (i > 0) {
+    guint parent = (i - 1) / 2;
+    GstSingleQueue *psq = g_ptr_array_index (heap, parent);
+
+    if (!sq_heap_before (sq, psq, slot))
+      break;
+    sq_heap_set (heap, i, psq, slot);
+    i = parent;
+  }
+  sq_heap_set (heap, i, sq, slot);
+}
+
+static void
+sq_heap_sift_down (GPtrArray * heap, guint i, guint slot)
+{
+  GstSingleQueue *sq = g_ptr_array_index (heap, i);
+
+  for (;;) {
+    guint child = 2 * i + 1;
+    GstSingleQueue *csq;
+
+    if (child >= heap->len)
+      break;
+    if (child + 1 < heap->len &&
+        sq_heap_before (g_ptr_array_index (heap, child + 1),
+            g_ptr_array_index (heap, child), slot))
+      child++;
+
+    csq = g_ptr_array_index (heap, child);
+    if (!sq_heap_before (csq, sq, slot))
+      break;
+    sq_heap_set (heap, i, csq, slot);
+    i = child;
+  }
+  sq_heap_set (heap, i, sq, slot);
+}
+
+/* Make @sq part of @heap with @key if @member is %TRUE, or remove it */
+static void
+sq_heap_update (GPtrArray * heap, GstSingleQueue * sq, guint slot,
+    gboolean member, gint64 key)
+{
+  guint i = sq->heap_index[slot];
+
+  if (!member) {
+    if (i == HEAP_INDEX_NONE)
+      return;
+
+    /* moves the last one into the hole */
+    g_ptr_array_remove_index_fast (heap, i);
+    sq->heap_index[slot] = HEAP_INDEX_NONE;
+    if (i < heap->len) {
+      GstSingleQueue *moved = g_ptr_array_index (heap, i);
+
+      moved->heap_index[slot] = i;
+      sq_heap_sift_up (heap, i, slot);
+      sq_heap_sift_down (heap, moved->heap_index[slot], slot);
+    }
+  } else if (i == HEAP_INDEX_NONE) {
+    sq->heap_key[slot] = key;
+    g_ptr_array_add (heap, sq);
+    sq_heap_sift_up (heap, heap->len - 1, slot);
+  } else if (sq->heap_key[slot] != key) {
+    sq->heap_key[slot] = key;
+    sq_heap_sift_up (heap, i, slot);
+    sq_heap_sift_down (heap, sq->heap_index[slot], slot);
+  }
+}
+
+static inline GstSingleQueue *
+sq_heap_top (GPtrArray * heap)
+{
+  return heap->len > 0 ? g_ptr_array_index (heap, 0) : NULL;
+}
+
+static void
+gst_multi_queue_group_free (GstMultiQueueGroup * group)
+{
+  g_ptr_array_unref (group->heaps[0]);
+  g_ptr_array_unref (group->heaps[1]);
+  g_slice_free (GstMultiQueueGroup, group);
+}
+
 /* WITH LOCK TAKEN */
 static void
-wake_up_next_non_linked (GstMultiQueue * mq)
+gst_single_queue_leave_group (GstMultiQueue * mq, GstSingleQueue * sq)
 {
-  GList *tmp;
+  GstMultiQueueGroup *group = sq->group;
+
+  if (group == NULL)
+    return;
+
+  sq_heap_update (group->heaps[0], sq, HEAP_GROUP_WAITING_TIME, FALSE, 0);
+  sq_heap_update (group->heaps[1], sq, HEAP_GROUP_LINKED_TIME, FALSE, 0);
+  sq->group = NULL;
+
+  if (--group->n_queues == 0)
+    g_hash_table_remove (mq->groups, GUINT_TO_POINTER (group->id));
+}
+
+/* WITH LOCK TAKEN */
+static void
+gst_single_queue_join_group (GstMultiQueue * mq, GstSingleQueue * sq)
+{
+  GstMultiQueueGroup *group;
+
+  group = g_hash_table_lookup (mq->groups, GUINT_TO_POINTER (sq->groupid));
+  if (group == NULL) {
+    group = g_slice_new0 (GstMultiQueueGroup);
+    group->id = sq->groupid;
+    group->high_time = GST_CLOCK_STIME_NONE;
+    group->heaps[0] = g_ptr_array_new ();
+    group->heaps[1] = g_ptr_array_new ();
+    g_hash_table_insert (mq->groups, GUINT_TO_POINTER (group->id), group);
+  }
+  group->n_queues++;
+  sq->group = group;
+}
+
+/* Update the position of @sq in the heaps after any of the srcresult, EOS
+ * state, nextid, oldid, next_time, last_time or groupid changed.
+ * WITH LOCK TAKEN */
+static void
+gst_single_queue_update_order (GstMultiQueue * mq, GstSingleQueue * sq)
+{
+  gboolean not_linked, linked, waiting_time, linked_time;
+
+  /* the group-id pad property is set without our lock */
+  if (G_UNLIKELY (sq->group == NULL || sq->group->id != sq->groupid)) {
+    gst_single_queue_leave_group (mq, sq);
+    gst_single_queue_join_group (mq, sq);
+  }
+
+  not_linked = sq->srcresult == GST_FLOW_NOT_LINKED;
+  linked = !not_linked && sq->srcresult != GST_FLOW_EOS
+      && !GST_PAD_IS_EOS (sq->srcpad);
+  waiting_time = not_linked && GST_CLOCK_STIME_IS_VALID (sq->next_time);
+  linked_time = linked && GST_CLOCK_STIME_IS_VALID (sq->last_time);
+
+  sq_heap_update (mq->heaps[HEAP_WAITING_ID], sq, HEAP_WAITING_ID,
+      not_linked && sq->nextid != 0, sq->nextid);
+  sq_heap_update (mq->heaps[HEAP_LINKED_ID], sq, HEAP_LINKED_ID, linked,
+      sq->oldid);
+  sq_heap_update (mq->heaps[HEAP_WAITING_TIME], sq, HEAP_WAITING_TIME,
+      waiting_time, sq->next_time);
+  sq_heap_update (mq->heaps[HEAP_LINKED_TIME], sq, HEAP_LINKED_TIME,
+      linked_time, sq->last_time);
+  sq_heap_update (sq->group->heaps[0], sq, HEAP_GROUP_WAITING_TIME,
+      waiting_time, sq->next_time);
+  sq_heap_update (sq->group->heaps[1], sq, HEAP_GROUP_LINKED_TIME,
+      linked_time, sq->last_time);
+}
+
+/* WITH LOCK TAKEN */
+static void
+gst_single_queue_remove_order (GstMultiQueue * mq, GstSingleQueue * sq)
+{
+  sq_heap_update (mq->heaps[HEAP_WAITING_ID], sq, HEAP_WAITING_ID, FALSE, 0);
+  sq_heap_update (mq->heaps[HEAP_LINKED_ID], sq, HEAP_LINKED_ID, FALSE, 0);
+  sq_heap_update (mq->heaps[HEAP_WAITING_TIME], sq, HEAP_WAITING_TIME, FALSE,
+      0);
+  sq_heap_update (mq->heaps[HEAP_LINKED_TIME], sq, HEAP_LINKED_TIME, FALSE, 0);
+  sq_heap_update (mq->ready, sq, HEAP_READY, FALSE, 0);
+  gst_single_queue_leave_group (mq, sq);
+
+  if (sq->above_high) {
+    sq->above_high = FALSE;
+    mq->n_high_buffering--;
+  }
+}
+
+/* Queue @sq for the worker threads if it has something to do. Parked queues
+ * only have something to do once they got woken up, the others whenever
+ * they have data. WITH LOCK TAKEN */
+static void
+gst_single_queue_set_ready (GstMultiQueue * mq, GstSingleQueue * sq)
+{
+  gboolean ready;
+
+  if (!sq->scheduled || sq->busy)
+    return;
+
+  if (sq->parked_object)
+    ready = sq->woken || sq->flushing;
+  else
+    ready = !gst_data_queue_is_empty (sq->queue);
+
+  if (ready && sq->heap_index[HEAP_READY] == HEAP_INDEX_NONE) {
+    sq_heap_update (mq->ready, sq, HEAP_READY, TRUE, sq->last_time);
+    g_cond_signal (&mq->worker_cond);
+  }
+}
+
+/* Wake up @sq waiting for a not-linked wakeup. WITH LOCK TAKEN */
+static void
+gst_single_queue_wake_up (GstMultiQueue * mq, GstSingleQueue * sq)
+{
+  g_cond_signal (&sq->turn);
+
+  if (sq->parked_object) {
+    sq->woken = TRUE;
+    gst_single_queue_set_ready (mq, sq);
+  }
+}
+
+/* Stop the worker threads from picking up @sq and wait until none of them
+ * is running it anymore. The object it was waiting with is dropped. */
+static void
+gst_single_queue_unschedule (GstMultiQueue * mq, GstSingleQueue * sq)
+{
+  GstMiniObject *object;
+
+  GST_MULTI_QUEUE_MUTEX_LOCK (mq);
+  sq->scheduled = FALSE;
+  sq_heap_update (mq->ready, sq, HEAP_READY, FALSE, 0);
+  while (sq->busy && sq->busy_thread != g_thread_self ())
+    g_cond_wait (&mq->worker_done_cond, &mq->qlock);
+
+  object = sq->parked_object;
+  if (object) {
+    sq->parked_object = NULL;
+    sq->woken = FALSE;
+    mq->numwaiting--;
+  }
+  sq->dropping = FALSE;
+  GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
+
+  /* queries are owned by the thread waiting for the result */
+  if (object && !GST_IS_QUERY (object))
+    gst_mini_object_unref (object);
+}
+
+/* Services the singlequeues that are ready, by running the loop function of
+ * their source pad the same way a pad task would */
+static gpointer
+gst_multi_queue_worker (GstMultiQueue * mq)
+{
+  GstSingleQueue *sq;
+
+  GST_MULTI_QUEUE_MUTEX_LOCK (mq);
+  while (mq->workers_running) {
+    sq = sq_heap_top (mq->ready);
+    if (sq == NULL) {
+      g_cond_wait (&mq->worker_cond, &mq->qlock);
+      continue;
+    }
+    sq_heap_update (mq->ready, sq, HEAP_READY, FALSE, 0);
+    sq->busy = TRUE;
+    sq->busy_thread = g_thread_self ();
+    GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
+
+    GST_LOG_OBJECT (mq, "SingleQueue %d : running in worker", sq->id);
+    GST_PAD_STREAM_LOCK (sq->srcpad);
+    gst_multi_queue_loop (sq->srcpad);
+    GST_PAD_STREAM_UNLOCK (sq->srcpad);
+
+    GST_MULTI_QUEUE_MUTEX_LOCK (mq);
+    sq->busy = FALSE;
+    sq->busy_thread = NULL;
+    /* it might have gotten more data in the meantime */
+    gst_single_queue_set_ready (mq, sq);
+    g_cond_broadcast (&mq->worker_done_cond);
+  }
+  GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
+
+  return NULL;
+}
+
+static void
+gst_multi_queue_start_workers (GstMultiQueue * mq)
+{
+  guint i;
+
+  if (mq->worker_threads == 0 || mq->workers != NULL)
+    return;
+
+  GST_DEBUG_OBJECT (mq, "starting %u worker threads", mq->worker_threads);
+
+  mq->workers_running = TRUE;
+  mq->workers = g_new0 (GThread *, mq->worker_threads);
+  for (i = 0; i < mq->worker_threads; i++)
+    mq->workers[i] = g_thread_new (GST_OBJECT_NAME (mq),
+        (GThreadFunc) gst_multi_queue_worker, mq);
+}
+
+static void
+gst_multi_queue_stop_workers (GstMultiQueue * mq)
+{
+  guint i;
+
+  if (mq->workers == NULL)
+    return;
+
+  GST_DEBUG_OBJECT (mq, "stopping worker threads");
+
+  GST_MULTI_QUEUE_MUTEX_LOCK (mq);
+  mq->workers_running = FALSE;
+  g_cond_broadcast (&mq->worker_cond);
+  GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
+
+  for (i = 0; i < mq->worker_threads; i++)
+    g_thread_join (mq->workers[i]);
+  g_free (mq->workers);
+  mq->workers = NULL;
+}
+
+
+/* signal all singlequeues in the min-heap @heap with a key up to @max,
+ * only visiting the part of the heap that is below it */
+static void
+wake_up_waiting (GstMultiQueue * mq, GPtrArray * heap, guint slot, guint i,
+    gint64 max)
+{
+  GstSingleQueue *sq;
+
+  if (i >= heap->len)
+    return;
+
+  sq = g_ptr_array_index (heap, i);
+  if (sq->heap_key[slot] > max)
+    return;
+
+  GST_LOG_OBJECT (mq, "Waking up singlequeue %d", sq->id);
+  gst_single_queue_wake_up (mq, sq);
+
+  wake_up_waiting (mq, heap, slot, 2 * i + 1, max);
+  wake_up_waiting (mq, heap, slot, 2 * i + 2, max);
+}
 
+/* WITH LOCK TAKEN */
+static void
+wake_up_next_non_linked (GstMultiQueue * mq)
+{
   /* maybe no-one is waiting */
   if (mq->numwaiting < 1)
     return;
 
   if (mq->sync_by_running_time && GST_CLOCK_STIME_IS_VALID (mq->high_time)) {
-    /* Else figure out which singlequeue(s) need waking up */
-    for (tmp = mq->queues; tmp; tmp = tmp->next) {
-      GstSingleQueue *sq = (GstSingleQueue *) tmp->data;
-      if (sq->srcresult == GST_FLOW_NOT_LINKED) {
-        GstClockTimeDiff high_time;
-
-        if (GST_CLOCK_STIME_IS_VALID (sq->group_high_time))
-          high_time = sq->group_high_time;
-        else
-          high_time = mq->high_time;
+    GHashTableIter iter;
+    gpointer value;
+
+    /* Else figure out which singlequeue(s) need waking up, the waiting ones
+     * of each group are ordered by their next time */
+    g_hash_table_iter_init (&iter, mq->groups);
+    while (g_hash_table_iter_next (&iter, NULL, &value)) {
+      GstMultiQueueGroup *group = value;
+      GstClockTimeDiff high_time;
+
+      if (GST_CLOCK_STIME_IS_VALID (group->high_time))
+        high_time = group->high_time;
+      else
+        high_time = mq->high_time;
 
-        if (GST_CLOCK_STIME_IS_VALID (sq->next_time) &&
-            GST_CLOCK_STIME_IS_VALID (high_time)
-            && sq->next_time <= high_time) {
-          GST_LOG_OBJECT (mq, "Waking up singlequeue %d", sq->id);
-          g_cond_signal (&sq->turn);
-        }
-      }
+      wake_up_waiting (mq, group->heaps[0], HEAP_GROUP_WAITING_TIME, 0,
+          high_time);
     }
   } else {
     /* Else figure out which singlequeue(s) need waking up */
-    for (tmp = mq->queues; tmp; tmp = tmp->next) {
-      GstSingleQueue *sq = (GstSingleQueue *) tmp->data;
-      if (sq->srcresult == GST_FLOW_NOT_LINKED &&
-          sq->nextid != 0 && sq->nextid <= mq->highid) {
-        GST_LOG_OBJECT (mq, "Waking up singlequeue %d", sq->id);
-        g_cond_signal (&sq->turn);
-      }
-    }
+    wake_up_waiting (mq, mq->heaps[HEAP_WAITING_ID], HEAP_WAITING_ID, 0,
+        mq->highid);
   }
 }
 
@@ -3349,33 +4147,17 @@ compute_high_id (GstMultiQueue * mq)
 {
   /* The high-id is either the highest id among the linked pads, or if all
    * pads are not-linked, it's the lowest not-linked pad */
-  GList *tmp;
+  GstSingleQueue *sq;
   guint32 lowest = G_MAXUINT32;
   guint32 highid = G_MAXUINT32;
 
-  for (tmp = mq->queues; tmp; tmp = g_list_next (tmp)) {
-    GstSingleQueue *sq = (GstSingleQueue *) tmp->data;
-
-    GST_LOG_OBJECT (mq, "inspecting sq:%d , nextid:%d, oldid:%d, srcresult:%s",
-        sq->id, sq->nextid, sq->oldid, gst_flow_get_name (sq->srcresult));
-
-    if (sq->srcresult == GST_FLOW_NOT_LINKED) {
-      /* No need to consider queues which are not waiting */
-      if (sq->nextid == 0) {
-        GST_LOG_OBJECT (mq, "sq:%d is not waiting - ignoring", sq->id);
-        continue;
-      }
+  /* only waiting not-linked queues are in here */
+  if ((sq = sq_heap_top (mq->heaps[HEAP_WAITING_ID])))
+    lowest = sq->heap_key[HEAP_WAITING_ID];
 
-      if (sq->nextid < lowest)
-        lowest = sq->nextid;
-    } else if (!GST_PAD_IS_EOS (sq->srcpad) && sq->srcresult != GST_FLOW_EOS) {
-      /* If we don't have a global highid, or the global highid is lower than
-       * this single queue's last outputted id, store the queue's one,
-       * unless the singlequeue output is at EOS */
-      if ((highid == G_MAXUINT32) || (sq->oldid > highid))
-        highid = sq->oldid;
-    }
-  }
+  /* and only linked ones that are not at EOS in here */
+  if ((sq = sq_heap_top (mq->heaps[HEAP_LINKED_ID])))
+    highid = sq->heap_key[HEAP_LINKED_ID];
 
   if (highid == G_MAXUINT32 || lowest < highid)
     mq->highid = lowest;
@@ -3388,68 +4170,37 @@ compute_high_id (GstMultiQueue * mq)
 
 /* WITH LOCK TAKEN */
 static void
-compute_high_time (GstMultiQueue * mq, guint groupid)
+compute_high_time (GstMultiQueue * mq, GstSingleQueue * sq)
 {
   /* The high-time is either the highest last time among the linked
    * pads, or if all pads are not-linked, it's the lowest nex time of
    * not-linked pad */
-  GList *tmp;
+  GstMultiQueueGroup *group;
+  GstSingleQueue *top;
   GstClockTimeDiff highest = GST_CLOCK_STIME_NONE;
   GstClockTimeDiff lowest = GST_CLOCK_STIME_NONE;
   GstClockTimeDiff group_high = GST_CLOCK_STIME_NONE;
   GstClockTimeDiff group_low = GST_CLOCK_STIME_NONE;
   GstClockTimeDiff res;
-  /* Number of streams which belong to groupid */
-  guint group_count = 0;
 
   if (!mq->sync_by_running_time)
     /* return GST_CLOCK_STIME_NONE; */
     return;
 
-  for (tmp = mq->queues; tmp; tmp = tmp->next) {
-    GstSingleQueue *sq = (GstSingleQueue *) tmp->data;
-
-    GST_LOG_OBJECT (mq,
-        "inspecting sq:%d (group:%d) , next_time:%" GST_STIME_FORMAT
-        ", last_time:%" GST_STIME_FORMAT ", srcresult:%s", sq->id, sq->groupid,
-        GST_STIME_ARGS (sq->next_time), GST_STIME_ARGS (sq->last_time),
-        gst_flow_get_name (sq->srcresult));
-
-    if (sq->groupid == groupid)
-      group_count++;
-
-    if (sq->srcresult == GST_FLOW_NOT_LINKED) {
-      /* No need to consider queues which are not waiting */
-      if (!GST_CLOCK_STIME_IS_VALID (sq->next_time)) {
-        GST_LOG_OBJECT (mq, "sq:%d is not waiting - ignoring", sq->id);
-        continue;
-      }
-
-      if (lowest == GST_CLOCK_STIME_NONE || sq->next_time < lowest)
-        lowest = sq->next_time;
-      if (sq->groupid == groupid && (group_low == GST_CLOCK_STIME_NONE
-              || sq->next_time < group_low))
-        group_low = sq->next_time;
-    } else if (!GST_PAD_IS_EOS (sq->srcpad) && sq->srcresult != GST_FLOW_EOS) {
-      /* If we don't have a global high time, or the global high time
-       * is lower than this single queue's last outputted time, store
-       * the queue's one, unless the singlequeue output is at EOS. */
-      if (highest == GST_CLOCK_STIME_NONE
-          || (sq->last_time != GST_CLOCK_STIME_NONE && sq->last_time > highest))
-        highest = sq->last_time;
-      if (sq->groupid == groupid && (group_high == GST_CLOCK_STIME_NONE
-              || (sq->last_time != GST_CLOCK_STIME_NONE
-                  && sq->last_time > group_high)))
-        group_high = sq->last_time;
-    }
-    GST_LOG_OBJECT (mq,
-        "highest now %" GST_STIME_FORMAT " lowest %" GST_STIME_FORMAT,
-        GST_STIME_ARGS (highest), GST_STIME_ARGS (lowest));
-    if (sq->groupid == groupid)
-      GST_LOG_OBJECT (mq,
-          "grouphigh %" GST_STIME_FORMAT " grouplow %" GST_STIME_FORMAT,
-          GST_STIME_ARGS (group_high), GST_STIME_ARGS (group_low));
-  }
+  /* make sure the group of the queue is up to date */
+  gst_single_queue_update_order (mq, sq);
+  group = sq->group;
+
+  /* The waiting not-linked queues are ordered by their next time, the linked
+   * ones that are not at EOS by their last time */
+  if ((top = sq_heap_top (mq->heaps[HEAP_WAITING_TIME])))
+    lowest = top->heap_key[HEAP_WAITING_TIME];
+  if ((top = sq_heap_top (mq->heaps[HEAP_LINKED_TIME])))
+    highest = top->heap_key[HEAP_LINKED_TIME];
+  if ((top = sq_heap_top (group->heaps[0])))
+    group_low = top->heap_key[HEAP_GROUP_WAITING_TIME];
+  if ((top = sq_heap_top (group->heaps[1])))
+    group_high = top->heap_key[HEAP_GROUP_LINKED_TIME];
 
   if (highest == GST_CLOCK_STIME_NONE)
     mq->high_time = lowest;
@@ -3457,25 +4208,22 @@ compute_high_time (GstMultiQueue * mq, guint groupid)
     mq->high_time = highest;
 
   /* If there's only one stream of a given type, use the global high */
-  if (group_count < 2)
+  if (group->n_queues < 2)
     res = GST_CLOCK_STIME_NONE;
   else if (group_high == GST_CLOCK_STIME_NONE)
     res = group_low;
   else
     res = group_high;
 
-  GST_LOG_OBJECT (mq, "group count %d for groupid %u", group_count, groupid);
+  GST_LOG_OBJECT (mq, "group count %d for groupid %u", group->n_queues,
+      group->id);
   GST_LOG_OBJECT (mq,
       "MQ High time is now : %" GST_STIME_FORMAT ", group %d high time %"
       GST_STIME_FORMAT ", lowest non-linked %" GST_STIME_FORMAT,
-      GST_STIME_ARGS (mq->high_time), groupid, GST_STIME_ARGS (mq->high_time),
+      GST_STIME_ARGS (mq->high_time), group->id, GST_STIME_ARGS (res),
       GST_STIME_ARGS (lowest));
 
-  for (tmp = mq->queues; tmp; tmp = tmp->next) {
-    GstSingleQueue *sq = (GstSingleQueue *) tmp->data;
-    if (groupid == sq->groupid)
-      sq->group_high_time = res;
-  }
+  group->high_time = res;
 }
 
 /*
@@ -3704,6 +4452,7 @@ gst_single_queue_new (GstMultiQueue * mqueue, guint id)
   gchar *name;
   GList *tmp;
   guint temp_id = (id == -1) ? 0 : id;
+  guint i;
 
   GST_MULTI_QUEUE_MUTEX_LOCK (mqueue);
 
@@ -3729,7 +4478,8 @@ gst_single_queue_new (GstMultiQueue * mqueue, guint id)
   mqueue->nbqueues++;
   sq->id = temp_id;
   sq->groupid = DEFAULT_PAD_GROUP_ID;
-  sq->group_high_time = GST_CLOCK_STIME_NONE;
+  for (i = 0; i < N_HEAPS; i++)
+    sq->heap_index[i] = HEAP_INDEX_NONE;
 
   mqueue->queues = g_list_insert_before (mqueue->queues, tmp, sq);
   mqueue->queues_cookie++;
@@ -3816,6 +4566,8 @@ gst_single_queue_new (GstMultiQueue * mqueue, guint id)
   gst_pad_set_element_private (sq->sinkpad, (gpointer) sq);
   gst_pad_set_element_private (sq->srcpad, (gpointer) sq);
 
+  gst_single_queue_update_order (mqueue, sq);
+
   GST_MULTI_QUEUE_MUTEX_UNLOCK (mqueue);
 
   /* only activate the pads when we are not in the NULL state
@@ -81,6 +81,14 @@ struct _GstMultiQueue {
 			/* queues lock). Protects nbqueues, queues, global */
 			/* GstMultiQueueSize, counter and highid */
 
+  /* Singlequeues ordered by the ids and running times that are used to
+   * compute highid and high_time, and the groups they belong to. Kept up
+   * to date incrementally so that nothing needs to iterate all queues
+   * for each buffer. Protected by qlock */
+  GPtrArray *heaps[4];
+  GHashTable *groups;
+  guint n_high_buffering; /* queues with a level >= the high watermark */
+
   gint numwaiting;	/* number of not-linked pads waiting */
 
   gboolean buffering_percent_changed;
@@ -92,6 +100,19 @@ struct _GstMultiQueue {
   GstClockTime unlinked_cache_time;
 
   gboolean interleave_by_serialized_event;
+
+  gboolean batch_push;		/* push consecutive buffers as lists */
+  guint batch_push_max_bytes;
+  GstClockTime batch_push_max_time;
+
+  /* shared worker threads servicing the singlequeues instead of a task per
+   * source pad, when worker_threads > 0. Protected by qlock */
+  guint worker_threads;
+  GThread **workers;
+  gboolean workers_running;
+  GPtrArray *ready;		/* singlequeues with work, by running time */
+  GCond worker_cond;		/* signalled when a singlequeue gets ready */
+  GCond worker_done_cond;	/* signalled when a worker is done with one */
 };
 
 struct _GstMultiQueueClass {
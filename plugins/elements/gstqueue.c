@@ -123,13 +123,23 @@ enum
   PROP_LAST_TIMESTAMP,
   PROP_LEAKY,
   PROP_SILENT,
-  PROP_FLUSH_ON_EOS
+  PROP_FLUSH_ON_EOS,
+  PROP_WAKEUP_THRESHOLD,
+  PROP_WAKEUP_TIMEOUT,
+  PROP_BATCH_PUSH,
+  PROP_BATCH_PUSH_MAX_BYTES,
+  PROP_BATCH_PUSH_MAX_TIME
 };
 
 /* default property values */
 #define DEFAULT_MAX_SIZE_BUFFERS  200   /* 200 buffers */
 #define DEFAULT_MAX_SIZE_BYTES    (10 * 1024 * 1024)    /* 10 MB       */
 #define DEFAULT_MAX_SIZE_TIME     GST_SECOND    /* 1 second    */
+#define DEFAULT_WAKEUP_THRESHOLD  1
+#define DEFAULT_WAKEUP_TIMEOUT    GST_MSECOND
+#define DEFAULT_BATCH_PUSH        FALSE
+#define DEFAULT_BATCH_PUSH_MAX_BYTES 0
+#define DEFAULT_BATCH_PUSH_MAX_TIME  0
 
 #define GST_QUEUE_MUTEX_LOCK(q) G_STMT_START {                          \
   g_mutex_lock (&q->qlock);                                              \
@@ -160,7 +170,11 @@ enum
 #define GST_QUEUE_WAIT_ADD_CHECK(q, label) G_STMT_START {               \
   STATUS (q, q->srcpad, "wait for ADD");                                \
   q->waiting_add = TRUE;                                                \
-  g_cond_wait (&q->item_add, &q->qlock);                                  \
+  if (q->wakeup_threshold > 1)                                          \
+    g_cond_wait_until (&q->item_add, &q->qlock,                         \
+        g_get_monotonic_time () + q->wakeup_timeout / GST_USECOND);     \
+  else                                                                  \
+    g_cond_wait (&q->item_add, &q->qlock);                              \
   q->waiting_add = FALSE;                                               \
   if (q->srcresult != GST_FLOW_OK) {                                    \
     STATUS (q, q->srcpad, "received ADD wakeup");                       \
@@ -183,6 +197,19 @@ enum
   }                                                                     \
 } G_STMT_END
 
+/* buffers only wake up the loop once enough of them are queued, the loop
+ * picks up smaller amounts after wakeup-timeout */
+#define GST_QUEUE_SIGNAL_ADD_DATA(q) G_STMT_START {                     \
+  if (q->waiting_add && (q->cur_level.buffers >= q->wakeup_threshold || \
+          gst_queue_is_filled (q))) {                                   \
+    STATUS (q, q->sinkpad, "signal ADD");                               \
+    g_cond_signal (&q->item_add);                                       \
+  }                                                                     \
+} G_STMT_END
+
+/* max. number of buffers the loop dequeues in one go */
+#define QUEUE_MAX_BATCH 64
+
 #define _do_init \
     GST_DEBUG_CATEGORY_INIT (queue_debug, "queue", 0, "queue element"); \
     GST_DEBUG_CATEGORY_INIT (queue_dataflow, "queue_dataflow", 0, \
@@ -416,6 +443,93 @@ gst_queue_class_init (GstQueueClass * klass)
           G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
           G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstQueue:wakeup-threshold
+   *
+   * The number of buffers that need to be queued before the streaming thread
+   * of the source pad is woken up when it is waiting for data. Events and
+   * queries always wake it up, and so does a full queue.
+   *
+   * With a value bigger than 1, the streaming thread also takes up to that
+   * many consecutive buffers out of the queue at once. At high buffer rates
+   * this saves a thread wakeup and a lock round trip per buffer, at the cost
+   * of up to #GstQueue:wakeup-timeout of extra latency.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_WAKEUP_THRESHOLD,
+      g_param_spec_uint ("wakeup-threshold", "Wakeup threshold",
+          "Number of queued buffers needed to wake up the source pad thread",
+          1, QUEUE_MAX_BATCH, DEFAULT_WAKEUP_THRESHOLD,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+          G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstQueue:wakeup-timeout
+   *
+   * The maximum time the streaming thread of the source pad keeps waiting
+   * while fewer than #GstQueue:wakeup-threshold buffers are queued. Only
+   * used when #GstQueue:wakeup-threshold is bigger than 1.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_WAKEUP_TIMEOUT,
+      g_param_spec_uint64 ("wakeup-timeout", "Wakeup timeout (ns)",
+          "Max. time data waits in the queue for the wakeup-threshold (in ns)",
+          GST_USECOND, G_MAXUINT64, DEFAULT_WAKEUP_TIMEOUT,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+          G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstQueue:batch-push
+   *
+   * Push all buffers that directly follow each other in the queue downstream
+   * as one #GstBufferList, instead of pushing them one by one. Events and
+   * queries end a batch, so they stay in order with the buffers.
+   *
+   * The size of a batch can be limited with #GstQueue:batch-push-max-bytes
+   * and #GstQueue:batch-push-max-time.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_BATCH_PUSH,
+      g_param_spec_boolean ("batch-push", "Batch push",
+          "Push consecutive queued buffers downstream as buffer lists",
+          DEFAULT_BATCH_PUSH,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+          G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstQueue:batch-push-max-bytes
+   *
+   * The maximum number of bytes in a buffer list pushed in
+   * #GstQueue:batch-push mode, or 0 for no limit. A batch always contains
+   * at least one buffer.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_BATCH_PUSH_MAX_BYTES,
+      g_param_spec_uint ("batch-push-max-bytes", "Batch push max. bytes",
+          "Max. amount of data in a pushed buffer list (bytes, 0=disable)",
+          0, G_MAXUINT, DEFAULT_BATCH_PUSH_MAX_BYTES,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+          G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstQueue:batch-push-max-time
+   *
+   * The maximum timestamp difference between the first and the last buffer
+   * of a buffer list pushed in #GstQueue:batch-push mode, or 0 for no limit.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_BATCH_PUSH_MAX_TIME,
+      g_param_spec_uint64 ("batch-push-max-time", "Batch push max. time (ns)",
+          "Max. duration of a pushed buffer list (in ns, 0=disable)",
+          0, G_MAXUINT64, DEFAULT_BATCH_PUSH_MAX_TIME,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+          G_PARAM_STATIC_STRINGS));
+
   gobject_class->finalize = gst_queue_finalize;
 
   gst_element_class_set_static_metadata (gstelement_class,
@@ -469,6 +583,11 @@ gst_queue_init (GstQueue * queue)
 
   queue->leaky = GST_QUEUE_NO_LEAK;
   queue->srcresult = GST_FLOW_FLUSHING;
+  queue->wakeup_threshold = DEFAULT_WAKEUP_THRESHOLD;
+  queue->wakeup_timeout = DEFAULT_WAKEUP_TIMEOUT;
+  queue->batch_push = DEFAULT_BATCH_PUSH;
+  queue->batch_push_max_bytes = DEFAULT_BATCH_PUSH_MAX_BYTES;
+  queue->batch_push_max_time = DEFAULT_BATCH_PUSH_MAX_TIME;
 
   g_mutex_init (&queue->qlock);
   g_cond_init (&queue->item_add);
@@ -790,7 +909,7 @@ gst_queue_locked_enqueue_buffer (GstQueue * queue, gpointer item)
   qitem.is_query = FALSE;
   qitem.size = bsize;
   gst_queue_array_push_tail_struct (queue->queue, &qitem);
-  GST_QUEUE_SIGNAL_ADD (queue);
+  GST_QUEUE_SIGNAL_ADD_DATA (queue);
 }
 
 static inline void
@@ -813,7 +932,7 @@ gst_queue_locked_enqueue_buffer_list (GstQueue * queue, gpointer item)
   qitem.is_query = FALSE;
   qitem.size = bsize;
   gst_queue_array_push_tail_struct (queue->queue, &qitem);
-  GST_QUEUE_SIGNAL_ADD (queue);
+  GST_QUEUE_SIGNAL_ADD_DATA (queue);
 }
 
 static inline void
@@ -860,9 +979,10 @@ gst_queue_locked_enqueue_event (GstQueue * queue, gpointer item)
   GST_QUEUE_SIGNAL_ADD (queue);
 }
 
-/* dequeue an item from the queue and update level stats, with QUEUE_LOCK */
+/* dequeue an item from the queue and update level stats, with QUEUE_LOCK.
+ * Does not wake up the chain function */
 static GstMiniObject *
-gst_queue_locked_dequeue (GstQueue * queue)
+gst_queue_locked_dequeue_item (GstQueue * queue)
 {
   GstQueueItem *qitem;
   GstMiniObject *item;
@@ -937,7 +1057,6 @@ gst_queue_locked_dequeue (GstQueue * queue)
         item, GST_OBJECT_NAME (queue));
     item = NULL;
   }
-  GST_QUEUE_SIGNAL_DEL (queue);
 
   return item;
 
@@ -949,6 +1068,127 @@ no_item:
   }
 }
 
+/* dequeue an item from the queue and update level stats, with QUEUE_LOCK */
+static GstMiniObject *
+gst_queue_locked_dequeue (GstQueue * queue)
+{
+  GstMiniObject *item;
+
+  item = gst_queue_locked_dequeue_item (queue);
+  if (item != NULL)
+    GST_QUEUE_SIGNAL_DEL (queue);
+
+  return item;
+}
+
+/* dequeue up to @max buffers that are directly at the head of the queue,
+ * with QUEUE_LOCK. Returns the number of buffers stored in @buffers */
+static guint
+gst_queue_locked_dequeue_buffers (GstQueue * queue, GstBuffer ** buffers,
+    guint max)
+{
+  GstQueueItem *qitem;
+  guint n = 0;
+
+  while (n < max) {
+    qitem = gst_queue_array_peek_head_struct (queue->queue);
+    if (qitem == NULL || qitem->is_query || !GST_IS_BUFFER (qitem->item))
+      break;
+
+    buffers[n++] = GST_BUFFER_CAST (gst_queue_locked_dequeue_item (queue));
+  }
+  if (n > 0)
+    GST_QUEUE_SIGNAL_DEL (queue);
+
+  return n;
+}
+
+/* put @n buffers that were dequeued by gst_queue_locked_dequeue_buffers()
+ * but not pushed back at the head of the queue, with QUEUE_LOCK. The queue
+ * array can only be appended to, so it is rebuilt, which is fine as this
+ * only happens when downstream stopped accepting data */
+static void
+gst_queue_locked_requeue_buffers (GstQueue * queue, GstBuffer ** buffers,
+    guint n)
+{
+  GstQueueArray *rest = queue->queue;
+  GstQueueItem qitem, *walk;
+  GstClockTime timestamp;
+  guint i;
+
+  GST_CAT_LOG_OBJECT (queue_dataflow, queue, "requeueing %u buffers", n);
+
+  queue->queue = gst_queue_array_new_for_struct (sizeof (GstQueueItem),
+      MAX (n + gst_queue_array_get_length (rest),
+          DEFAULT_MAX_SIZE_BUFFERS * 3 / 2));
+
+  for (i = 0; i < n; i++) {
+    qitem.item = GST_MINI_OBJECT_CAST (buffers[i]);
+    qitem.is_query = FALSE;
+    qitem.size = gst_buffer_get_size (buffers[i]);
+    gst_queue_array_push_tail_struct (queue->queue, &qitem);
+
+    queue->cur_level.buffers++;
+    queue->cur_level.bytes += qitem.size;
+  }
+  while ((walk = gst_queue_array_pop_head_struct (rest)))
+    gst_queue_array_push_tail_struct (queue->queue, walk);
+  gst_queue_array_free (rest);
+
+  /* the output did not get further than the first buffer put back */
+  timestamp = GST_BUFFER_DTS_OR_PTS (buffers[0]);
+  if (GST_CLOCK_TIME_IS_VALID (timestamp)) {
+    queue->src_segment.position = timestamp;
+    queue->src_tainted = TRUE;
+    update_time_level (queue);
+  }
+}
+
+/* dequeue the buffers that directly follow @buffer in the queue, within the
+ * batch-push limits, with QUEUE_LOCK. Returns %NULL when there are none */
+static GstBufferList *
+gst_queue_locked_dequeue_buffer_list (GstQueue * queue, GstBuffer * buffer)
+{
+  GstBufferList *buffer_list = NULL;
+  GstQueueItem *qitem;
+  GstClockTime first_ts, ts;
+  guint64 bytes;
+
+  first_ts = GST_BUFFER_DTS_OR_PTS (buffer);
+  bytes = gst_buffer_get_size (buffer);
+
+  while ((qitem = gst_queue_array_peek_head_struct (queue->queue))) {
+    if (qitem->is_query || !GST_IS_BUFFER (qitem->item))
+      break;
+
+    if (queue->batch_push_max_bytes > 0 &&
+        bytes + qitem->size > queue->batch_push_max_bytes)
+      break;
+
+    ts = GST_BUFFER_DTS_OR_PTS (qitem->item);
+    if (queue->batch_push_max_time > 0 && GST_CLOCK_TIME_IS_VALID (first_ts)
+        && GST_CLOCK_TIME_IS_VALID (ts) && ts >= first_ts
+        && ts - first_ts >= queue->batch_push_max_time)
+      break;
+
+    if (buffer_list == NULL) {
+      buffer_list = gst_buffer_list_new ();
+      gst_buffer_list_add (buffer_list, buffer);
+    }
+    bytes += qitem->size;
+    gst_buffer_list_add (buffer_list,
+        GST_BUFFER_CAST (gst_queue_locked_dequeue_item (queue)));
+  }
+  if (buffer_list != NULL) {
+    GST_CAT_LOG_OBJECT (queue_dataflow, queue,
+        "batched %u buffers in list %p", gst_buffer_list_length (buffer_list),
+        buffer_list);
+    GST_QUEUE_SIGNAL_DEL (queue);
+  }
+
+  return buffer_list;
+}
+
 static GstFlowReturn
 gst_queue_handle_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
 {
@@ -1412,6 +1652,8 @@ next:
   if (GST_IS_BUFFER (data) || is_list) {
     if (!is_list) {
       GstBuffer *buffer;
+      GstBuffer *batch[QUEUE_MAX_BATCH];
+      guint n_batch = 0, i;
 
       buffer = GST_BUFFER_CAST (data);
 
@@ -1427,8 +1669,42 @@ next:
         queue->head_needs_discont = FALSE;
       }
 
+      if (queue->batch_push) {
+        GstBufferList *buffer_list;
+
+        buffer_list = gst_queue_locked_dequeue_buffer_list (queue, buffer);
+        if (buffer_list != NULL) {
+          GST_QUEUE_MUTEX_UNLOCK (queue);
+          result = gst_pad_push_list (queue->srcpad, buffer_list);
+          goto pushed;
+        }
+      } else if (queue->wakeup_threshold > 1) {
+        /* take the buffers right behind this one along, so that we don't
+         * need to take the lock again for each of them */
+        n_batch = gst_queue_locked_dequeue_buffers (queue, batch,
+            queue->wakeup_threshold - 1);
+      }
+
       GST_QUEUE_MUTEX_UNLOCK (queue);
       result = gst_pad_push (queue->srcpad, buffer);
+
+      for (i = 0; i < n_batch && result == GST_FLOW_OK; i++)
+        result = gst_pad_push (queue->srcpad, batch[i]);
+
+      /* the rest of the batch was never pushed, it stays queued like it
+       * would have without batching. Only flushing and EOS drop it, like
+       * they drop everything else that is queued. */
+      if (i < n_batch) {
+        GST_QUEUE_MUTEX_LOCK (queue);
+        if (result == GST_FLOW_FLUSHING || result == GST_FLOW_EOS ||
+            queue->srcresult == GST_FLOW_FLUSHING) {
+          for (; i < n_batch; i++)
+            gst_buffer_unref (batch[i]);
+        } else {
+          gst_queue_locked_requeue_buffers (queue, batch + i, n_batch - i);
+        }
+        GST_QUEUE_MUTEX_UNLOCK (queue);
+      }
     } else {
       GstBufferList *buffer_list;
 
@@ -1444,6 +1720,7 @@ next:
       result = gst_pad_push_list (queue->srcpad, buffer_list);
     }
 
+  pushed:
     /* need to check for srcresult here as well */
     GST_QUEUE_MUTEX_LOCK_CHECK (queue, out_flushing);
 
@@ -1887,6 +2164,23 @@ gst_queue_set_property (GObject * object,
     case PROP_FLUSH_ON_EOS:
       queue->flush_on_eos = g_value_get_boolean (value);
       break;
+    case PROP_WAKEUP_THRESHOLD:
+      queue->wakeup_threshold = g_value_get_uint (value);
+      QUEUE_THRESHOLD_CHANGE (queue);
+      break;
+    case PROP_WAKEUP_TIMEOUT:
+      queue->wakeup_timeout = g_value_get_uint64 (value);
+      QUEUE_THRESHOLD_CHANGE (queue);
+      break;
+    case PROP_BATCH_PUSH:
+      queue->batch_push = g_value_get_boolean (value);
+      break;
+    case PROP_BATCH_PUSH_MAX_BYTES:
+      queue->batch_push_max_bytes = g_value_get_uint (value);
+      break;
+    case PROP_BATCH_PUSH_MAX_TIME:
+      queue->batch_push_max_time = g_value_get_uint64 (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1946,6 +2240,21 @@ gst_queue_get_property (GObject * object,
     case PROP_FLUSH_ON_EOS:
       g_value_set_boolean (value, queue->flush_on_eos);
       break;
+    case PROP_WAKEUP_THRESHOLD:
+      g_value_set_uint (value, queue->wakeup_threshold);
+      break;
+    case PROP_WAKEUP_TIMEOUT:
+      g_value_set_uint64 (value, queue->wakeup_timeout);
+      break;
+    case PROP_BATCH_PUSH:
+      g_value_set_boolean (value, queue->batch_push);
+      break;
+    case PROP_BATCH_PUSH_MAX_BYTES:
+      g_value_set_uint (value, queue->batch_push_max_bytes);
+      break;
+    case PROP_BATCH_PUSH_MAX_TIME:
+      g_value_set_uint64 (value, queue->batch_push_max_time);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -142,6 +142,13 @@ struct _GstQueue {
   GstQuery *last_handled_query;
 
   gboolean flush_on_eos; /* flush on EOS */
+
+  guint wakeup_threshold;     /* buffers needed to wake up the loop */
+  GstClockTime wakeup_timeout; /* max. time the loop sleeps with data queued */
+
+  gboolean batch_push;          /* push queued buffers as buffer lists */
+  guint batch_push_max_bytes;
+  GstClockTime batch_push_max_time;
 };
 
 struct _GstQueueClass {
@@ -55,6 +55,9 @@
 #include "config.h"
 #endif
 
+/* for memfd_create() */
+#define _GNU_SOURCE 1
+
 #include "gstqueue2.h"
 
 #include <glib/gstdio.h>
@@ -74,10 +77,15 @@
 #include <unistd.h>
 #endif
 
-#ifdef __BIONIC__               /* Android */
+#if defined (__BIONIC__) || defined (HAVE_POSIX_FADVISE)
 #include <fcntl.h>
 #endif
 
+#if defined (HAVE_SYS_MMAN_H) && defined (HAVE_MEMFD_CREATE)
+#include <sys/mman.h>
+#define USE_RING_MMAP 1
+#endif
+
 static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
@@ -99,6 +107,7 @@ enum
 
 /* other defines */
 #define DEFAULT_BUFFER_SIZE 4096
+#define PREFETCH_SIZE (256 * 1024)
 #define QUEUE_IS_USING_TEMP_FILE(queue) ((queue)->temp_template != NULL)
 #define QUEUE_IS_USING_RING_BUFFER(queue) ((queue)->ring_buffer_max_size != 0)  /* for consistency with the above macro */
 #define QUEUE_IS_USING_QUEUE(queue) (!QUEUE_IS_USING_TEMP_FILE(queue) && !QUEUE_IS_USING_RING_BUFFER (queue))
@@ -120,6 +129,10 @@ enum
 #define DEFAULT_RING_BUFFER_MAX_SIZE 0
 #define DEFAULT_EOS                FALSE
 
+/* how long the writer waits for downstream to release ring buffer data
+ * before it continues in a copy of the ring */
+#define RING_RELEASE_TIMEOUT (100 * G_TIME_SPAN_MILLISECOND)
+
 enum
 {
   PROP_0,
@@ -220,6 +233,19 @@ enum
   STATUS (queue, q->sinkpad, "received DEL");                           \
 } G_STMT_END
 
+/* held ring data is released without the queue lock, so a wakeup can be
+ * missed and the wait is only until @deadline */
+#define GST_QUEUE2_WAIT_RING_CHECK(q, deadline, res, label) G_STMT_START { \
+  STATUS (queue, q->sinkpad, "wait for ring release");                  \
+  q->waiting_del = TRUE;                                                \
+  g_cond_wait_until (&q->item_del, &q->qlock, deadline);                \
+  q->waiting_del = FALSE;                                               \
+  if (res != GST_FLOW_OK) {                                             \
+    STATUS (queue, q->sinkpad, "received ring wakeup");                 \
+    goto label;                                                         \
+  }                                                                     \
+} G_STMT_END
+
 #define GST_QUEUE2_WAIT_ADD_CHECK(q, res, label) G_STMT_START {         \
   STATUS (queue, q->srcpad, "wait for ADD");                            \
   q->waiting_add = TRUE;                                                \
@@ -299,6 +325,8 @@ static gboolean gst_queue2_sink_activate_mode (GstPad * pad, GstObject * parent,
 static GstStateChangeReturn gst_queue2_change_state (GstElement * element,
     GstStateChange transition);
 
+static void gst_queue2_free_ring_buffer (GstQueue2 * queue);
+
 static gboolean gst_queue2_is_empty (GstQueue2 * queue);
 static gboolean gst_queue2_is_filled (GstQueue2 * queue);
 
@@ -558,6 +586,8 @@ gst_queue2_init (GstQueue2 * queue)
   queue->temp_template = NULL;
   queue->temp_location = NULL;
   queue->temp_remove = DEFAULT_TEMP_REMOVE;
+  queue->temp_fd = -1;
+  g_cond_init (&queue->prefetch_cond);
 
   queue->ring_buffer = NULL;
   queue->ring_buffer_max_size = DEFAULT_RING_BUFFER_MAX_SIZE;
@@ -594,6 +624,8 @@ gst_queue2_finalize (GObject * object)
   g_cond_clear (&queue->item_add);
   g_cond_clear (&queue->item_del);
   g_cond_clear (&queue->query_handled);
+  g_cond_clear (&queue->prefetch_cond);
+  gst_queue2_free_ring_buffer (queue);
   g_timer_destroy (queue->in_timer);
   g_timer_destroy (queue->out_timer);
 
@@ -655,6 +687,29 @@ find_range (GstQueue2 * queue, guint64 offset)
   return range;
 }
 
+/* Forget what was read ahead from [@offset, @offset + @length) because it is
+ * about to be written again, including what the prefetch thread is reading
+ * right now. Must be called with the lock. */
+static void
+gst_queue2_prefetch_invalidate (GstQueue2 * queue, guint64 offset,
+    guint64 length)
+{
+  if (queue->prefetch_thread == NULL || length == 0)
+    return;
+
+  if (offset < queue->prefetch_read_end &&
+      offset + length > queue->prefetch_read_offset)
+    queue->prefetch_cookie++;
+
+  if (queue->prefetch_size > 0 &&
+      offset < queue->prefetch_offset + queue->prefetch_size &&
+      offset + length > queue->prefetch_offset) {
+    GST_LOG_OBJECT (queue, "dropping data read ahead from %" G_GUINT64_FORMAT,
+        queue->prefetch_offset);
+    queue->prefetch_size = 0;
+  }
+}
+
 static void
 update_cur_level (GstQueue2 * queue, GstQueue2Range * range)
 {
@@ -684,6 +739,11 @@ add_range (GstQueue2 * queue, guint64 offset, gboolean update_existing)
     if (update_existing && range->writing_pos != offset) {
       GST_DEBUG_OBJECT (queue, "updating range writing position to "
           "%" G_GUINT64_FORMAT, offset);
+      /* the data after the new position will be written again, and a request
+       * may have been clamped to the old position */
+      gst_queue2_prefetch_invalidate (queue, offset,
+          range->writing_pos - MIN (offset, range->writing_pos));
+      queue->prefetch_request = G_MAXUINT64;
       range->writing_pos = offset;
     }
   } else {
@@ -1388,57 +1448,421 @@ gst_queue2_have_data (GstQueue2 * queue, guint64 offset, guint length)
   return FALSE;
 }
 
-#ifdef HAVE_FSEEKO
-#define FSEEK_FILE(file,offset)  (fseeko (file, (off_t) offset, SEEK_SET) != 0)
-#elif defined (G_OS_UNIX) || defined (G_OS_WIN32)
-#define FSEEK_FILE(file,offset)  (lseek (fileno (file), (off_t) offset, SEEK_SET) == (off_t) -1)
+/* Positional I/O on the temp file. Without pread/pwrite, the file offset is
+ * moved first, which is only safe because all users hold the queue lock and
+ * there is no prefetch thread then. */
+static gssize
+gst_queue2_pread (gint fd, guint8 * dst, gsize length, guint64 offset)
+{
+  gssize res;
+
+#ifdef HAVE_PREAD
+  do {
+    res = pread (fd, dst, length, (off_t) offset);
+  } while (res < 0 && errno == EINTR);
 #else
-#define FSEEK_FILE(file,offset)  (fseek (file, offset, SEEK_SET) != 0)
+  if (lseek (fd, (off_t) offset, SEEK_SET) == (off_t) - 1)
+    return -1;
+  do {
+    res = read (fd, dst, length);
+  } while (res < 0 && errno == EINTR);
+#endif
+
+  return res;
+}
+
+static gboolean
+gst_queue2_pwrite (gint fd, const guint8 * src, gsize length, guint64 offset)
+{
+  gssize res;
+
+#ifndef HAVE_PWRITE
+  if (lseek (fd, (off_t) offset, SEEK_SET) == (off_t) - 1)
+    return FALSE;
 #endif
 
+  while (length > 0) {
+#ifdef HAVE_PWRITE
+    res = pwrite (fd, src, length, (off_t) offset);
+#else
+    res = write (fd, src, length);
+#endif
+    if (res < 0) {
+      if (errno == EINTR)
+        continue;
+      return FALSE;
+    }
+    src += res;
+    length -= res;
+    offset += res;
+  }
+  return TRUE;
+}
+
+/* The memory of the ring buffer. Output buffers wrap the part of the ring
+ * they cover instead of copying it, so the ring is refcounted and the parts
+ * that are still used downstream are kept in @held, where the writer must
+ * not write. When downstream keeps them for too long, the writer continues
+ * in a copy and the old ring goes away with the last buffer using it.
+ *
+ * Where possible, the ring is a memfd that is mapped twice in a row so that
+ * data wrapping around the end is contiguous in memory. Otherwise only data
+ * that does not wrap can be wrapped, the rest is copied. */
+struct _GstQueue2Ring
+{
+  gint refcount;
+  guint8 *data;
+  gsize size;
+  gboolean mapped;
+
+  GMutex lock;
+  GQueue held;                  /* of GstQueue2RingRegion */
+};
+
+typedef struct
+{
+  GstQueue2 *queue;             /* woken up when the region is released */
+  GstQueue2Ring *ring;
+  guint64 start;                /* offset in the ring */
+  guint64 size;
+} GstQueue2RingRegion;
+
+#ifdef USE_RING_MMAP
+static gboolean
+gst_queue2_ring_map (GstQueue2Ring * ring)
+{
+  guint8 *addr;
+  gint fd;
+
+  if (ring->size % getpagesize () != 0)
+    return FALSE;
+
+  fd = memfd_create ("queue2-ring", MFD_CLOEXEC);
+  if (fd < 0)
+    return FALSE;
+  if (ftruncate (fd, ring->size) < 0)
+    goto failed;
+
+  /* reserve twice the size and map the memory in both halves */
+  addr = mmap (NULL, 2 * ring->size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS,
+      -1, 0);
+  if (addr == MAP_FAILED)
+    goto failed;
+  if (mmap (addr, ring->size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+          fd, 0) == MAP_FAILED
+      || mmap (addr + ring->size, ring->size, PROT_READ | PROT_WRITE,
+          MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+    munmap (addr, 2 * ring->size);
+    goto failed;
+  }
+  close (fd);
+
+  ring->data = addr;
+  ring->mapped = TRUE;
+
+  return TRUE;
+
+failed:
+  {
+    close (fd);
+    return FALSE;
+  }
+}
+#endif
+
+static GstQueue2Ring *
+gst_queue2_ring_new (gsize size)
+{
+  GstQueue2Ring *ring;
+
+  ring = g_slice_new0 (GstQueue2Ring);
+  ring->refcount = 1;
+  ring->size = size;
+  g_mutex_init (&ring->lock);
+  g_queue_init (&ring->held);
+
+#ifdef USE_RING_MMAP
+  if (gst_queue2_ring_map (ring))
+    return ring;
+#endif
+
+  ring->data = g_try_malloc (size);
+  if (ring->data == NULL) {
+    g_mutex_clear (&ring->lock);
+    g_slice_free (GstQueue2Ring, ring);
+    return NULL;
+  }
+  return ring;
+}
+
+static void
+gst_queue2_ring_unref (GstQueue2Ring * ring)
+{
+  if (!g_atomic_int_dec_and_test (&ring->refcount))
+    return;
+
+#ifdef USE_RING_MMAP
+  if (ring->mapped)
+    munmap (ring->data, 2 * ring->size);
+  else
+#endif
+    g_free (ring->data);
+
+  g_mutex_clear (&ring->lock);
+  g_slice_free (GstQueue2Ring, ring);
+}
+
+/* Keep the ring of @queue from being written at @start. The region starts
+ * out empty and grows while the data is read. */
+static GstQueue2RingRegion *
+gst_queue2_ring_hold (GstQueue2 * queue, guint64 start)
+{
+  GstQueue2Ring *ring = queue->ring;
+  GstQueue2RingRegion *region;
+
+  region = g_slice_new (GstQueue2RingRegion);
+  region->queue = gst_object_ref (queue);
+  region->ring = ring;
+  region->start = start;
+  region->size = 0;
+  g_atomic_int_inc (&ring->refcount);
+
+  g_mutex_lock (&ring->lock);
+  g_queue_push_tail (&ring->held, region);
+  g_mutex_unlock (&ring->lock);
+
+  return region;
+}
+
+static void
+gst_queue2_ring_grow (GstQueue2RingRegion * region, guint64 size)
+{
+  g_mutex_lock (&region->ring->lock);
+  region->size += size;
+  g_mutex_unlock (&region->ring->lock);
+}
+
+/* Called when downstream is done with the data. This can happen in any
+ * thread, possibly with the queue lock held, so only the ring lock is taken
+ * and the writer is woken up without the queue lock. The writer only waits
+ * for a while to not depend on that. */
+static void
+gst_queue2_ring_release (GstQueue2RingRegion * region)
+{
+  GstQueue2 *queue = region->queue;
+  GstQueue2Ring *ring = region->ring;
+
+  g_mutex_lock (&ring->lock);
+  g_queue_remove (&ring->held, region);
+  g_mutex_unlock (&ring->lock);
+  g_cond_broadcast (&queue->item_del);
+
+  g_slice_free (GstQueue2RingRegion, region);
+  gst_queue2_ring_unref (ring);
+  gst_object_unref (queue);
+}
+
+/* Returns how much of @size bytes can be written at @pos without touching
+ * held data. */
+static guint64
+gst_queue2_ring_writable (GstQueue2Ring * ring, guint64 pos, guint64 size)
+{
+  GList *l;
+
+  g_mutex_lock (&ring->lock);
+  for (l = ring->held.head; l && size > 0; l = l->next) {
+    GstQueue2RingRegion *region = l->data;
+    guint64 dist;
+
+    if (region->size == 0)
+      continue;
+
+    /* inside the region */
+    if ((pos + ring->size - region->start) % ring->size < region->size)
+      size = 0;
+
+    /* up to the start of the region */
+    dist = (region->start + ring->size - pos) % ring->size;
+    size = MIN (size, dist);
+  }
+  g_mutex_unlock (&ring->lock);
+
+  return size;
+}
+
+/* Downstream keeps data the writer has to overwrite. Continue in a copy of
+ * the ring, the old memory stays around for as long as it is used. Must be
+ * called with the lock. */
+static gboolean
+gst_queue2_ring_replace (GstQueue2 * queue)
+{
+  GstQueue2Ring *ring;
+
+  ring = gst_queue2_ring_new (queue->ring->size);
+  if (ring == NULL)
+    return FALSE;
+
+  GST_DEBUG_OBJECT (queue, "ring buffer data is held downstream, copying "
+      "%" G_GSIZE_FORMAT " bytes to new memory", ring->size);
+  memcpy (ring->data, queue->ring->data, ring->size);
+
+  gst_queue2_ring_unref (queue->ring);
+  queue->ring = ring;
+  queue->ring_buffer = ring->data;
+
+  return TRUE;
+}
+
+/* Wrap @size bytes of @region in a buffer, copying them when they wrap
+ * around the end of a ring that is not mapped twice. Takes ownership of
+ * @region. */
+static GstBuffer *
+gst_queue2_ring_wrap (GstQueue2RingRegion * region, guint size)
+{
+  GstQueue2Ring *ring = region->ring;
+  GstBuffer *buf;
+
+  size = MIN (size, region->size);
+
+  if (ring->mapped || region->start + size <= ring->size) {
+    buf = gst_buffer_new ();
+    gst_buffer_append_memory (buf,
+        gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY,
+            ring->data + region->start, size, 0, size, region,
+            (GDestroyNotify) gst_queue2_ring_release));
+  } else {
+    guint block_one = ring->size - region->start;
+
+    buf = gst_buffer_new_allocate (NULL, size, NULL);
+    gst_buffer_fill (buf, 0, ring->data + region->start, block_one);
+    gst_buffer_fill (buf, block_one, ring->data, size - block_one);
+    gst_queue2_ring_release (region);
+  }
+  return buf;
+}
+
+/* The prefetch thread reads the temp file ahead of the reading position, so
+ * that the streaming thread can take the data from memory instead of going
+ * to the disk while holding the queue lock. Only used when the temp file is
+ * not a ring buffer, then everything that was written stays valid until the
+ * file is truncated. */
+static gpointer
+gst_queue2_prefetch_loop (GstQueue2 * queue)
+{
+  guint64 offset, limit;
+  guint cookie;
+  gssize res;
+
+  GST_QUEUE2_MUTEX_LOCK (queue);
+  while (queue->prefetch_running) {
+    if (queue->prefetch_request == G_MAXUINT64) {
+      g_cond_wait (&queue->prefetch_cond, &queue->qlock);
+      continue;
+    }
+    offset = queue->prefetch_request;
+    limit = MIN (offset + PREFETCH_SIZE, queue->prefetch_limit);
+    cookie = queue->prefetch_cookie;
+    queue->prefetch_request = G_MAXUINT64;
+    queue->prefetch_read_offset = offset;
+    queue->prefetch_read_end = limit;
+    GST_QUEUE2_MUTEX_UNLOCK (queue);
+
+    GST_LOG_OBJECT (queue, "prefetching %" G_GUINT64_FORMAT " bytes from %"
+        G_GUINT64_FORMAT, limit - offset, offset);
+    res = gst_queue2_pread (queue->temp_fd, queue->prefetch_spare,
+        limit - offset, offset);
+#ifdef HAVE_POSIX_FADVISE
+    /* and let the kernel start on the block after that */
+    if (res > 0)
+      posix_fadvise (queue->temp_fd, offset + res, PREFETCH_SIZE,
+          POSIX_FADV_WILLNEED);
+#endif
+
+    GST_QUEUE2_MUTEX_LOCK (queue);
+    queue->prefetch_read_offset = queue->prefetch_read_end = 0;
+    if (res > 0 && cookie == queue->prefetch_cookie) {
+      guint8 *data = queue->prefetch_data;
+
+      queue->prefetch_data = queue->prefetch_spare;
+      queue->prefetch_spare = data;
+      queue->prefetch_offset = offset;
+      queue->prefetch_size = res;
+    }
+  }
+  GST_QUEUE2_MUTEX_UNLOCK (queue);
+
+  return NULL;
+}
+
+/* Ask for the data after @offset when the reading position gets close to
+ * the end of what was read ahead. Only the range that contains @offset was
+ * written, what follows it is a hole in the file. Must be called with the
+ * lock. */
+static void
+gst_queue2_prefetch_from (GstQueue2 * queue, guint64 offset)
+{
+  GstQueue2Range *range;
+
+  if (queue->prefetch_thread == NULL)
+    return;
+
+  if (offset >= queue->prefetch_offset &&
+      offset < queue->prefetch_offset + queue->prefetch_size / 2)
+    return;
+
+  for (range = queue->ranges; range; range = range->next) {
+    if (offset >= range->offset && offset < range->writing_pos)
+      break;
+  }
+  if (range == NULL)
+    return;
+
+  queue->prefetch_request = offset;
+  queue->prefetch_limit = range->writing_pos;
+  g_cond_signal (&queue->prefetch_cond);
+}
+
 static GstFlowReturn
 gst_queue2_read_data_at_offset (GstQueue2 * queue, guint64 offset, guint length,
     guint8 * dst, gint64 * read_return)
 {
   guint8 *ring_buffer;
-  size_t res;
+  gssize res;
 
   ring_buffer = queue->ring_buffer;
 
-  if (QUEUE_IS_USING_TEMP_FILE (queue) && FSEEK_FILE (queue->temp_file, offset))
-    goto seek_failed;
-
   /* this should not block */
   GST_LOG_OBJECT (queue, "Reading %d bytes from offset %" G_GUINT64_FORMAT,
       length, offset);
   if (QUEUE_IS_USING_TEMP_FILE (queue)) {
-    res = fread (dst, 1, length, queue->temp_file);
+    if (queue->prefetch_size > 0 && offset >= queue->prefetch_offset &&
+        offset < queue->prefetch_offset + queue->prefetch_size) {
+      /* already read ahead */
+      res = MIN (length, queue->prefetch_offset + queue->prefetch_size -
+          offset);
+      memcpy (dst, queue->prefetch_data + (offset - queue->prefetch_offset),
+          res);
+    } else {
+      res = gst_queue2_pread (queue->temp_fd, dst, length, offset);
+      if (res < 0)
+        goto could_not_read;
+    }
+    gst_queue2_prefetch_from (queue, offset + res);
   } else {
     memcpy (dst, ring_buffer + offset, length);
     res = length;
   }
 
-  GST_LOG_OBJECT (queue, "read %" G_GSIZE_FORMAT " bytes", res);
+  GST_LOG_OBJECT (queue, "read %" G_GSSIZE_FORMAT " bytes", res);
 
-  if (G_UNLIKELY (res < length)) {
-    if (!QUEUE_IS_USING_TEMP_FILE (queue))
-      goto could_not_read;
-    /* check for errors or EOF */
-    if (ferror (queue->temp_file))
-      goto could_not_read;
-    if (feof (queue->temp_file) && length > 0)
-      goto eos;
-  }
+  /* hitting the end of the file */
+  if (G_UNLIKELY (res == 0 && length > 0))
+    goto eos;
 
   *read_return = res;
 
   return GST_FLOW_OK;
 
-seek_failed:
-  {
-    GST_ELEMENT_ERROR (queue, RESOURCE, SEEK, (NULL), GST_ERROR_SYSTEM);
-    return GST_FLOW_ERROR;
-  }
 could_not_read:
   {
     GST_ELEMENT_ERROR (queue, RESOURCE, READ, (NULL), GST_ERROR_SYSTEM);
@@ -1451,6 +1875,21 @@ eos:
   }
 }
 
+static void
+gst_queue2_create_read_cleanup (GstBuffer * buf, GstMapInfo * info,
+    GstBuffer * provided, GstQueue2RingRegion * region, GstBuffer * head)
+{
+  if (buf) {
+    gst_buffer_unmap (buf, info);
+    if (provided == NULL)
+      gst_buffer_unref (buf);
+  }
+  if (region)
+    gst_queue2_ring_release (region);
+  if (head)
+    gst_buffer_unref (head);
+}
+
 static GstFlowReturn
 gst_queue2_create_read (GstQueue2 * queue, guint64 offset, guint length,
     GstBuffer ** buffer)
@@ -1464,16 +1903,27 @@ gst_queue2_create_read (GstQueue2 * queue, guint64 offset, guint length,
   guint64 max_size;
   guint64 rpos;
   GstFlowReturn ret = GST_FLOW_OK;
+  GstQueue2RingRegion *region = NULL;
+  GstBuffer *head = NULL;
+  gboolean zero_copy;
+
+  /* wrap the memory of the ring buffer instead of copying from it when the
+   * caller did not provide a buffer */
+  zero_copy = *buffer == NULL && queue->ring != NULL;
+
+  buf = NULL;
+  data = NULL;
+  if (!zero_copy) {
+    /* allocate the output buffer of the requested size */
+    if (*buffer == NULL)
+      buf = gst_buffer_new_allocate (NULL, length, NULL);
+    else
+      buf = *buffer;
 
-  /* allocate the output buffer of the requested size */
-  if (*buffer == NULL)
-    buf = gst_buffer_new_allocate (NULL, length, NULL);
-  else
-    buf = *buffer;
-
-  if (!gst_buffer_map (buf, &info, GST_MAP_WRITE))
-    goto buffer_write_fail;
-  data = info.data;
+    if (!gst_buffer_map (buf, &info, GST_MAP_WRITE))
+      goto buffer_write_fail;
+    data = info.data;
+  }
 
   GST_DEBUG_OBJECT (queue, "Reading %u bytes from %" G_GUINT64_FORMAT, length,
       offset);
@@ -1566,17 +2016,33 @@ gst_queue2_create_read (GstQueue2 * queue, guint64 offset, guint length,
     while (read_length > 0) {
       gint64 read_return;
 
-      ret =
-          gst_queue2_read_data_at_offset (queue, file_offset, block_length,
-          data, &read_return);
-      if (ret != GST_FLOW_OK)
-        goto read_error;
+      if (zero_copy) {
+        /* the writer moved on to a copy of the ring while we waited, what
+         * was read so far is only still valid in the old one */
+        if (region && region->ring != queue->ring) {
+          head = head ? gst_buffer_append (head,
+              gst_queue2_ring_wrap (region, region->size)) :
+              gst_queue2_ring_wrap (region, region->size);
+          region = NULL;
+        }
+        /* the data stays where it is, keep it from being overwritten */
+        if (region == NULL)
+          region = gst_queue2_ring_hold (queue, file_offset);
+        read_return = block_length;
+        gst_queue2_ring_grow (region, read_return);
+      } else {
+        ret =
+            gst_queue2_read_data_at_offset (queue, file_offset, block_length,
+            data, &read_return);
+        if (ret != GST_FLOW_OK)
+          goto read_error;
+        data += read_return;
+      }
 
       file_offset += read_return;
       if (QUEUE_IS_USING_RING_BUFFER (queue))
         file_offset %= rb_size;
 
-      data += read_return;
       read_length -= read_return;
       block_length = read_length;
       remaining -= read_return;
@@ -1588,8 +2054,17 @@ gst_queue2_create_read (GstQueue2 * queue, guint64 offset, guint length,
     GST_DEBUG_OBJECT (queue, "%u bytes left to read", remaining);
   }
 
-  gst_buffer_unmap (buf, &info);
-  gst_buffer_resize (buf, 0, length);
+  if (zero_copy) {
+    guint head_size = head ? gst_buffer_get_size (head) : 0;
+
+    buf = region ? gst_queue2_ring_wrap (region, length - head_size) :
+        gst_buffer_new ();
+    if (head)
+      buf = gst_buffer_append (head, buf);
+  } else {
+    gst_buffer_unmap (buf, &info);
+    gst_buffer_resize (buf, 0, length);
+  }
 
   GST_BUFFER_OFFSET (buf) = offset;
   GST_BUFFER_OFFSET_END (buf) = offset + length;
@@ -1602,25 +2077,19 @@ gst_queue2_create_read (GstQueue2 * queue, guint64 offset, guint length,
 hit_eos:
   {
     GST_DEBUG_OBJECT (queue, "EOS hit and we don't have any requested data");
-    gst_buffer_unmap (buf, &info);
-    if (*buffer == NULL)
-      gst_buffer_unref (buf);
+    gst_queue2_create_read_cleanup (buf, &info, *buffer, region, head);
     return GST_FLOW_EOS;
   }
 out_flushing:
   {
     GST_DEBUG_OBJECT (queue, "we are flushing");
-    gst_buffer_unmap (buf, &info);
-    if (*buffer == NULL)
-      gst_buffer_unref (buf);
+    gst_queue2_create_read_cleanup (buf, &info, *buffer, region, head);
     return GST_FLOW_FLUSHING;
   }
 read_error:
   {
     GST_DEBUG_OBJECT (queue, "we have a read error");
-    gst_buffer_unmap (buf, &info);
-    if (*buffer == NULL)
-      gst_buffer_unref (buf);
+    gst_queue2_create_read_cleanup (buf, &info, *buffer, region, head);
     return ret;
   }
 buffer_write_fail:
@@ -1679,7 +2148,7 @@ gst_queue2_open_temp_location_file (GstQueue2 * queue)
   gint fd = -1;
   gchar *name = NULL;
 
-  if (queue->temp_file)
+  if (queue->temp_fd != -1)
     goto already_opened;
 
   GST_DEBUG_OBJECT (queue, "opening temp file %s", queue->temp_template);
@@ -1702,15 +2171,27 @@ gst_queue2_open_temp_location_file (GstQueue2 * queue)
   if (fd == -1)
     goto mkstemp_failed;
 
-  /* open the file for update/writing */
-  queue->temp_file = fdopen (fd, "wb+");
-  /* error creating file */
-  if (queue->temp_file == NULL)
-    goto open_failed;
+  queue->temp_fd = fd;
+#ifdef HAVE_POSIX_FADVISE
+  posix_fadvise (fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
 
   g_free (queue->temp_location);
   queue->temp_location = name;
 
+#ifdef HAVE_PREAD
+  if (!QUEUE_IS_USING_RING_BUFFER (queue)) {
+    queue->prefetch_data = g_malloc (PREFETCH_SIZE);
+    queue->prefetch_spare = g_malloc (PREFETCH_SIZE);
+    queue->prefetch_size = 0;
+    queue->prefetch_request = G_MAXUINT64;
+    queue->prefetch_read_offset = queue->prefetch_read_end = 0;
+    queue->prefetch_running = TRUE;
+    queue->prefetch_thread = g_thread_new ("queue2-prefetch",
+        (GThreadFunc) gst_queue2_prefetch_loop, queue);
+  }
+#endif
+
   GST_QUEUE2_MUTEX_UNLOCK (queue);
 
   /* we can't emit the notify with the lock */
@@ -1742,28 +2223,36 @@ mkstemp_failed:
     g_free (name);
     return FALSE;
   }
-open_failed:
-  {
-    GST_ELEMENT_ERROR (queue, RESOURCE, OPEN_READ,
-        (_("Could not open file \"%s\" for reading."), name), GST_ERROR_SYSTEM);
-    g_free (name);
-    if (fd != -1)
-      close (fd);
-    return FALSE;
-  }
 }
 
+/* must be called with MUTEX_LOCK. Will briefly release the lock when stopping
+ * the prefetch thread. */
 static void
 gst_queue2_close_temp_location_file (GstQueue2 * queue)
 {
   /* nothing to do */
-  if (queue->temp_file == NULL)
+  if (queue->temp_fd == -1)
     return;
 
   GST_DEBUG_OBJECT (queue, "closing temp file");
 
-  fflush (queue->temp_file);
-  fclose (queue->temp_file);
+  if (queue->prefetch_thread) {
+    GThread *thread = queue->prefetch_thread;
+
+    queue->prefetch_thread = NULL;
+    queue->prefetch_running = FALSE;
+    g_cond_signal (&queue->prefetch_cond);
+    GST_QUEUE2_MUTEX_UNLOCK (queue);
+    g_thread_join (thread);
+    GST_QUEUE2_MUTEX_LOCK (queue);
+
+    g_free (queue->prefetch_data);
+    g_free (queue->prefetch_spare);
+    queue->prefetch_data = queue->prefetch_spare = NULL;
+    queue->prefetch_size = 0;
+  }
+
+  close (queue->temp_fd);
 
   if (queue->temp_remove) {
     if (remove (queue->temp_location) < 0) {
@@ -1772,19 +2261,33 @@ gst_queue2_close_temp_location_file (GstQueue2 * queue)
     }
   }
 
-  queue->temp_file = NULL;
+  queue->temp_fd = -1;
   clean_ranges (queue);
 }
 
 static void
 gst_queue2_flush_temp_file (GstQueue2 * queue)
 {
-  if (queue->temp_file == NULL)
+  gint res;
+
+  if (queue->temp_fd == -1)
     return;
 
   GST_DEBUG_OBJECT (queue, "flushing temp file");
 
-  queue->temp_file = g_freopen (queue->temp_location, "wb+", queue->temp_file);
+  /* whatever was read ahead is gone now */
+  queue->prefetch_cookie++;
+  queue->prefetch_size = 0;
+  queue->prefetch_request = G_MAXUINT64;
+
+#ifdef G_OS_WIN32
+  res = _chsize_s (queue->temp_fd, 0);
+#else
+  res = ftruncate (queue->temp_fd, 0);
+#endif
+  if (res != 0)
+    GST_WARNING_OBJECT (queue, "Failed to truncate temporary file %s: %s",
+        queue->temp_location, g_strerror (errno));
 }
 
 static void
@@ -1874,6 +2377,7 @@ gst_queue2_create_write (GstQueue2 * queue, GstBuffer * buffer)
   guint64 writing_pos, new_writing_pos;
   GstQueue2Range *range, *prev, *next;
   gboolean do_seek = FALSE;
+  gint64 ring_deadline = 0;
 
   if (QUEUE_IS_USING_RING_BUFFER (queue))
     writing_pos = queue->current->rb_writing_pos;
@@ -1918,6 +2422,27 @@ gst_queue2_create_write (GstQueue2 * queue, GstBuffer * buffer)
        * buffer now */
       to_write = MIN (size, space);
 
+      /* don't overwrite data that is still used downstream, and don't
+       * wait for it forever either */
+      if (queue->ring) {
+        to_write = gst_queue2_ring_writable (queue->ring, writing_pos,
+            to_write);
+        if (to_write == 0) {
+          if (ring_deadline == 0)
+            ring_deadline = g_get_monotonic_time () + RING_RELEASE_TIMEOUT;
+          if (g_get_monotonic_time () < ring_deadline) {
+            GST_QUEUE2_WAIT_RING_CHECK (queue, ring_deadline,
+                queue->sinkresult, out_flushing);
+            continue;
+          }
+          ring_deadline = 0;
+          if (gst_queue2_ring_replace (queue))
+            ring_buffer = queue->ring_buffer;
+          continue;
+        }
+        ring_deadline = 0;
+      }
+
       /* the writing position in the ring buffer after writing (part
        * or all of) the buffer */
       new_writing_pos = (writing_pos + to_write) % rb_size;
@@ -2022,10 +2547,6 @@ gst_queue2_create_write (GstQueue2 * queue, GstBuffer * buffer)
       new_writing_pos = writing_pos + to_write;
     }
 
-    if (QUEUE_IS_USING_TEMP_FILE (queue)
-        && FSEEK_FILE (queue->temp_file, writing_pos))
-      goto seek_failed;
-
     if (new_writing_pos > writing_pos) {
       GST_INFO_OBJECT (queue,
           "writing %u bytes to range [%" G_GUINT64_FORMAT "-%" G_GUINT64_FORMAT
@@ -2033,7 +2554,8 @@ gst_queue2_create_write (GstQueue2 * queue, GstBuffer * buffer)
           queue->current->writing_pos, queue->current->rb_writing_pos);
       /* either not using ring buffer or no wrapping, just write */
       if (QUEUE_IS_USING_TEMP_FILE (queue)) {
-        if (fwrite (data, to_write, 1, queue->temp_file) != 1)
+        gst_queue2_prefetch_invalidate (queue, writing_pos, to_write);
+        if (!gst_queue2_pwrite (queue->temp_fd, data, to_write, writing_pos))
           goto handle_error;
       } else {
         memcpy (ring_buffer + writing_pos, data, to_write);
@@ -2078,20 +2600,19 @@ gst_queue2_create_write (GstQueue2 * queue, GstBuffer * buffer)
         GST_INFO_OBJECT (queue, "writing %u bytes", block_one);
         /* write data to end of ring buffer */
         if (QUEUE_IS_USING_TEMP_FILE (queue)) {
-          if (fwrite (data, block_one, 1, queue->temp_file) != 1)
+          if (!gst_queue2_pwrite (queue->temp_fd, data, block_one,
+                  writing_pos))
             goto handle_error;
         } else {
           memcpy (ring_buffer + writing_pos, data, block_one);
         }
       }
 
-      if (QUEUE_IS_USING_TEMP_FILE (queue) && FSEEK_FILE (queue->temp_file, 0))
-        goto seek_failed;
-
       if (block_two > 0) {
         GST_INFO_OBJECT (queue, "writing %u bytes", block_two);
         if (QUEUE_IS_USING_TEMP_FILE (queue)) {
-          if (fwrite (data + block_one, block_two, 1, queue->temp_file) != 1)
+          if (!gst_queue2_pwrite (queue->temp_fd, data + block_one, block_two,
+                  0))
             goto handle_error;
         } else {
           memcpy (ring_buffer, data + block_one, block_two);
@@ -2150,12 +2671,6 @@ out_flushing:
     /* FIXME - GST_FLOW_EOS ? */
     return FALSE;
   }
-seek_failed:
-  {
-    GST_ELEMENT_ERROR (queue, RESOURCE, SEEK, (NULL), GST_ERROR_SYSTEM);
-    gst_buffer_unmap (buffer, &info);
-    return FALSE;
-  }
 handle_error:
   {
     switch (errno) {
@@ -3592,6 +4107,35 @@ gst_queue2_src_activate_push (GstPad * pad, GstObject * parent, gboolean active)
 }
 
 /* pull mode, downstream will call our getrange function */
+/* must be called with MUTEX_LOCK */
+static gboolean
+gst_queue2_alloc_ring_buffer (GstQueue2 * queue)
+{
+  queue->ring = gst_queue2_ring_new (queue->ring_buffer_max_size);
+  if (queue->ring == NULL)
+    return FALSE;
+
+  GST_DEBUG_OBJECT (queue, "allocated %s ring buffer of %" G_GUINT64_FORMAT
+      " bytes", queue->ring->mapped ? "double mapped" : "plain",
+      queue->ring_buffer_max_size);
+  queue->ring_buffer = queue->ring->data;
+
+  return TRUE;
+}
+
+/* must be called with MUTEX_LOCK. The memory stays around for as long as
+ * buffers downstream use it. */
+static void
+gst_queue2_free_ring_buffer (GstQueue2 * queue)
+{
+  if (queue->ring == NULL)
+    return;
+
+  gst_queue2_ring_unref (queue->ring);
+  queue->ring = NULL;
+  queue->ring_buffer = NULL;
+}
+
 static gboolean
 gst_queue2_src_activate_pull (GstPad * pad, GstObject * parent, gboolean active)
 {
@@ -3607,8 +4151,7 @@ gst_queue2_src_activate_pull (GstPad * pad, GstObject * parent, gboolean active)
         /* open the temp file now */
         result = gst_queue2_open_temp_location_file (queue);
       } else if (!queue->ring_buffer) {
-        queue->ring_buffer = g_malloc (queue->ring_buffer_max_size);
-        result = ! !queue->ring_buffer;
+        result = gst_queue2_alloc_ring_buffer (queue);
       } else {
         result = TRUE;
       }
@@ -3682,11 +4225,8 @@ gst_queue2_change_state (GstElement * element, GstStateChange transition)
           if (!gst_queue2_open_temp_location_file (queue))
             ret = GST_STATE_CHANGE_FAILURE;
         } else {
-          if (queue->ring_buffer) {
-            g_free (queue->ring_buffer);
-            queue->ring_buffer = NULL;
-          }
-          if (!(queue->ring_buffer = g_malloc (queue->ring_buffer_max_size)))
+          gst_queue2_free_ring_buffer (queue);
+          if (!gst_queue2_alloc_ring_buffer (queue))
             ret = GST_STATE_CHANGE_FAILURE;
         }
         init_ranges (queue);
@@ -3718,9 +4258,8 @@ gst_queue2_change_state (GstElement * element, GstStateChange transition)
       if (!QUEUE_IS_USING_QUEUE (queue)) {
         if (QUEUE_IS_USING_TEMP_FILE (queue)) {
           gst_queue2_close_temp_location_file (queue);
-        } else if (queue->ring_buffer) {
-          g_free (queue->ring_buffer);
-          queue->ring_buffer = NULL;
+        } else {
+          gst_queue2_free_ring_buffer (queue);
         }
         clean_ranges (queue);
       }
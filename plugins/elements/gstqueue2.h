@@ -46,6 +46,7 @@ typedef struct _GstQueue2 GstQueue2;
 typedef struct _GstQueue2Size GstQueue2Size;
 typedef struct _GstQueue2Class GstQueue2Class;
 typedef struct _GstQueue2Range GstQueue2Range;
+typedef struct _GstQueue2Ring GstQueue2Ring;
 
 /* used to keep track of sizes (current and max) */
 struct _GstQueue2Size
@@ -145,7 +146,20 @@ struct _GstQueue2
   gboolean temp_location_set;
   gchar *temp_location;
   gboolean temp_remove;
-  FILE *temp_file;
+  gint temp_fd;
+  /* read-ahead of the temp file, protected by qlock */
+  GThread *prefetch_thread;
+  gboolean prefetch_running;
+  GCond prefetch_cond;
+  guint64 prefetch_request;     /* offset to read ahead from, or G_MAXUINT64 */
+  guint64 prefetch_limit;       /* end of the range it is in */
+  guint prefetch_cookie;        /* changes when read ahead data is replaced */
+  guint8 *prefetch_data;        /* data read ahead */
+  guint64 prefetch_offset;
+  guint prefetch_size;
+  guint8 *prefetch_spare;       /* block the prefetch thread reads into */
+  guint64 prefetch_read_offset; /* what the prefetch thread is reading */
+  guint64 prefetch_read_end;
   /* list of downloaded areas and the current area */
   GstQueue2Range *ranges;
   GstQueue2Range *current;
@@ -159,6 +173,7 @@ struct _GstQueue2
 
   guint64 ring_buffer_max_size;
   guint8 * ring_buffer;
+  GstQueue2Ring *ring;          /* memory of ring_buffer, shared with buffers */
 
   volatile gint downstream_may_block;
 
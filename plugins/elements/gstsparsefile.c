@@ -24,6 +24,8 @@
 #include <gst/gst.h>
 #include <glib/gstdio.h>
 
+#include <string.h>
+
 #include "gstsparsefile.h"
 
 #ifdef G_OS_WIN32
@@ -36,17 +38,12 @@
 #include <unistd.h>
 #endif
 
-#ifdef HAVE_FSEEKO
-#define FSEEK_FILE(file,offset)  (fseeko (file, (off_t) offset, SEEK_SET) != 0)
-#elif defined (G_OS_UNIX) || defined (G_OS_WIN32)
-#define FSEEK_FILE(file,offset)  (lseek (fileno (file), (off_t) offset, SEEK_SET) == (off_t) -1)
-#else
-#define FSEEK_FILE(file,offset)  (fseek (file, offset, SEEK_SET) != 0)
-#endif
-
 #define GST_SPARSE_FILE_IO_ERROR \
     g_quark_from_static_string("gst-sparse-file-io-error-quark")
 
+/* first line of a saved range index */
+#define INDEX_HEADER "GstSparseFile 1"
+
 static GstSparseFileIOErrorEnum
 gst_sparse_file_io_error_from_errno (gint err_no);
 
@@ -54,85 +51,148 @@ typedef struct _GstSparseRange GstSparseRange;
 
 struct _GstSparseRange
 {
-  GstSparseRange *next;
-
   gsize start;
   gsize stop;
 };
 
-#define RANGE_CONTAINS(r,o) ((r)->start <= (o) && (r)->stop > (o))
+#define RANGE(iter) ((GstSparseRange *) g_sequence_get (iter))
 
 struct _GstSparseFile
 {
   gint fd;
-  FILE *file;
-  gsize current_pos;
 
-  GstSparseRange *ranges;
-  guint n_ranges;
+  /* the written ranges, sorted on start. Ranges never overlap or touch, they
+   * are merged when they do. */
+  GSequence *ranges;
 
-  GstSparseRange *write_range;
-  GstSparseRange *read_range;
+  GSequenceIter *write_range;
+  GSequenceIter *read_range;
 };
 
-static GstSparseRange *
+static void
+range_free (GstSparseRange * range)
+{
+  g_slice_free (GstSparseRange, range);
+}
+
+static gint
+range_compare (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+  const GstSparseRange *ra = a, *rb = b;
+
+  if (ra->start < rb->start)
+    return -1;
+  if (ra->start > rb->start)
+    return 1;
+  return 0;
+}
+
+/* get the last range that starts at or before @offset, or NULL */
+static GSequenceIter *
+find_range_before (GstSparseFile * file, gsize offset)
+{
+  GstSparseRange key;
+  GSequenceIter *iter;
+
+  key.start = offset;
+  /* points to the first range that starts after offset */
+  iter = g_sequence_search (file->ranges, &key, range_compare, NULL);
+  if (g_sequence_iter_is_begin (iter))
+    return NULL;
+
+  return g_sequence_iter_prev (iter);
+}
+
+static GSequenceIter *
 get_write_range (GstSparseFile * file, gsize offset)
 {
-  GstSparseRange *next, *prev, *result = NULL;
+  GSequenceIter *iter;
+  GstSparseRange *range;
 
-  if (file->write_range && file->write_range->stop == offset)
+  if (file->write_range && RANGE (file->write_range)->stop == offset)
     return file->write_range;
 
-  prev = NULL;
-  next = file->ranges;
-  while (next) {
-    if (next->start > offset)
-      break;
+  iter = find_range_before (file, offset);
+  if (iter == NULL || RANGE (iter)->stop < offset) {
+    range = g_slice_new (GstSparseRange);
+    range->start = offset;
+    range->stop = offset;
 
-    if (next->stop >= offset) {
-      result = next;
-      break;
-    }
-    prev = next;
-    next = next->next;
-  }
-  if (result == NULL) {
-    result = g_slice_new0 (GstSparseRange);
-    result->start = offset;
-    result->stop = offset;
-
-    result->next = next;
-    if (prev)
-      prev->next = result;
-    else
-      file->ranges = result;
-
-    file->write_range = result;
+    iter = g_sequence_insert_sorted (file->ranges, range, range_compare, NULL);
     file->read_range = NULL;
-
-    file->n_ranges++;
   }
-  return result;
+  file->write_range = iter;
+
+  return iter;
 }
 
-static GstSparseRange *
+static GSequenceIter *
 get_read_range (GstSparseFile * file, gsize offset, gsize count)
 {
-  GstSparseRange *walk, *result = NULL;
+  GSequenceIter *iter;
+  GstSparseRange *range;
+
+  if (file->read_range) {
+    range = RANGE (file->read_range);
+    if (range->start <= offset && range->stop >= offset + count)
+      return file->read_range;
+  }
+
+  iter = find_range_before (file, offset);
+  if (iter == NULL || RANGE (iter)->stop < offset + count)
+    return NULL;
+
+  file->read_range = iter;
+
+  return iter;
+}
+
+static gssize
+sparse_file_pread (gint fd, gpointer data, gsize count, gsize offset)
+{
+  gssize res;
 
-  if (file->read_range && RANGE_CONTAINS (file->read_range, offset))
-    return file->read_range;
+#ifdef HAVE_PREAD
+  do {
+    res = pread (fd, data, count, (off_t) offset);
+  } while (res < 0 && errno == EINTR);
+#else
+  if (lseek (fd, (off_t) offset, SEEK_SET) == (off_t) - 1)
+    return -1;
+  do {
+    res = read (fd, data, count);
+  } while (res < 0 && errno == EINTR);
+#endif
 
-  for (walk = file->ranges; walk; walk = walk->next) {
-    if (walk->start > offset)
-      break;
+  return res;
+}
 
-    if (walk->stop >= offset + count) {
-      result = walk;
-      break;
+static gboolean
+sparse_file_pwrite (gint fd, const guint8 * data, gsize count, gsize offset)
+{
+  gssize res;
+
+#ifndef HAVE_PWRITE
+  if (lseek (fd, (off_t) offset, SEEK_SET) == (off_t) - 1)
+    return FALSE;
+#endif
+
+  while (count > 0) {
+#ifdef HAVE_PWRITE
+    res = pwrite (fd, data, count, (off_t) offset);
+#else
+    res = write (fd, data, count);
+#endif
+    if (res < 0) {
+      if (errno == EINTR)
+        continue;
+      return FALSE;
     }
+    data += res;
+    count -= res;
+    offset += res;
   }
-  return result;
+  return TRUE;
 }
 
 /**
@@ -150,9 +210,8 @@ gst_sparse_file_new (void)
   GstSparseFile *result;
 
   result = g_slice_new0 (GstSparseFile);
-  result->current_pos = 0;
-  result->ranges = NULL;
-  result->n_ranges = 0;
+  result->fd = -1;
+  result->ranges = g_sequence_new ((GDestroyNotify) range_free);
 
   return result;
 }
@@ -162,7 +221,8 @@ gst_sparse_file_new (void)
  * @file: a #GstSparseFile
  * @fd: a file descriptor
  *
- * Store the data for @file in the file represented with @fd.
+ * Store the data for @file in the file represented with @fd. @file takes
+ * ownership of @fd and closes it in gst_sparse_file_free().
  *
  * Returns: %TRUE when @fd could be set
  *
@@ -174,10 +234,9 @@ gst_sparse_file_set_fd (GstSparseFile * file, gint fd)
   g_return_val_if_fail (file != NULL, FALSE);
   g_return_val_if_fail (fd != 0, FALSE);
 
-  file->file = fdopen (fd, "wb+");
   file->fd = fd;
 
-  return file->file != NULL;
+  return fd != -1;
 }
 
 /**
@@ -191,14 +250,10 @@ gst_sparse_file_clear (GstSparseFile * file)
 {
   g_return_if_fail (file != NULL);
 
-  if (file->file) {
-    fclose (file->file);
-    file->file = fdopen (file->fd, "wb+");
-  }
-  g_slice_free_chain (GstSparseRange, file->ranges, next);
-  file->current_pos = 0;
-  file->ranges = NULL;
-  file->n_ranges = 0;
+  g_sequence_remove_range (g_sequence_get_begin_iter (file->ranges),
+      g_sequence_get_end_iter (file->ranges));
+  file->write_range = NULL;
+  file->read_range = NULL;
 }
 
 /**
@@ -214,11 +269,9 @@ gst_sparse_file_free (GstSparseFile * file)
 {
   g_return_if_fail (file != NULL);
 
-  if (file->file) {
-    fflush (file->file);
-    fclose (file->file);
-  }
-  g_slice_free_chain (GstSparseRange, file->ranges, next);
+  if (file->fd != -1)
+    close (file->fd);
+  g_sequence_free (file->ranges);
   g_slice_free (GstSparseFile, file);
 }
 
@@ -244,31 +297,28 @@ gsize
 gst_sparse_file_write (GstSparseFile * file, gsize offset, gconstpointer data,
     gsize count, gsize * available, GError ** error)
 {
+  GSequenceIter *iter, *next_iter;
   GstSparseRange *range, *next;
   gsize stop;
 
   g_return_val_if_fail (file != NULL, 0);
   g_return_val_if_fail (count != 0, 0);
 
-  if (file->file) {
-    if (file->current_pos != offset) {
-      GST_DEBUG ("seeking to %" G_GSIZE_FORMAT, offset);
-      if (FSEEK_FILE (file->file, offset))
-        goto error;
-    }
-    if (fwrite (data, count, 1, file->file) != 1)
+  if (file->fd != -1) {
+    if (!sparse_file_pwrite (file->fd, data, count, offset))
       goto error;
   }
 
-  file->current_pos = offset + count;
-
   /* update the new stop position in the range */
-  range = get_write_range (file, offset);
+  iter = get_write_range (file, offset);
+  range = RANGE (iter);
   stop = offset + count;
   range->stop = MAX (range->stop, stop);
 
-  /* see if we can merge with next region */
-  while ((next = range->next)) {
+  /* see if we can merge with next regions */
+  next_iter = g_sequence_iter_next (iter);
+  while (!g_sequence_iter_is_end (next_iter)) {
+    next = RANGE (next_iter);
     if (next->start > range->stop)
       break;
 
@@ -277,14 +327,14 @@ gst_sparse_file_write (GstSparseFile * file, gsize offset, gconstpointer data,
         next->start, next->stop);
 
     range->stop = MAX (next->stop, range->stop);
-    range->next = next->next;
 
-    if (file->write_range == next)
+    if (file->write_range == next_iter)
       file->write_range = NULL;
-    if (file->read_range == next)
+    if (file->read_range == next_iter)
       file->read_range = NULL;
-    g_slice_free (GstSparseRange, next);
-    file->n_ranges--;
+    g_sequence_remove (next_iter);
+
+    next_iter = g_sequence_iter_next (iter);
   }
   if (available)
     *available = range->stop - stop;
@@ -326,31 +376,30 @@ gsize
 gst_sparse_file_read (GstSparseFile * file, gsize offset, gpointer data,
     gsize count, gsize * remaining, GError ** error)
 {
-  GstSparseRange *range;
+  GSequenceIter *iter;
   gsize res = 0;
+  gssize r;
 
   g_return_val_if_fail (file != NULL, 0);
   g_return_val_if_fail (count != 0, 0);
 
-  if ((range = get_read_range (file, offset, count)) == NULL)
+  if ((iter = get_read_range (file, offset, count)) == NULL)
     goto no_range;
 
-  if (file->file) {
-    if (file->current_pos != offset) {
-      GST_DEBUG ("seeking from %" G_GSIZE_FORMAT " to %" G_GSIZE_FORMAT,
-          file->current_pos, offset);
-      if (FSEEK_FILE (file->file, offset))
+  if (file->fd != -1) {
+    while (res < count) {
+      r = sparse_file_pread (file->fd, (guint8 *) data + res, count - res,
+          offset + res);
+      if (G_UNLIKELY (r < 0))
         goto error;
+      if (G_UNLIKELY (r == 0))
+        goto eof;
+      res += r;
     }
-    res = fread (data, 1, count, file->file);
-    if (G_UNLIKELY (res < count))
-      goto error;
   }
 
-  file->current_pos = offset + res;
-
   if (remaining)
-    *remaining = range->stop - file->current_pos;
+    *remaining = RANGE (iter)->stop - (offset + count);
 
   return count;
 
@@ -363,15 +412,15 @@ no_range:
   }
 error:
   {
-    if (ferror (file->file)) {
-      g_set_error (error, GST_SPARSE_FILE_IO_ERROR,
-          gst_sparse_file_io_error_from_errno (errno), "Error reading file: %s",
-          g_strerror (errno));
-    } else if (feof (file->file)) {
-      return res;
-    }
+    g_set_error (error, GST_SPARSE_FILE_IO_ERROR,
+        gst_sparse_file_io_error_from_errno (errno), "Error reading file: %s",
+        g_strerror (errno));
     return 0;
   }
+eof:
+  {
+    return res;
+  }
 }
 
 /**
@@ -389,7 +438,7 @@ gst_sparse_file_n_ranges (GstSparseFile * file)
 {
   g_return_val_if_fail (file != NULL, 0);
 
-  return file->n_ranges;
+  return g_sequence_get_length (file->ranges);
 }
 
 /**
@@ -410,27 +459,21 @@ gboolean
 gst_sparse_file_get_range_before (GstSparseFile * file, gsize offset,
     gsize * start, gsize * stop)
 {
-  GstSparseRange *walk, *result = NULL;
+  GSequenceIter *iter;
+  GstSparseRange *result;
 
   g_return_val_if_fail (file != NULL, FALSE);
 
-  for (walk = file->ranges; walk; walk = walk->next) {
-    GST_DEBUG ("start %" G_GSIZE_FORMAT " > %" G_GSIZE_FORMAT,
-        walk->stop, offset);
-    if (walk->start > offset)
-      break;
+  if ((iter = find_range_before (file, offset)) == NULL)
+    return FALSE;
 
-    if (walk->start <= offset)
-      result = walk;
-  }
+  result = RANGE (iter);
+  if (start)
+    *start = result->start;
+  if (stop)
+    *stop = result->stop;
 
-  if (result) {
-    if (start)
-      *start = result->start;
-    if (stop)
-      *stop = result->stop;
-  }
-  return result != NULL;
+  return TRUE;
 }
 
 /**
@@ -451,25 +494,157 @@ gboolean
 gst_sparse_file_get_range_after (GstSparseFile * file, gsize offset,
     gsize * start, gsize * stop)
 {
-  GstSparseRange *walk, *result = NULL;
+  GSequenceIter *iter;
+  GstSparseRange *result;
+
+  g_return_val_if_fail (file != NULL, FALSE);
+
+  /* the range starting before offset when it includes offset, else the first
+   * range after it */
+  iter = find_range_before (file, offset);
+  if (iter == NULL)
+    iter = g_sequence_get_begin_iter (file->ranges);
+  else if (RANGE (iter)->stop <= offset)
+    iter = g_sequence_iter_next (iter);
+
+  if (g_sequence_iter_is_end (iter))
+    return FALSE;
+
+  result = RANGE (iter);
+  if (start)
+    *start = result->start;
+  if (stop)
+    *stop = result->stop;
+
+  return TRUE;
+}
+
+/**
+ * gst_sparse_file_save_index:
+ * @file: a #GstSparseFile
+ * @filename: the file to save the index in
+ * @error: a #GError
+ *
+ * Save the written ranges of @file in @filename so that they can be
+ * restored with gst_sparse_file_load_index() when the data file is opened
+ * again later.
+ *
+ * Returns: %TRUE on success.
+ *
+ * Since: 1.16
+ */
+gboolean
+gst_sparse_file_save_index (GstSparseFile * file, const gchar * filename,
+    GError ** error)
+{
+  GSequenceIter *iter;
+  GstSparseRange *range;
+  GString *str;
+  gboolean res;
+
+  g_return_val_if_fail (file != NULL, FALSE);
+  g_return_val_if_fail (filename != NULL, FALSE);
+
+  str = g_string_new (INDEX_HEADER "\n");
+  for (iter = g_sequence_get_begin_iter (file->ranges);
+      !g_sequence_iter_is_end (iter); iter = g_sequence_iter_next (iter)) {
+    range = RANGE (iter);
+    g_string_append_printf (str, "%" G_GSIZE_FORMAT " %" G_GSIZE_FORMAT "\n",
+        range->start, range->stop);
+  }
+  res = g_file_set_contents (filename, str->str, str->len, error);
+  g_string_free (str, TRUE);
+
+  return res;
+}
+
+/**
+ * gst_sparse_file_load_index:
+ * @file: a #GstSparseFile
+ * @filename: the file to load the index from
+ * @error: a #GError
+ *
+ * Replace the ranges of @file with the ones saved in @filename with
+ * gst_sparse_file_save_index(). Ranges that go past the end of the data
+ * file are clipped.
+ *
+ * Returns: %TRUE on success.
+ *
+ * Since: 1.16
+ */
+gboolean
+gst_sparse_file_load_index (GstSparseFile * file, const gchar * filename,
+    GError ** error)
+{
+  GSequence *ranges = NULL;
+  GstSparseRange *range, *last = NULL;
+  gchar *contents, **lines, *end;
+  gsize start, stop, size = G_MAXSIZE;
+  off_t file_size;
+  guint i;
 
   g_return_val_if_fail (file != NULL, FALSE);
+  g_return_val_if_fail (filename != NULL, FALSE);
+
+  if (!g_file_get_contents (filename, &contents, NULL, error))
+    return FALSE;
 
-  for (walk = file->ranges; walk; walk = walk->next) {
-    GST_DEBUG ("stop %" G_GSIZE_FORMAT " > %" G_GSIZE_FORMAT,
-        walk->stop, offset);
-    if (walk->stop > offset) {
-      result = walk;
+  lines = g_strsplit (contents, "\n", -1);
+  g_free (contents);
+
+  if (lines[0] == NULL || strcmp (lines[0], INDEX_HEADER) != 0)
+    goto invalid_index;
+
+  /* don't claim data that never made it into the file */
+  if (file->fd != -1) {
+    file_size = lseek (file->fd, 0, SEEK_END);
+    if (file_size != (off_t) - 1)
+      size = file_size;
+  }
+
+  ranges = g_sequence_new ((GDestroyNotify) range_free);
+  for (i = 1; lines[i] != NULL; i++) {
+    if (lines[i][0] == '\0')
+      continue;
+
+    start = g_ascii_strtoull (lines[i], &end, 10);
+    if (end == lines[i] || *end != ' ')
+      goto invalid_index;
+    stop = g_ascii_strtoull (end + 1, &end, 10);
+    if (*end != '\0')
+      goto invalid_index;
+    if (start >= stop || (last && start <= last->stop))
+      goto invalid_index;
+
+    if (start >= size)
       break;
-    }
+
+    range = g_slice_new (GstSparseRange);
+    range->start = start;
+    range->stop = MIN (stop, size);
+    g_sequence_append (ranges, range);
+    last = range;
   }
-  if (result) {
-    if (start)
-      *start = result->start;
-    if (stop)
-      *stop = result->stop;
+  g_strfreev (lines);
+
+  g_sequence_free (file->ranges);
+  file->ranges = ranges;
+  file->write_range = NULL;
+  file->read_range = NULL;
+
+  return TRUE;
+
+  /* ERRORS */
+invalid_index:
+  {
+    if (ranges)
+      g_sequence_free (ranges);
+    g_set_error (error, GST_SPARSE_FILE_IO_ERROR,
+        GST_SPARSE_FILE_IO_ERROR_INVALID_ARGUMENT,
+        "Invalid range index in file %s", filename);
+    g_strfreev (lines);
+    return FALSE;
   }
-  return result != NULL;
 }
 
 /* we don't want to rely on libgio just for g_io_error_from_errno() */
@@ -103,6 +103,14 @@ gboolean        gst_sparse_file_get_range_before (GstSparseFile *file, gsize off
 gboolean        gst_sparse_file_get_range_after  (GstSparseFile *file, gsize offset,
                                                   gsize *start, gsize *stop);
 
+gboolean        gst_sparse_file_save_index       (GstSparseFile *file,
+                                                  const gchar *filename,
+                                                  GError **error);
+
+gboolean        gst_sparse_file_load_index       (GstSparseFile *file,
+                                                  const gchar *filename,
+                                                  GError **error);
+
 G_END_DECLS
 
 #endif /* __GST_SPARSE_FILE_H__ */
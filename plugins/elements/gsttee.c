@@ -87,6 +87,7 @@ gst_tee_pull_mode_get_type (void)
 #define DEFAULT_PROP_LAST_MESSAGE	NULL
 #define DEFAULT_PULL_MODE		GST_TEE_PULL_MODE_NEVER
 #define DEFAULT_PROP_ALLOW_NOT_LINKED	FALSE
+#define DEFAULT_PROP_PARALLEL_PUSH	FALSE
 
 enum
 {
@@ -98,6 +99,7 @@ enum
   PROP_PULL_MODE,
   PROP_ALLOC_PAD,
   PROP_ALLOW_NOT_LINKED,
+  PROP_PARALLEL_PUSH,
 };
 
 static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src_%u",
@@ -223,6 +225,11 @@ gst_tee_finalize (GObject * object)
 
   g_free (tee->last_message);
 
+  if (tee->pool) {
+    gst_task_pool_cleanup (tee->pool);
+    gst_object_unref (tee->pool);
+  }
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -286,6 +293,26 @@ gst_tee_class_init (GstTeeClass * klass)
           "all unlinked", DEFAULT_PROP_ALLOW_NOT_LINKED,
           G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstTee:parallel-push
+   *
+   * Push data to all source pads at the same time from a pool of threads
+   * instead of one pad after the other from the streaming thread. tee still
+   * waits for all branches before returning, so a slow branch does not delay
+   * the other branches anymore, only upstream.
+   *
+   * The flow returns are combined like when pushing one pad after the other,
+   * except that all branches get the data even when one of them returns an
+   * error.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_PARALLEL_PUSH,
+      g_param_spec_boolean ("parallel-push", "Parallel push",
+          "Push to all source pads concurrently from a thread pool",
+          DEFAULT_PROP_PARALLEL_PUSH,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_set_static_metadata (gstelement_class,
       "Tee pipe fitting",
       "Generic",
@@ -508,6 +535,9 @@ gst_tee_set_property (GObject * object, guint prop_id, const GValue * value,
     case PROP_ALLOW_NOT_LINKED:
       tee->allow_not_linked = g_value_get_boolean (value);
       break;
+    case PROP_PARALLEL_PUSH:
+      tee->parallel_push = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -544,6 +574,9 @@ gst_tee_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_ALLOW_NOT_LINKED:
       g_value_set_boolean (value, tee->allow_not_linked);
       break;
+    case PROP_PARALLEL_PUSH:
+      g_value_set_boolean (value, tee->parallel_push);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -858,6 +891,188 @@ gst_tee_do_push (GstTee * tee, GstPad * pad, gpointer data, gboolean is_list)
   return res;
 }
 
+struct ParallelPush;
+
+struct ParallelPushCtx
+{
+  gint refcount;
+
+  GstTee *tee;
+  gpointer data;
+  gboolean is_list;
+
+  GMutex lock;
+  GCond cond;
+  guint pending;
+
+  struct ParallelPush *pushes;
+};
+
+struct ParallelPush
+{
+  struct ParallelPushCtx *ctx;
+  GstPad *pad;
+  GstFlowReturn result;
+  gint claimed;
+};
+
+/* the streaming thread and every queued task own a ref, so that a task
+ * that runs after the streaming thread pushed to its pad itself can still
+ * look at it */
+static void
+gst_tee_parallel_push_ctx_unref (struct ParallelPushCtx *ctx)
+{
+  if (!g_atomic_int_dec_and_test (&ctx->refcount))
+    return;
+
+  g_free (ctx->pushes);
+  g_mutex_clear (&ctx->lock);
+  g_cond_clear (&ctx->cond);
+  g_free (ctx);
+}
+
+static void
+gst_tee_parallel_push (struct ParallelPush *push)
+{
+  struct ParallelPushCtx *ctx = push->ctx;
+
+  /* done by the streaming thread already when the pool failed */
+  if (!g_atomic_int_compare_and_exchange (&push->claimed, FALSE, TRUE))
+    return;
+
+  GST_LOG_OBJECT (push->pad, "Starting to push %s %p",
+      ctx->is_list ? "list" : "buffer", ctx->data);
+
+  push->result = gst_tee_do_push (ctx->tee, push->pad, ctx->data, ctx->is_list);
+
+  GST_LOG_OBJECT (push->pad, "Pushing item %p yielded result %s", ctx->data,
+      gst_flow_get_name (push->result));
+
+  g_mutex_lock (&ctx->lock);
+  if (--ctx->pending == 0)
+    g_cond_signal (&ctx->cond);
+  g_mutex_unlock (&ctx->lock);
+}
+
+static void
+gst_tee_parallel_push_func (struct ParallelPush *push)
+{
+  struct ParallelPushCtx *ctx = push->ctx;
+
+  gst_tee_parallel_push (push);
+  gst_tee_parallel_push_ctx_unref (ctx);
+}
+
+/* called with the object lock, which is released. Pushes @data to all pads
+ * at once, the first one from this thread and the others from the pool. */
+static GstFlowReturn
+gst_tee_handle_data_parallel (GstTee * tee, gpointer data, gboolean is_list)
+{
+  struct ParallelPushCtx *ctx;
+  struct ParallelPush *pushes;
+  GstTaskPool *pool;
+  GError *error = NULL;
+  GstFlowReturn ret, cret;
+  GList *pads;
+  guint i, n_pushes;
+
+  if (G_UNLIKELY (tee->pool == NULL)) {
+    tee->pool = gst_task_pool_new ();
+    gst_task_pool_prepare (tee->pool, &error);
+    if (error)
+      goto prepare_failed;
+  }
+  pool = gst_object_ref (tee->pool);
+
+  ctx = g_new0 (struct ParallelPushCtx, 1);
+  ctx->refcount = 1;
+  ctx->tee = tee;
+  ctx->data = data;
+  ctx->is_list = is_list;
+  g_mutex_init (&ctx->lock);
+  g_cond_init (&ctx->cond);
+
+  pushes = g_new (struct ParallelPush, GST_ELEMENT_CAST (tee)->numsrcpads);
+  n_pushes = 0;
+  for (pads = GST_ELEMENT_CAST (tee)->srcpads; pads; pads = pads->next) {
+    pushes[n_pushes].ctx = ctx;
+    pushes[n_pushes].pad = gst_object_ref (pads->data);
+    pushes[n_pushes].result = GST_FLOW_NOT_LINKED;
+    pushes[n_pushes].claimed = FALSE;
+    n_pushes++;
+  }
+  ctx->pushes = pushes;
+  ctx->pending = n_pushes;
+  GST_OBJECT_UNLOCK (tee);
+
+  for (i = 1; i < n_pushes; i++) {
+    g_atomic_int_inc (&ctx->refcount);
+    gst_task_pool_push (pool, (GstTaskPoolFunction) gst_tee_parallel_push_func,
+        &pushes[i], &error);
+    /* the task might not run, or only once a thread becomes free, so push
+     * from here. Should it run later it finds the push done, and a pool
+     * that did not queue it leaks the small context instead of the pads */
+    if (G_UNLIKELY (error)) {
+      GST_WARNING_OBJECT (tee, "could not start thread: %s", error->message);
+      g_clear_error (&error);
+      gst_tee_parallel_push (&pushes[i]);
+    }
+  }
+  gst_tee_parallel_push (&pushes[0]);
+
+  g_mutex_lock (&ctx->lock);
+  while (ctx->pending > 0)
+    g_cond_wait (&ctx->cond, &ctx->lock);
+  g_mutex_unlock (&ctx->lock);
+
+  if (tee->allow_not_linked) {
+    cret = GST_FLOW_OK;
+  } else {
+    cret = GST_FLOW_NOT_LINKED;
+  }
+
+  GST_OBJECT_LOCK (tee);
+  for (i = 0; i < n_pushes; i++) {
+    ret = pushes[i].result;
+
+    /* the pad was released while we pushed, its result does not count */
+    if (GST_TEE_PAD_CAST (pushes[i].pad)->removed)
+      ret = GST_FLOW_NOT_LINKED;
+
+    /* the first fatal error wins */
+    if (G_UNLIKELY (ret != GST_FLOW_OK && ret != GST_FLOW_NOT_LINKED)) {
+      GST_DEBUG_OBJECT (tee, "received error %s", gst_flow_get_name (ret));
+      cret = ret;
+      break;
+    }
+    if (G_LIKELY (ret != GST_FLOW_NOT_LINKED))
+      cret = ret;
+  }
+  GST_OBJECT_UNLOCK (tee);
+
+  for (i = 0; i < n_pushes; i++)
+    gst_object_unref (pushes[i].pad);
+  gst_tee_parallel_push_ctx_unref (ctx);
+  gst_object_unref (pool);
+
+  gst_mini_object_unref (GST_MINI_OBJECT_CAST (data));
+
+  return cret;
+
+  /* ERRORS */
+prepare_failed:
+  {
+    gst_object_unref (tee->pool);
+    tee->pool = NULL;
+    GST_OBJECT_UNLOCK (tee);
+    GST_ELEMENT_ERROR (tee, RESOURCE, FAILED, (NULL),
+        ("Could not prepare thread pool: %s", error->message));
+    g_clear_error (&error);
+    gst_mini_object_unref (GST_MINI_OBJECT_CAST (data));
+    return GST_FLOW_ERROR;
+  }
+}
+
 static void
 clear_pads (GstPad * pad, GstTee * tee)
 {
@@ -911,6 +1126,9 @@ gst_tee_handle_data (GstTee * tee, gpointer data, gboolean is_list)
     return ret;
   }
 
+  if (tee->parallel_push)
+    return gst_tee_handle_data_parallel (tee, data, is_list);
+
   /* mark all pads as 'not pushed on yet' */
   g_list_foreach (pads, (GFunc) clear_pads, tee);
 
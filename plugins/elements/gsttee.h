@@ -81,6 +81,9 @@ struct _GstTee {
   GstPad         *pull_pad;
 
   gboolean        allow_not_linked;
+
+  gboolean        parallel_push;
+  GstTaskPool    *pool;
 };
 
 struct _GstTeeClass {
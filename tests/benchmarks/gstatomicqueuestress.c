@@ -0,0 +1,155 @@
+/* GStreamer
+ * Copyright (C) <2018> GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <gst/gst.h>
+#include <gst/gstatomicqueue.h>
+
+#define MAX_THREADS  64
+#define MAX_BATCH    64
+#define NUM_ITEMS    1000000
+
+static GstAtomicQueue *queue;
+static guint batch;
+static gint remaining;
+
+static gpointer
+run_producer (gpointer user_data)
+{
+  gint n_items = GPOINTER_TO_INT (user_data);
+  gpointer items[MAX_BATCH];
+  gint i, n;
+  guint pushed;
+
+  for (i = 0; i < MAX_BATCH; i++)
+    items[i] = GINT_TO_POINTER (i + 1);
+
+  for (i = 0; i < n_items; i += n) {
+    n = MIN (batch, n_items - i);
+
+    if (batch == 1) {
+      gst_atomic_queue_push (queue, items[0]);
+      continue;
+    }
+
+    pushed = 0;
+    while (pushed < n) {
+      pushed += gst_atomic_queue_push_many (queue, items + pushed, n - pushed);
+      if (pushed < n)
+        g_thread_yield ();
+    }
+  }
+  return NULL;
+}
+
+static gpointer
+run_consumer (gpointer user_data)
+{
+  gpointer items[MAX_BATCH];
+  guint n;
+
+  while (g_atomic_int_get (&remaining) > 0) {
+    if (batch == 1) {
+      n = gst_atomic_queue_pop (queue) != NULL;
+    } else {
+      n = gst_atomic_queue_pop_many (queue, items, batch);
+    }
+    if (n == 0)
+      g_thread_yield ();
+    else
+      g_atomic_int_add (&remaining, -n);
+  }
+  return NULL;
+}
+
+static void
+run_test (const gchar * name, GstAtomicQueue * q, gint num_producers,
+    gint num_consumers)
+{
+  GThread *threads[2 * MAX_THREADS];
+  GstClockTime start, end;
+  GstClockTimeDiff dur;
+  gint t, total;
+
+  queue = q;
+  total = (NUM_ITEMS / num_producers) * num_producers;
+  remaining = total;
+
+  start = gst_util_get_timestamp ();
+  for (t = 0; t < num_consumers; t++)
+    threads[t] = g_thread_new ("consumer", run_consumer, NULL);
+  for (t = 0; t < num_producers; t++)
+    threads[num_consumers + t] = g_thread_new ("producer", run_producer,
+        GINT_TO_POINTER (NUM_ITEMS / num_producers));
+  for (t = 0; t < num_consumers + num_producers; t++)
+    g_thread_join (threads[t]);
+  end = gst_util_get_timestamp ();
+
+  dur = GST_CLOCK_DIFF (start, end);
+  g_print ("*** %-10s batch %2u: total %" GST_TIME_FORMAT " - %.1f Mitems/s\n",
+      name, batch, GST_TIME_ARGS (dur), (gdouble) total * 1000.0 / dur);
+
+  gst_atomic_queue_unref (q);
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  gint num_producers, num_consumers;
+  guint capacity = 1024;
+
+  gst_init (&argc, &argv);
+
+  if (argc < 3 || argc > 5) {
+    g_print ("usage: %s <producers> <consumers> [<batch> [<capacity>]]\n",
+        argv[0]);
+    exit (-1);
+  }
+
+  num_producers = atoi (argv[1]);
+  num_consumers = atoi (argv[2]);
+  batch = argc > 3 ? atoi (argv[3]) : 1;
+  if (argc > 4)
+    capacity = atoi (argv[4]);
+
+  if (num_producers <= 0 || num_producers > MAX_THREADS ||
+      num_consumers <= 0 || num_consumers > MAX_THREADS) {
+    g_print ("number of threads must be between 1 and %d\n", MAX_THREADS);
+    exit (-2);
+  }
+  if (batch == 0 || batch > MAX_BATCH) {
+    g_print ("batch must be between 1 and %d\n", MAX_BATCH);
+    exit (-3);
+  }
+
+  g_print ("%d producers, %d consumers, capacity %u\n", num_producers,
+      num_consumers, capacity);
+
+  run_test ("unbounded", gst_atomic_queue_new (capacity), num_producers,
+      num_consumers);
+  run_test ("bounded", gst_atomic_queue_new_bounded (capacity,
+          GST_ATOMIC_QUEUE_FLAG_NONE), num_producers, num_consumers);
+  if (num_producers == 1 && num_consumers == 1)
+    run_test ("spsc", gst_atomic_queue_new_bounded (capacity,
+            GST_ATOMIC_QUEUE_FLAG_SINGLE_PRODUCER |
+            GST_ATOMIC_QUEUE_FLAG_SINGLE_CONSUMER), 1, 1);
+
+  return 0;
+}
@@ -0,0 +1,142 @@
+/* GStreamer
+ * Copyright (C) <2018> GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Pushes empty buffers into a fakesink without syncing and measures the
+ * throughput of the GstBaseSink render path, without last-sample, with
+ * last-sample and with threads reading the last-sample at the same time. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <gst/gst.h>
+#include <gst/base/gstbasesink.h>
+
+#define MAX_READERS 64
+
+static gint running;
+
+static gpointer
+run_reader (gpointer user_data)
+{
+  GstBaseSink *sink = user_data;
+
+  while (g_atomic_int_get (&running)) {
+    GstSample *sample;
+
+    if ((sample = gst_base_sink_get_last_sample (sink)))
+      gst_sample_unref (sample);
+  }
+  return NULL;
+}
+
+static void
+run_test (const gchar * name, guint64 nbuffers, gboolean last_sample,
+    gint nreaders)
+{
+  GstElement *sink;
+  GstPad *srcpad, *sinkpad;
+  GThread *threads[MAX_READERS];
+  GstCaps *caps;
+  GstSegment segment;
+  GstClockTime start, end;
+  GstClockTimeDiff dur;
+  guint64 i;
+  gint j;
+
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (sink, "sync", FALSE, "async", FALSE, "enable-last-sample",
+      last_sample, NULL);
+
+  srcpad = gst_pad_new ("src", GST_PAD_SRC);
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_link (srcpad, sinkpad);
+  gst_object_unref (sinkpad);
+
+  gst_element_set_state (sink, GST_STATE_PLAYING);
+  gst_pad_set_active (srcpad, TRUE);
+
+  caps = gst_caps_new_empty_simple ("application/x-test");
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("basesinkstress"));
+  gst_pad_push_event (srcpad, gst_event_new_caps (caps));
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+  gst_caps_unref (caps);
+
+  g_atomic_int_set (&running, 1);
+  for (j = 0; j < nreaders; j++)
+    threads[j] = g_thread_new ("reader", run_reader, sink);
+
+  /* buffers without memory and timestamps, to mostly measure the sink */
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < nbuffers; i++) {
+    if (gst_pad_push (srcpad, gst_buffer_new ()) != GST_FLOW_OK)
+      break;
+  }
+  end = gst_util_get_timestamp ();
+
+  g_atomic_int_set (&running, 0);
+  for (j = 0; j < nreaders; j++)
+    g_thread_join (threads[j]);
+
+  dur = GST_CLOCK_DIFF (start, end);
+  g_print ("*** %s: total %" GST_TIME_FORMAT " - %.0f buffers/s\n", name,
+      GST_TIME_ARGS (dur), (gdouble) nbuffers * GST_SECOND / dur);
+
+  gst_element_set_state (sink, GST_STATE_NULL);
+  gst_pad_set_active (srcpad, FALSE);
+  gst_object_unref (srcpad);
+  gst_object_unref (sink);
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  guint64 nbuffers;
+  gint nreaders = 1;
+  gchar *name;
+
+  gst_init (&argc, &argv);
+
+  if (argc < 2 || argc > 3) {
+    g_print ("usage: %s <buffers> [<last-sample readers>]\n", argv[0]);
+    exit (-1);
+  }
+
+  nbuffers = g_ascii_strtoull (argv[1], NULL, 10);
+  if (argc > 2)
+    nreaders = atoi (argv[2]);
+
+  if (nbuffers == 0) {
+    g_print ("number of buffers must be greater than 0\n");
+    exit (-2);
+  }
+  if (nreaders < 0 || nreaders > MAX_READERS) {
+    g_print ("number of readers must be between 0 and %d\n", MAX_READERS);
+    exit (-3);
+  }
+
+  run_test ("no last-sample", nbuffers, FALSE, 0);
+  run_test ("last-sample", nbuffers, TRUE, 0);
+  if (nreaders > 0) {
+    name = g_strdup_printf ("last-sample, %d readers", nreaders);
+    run_test (name, nbuffers, TRUE, nreaders);
+    g_free (name);
+  }
+
+  return 0;
+}
@@ -0,0 +1,137 @@
+/* GStreamer
+ * Copyright (C) <2018> GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Writes large buffers into a local pipe with fdsink, copying and without
+ * copying, and measures the throughput and the CPU time it takes. A thread
+ * drains the other end of the pipe with read(), so the pipe may be spliced
+ * to. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <gst/gst.h>
+
+#ifdef G_OS_UNIX
+#include <unistd.h>
+#include <sys/resource.h>
+
+static gpointer
+run_reader (gpointer user_data)
+{
+  gint fd = GPOINTER_TO_INT (user_data);
+  gchar *data = g_malloc (1024 * 1024);
+
+  while (read (fd, data, 1024 * 1024) > 0);
+
+  g_free (data);
+  return NULL;
+}
+
+static GstClockTime
+get_cpu_time (void)
+{
+  struct rusage usage;
+
+  getrusage (RUSAGE_SELF, &usage);
+  return GST_TIMEVAL_TO_TIME (usage.ru_utime) +
+      GST_TIMEVAL_TO_TIME (usage.ru_stime);
+}
+
+static void
+run_test (gboolean zero_copy, guint size, guint nbuffers)
+{
+  GstElement *pipeline;
+  GstMessage *msg;
+  GThread *reader;
+  GstClockTime start, end, cpu;
+  GstClockTimeDiff dur;
+  gchar *desc;
+  gint fds[2];
+
+  if (pipe (fds) < 0) {
+    g_print ("failed to create a pipe\n");
+    exit (-3);
+  }
+
+  desc = g_strdup_printf ("fakesrc sizetype=fixed sizemax=%u filltype=zero "
+      "num-buffers=%u ! fdsink fd=%d zero-copy=%d zero-copy-pipe=%d", size,
+      nbuffers, fds[1], zero_copy, zero_copy);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  if (!pipeline) {
+    g_print ("fakesrc and fdsink elements are needed\n");
+    exit (-4);
+  }
+
+  reader = g_thread_new ("reader", run_reader, GINT_TO_POINTER (fds[0]));
+
+  start = gst_util_get_timestamp ();
+  cpu = get_cpu_time ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (pipeline),
+      GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  gst_message_unref (msg);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  end = gst_util_get_timestamp ();
+  cpu = get_cpu_time () - cpu;
+
+  close (fds[1]);
+  g_thread_join (reader);
+  close (fds[0]);
+  gst_object_unref (pipeline);
+
+  dur = GST_CLOCK_DIFF (start, end);
+  g_print ("*** %-9s: total %" GST_TIME_FORMAT " - %.1f MB/s - cpu %"
+      GST_TIME_FORMAT "\n", zero_copy ? "zero-copy" : "copy",
+      GST_TIME_ARGS (dur), (gdouble) size * nbuffers * 1000.0 / dur,
+      GST_TIME_ARGS (cpu));
+}
+#endif
+
+gint
+main (gint argc, gchar * argv[])
+{
+  guint size = 65536, nbuffers = 100000;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 3) {
+    g_print ("usage: %s [<buffer size> [<buffers>]]\n", argv[0]);
+    exit (-1);
+  }
+
+  if (argc > 1)
+    size = atoi (argv[1]);
+  if (argc > 2)
+    nbuffers = atoi (argv[2]);
+
+  if (size == 0 || nbuffers == 0) {
+    g_print ("buffer size and number of buffers must be greater than 0\n");
+    exit (-2);
+  }
+
+#ifdef G_OS_UNIX
+  g_print ("%u buffers of %u bytes\n", nbuffers, size);
+  run_test (FALSE, size, nbuffers);
+  run_test (TRUE, size, nbuffers);
+#else
+  g_print ("pipes are not supported on this platform\n");
+#endif
+
+  return 0;
+}
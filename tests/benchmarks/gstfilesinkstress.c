@@ -0,0 +1,121 @@
+/* GStreamer
+ * Copyright (C) <2018> GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Writes a file with filesink and with fdsink, once with synchronous writes
+ * and once with io_uring, and measures the throughput. The file is
+ * overwritten by every run. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+
+static void
+run_test (const gchar * location, const gchar * sink, gboolean io_uring,
+    guint size, guint nbuffers, guint depth)
+{
+  GstElement *pipeline;
+  GstMessage *msg;
+  GstClockTime start, end;
+  GstClockTimeDiff dur;
+  gchar *desc, *target;
+  gint fd = -1;
+
+  if (g_str_equal (sink, "fdsink")) {
+    fd = g_open (location, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+      g_print ("can't open %s\n", location);
+      exit (-3);
+    }
+    target = g_strdup_printf ("fd=%d", fd);
+  } else {
+    target = g_strdup_printf ("location=\"%s\"", location);
+  }
+
+  desc = g_strdup_printf ("fakesrc sizetype=fixed sizemax=%u filltype=zero "
+      "num-buffers=%u ! %s %s io-uring=%d io-depth=%u", size, nbuffers, sink,
+      target, io_uring, depth);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  g_free (target);
+  if (!pipeline) {
+    g_print ("fakesrc and %s elements are needed\n", sink);
+    exit (-4);
+  }
+
+  start = gst_util_get_timestamp ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (pipeline),
+      GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR)
+    g_print ("*** %s %s: error\n", sink, io_uring ? "io-uring" : "sync");
+  gst_message_unref (msg);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  end = gst_util_get_timestamp ();
+
+  if (fd >= 0)
+    g_close (fd, NULL);
+  gst_object_unref (pipeline);
+
+  dur = GST_CLOCK_DIFF (start, end);
+  g_print ("*** %-8s %-8s: total %" GST_TIME_FORMAT " - %.1f MB/s\n", sink,
+      io_uring ? "io-uring" : "sync", GST_TIME_ARGS (dur),
+      (gdouble) size * nbuffers * 1000.0 / dur);
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  static const gchar *sinks[] = { "filesink", "fdsink" };
+  const gchar *location;
+  guint size = 65536, nbuffers = 16384, depth = 4;
+  gint i;
+
+  gst_init (&argc, &argv);
+
+  if (argc < 2 || argc > 5) {
+    g_print ("usage: %s <file> [<buffer size> [<buffers> [<io-depth>]]]\n",
+        argv[0]);
+    exit (-1);
+  }
+
+  location = argv[1];
+  if (argc > 2)
+    size = atoi (argv[2]);
+  if (argc > 3)
+    nbuffers = atoi (argv[3]);
+  if (argc > 4)
+    depth = atoi (argv[4]);
+
+  if (size == 0 || nbuffers == 0 || depth == 0) {
+    g_print ("buffer size, number of buffers and depth must be greater "
+        "than 0\n");
+    exit (-2);
+  }
+
+  g_print ("%u buffers of %u bytes, io-depth %u\n", nbuffers, size, depth);
+
+  for (i = 0; i < G_N_ELEMENTS (sinks); i++) {
+    run_test (location, sinks[i], FALSE, size, nbuffers, depth);
+    run_test (location, sinks[i], TRUE, size, nbuffers, depth);
+  }
+
+  return 0;
+}
@@ -0,0 +1,200 @@
+/* GStreamer
+ * Copyright (C) <2018> GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Reads a file with filesrc in the given read mode, once sequentially
+ * through fakesink and once with random pulls, and measures the
+ * throughput of both. Drop the page cache between runs to measure the
+ * disk instead of the memory. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+
+#define NUM_SEEKS 10000
+
+static GstElement *
+make_filesrc (const gchar * location, const gchar * mode, guint blocksize,
+    guint64 readahead)
+{
+  GstElement *src;
+
+  src = gst_element_factory_make ("filesrc", NULL);
+  if (!src) {
+    g_print ("filesrc element is needed\n");
+    exit (-2);
+  }
+  gst_util_set_object_arg (G_OBJECT (src), "read-mode", mode);
+  g_object_set (src, "location", location, "blocksize", blocksize,
+      "readahead", readahead, NULL);
+
+  return src;
+}
+
+/* checksum the data so that the mapped pages are actually touched */
+static guint8
+touch_buffer (GstBuffer * buffer)
+{
+  GstMapInfo info;
+  guint8 sum = 0;
+  gsize i;
+
+  gst_buffer_map (buffer, &info, GST_MAP_READ);
+  for (i = 0; i < info.size; i += 512)
+    sum ^= info.data[i];
+  gst_buffer_unmap (buffer, &info);
+
+  return sum;
+}
+
+static GstPadProbeReturn
+touch_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  guint8 *sum = user_data;
+
+  *sum ^= touch_buffer (GST_PAD_PROBE_INFO_BUFFER (info));
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+run_sequential (const gchar * location, const gchar * mode, guint blocksize,
+    guint64 readahead, guint64 size)
+{
+  GstElement *pipeline, *src, *sink;
+  GstPad *pad;
+  GstMessage *msg;
+  GstClockTime start, end;
+  GstClockTimeDiff dur;
+  guint8 sum = 0;
+
+  pipeline = gst_pipeline_new ("pipeline");
+  src = make_filesrc (location, mode, blocksize, readahead);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), src, sink, NULL);
+  gst_element_link (src, sink);
+
+  pad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, touch_probe, &sum, NULL);
+  gst_object_unref (pad);
+
+  start = gst_util_get_timestamp ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (pipeline),
+      GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  end = gst_util_get_timestamp ();
+
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR)
+    g_print ("*** sequential %s: error\n", mode);
+  gst_message_unref (msg);
+
+  dur = GST_CLOCK_DIFF (start, end);
+  g_print ("*** sequential %-6s: total %" GST_TIME_FORMAT " - %.1f MB/s "
+      "(%02x)\n", mode, GST_TIME_ARGS (dur),
+      (gdouble) size * GST_SECOND / dur / (1024 * 1024), sum);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+}
+
+static void
+run_seeky (const gchar * location, const gchar * mode, guint blocksize,
+    guint64 readahead, guint64 size)
+{
+  GstElement *src;
+  GstPad *pad;
+  GstClockTime start, end;
+  GstClockTimeDiff dur;
+  GRand *rand;
+  guint8 sum = 0;
+  gint i;
+
+  src = make_filesrc (location, mode, blocksize, readahead);
+  gst_element_set_state (src, GST_STATE_READY);
+  pad = gst_element_get_static_pad (src, "src");
+  gst_pad_activate_mode (pad, GST_PAD_MODE_PULL, TRUE);
+  gst_element_set_state (src, GST_STATE_PLAYING);
+
+  /* same sequence of offsets for every mode */
+  rand = g_rand_new_with_seed (0);
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < NUM_SEEKS; i++) {
+    GstBuffer *buffer = NULL;
+    guint64 offset;
+
+    offset = (guint64) (g_rand_double (rand) * size);
+    if (gst_pad_get_range (pad, offset, blocksize, &buffer) != GST_FLOW_OK)
+      continue;
+    sum ^= touch_buffer (buffer);
+    gst_buffer_unref (buffer);
+  }
+  end = gst_util_get_timestamp ();
+
+  dur = GST_CLOCK_DIFF (start, end);
+  g_print ("*** seeky      %-6s: total %" GST_TIME_FORMAT " - %.0f reads/s "
+      "(%02x)\n", mode, GST_TIME_ARGS (dur),
+      (gdouble) NUM_SEEKS * GST_SECOND / dur, sum);
+
+  g_rand_free (rand);
+  gst_element_set_state (src, GST_STATE_NULL);
+  gst_object_unref (pad);
+  gst_object_unref (src);
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  static const gchar *modes[] = { "read", "mmap", "direct", "uring" };
+  const gchar *location;
+  guint blocksize = 64 * 1024;
+  guint64 readahead = 0, size;
+  GStatBuf st;
+  gint i;
+
+  gst_init (&argc, &argv);
+
+  if (argc < 2 || argc > 4) {
+    g_print ("usage: %s <file> [<blocksize> [<readahead>]]\n", argv[0]);
+    exit (-1);
+  }
+
+  location = argv[1];
+  if (argc > 2)
+    blocksize = atoi (argv[2]);
+  if (argc > 3)
+    readahead = g_ascii_strtoull (argv[3], NULL, 10);
+
+  if (g_stat (location, &st) < 0 || st.st_size == 0) {
+    g_print ("can't read %s\n", location);
+    exit (-3);
+  }
+  size = st.st_size;
+
+  g_print ("%" G_GUINT64_FORMAT " bytes, blocksize %u, readahead %"
+      G_GUINT64_FORMAT "\n", size, blocksize, readahead);
+
+  for (i = 0; i < G_N_ELEMENTS (modes); i++)
+    run_sequential (location, modes[i], blocksize, readahead, size);
+  for (i = 0; i < G_N_ELEMENTS (modes); i++)
+    run_seeky (location, modes[i], blocksize, readahead, size);
+
+  return 0;
+}
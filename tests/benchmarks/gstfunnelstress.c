@@ -0,0 +1,136 @@
+/* GStreamer
+ * Copyright (C) <2018> GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Pushes small buffers into many sink pads of a funnel or input-selector
+ * at once, one thread per pad, and measures the total throughput. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <gst/gst.h>
+
+#define MAX_INPUTS  1024
+#define BUFFER_SIZE 64
+
+static guint64 nbuffers;
+
+static gpointer
+run_input (gpointer user_data)
+{
+  GstPad *srcpad = user_data;
+  guint64 i;
+
+  for (i = 0; i < nbuffers; i++) {
+    GstBuffer *buffer;
+
+    buffer = gst_buffer_new_allocate (NULL, BUFFER_SIZE, NULL);
+    GST_BUFFER_PTS (buffer) = i * GST_MSECOND;
+    if (gst_pad_push (srcpad, buffer) != GST_FLOW_OK)
+      break;
+  }
+  return NULL;
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  GstElement *pipeline, *element, *sink;
+  GstPad *srcpads[MAX_INPUTS];
+  GThread *threads[MAX_INPUTS];
+  GstCaps *caps;
+  GstSegment segment;
+  GstClockTime start, end;
+  GstClockTimeDiff dur;
+  gint i, ninputs;
+
+  gst_init (&argc, &argv);
+
+  if (argc != 4) {
+    g_print ("usage: %s <funnel|input-selector> <inputs> <buffers per input>\n",
+        argv[0]);
+    exit (-1);
+  }
+
+  ninputs = atoi (argv[2]);
+  nbuffers = g_ascii_strtoull (argv[3], NULL, 10);
+
+  if (ninputs <= 0 || ninputs > MAX_INPUTS) {
+    g_print ("number of inputs must be between 1 and %d\n", MAX_INPUTS);
+    exit (-2);
+  }
+
+  pipeline = gst_pipeline_new ("pipeline");
+  element = gst_element_factory_make (argv[1], NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  if (!element || !sink) {
+    g_print ("%s and fakesink elements are needed\n", argv[1]);
+    exit (-3);
+  }
+
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), element, sink, NULL);
+  gst_element_link (element, sink);
+
+  for (i = 0; i < ninputs; i++) {
+    GstPad *sinkpad;
+
+    srcpads[i] = gst_pad_new (NULL, GST_PAD_SRC);
+    sinkpad = gst_element_get_request_pad (element, "sink_%u");
+    gst_pad_link (srcpads[i], sinkpad);
+    gst_object_unref (sinkpad);
+  }
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  /* all inputs carry the same caps and segment, like a set of equal
+   * streams */
+  caps = gst_caps_new_empty_simple ("application/x-test");
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  for (i = 0; i < ninputs; i++) {
+    gchar *stream_id;
+
+    gst_pad_set_active (srcpads[i], TRUE);
+    stream_id = g_strdup_printf ("funnelstress/%d", i);
+    gst_pad_push_event (srcpads[i], gst_event_new_stream_start (stream_id));
+    g_free (stream_id);
+    gst_pad_push_event (srcpads[i], gst_event_new_caps (caps));
+    gst_pad_push_event (srcpads[i], gst_event_new_segment (&segment));
+  }
+  gst_caps_unref (caps);
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < ninputs; i++)
+    threads[i] = g_thread_new ("input", run_input, srcpads[i]);
+  for (i = 0; i < ninputs; i++)
+    g_thread_join (threads[i]);
+  end = gst_util_get_timestamp ();
+
+  dur = GST_CLOCK_DIFF (start, end);
+  g_print ("*** %s, %d inputs: total %" GST_TIME_FORMAT " - %.0f buffers/s\n",
+      argv[1], ninputs, GST_TIME_ARGS (dur),
+      (gdouble) nbuffers * ninputs * GST_SECOND / dur);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  for (i = 0; i < ninputs; i++) {
+    gst_pad_set_active (srcpads[i], FALSE);
+    gst_object_unref (srcpads[i]);
+  }
+  gst_object_unref (pipeline);
+
+  return 0;
+}
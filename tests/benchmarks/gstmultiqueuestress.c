@@ -0,0 +1,144 @@
+/* GStreamer
+ * Copyright (C) <2018> GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Pushes buffers round-robin into a multiqueue with many streams and
+ * measures the throughput, to see how the multiqueue scales with the number
+ * of streams. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <gst/gst.h>
+
+#define BUFFER_SIZE 64
+#define BUFFER_DURATION (10 * GST_MSECOND)
+
+gint
+main (gint argc, gchar * argv[])
+{
+  GstElement *pipeline, *mq;
+  GstPad **srcpads;
+  GstSegment segment;
+  GstMessage *msg;
+  GstClockTime start, end;
+  GstClockTimeDiff dur;
+  guint i, s, nstreams, nbuffers, nunlinked = 0;
+
+  gst_init (&argc, &argv);
+
+  if (argc < 3 || argc > 4) {
+    g_print ("usage: %s <streams> <buffers per stream> [<not-linked streams>]\n",
+        argv[0]);
+    exit (-1);
+  }
+
+  nstreams = atoi (argv[1]);
+  nbuffers = atoi (argv[2]);
+  if (argc > 3)
+    nunlinked = atoi (argv[3]);
+
+  if (nstreams == 0 || nunlinked >= nstreams) {
+    g_print ("need at least one linked stream\n");
+    exit (-2);
+  }
+
+  pipeline = gst_pipeline_new ("pipeline");
+  mq = gst_element_factory_make ("multiqueue", NULL);
+  if (!mq) {
+    g_print ("multiqueue element is needed\n");
+    exit (-3);
+  }
+  g_object_set (mq, "max-size-bytes", 0, "max-size-buffers", 0,
+      "max-size-time", (guint64) 0, "sync-by-running-time", TRUE, NULL);
+  gst_bin_add (GST_BIN (pipeline), mq);
+
+  srcpads = g_new0 (GstPad *, nstreams);
+  for (s = 0; s < nstreams; s++) {
+    GstPad *sinkpad, *mqsrcpad;
+    gchar *name;
+
+    srcpads[s] = gst_pad_new (NULL, GST_PAD_SRC);
+    sinkpad = gst_element_get_request_pad (mq, "sink_%u");
+    gst_pad_link (srcpads[s], sinkpad);
+
+    /* the last streams are left not-linked */
+    if (s < nstreams - nunlinked) {
+      GstElement *sink;
+
+      sink = gst_element_factory_make ("fakesink", NULL);
+      g_object_set (sink, "sync", FALSE, NULL);
+      gst_bin_add (GST_BIN (pipeline), sink);
+
+      name = g_strdup_printf ("src_%s", GST_PAD_NAME (sinkpad) + 5);
+      mqsrcpad = gst_element_get_static_pad (mq, name);
+      g_free (name);
+      gst_element_link_pads (mq, GST_PAD_NAME (mqsrcpad), sink, "sink");
+      gst_object_unref (mqsrcpad);
+    }
+    gst_object_unref (sinkpad);
+  }
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  for (s = 0; s < nstreams; s++) {
+    gchar *stream_id;
+
+    gst_pad_set_active (srcpads[s], TRUE);
+    stream_id = g_strdup_printf ("mqstress/%u", s);
+    gst_pad_push_event (srcpads[s], gst_event_new_stream_start (stream_id));
+    g_free (stream_id);
+    gst_pad_push_event (srcpads[s], gst_event_new_segment (&segment));
+  }
+
+  g_print ("%u streams (%u not-linked), %u buffers per stream\n", nstreams,
+      nunlinked, nbuffers);
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < nbuffers; i++) {
+    for (s = 0; s < nstreams; s++) {
+      GstBuffer *buffer;
+
+      buffer = gst_buffer_new_allocate (NULL, BUFFER_SIZE, NULL);
+      GST_BUFFER_PTS (buffer) = i * BUFFER_DURATION;
+      GST_BUFFER_DURATION (buffer) = BUFFER_DURATION;
+      gst_pad_push (srcpads[s], buffer);
+    }
+  }
+  for (s = 0; s < nstreams; s++)
+    gst_pad_push_event (srcpads[s], gst_event_new_eos ());
+
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (pipeline),
+      GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  gst_message_unref (msg);
+  end = gst_util_get_timestamp ();
+
+  dur = GST_CLOCK_DIFF (start, end);
+  g_print ("*** total %" GST_TIME_FORMAT " - %.0f buffers/s\n",
+      GST_TIME_ARGS (dur), (gdouble) nbuffers * nstreams * GST_SECOND / dur);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  for (s = 0; s < nstreams; s++) {
+    gst_pad_set_active (srcpads[s], FALSE);
+    gst_object_unref (srcpads[s]);
+  }
+  g_free (srcpads);
+  gst_object_unref (pipeline);
+
+  return 0;
+}
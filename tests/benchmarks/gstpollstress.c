@@ -20,9 +20,16 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <gst/gst.h>
 #include "gst/glib-compat-private.h"
 
+#ifndef G_OS_WIN32
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#endif
+
 static GstPoll *set;
 static GList *fds = NULL;
 static GMutex fdlock;
@@ -136,6 +143,85 @@ run_test (void *threadid)
   return NULL;
 }
 
+#ifndef G_OS_WIN32
+#define WAIT_ITERATIONS 100000
+
+/* measures the cost of a wait with a single active fd out of @num_fds */
+static void
+run_wait_test (gint num_fds)
+{
+  GstPollFD *rfds;
+  gint *wfds;
+  struct rlimit rl;
+  gint i, added;
+  gint64 start, end;
+  gchar c = 'A';
+
+  /* every pair needs two fds */
+  if (getrlimit (RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < 2 * num_fds + 64) {
+    rl.rlim_cur = MIN (rl.rlim_max, 2 * num_fds + 64);
+    setrlimit (RLIMIT_NOFILE, &rl);
+  }
+
+  set = gst_poll_new (TRUE);
+  rfds = g_new0 (GstPollFD, num_fds);
+  wfds = g_new0 (gint, num_fds);
+
+  for (added = 0; added < num_fds; added++) {
+    gint socks[2];
+
+    if (socketpair (PF_UNIX, SOCK_STREAM, 0, socks) < 0) {
+      g_print ("could only create %d socket pairs: %s\n", added,
+          g_strerror (errno));
+      break;
+    }
+    gst_poll_fd_init (&rfds[added]);
+    rfds[added].fd = socks[0];
+    wfds[added] = socks[1];
+
+    gst_poll_add_fd (set, &rfds[added]);
+    gst_poll_fd_ctl_read (set, &rfds[added], TRUE);
+  }
+
+  if (added == 0)
+    goto done;
+
+  /* first wait rebuilds the set */
+  gst_poll_wait (set, 0);
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < WAIT_ITERATIONS; i++) {
+    gint idx = g_random_int_range (0, added);
+
+    if (write (wfds[idx], &c, 1) != 1)
+      g_error ("write failed: %s", g_strerror (errno));
+
+    if (gst_poll_wait (set, GST_CLOCK_TIME_NONE) != 1)
+      g_error ("expected one active fd");
+    if (!gst_poll_fd_can_read (set, &rfds[idx]))
+      g_error ("fd %d should be readable", rfds[idx].fd);
+
+    if (read (rfds[idx].fd, &c, 1) != 1)
+      g_error ("read failed: %s", g_strerror (errno));
+  }
+  end = g_get_monotonic_time ();
+
+  g_print ("%d fds, %d waits: %" G_GINT64_FORMAT " us, %.3f us per wait\n",
+      added, WAIT_ITERATIONS, end - start,
+      (gdouble) (end - start) / WAIT_ITERATIONS);
+
+done:
+  for (i = 0; i < added; i++) {
+    gst_poll_remove_fd (set, &rfds[i]);
+    close (rfds[i].fd);
+    close (wfds[i]);
+  }
+  g_free (rfds);
+  g_free (wfds);
+  gst_poll_free (set);
+}
+#endif
+
 gint
 main (gint argc, gchar * argv[])
 {
@@ -148,8 +234,17 @@ main (gint argc, gchar * argv[])
   g_mutex_init (&fdlock);
   timer = g_timer_new ();
 
+#ifndef G_OS_WIN32
+  if (argc == 3 && strcmp (argv[1], "--fds") == 0) {
+    /* e.g. --fds 10000 */
+    run_wait_test (atoi (argv[2]));
+    return 0;
+  }
+#endif
+
   if (argc != 2) {
     g_print ("usage: %s <num_threads>\n", argv[0]);
+    g_print ("       %s --fds <num_fds>\n", argv[0]);
     exit (-1);
   }
 
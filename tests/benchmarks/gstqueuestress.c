@@ -0,0 +1,150 @@
+/* GStreamer
+ * Copyright (C) <2018> GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Pushes small buffers through a queue at a fixed rate and measures the
+ * throughput and the time buffers spend in the queue. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <gst/gst.h>
+
+#define BUFFER_SIZE 64
+
+static GstClockTime start;
+static guint64 n_received;
+static GstClockTime latency_sum, latency_max;
+
+static GstPadProbeReturn
+latency_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+  GstClockTime now, latency;
+
+  now = gst_util_get_timestamp () - start;
+  latency = now - GST_BUFFER_PTS (buffer);
+
+  latency_sum += latency;
+  latency_max = MAX (latency_max, latency);
+  n_received++;
+
+  return GST_PAD_PROBE_OK;
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  GstElement *pipeline, *queue, *sink;
+  GstPad *srcpad, *sinkpad, *qsrcpad;
+  GstSegment segment;
+  GstMessage *msg;
+  GstClockTime end, interval, next;
+  GstClockTimeDiff dur;
+  guint64 i, nbuffers, rate = 1000000;
+  guint threshold = 1;
+
+  gst_init (&argc, &argv);
+
+  if (argc < 2 || argc > 4) {
+    g_print ("usage: %s <nbuffers> [<buffers per second> [<wakeup-threshold>]]\n"
+        "  a rate of 0 pushes as fast as possible\n", argv[0]);
+    exit (-1);
+  }
+
+  nbuffers = g_ascii_strtoull (argv[1], NULL, 10);
+  if (argc > 2)
+    rate = g_ascii_strtoull (argv[2], NULL, 10);
+  if (argc > 3)
+    threshold = atoi (argv[3]);
+
+  if (nbuffers == 0) {
+    g_print ("number of buffers must be greater than 0\n");
+    exit (-3);
+  }
+
+  pipeline = gst_pipeline_new ("pipeline");
+  queue = gst_element_factory_make ("queue", NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  if (!queue || !sink) {
+    g_print ("queue and fakesink elements are needed\n");
+    exit (-4);
+  }
+
+  g_object_set (queue, "wakeup-threshold", threshold, NULL);
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), queue, sink, NULL);
+  gst_element_link (queue, sink);
+
+  srcpad = gst_pad_new ("src", GST_PAD_SRC);
+  sinkpad = gst_element_get_static_pad (queue, "sink");
+  gst_pad_link (srcpad, sinkpad);
+  gst_object_unref (sinkpad);
+
+  qsrcpad = gst_element_get_static_pad (queue, "src");
+  gst_pad_add_probe (qsrcpad, GST_PAD_PROBE_TYPE_BUFFER, latency_probe, NULL,
+      NULL);
+  gst_object_unref (qsrcpad);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  gst_pad_set_active (srcpad, TRUE);
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("queuestress"));
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  interval = rate ? GST_SECOND / rate : 0;
+
+  start = gst_util_get_timestamp ();
+  next = 0;
+  for (i = 0; i < nbuffers; i++) {
+    GstBuffer *buffer;
+    GstClockTime now;
+
+    /* spin until it's time for the next buffer */
+    do {
+      now = gst_util_get_timestamp () - start;
+    } while (now < next);
+    next += interval;
+
+    buffer = gst_buffer_new_allocate (NULL, BUFFER_SIZE, NULL);
+    GST_BUFFER_PTS (buffer) = now;
+    if (gst_pad_push (srcpad, buffer) != GST_FLOW_OK)
+      break;
+  }
+  gst_pad_push_event (srcpad, gst_event_new_eos ());
+
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (pipeline),
+      GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  gst_message_unref (msg);
+  end = gst_util_get_timestamp ();
+
+  dur = GST_CLOCK_DIFF (start, end);
+  g_print ("*** total %" GST_TIME_FORMAT " - %.0f buffers/s\n",
+      GST_TIME_ARGS (dur), (gdouble) n_received * GST_SECOND / dur);
+  if (n_received > 0)
+    g_print ("*** latency average %" GST_TIME_FORMAT " - max %"
+        GST_TIME_FORMAT "\n", GST_TIME_ARGS (latency_sum / n_received),
+        GST_TIME_ARGS (latency_max));
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_pad_set_active (srcpad, FALSE);
+  gst_object_unref (srcpad);
+  gst_object_unref (pipeline);
+
+  return 0;
+}
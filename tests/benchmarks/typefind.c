@@ -0,0 +1,236 @@
+/* GStreamer
+ * Copyright (C) <2018> GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Typefinds the start of every file below a directory, once by calling all
+ * typefinders in rank order and once with the magic index of
+ * gst_type_find_helper_for_data(), and compares the time and the results. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <gst/gst.h>
+#include <gst/base/gsttypefindhelper.h>
+
+#define HEAD_SIZE (64 * 1024)
+
+typedef struct
+{
+  gchar *path;
+  guint8 *data;
+  gsize size;
+} CorpusFile;
+
+typedef struct
+{
+  const guint8 *data;
+  gsize size;
+  guint probability;
+  GstCaps *caps;
+} FindData;
+
+static const guint8 *
+find_peek (gpointer data, gint64 offset, guint size)
+{
+  FindData *find = data;
+
+  if (offset < 0 || size == 0 || size > find->size
+      || offset > find->size - size)
+    return NULL;
+
+  return find->data + offset;
+}
+
+static void
+find_suggest (gpointer data, guint probability, GstCaps * caps)
+{
+  FindData *find = data;
+
+  if (probability > find->probability) {
+    gst_caps_replace (&find->caps, caps);
+    find->probability = probability;
+  }
+}
+
+/* what the typefind helpers did before the magic index */
+static GstCaps *
+find_all (const CorpusFile * file, guint * ncalled)
+{
+  FindData find_data = { file->data, file->size, 0, NULL };
+  GstTypeFind find = { find_peek, find_suggest, &find_data, NULL };
+  GList *l, *type_list;
+
+  type_list = gst_type_find_factory_get_list ();
+  for (l = type_list; l; l = l->next) {
+    gst_type_find_factory_call_function (l->data, &find);
+    *ncalled += 1;
+    if (find_data.probability >= GST_TYPE_FIND_MAXIMUM)
+      break;
+  }
+  gst_plugin_feature_list_free (type_list);
+
+  return find_data.caps;
+}
+
+static void
+add_files (const gchar * dirname, GArray * files)
+{
+  GDir *dir;
+  const gchar *name;
+
+  if (!(dir = g_dir_open (dirname, 0, NULL)))
+    return;
+
+  while ((name = g_dir_read_name (dir))) {
+    CorpusFile file;
+    FILE *f;
+
+    file.path = g_build_filename (dirname, name, NULL);
+    if (g_file_test (file.path, G_FILE_TEST_IS_DIR)) {
+      add_files (file.path, files);
+      g_free (file.path);
+      continue;
+    }
+
+    if (!(f = fopen (file.path, "rb"))) {
+      g_free (file.path);
+      continue;
+    }
+    file.data = g_malloc (HEAD_SIZE);
+    file.size = fread (file.data, 1, HEAD_SIZE, f);
+    fclose (f);
+
+    if (file.size == 0) {
+      g_free (file.data);
+      g_free (file.path);
+      continue;
+    }
+    g_array_append_val (files, file);
+  }
+  g_dir_close (dir);
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  GArray *files;
+  GstClockTime start, end, dur_all, dur_index;
+  guint64 ncalled = 0, ncandidates = 0;
+  guint i, j, iterations = 1, mismatches = 0;
+
+  gst_init (&argc, &argv);
+
+  if (argc < 2 || argc > 3) {
+    g_print ("usage: %s <directory> [<iterations>]\n", argv[0]);
+    exit (-1);
+  }
+  if (argc > 2)
+    iterations = atoi (argv[2]);
+  if (iterations == 0) {
+    g_print ("number of iterations must be greater than 0\n");
+    exit (-2);
+  }
+
+  files = g_array_new (FALSE, FALSE, sizeof (CorpusFile));
+  add_files (argv[1], files);
+  if (files->len == 0) {
+    g_print ("no files found in %s\n", argv[1]);
+    exit (-3);
+  }
+
+  g_print ("%u files, %u iterations\n", files->len, iterations);
+
+  /* the first round loads all plugins, don't count it */
+  for (i = 0; i < files->len; i++) {
+    CorpusFile *file = &g_array_index (files, CorpusFile, i);
+    GstCaps *caps_all, *caps_index;
+    GList *list;
+    guint ncalled_file = 0;
+
+    caps_all = find_all (file, &ncalled_file);
+    caps_index = gst_type_find_helper_for_data (NULL, file->data, file->size,
+        NULL);
+
+    list = gst_type_find_factory_get_list_for_data (file->data, file->size,
+        NULL);
+    ncandidates += g_list_length (list);
+    gst_plugin_feature_list_free (list);
+    ncalled += ncalled_file;
+
+    if (caps_all != caps_index && (caps_all == NULL || caps_index == NULL
+            || !gst_caps_is_equal (caps_all, caps_index))) {
+      gst_print ("*** %s: %" GST_PTR_FORMAT " with all typefinders, %"
+          GST_PTR_FORMAT " with the index\n", file->path, caps_all,
+          caps_index);
+      mismatches++;
+    }
+    if (caps_all)
+      gst_caps_unref (caps_all);
+    if (caps_index)
+      gst_caps_unref (caps_index);
+  }
+
+  start = gst_util_get_timestamp ();
+  for (j = 0; j < iterations; j++) {
+    for (i = 0; i < files->len; i++) {
+      guint ncalled_file = 0;
+      GstCaps *caps;
+
+      caps = find_all (&g_array_index (files, CorpusFile, i), &ncalled_file);
+      if (caps)
+        gst_caps_unref (caps);
+    }
+  }
+  end = gst_util_get_timestamp ();
+  dur_all = end - start;
+
+  start = gst_util_get_timestamp ();
+  for (j = 0; j < iterations; j++) {
+    for (i = 0; i < files->len; i++) {
+      CorpusFile *file = &g_array_index (files, CorpusFile, i);
+      GstCaps *caps;
+
+      caps = gst_type_find_helper_for_data (NULL, file->data, file->size,
+          NULL);
+      if (caps)
+        gst_caps_unref (caps);
+    }
+  }
+  end = gst_util_get_timestamp ();
+  dur_index = end - start;
+
+  g_print ("*** all typefinders: total %" GST_TIME_FORMAT " - %.0f files/s, "
+      "%.1f typefinders called per file\n", GST_TIME_ARGS (dur_all),
+      (gdouble) files->len * iterations * GST_SECOND / dur_all,
+      (gdouble) ncalled / files->len);
+  g_print ("*** magic index    : total %" GST_TIME_FORMAT " - %.0f files/s, "
+      "%.1f candidates per file\n", GST_TIME_ARGS (dur_index),
+      (gdouble) files->len * iterations * GST_SECOND / dur_index,
+      (gdouble) ncandidates / files->len);
+  g_print ("*** %u files typefound differently\n", mismatches);
+
+  for (i = 0; i < files->len; i++) {
+    CorpusFile *file = &g_array_index (files, CorpusFile, i);
+
+    g_free (file->path);
+    g_free (file->data);
+  }
+  g_array_free (files, TRUE);
+
+  return 0;
+}
@@ -1176,6 +1176,70 @@ GST_START_TEST (test_last_message_deep_notify)
 
 GST_END_TEST;
 
+static gint
+histogram_sum (const GstStructure * s, const gchar * field)
+{
+  const GValue *histogram;
+  guint i;
+  gint sum = 0;
+
+  histogram = gst_structure_get_value (s, field);
+  fail_unless (histogram != NULL);
+  for (i = 0; i < gst_value_array_get_size (histogram); i++)
+    sum += g_value_get_int (gst_value_array_get_value (histogram, i));
+
+  return sum;
+}
+
+GST_START_TEST (test_measure)
+{
+  GstElement *pipe, *src, *sink;
+  GstStructure *stats;
+  GstClockTime latency;
+  guint64 buffers, bytes;
+  GstMessage *m;
+
+  pipe = gst_pipeline_new ("pipeline");
+  src = gst_element_factory_make ("fakesrc", NULL);
+  gst_util_set_object_arg (G_OBJECT (src), "sizetype", "fixed");
+  gst_util_set_object_arg (G_OBJECT (src), "format", "time");
+  g_object_set (src, "num-buffers", 50, "sizemax", 10, "buffer-rate", 1000,
+      NULL);
+
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (sink, "sync", TRUE, "measure", TRUE, NULL);
+
+  gst_bin_add_many (GST_BIN (pipe), src, sink, NULL);
+  fail_unless (gst_element_link (src, sink));
+
+  fail_unless_equals_int (gst_element_set_state (pipe, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_ASYNC);
+
+  m = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (pipe), -1, GST_MESSAGE_EOS);
+  gst_message_unref (m);
+
+  g_object_get (sink, "stats", &stats, NULL);
+  fail_unless (stats != NULL);
+  fail_unless (gst_structure_get_uint64 (stats, "buffers", &buffers));
+  fail_unless (gst_structure_get_uint64 (stats, "bytes", &bytes));
+  fail_unless_equals_uint64 (buffers, 50);
+  fail_unless_equals_uint64 (bytes, 500);
+
+  /* all buffers are timestamped and rendered against the clock */
+  fail_unless (gst_structure_get_uint64 (stats, "latency-average", &latency));
+  fail_unless (GST_CLOCK_TIME_IS_VALID (latency));
+  fail_unless_equals_int (histogram_sum (stats, "latency-histogram"), 50);
+  fail_unless_equals_int (histogram_sum (stats, "interval-histogram"), 49);
+  gst_structure_free (stats);
+
+  fail_unless_equals_int (gst_element_set_state (pipe, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+
+  gst_object_unref (pipe);
+}
+
+GST_END_TEST;
+
 static Suite *
 fakesink_suite (void)
 {
@@ -1192,6 +1256,7 @@ fakesink_suite (void)
   tcase_add_test (tc_chain, test_position);
   tcase_add_test (tc_chain, test_notify_race);
   tcase_add_test (tc_chain, test_last_message_notify);
+  tcase_add_test (tc_chain, test_measure);
   tcase_skip_broken_test (tc_chain, test_last_message_deep_notify);
 
   return s;
@@ -207,6 +207,51 @@ GST_START_TEST (test_sizetype_random)
 
 GST_END_TEST;
 
+GST_START_TEST (test_pool_list_rate)
+{
+  GstElement *src;
+  GList *l;
+  guint i;
+
+  src = setup_fakesrc ();
+
+  g_object_set (G_OBJECT (src), "data", 3, NULL);
+  g_object_set (G_OBJECT (src), "sizetype", 4, NULL);
+  g_object_set (G_OBJECT (src), "sizemin", 100, NULL);
+  g_object_set (G_OBJECT (src), "sizemax", 1000, NULL);
+  g_object_set (G_OBJECT (src), "list-size", 4, NULL);
+  g_object_set (G_OBJECT (src), "buffer-rate", 100, NULL);
+  g_object_set (G_OBJECT (src), "num-buffers", 10, NULL);
+
+  fail_unless (gst_element_set_state (src,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  while (!have_eos) {
+    g_usleep (1000);
+  }
+
+  /* num-buffers counts the lists */
+  fail_unless_equals_int (g_list_length (buffers), 40);
+  for (l = buffers, i = 0; l; l = l->next, i++) {
+    GstBuffer *buf = l->data;
+
+    fail_if (gst_buffer_get_size (buf) > 1000);
+    fail_if (gst_buffer_get_size (buf) < 100);
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (buf), i * 10 * GST_MSECOND);
+    fail_unless_equals_uint64 (GST_BUFFER_DURATION (buf), 10 * GST_MSECOND);
+  }
+  gst_check_drop_buffers ();
+
+  fail_unless (gst_element_set_state (src,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS, "could not set to null");
+
+  /* cleanup */
+  cleanup_fakesrc (src);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_no_preroll)
 {
   GstElement *src;
@@ -327,6 +372,7 @@ fakesrc_suite (void)
   tcase_add_test (tc_chain, test_sizetype_empty);
   tcase_add_test (tc_chain, test_sizetype_fixed);
   tcase_add_test (tc_chain, test_sizetype_random);
+  tcase_add_test (tc_chain, test_pool_list_rate);
   tcase_add_test (tc_chain, test_no_preroll);
   tcase_add_test (tc_chain, test_reuse_push);
 
@@ -0,0 +1,246 @@
+/* GStreamer unit test for the fdsink element
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+
+#ifdef G_OS_UNIX
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+/* the smallest buffer fdsink writes without copying */
+#define BUFFER_SIZE (16 * 1024)
+
+static GstPad *mysrcpad;
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstElement *
+setup_fdsink (gint fd, gboolean zero_copy_pipe)
+{
+  GstElement *fdsink;
+
+  GST_DEBUG ("setup_fdsink");
+  fdsink = gst_check_setup_element ("fdsink");
+  /* the last sample would keep a reference to the buffers too */
+  g_object_set (fdsink, "fd", fd, "zero-copy", TRUE, "zero-copy-pipe",
+      zero_copy_pipe, "enable-last-sample", FALSE, NULL);
+  mysrcpad = gst_check_setup_src_pad (fdsink, &srctemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+
+  gst_element_set_state (fdsink, GST_STATE_PLAYING);
+  gst_check_setup_events (mysrcpad, fdsink, NULL, GST_FORMAT_BYTES);
+
+  return fdsink;
+}
+
+static void
+cleanup_fdsink (GstElement * fdsink)
+{
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_check_teardown_src_pad (fdsink);
+  gst_check_teardown_element (fdsink);
+}
+
+static GstBuffer *
+push_buffer (guint8 fill)
+{
+  GstBuffer *buf;
+
+  buf = gst_buffer_new_and_alloc (BUFFER_SIZE);
+  gst_buffer_memset (buf, 0, fill, BUFFER_SIZE);
+  fail_unless_equals_int (gst_pad_push (mysrcpad, gst_buffer_ref (buf)),
+      GST_FLOW_OK);
+
+  return buf;
+}
+
+static void
+check_data (gint fd, guint8 fill)
+{
+  guint8 data[BUFFER_SIZE];
+  gsize offset = 0;
+  guint i;
+
+  while (offset < BUFFER_SIZE) {
+    gssize ret = read (fd, data + offset, BUFFER_SIZE - offset);
+
+    fail_unless (ret > 0);
+    offset += ret;
+  }
+
+  for (i = 0; i < BUFFER_SIZE; i++)
+    fail_unless_equals_int (data[i], fill);
+}
+
+GST_START_TEST (test_zero_copy_pipe)
+{
+  GstElement *sink;
+  GstBuffer *bufs[4];
+  gint fds[2];
+  guint i;
+
+  fail_if (pipe (fds) < 0);
+  sink = setup_fdsink (fds[1], TRUE);
+
+  /* the pipe holds 64kB, enough to not block on these */
+  for (i = 0; i < 3; i++)
+    bufs[i] = push_buffer (i + 1);
+
+#ifdef HAVE_VMSPLICE
+  /* the pipe references the memory of all of them */
+  for (i = 0; i < 3; i++)
+    fail_unless (GST_MINI_OBJECT_REFCOUNT_VALUE (bufs[i]) > 1);
+#endif
+
+  for (i = 0; i < 3; i++)
+    check_data (fds[0], i + 1);
+
+  /* the next write releases the buffers that were read */
+  bufs[3] = push_buffer (4);
+  for (i = 0; i < 3; i++)
+    ASSERT_BUFFER_REFCOUNT (bufs[i], "buffer", 1);
+
+  check_data (fds[0], 4);
+
+  /* and stopping the one that was read last */
+  fail_unless (gst_element_set_state (sink,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS, "could not set to null");
+  ASSERT_BUFFER_REFCOUNT (bufs[3], "buffer", 1);
+
+  for (i = 0; i < 4; i++)
+    gst_buffer_unref (bufs[i]);
+  cleanup_fdsink (sink);
+  close (fds[0]);
+  close (fds[1]);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_zero_copy_pipe_copies)
+{
+  GstElement *sink;
+  GstBuffer *buf;
+  gint fds[2];
+
+  fail_if (pipe (fds) < 0);
+  sink = setup_fdsink (fds[1], FALSE);
+
+  /* without zero-copy-pipe the data is copied into the pipe */
+  buf = push_buffer (1);
+  ASSERT_BUFFER_REFCOUNT (buf, "buffer", 1);
+  check_data (fds[0], 1);
+
+  fail_unless (gst_element_set_state (sink,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS, "could not set to null");
+
+  gst_buffer_unref (buf);
+  cleanup_fdsink (sink);
+  close (fds[0]);
+  close (fds[1]);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_zero_copy_pipe_teardown)
+{
+  GstElement *sink;
+  GstBuffer *bufs[3];
+  gint fds[2];
+  guint i;
+
+  fail_if (pipe (fds) < 0);
+  sink = setup_fdsink (fds[1], TRUE);
+
+  for (i = 0; i < 3; i++)
+    bufs[i] = push_buffer (i + 1);
+
+  /* the reader goes away without reading anything, the pipe and the pages
+   * it references are gone with it, so stopping releases the buffers
+   * instead of leaking them */
+  close (fds[0]);
+  fail_unless (gst_element_set_state (sink,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS, "could not set to null");
+
+  for (i = 0; i < 3; i++) {
+    ASSERT_BUFFER_REFCOUNT (bufs[i], "buffer", 1);
+    gst_buffer_unref (bufs[i]);
+  }
+  cleanup_fdsink (sink);
+  close (fds[1]);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_zero_copy_socket)
+{
+  GstElement *sink;
+  GstBuffer *bufs[3];
+  gint fds[2];
+  guint i;
+
+  fail_if (socketpair (AF_UNIX, SOCK_STREAM, 0, fds) < 0);
+  sink = setup_fdsink (fds[1], FALSE);
+
+  /* local sockets don't support MSG_ZEROCOPY and are copied, either way the
+   * data must arrive intact */
+  for (i = 0; i < 3; i++) {
+    bufs[i] = push_buffer (i + 1);
+    check_data (fds[0], i + 1);
+  }
+
+  fail_unless (gst_element_set_state (sink,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS, "could not set to null");
+
+  for (i = 0; i < 3; i++) {
+    ASSERT_BUFFER_REFCOUNT (bufs[i], "buffer", 1);
+    gst_buffer_unref (bufs[i]);
+  }
+  cleanup_fdsink (sink);
+  close (fds[0]);
+  close (fds[1]);
+}
+
+GST_END_TEST;
+#endif
+
+static Suite *
+fdsink_suite (void)
+{
+  Suite *s = suite_create ("fdsink");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+#ifdef G_OS_UNIX
+  tcase_add_test (tc_chain, test_zero_copy_pipe);
+  tcase_add_test (tc_chain, test_zero_copy_pipe_copies);
+  tcase_add_test (tc_chain, test_zero_copy_pipe_teardown);
+  tcase_add_test (tc_chain, test_zero_copy_socket);
+#endif
+
+  return s;
+}
+
+GST_CHECK_MAIN (fdsink);
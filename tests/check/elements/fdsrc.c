@@ -202,6 +202,49 @@ GST_START_TEST (test_seeking)
 
 GST_END_TEST;
 
+GST_START_TEST (test_read_buffers)
+{
+  GstElement *src;
+  struct stat stat_results;
+  guint64 offset = 0;
+  GList *l;
+  gint in_fd;
+
+  fail_if ((in_fd = open (TESTFILE, O_RDONLY)) < 0);
+  fail_if (fstat (in_fd, &stat_results) < 0);
+  have_eos = FALSE;
+  src = setup_fdsrc ();
+
+  g_object_set (G_OBJECT (src), "fd", in_fd, "blocksize", 1024,
+      "read-buffers", 4, NULL);
+  fail_unless (gst_element_set_state (src,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  while (!have_eos)
+    g_usleep (1000);
+
+  /* the file is read in order, in blocksize buffers */
+  for (l = buffers; l; l = l->next) {
+    GstBuffer *buf = l->data;
+
+    fail_unless_equals_uint64 (GST_BUFFER_OFFSET (buf), offset);
+    fail_unless (gst_buffer_get_size (buf) <= 1024);
+    offset += gst_buffer_get_size (buf);
+  }
+  fail_unless_equals_uint64 (offset, stat_results.st_size);
+
+  fail_unless (gst_element_set_state (src,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS, "could not set to null");
+
+  /* cleanup */
+  cleanup_fdsrc (src);
+  close (in_fd);
+  gst_check_drop_buffers ();
+}
+
+GST_END_TEST;
+
 static Suite *
 fdsrc_suite (void)
 {
@@ -212,6 +255,7 @@ fdsrc_suite (void)
   tcase_add_test (tc_chain, test_num_buffers);
   tcase_add_test (tc_chain, test_nonseeking);
   tcase_add_test (tc_chain, test_seeking);
+  tcase_add_test (tc_chain, test_read_buffers);
 
   return s;
 }
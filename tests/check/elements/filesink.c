@@ -366,6 +366,78 @@ GST_START_TEST (test_flush)
 
 GST_END_TEST;
 
+/* writes the same data as test_seeking with the given options and checks
+ * the file once it is closed */
+static void
+check_write_options (gboolean direct, gboolean async_write,
+    gboolean io_uring)
+{
+  GstElement *filesink;
+  gchar *tmp_fn;
+  GstSegment segment;
+
+  tmp_fn = create_temporary_file ();
+  if (tmp_fn == NULL)
+    return;
+  filesink = setup_filesink ();
+
+  GST_LOG ("using temp file '%s', direct %d, async %d, io_uring %d", tmp_fn,
+      direct, async_write, io_uring);
+  g_object_set (filesink, "location", tmp_fn, "o-direct", direct,
+      "async-write", async_write, "async-write-max-bytes", (guint64) 4096,
+      "preallocate", (guint64) 1024 * 1024, "sync-bytes", (guint64) 8192,
+      "buffer-size", 4096, "io-uring", io_uring, "io-depth", 2, NULL);
+
+  fail_unless_equals_int (gst_element_set_state (filesink, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_ASYNC);
+
+  fail_unless (gst_pad_push_event (mysrcpad,
+          gst_event_new_stream_start ("test")));
+
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_segment (&segment)));
+
+  PUSH_BYTES (1);
+  PUSH_BYTES (99);
+  PUSH_BYTES (8800);
+  PUSH_BUFFER_LIST (2, 50);
+  PUSH_BUFFER_WITH_MULTIPLE_MEM_BLOCKS (2, 20);
+
+  /* seek to an unaligned position and write across several blocks */
+  segment.start = 8800;
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_segment (&segment)));
+  CHECK_QUERY_POSITION (filesink, GST_FORMAT_BYTES, 8800);
+  PUSH_BYTES (1);
+  PUSH_BYTES (9256);
+
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+  CHECK_QUERY_POSITION (filesink, GST_FORMAT_BYTES, 18057);
+
+  fail_unless_equals_int (gst_element_set_state (filesink, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+
+  cleanup_filesink (filesink);
+
+  /* the preallocated space must not show up in the file size */
+  CHECK_WRITTEN_BYTES (0, 1, 18057);
+  CHECK_WRITTEN_BYTES (1, 99, 18057);
+  CHECK_WRITTEN_BYTES (8801, 9256, 18057);
+
+  g_remove (tmp_fn);
+  g_free (tmp_fn);
+}
+
+GST_START_TEST (test_write_options)
+{
+  check_write_options (FALSE, FALSE, FALSE);
+  check_write_options (TRUE, FALSE, FALSE);
+  check_write_options (FALSE, TRUE, FALSE);
+  check_write_options (TRUE, TRUE, FALSE);
+  check_write_options (FALSE, FALSE, TRUE);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_coverage)
 {
   GstElement *filesink;
@@ -481,6 +553,7 @@ filesink_suite (void)
   tcase_add_test (tc_chain, test_uri_interface);
   tcase_add_test (tc_chain, test_seeking);
   tcase_add_test (tc_chain, test_flush);
+  tcase_add_test (tc_chain, test_write_options);
 
   return s;
 }
@@ -303,6 +303,71 @@ GST_START_TEST (test_pull)
 
 GST_END_TEST;
 
+GST_START_TEST (test_read_modes)
+{
+  static const gchar *modes[] = { "read", "mmap", "direct", "uring" };
+  static const guint64 offsets[] = { 0, 1, 100, 4095, 4096, 5000 };
+  gchar *contents;
+  gsize length;
+  gint i, j;
+
+  fail_unless (g_file_get_contents (TESTFILE, &contents, &length, NULL));
+  fail_unless (length > 200);
+
+  for (i = 0; i < G_N_ELEMENTS (modes); i++) {
+    GstElement *src;
+    GstBuffer *buffer;
+    GstPad *pad;
+
+    GST_DEBUG ("read mode %s", modes[i]);
+    src = setup_filesrc ();
+    gst_util_set_object_arg (G_OBJECT (src), "read-mode", modes[i]);
+    g_object_set (G_OBJECT (src), "location", TESTFILE, "readahead",
+        (guint64) 65536, NULL);
+    fail_unless (gst_element_set_state (src,
+            GST_STATE_READY) == GST_STATE_CHANGE_SUCCESS,
+        "could not set to ready");
+
+    pad = gst_element_get_static_pad (src, "src");
+    fail_unless (gst_pad_activate_mode (pad, GST_PAD_MODE_PULL, TRUE));
+    fail_unless (gst_element_set_state (src,
+            GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+        "could not set to playing");
+
+    /* unaligned offsets and reads past the end give the file contents */
+    for (j = 0; j < G_N_ELEMENTS (offsets); j++) {
+      GstFlowReturn ret;
+      gsize expected;
+
+      if (offsets[j] >= length)
+        continue;
+
+      expected = MIN (length - offsets[j], 100);
+      buffer = NULL;
+      ret = gst_pad_get_range (pad, offsets[j], 100, &buffer);
+      fail_unless_equals_int (ret, GST_FLOW_OK);
+      fail_unless_equals_int (gst_buffer_get_size (buffer), expected);
+      fail_unless (gst_buffer_memcmp (buffer, 0, contents + offsets[j],
+              expected) == 0);
+      gst_buffer_unref (buffer);
+    }
+
+    buffer = NULL;
+    fail_unless_equals_int (gst_pad_get_range (pad, length, 10, &buffer),
+        GST_FLOW_EOS);
+
+    fail_unless (gst_element_set_state (src,
+            GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS,
+        "could not set to null");
+    gst_object_unref (pad);
+    cleanup_filesrc (src);
+  }
+
+  g_free (contents);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_coverage)
 {
   GstElement *src;
@@ -554,6 +619,7 @@ filesrc_suite (void)
   tcase_add_test (tc_chain, test_seeking);
   tcase_add_test (tc_chain, test_reverse);
   tcase_add_test (tc_chain, test_pull);
+  tcase_add_test (tc_chain, test_read_modes);
   tcase_add_test (tc_chain, test_coverage);
   tcase_add_test (tc_chain, test_uri_interface);
   tcase_add_test (tc_chain, test_uri_query);
@@ -373,6 +373,69 @@ GST_START_TEST (test_funnel_gap_event)
 
 GST_END_TEST;
 
+static gint n_stream_start, n_caps, n_segment;
+
+static GstPadProbeReturn
+count_sticky_events (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  switch (GST_EVENT_TYPE (GST_PAD_PROBE_INFO_EVENT (info))) {
+    case GST_EVENT_STREAM_START:
+      n_stream_start++;
+      break;
+    case GST_EVENT_CAPS:
+      n_caps++;
+      break;
+    case GST_EVENT_SEGMENT:
+      n_segment++;
+      break;
+    default:
+      break;
+  }
+  return GST_PAD_PROBE_OK;
+}
+
+GST_START_TEST (test_funnel_switch_sticky_events)
+{
+  struct TestData td;
+  GstCaps *caps;
+  gint i;
+
+  setup_test_objects (&td, chain_ok);
+
+  gst_pad_add_probe (td.mysink, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+      count_sticky_events, NULL, NULL);
+
+  bufcount = 0;
+  n_stream_start = n_caps = n_segment = 0;
+
+  /* both inputs have the same caps and segment, only the stream-start
+   * differs and needs to be sent again when switching inputs */
+  for (i = 0; i < 4; i++) {
+    fail_unless (gst_pad_push (i % 2 ? td.mysrc2 : td.mysrc1,
+            gst_buffer_new ()) == GST_FLOW_OK);
+  }
+
+  fail_unless_equals_int (bufcount, 4);
+  fail_unless_equals_int (n_stream_start, 4);
+  fail_unless_equals_int (n_caps, 1);
+  fail_unless_equals_int (n_segment, 1);
+
+  /* new caps on the inactive input are sent when switching to it */
+  caps = gst_caps_new_empty_simple ("test/other");
+  fail_unless (gst_pad_push_event (td.mysrc1, gst_event_new_caps (caps)));
+  gst_caps_unref (caps);
+  fail_unless_equals_int (n_caps, 1);
+  fail_unless (gst_pad_push (td.mysrc1, gst_buffer_new ()) == GST_FLOW_OK);
+  fail_unless_equals_int (n_caps, 2);
+  fail_unless (gst_pad_push (td.mysrc2, gst_buffer_new ()) == GST_FLOW_OK);
+  fail_unless_equals_int (n_caps, 3);
+  fail_unless_equals_int (n_segment, 1);
+
+  release_test_objects (&td);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_funnel_stress)
 {
   GstHarness *h0 = gst_harness_new_with_padnames ("funnel", "sink_0", "src");
@@ -418,6 +481,7 @@ funnel_suite (void)
   tcase_add_test (tc_chain, test_funnel_simple);
   tcase_add_test (tc_chain, test_funnel_eos);
   tcase_add_test (tc_chain, test_funnel_gap_event);
+  tcase_add_test (tc_chain, test_funnel_switch_sticky_events);
   tcase_add_test (tc_chain, test_funnel_stress);
   suite_add_tcase (s, tc_chain);
 
@@ -127,6 +127,46 @@ GST_START_TEST (test_simple_pipeline)
 
 GST_END_TEST;
 
+GST_START_TEST (test_worker_threads)
+{
+  GstElement *pipe;
+  GstElement *inputs[4];
+  GstElement *outputs[4];
+  GstElement *mq;
+  GstMessage *msg;
+  gint i;
+
+  pipe = gst_pipeline_new ("pipeline");
+
+  for (i = 0; i < 4; i++) {
+    inputs[i] = gst_element_factory_make ("fakesrc", NULL);
+    fail_unless (inputs[i] != NULL, "failed to create 'fakesrc' element");
+    g_object_set (inputs[i], "num-buffers", 256, NULL);
+
+    /* prerolling sinks would hold on to the workers */
+    outputs[i] = gst_element_factory_make ("fakesink", NULL);
+    fail_unless (outputs[i] != NULL, "failed to create 'fakesink' element");
+    g_object_set (outputs[i], "async", FALSE, NULL);
+  }
+
+  mq = setup_multiqueue (pipe, inputs, outputs, 4);
+  g_object_set (mq, "worker-threads", 2, NULL);
+
+  gst_element_set_state (pipe, GST_STATE_PLAYING);
+
+  msg = gst_bus_poll (GST_ELEMENT_BUS (pipe),
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR, -1);
+
+  fail_if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR,
+      "Expected EOS message, got ERROR message");
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipe, GST_STATE_NULL);
+  gst_object_unref (pipe);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_simple_shutdown_while_running)
 {
   GstElement *pipe;
@@ -602,6 +642,127 @@ GST_START_TEST (test_output_order)
 
 GST_END_TEST;
 
+static GstPadProbeReturn
+count_lists_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  guint *counts = user_data;
+
+  counts[0]++;
+  counts[1] += gst_buffer_list_length (GST_PAD_PROBE_INFO_BUFFER_LIST (info));
+
+  return GST_PAD_PROBE_OK;
+}
+
+static gint n_blocked;
+
+static GstPadProbeReturn
+count_blocked_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  struct PadData *pad_data = user_data;
+
+  g_mutex_lock (pad_data->mutex);
+  n_blocked++;
+  g_cond_broadcast (pad_data->cond);
+  g_mutex_unlock (pad_data->mutex);
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* pushes 20 buffers alternating over @n_pads linked pads while the outputs
+ * are blocked and checks that each pad pushes its buffers as one list */
+static void
+run_batch_push_test (gint n_pads)
+{
+  GstElement *pipe;
+  GstElement *mq;
+  GstPad *mq_srcpads[2];
+  struct PadData pad_data[2];
+  guint32 eos_seen = 0;
+  guint counts[2][2] = { {0, 0}, {0, 0} };
+  gulong block_ids[2];
+  GMutex mutex;
+  GCond cond;
+  const guint8 pad_pattern[] = { 0, 1 };
+  gint i;
+
+  g_mutex_init (&mutex);
+  g_cond_init (&cond);
+
+  pipe = gst_bin_new ("testbin");
+  mq = gst_element_factory_make ("multiqueue", NULL);
+  fail_unless (mq != NULL);
+  gst_bin_add (GST_BIN (pipe), mq);
+
+  g_object_set (mq,
+      "max-size-bytes", (guint) 0,
+      "max-size-buffers", (guint) 0,
+      "max-size-time", (guint64) 0, "batch-push", TRUE, NULL);
+
+  construct_n_pads (mq, pad_data, n_pads, n_pads);
+  for (i = 0; i < n_pads; i++) {
+    pad_data[i].eos_count_ptr = &eos_seen;
+    pad_data[i].cond = &cond;
+    pad_data[i].mutex = &mutex;
+
+    /* keep everything in the queue until all buffers are in */
+    mq_srcpads[i] = gst_pad_get_peer (pad_data[i].out_pad);
+    block_ids[i] = gst_pad_add_probe (mq_srcpads[i],
+        GST_PAD_PROBE_TYPE_BLOCK | GST_PAD_PROBE_TYPE_BUFFER |
+        GST_PAD_PROBE_TYPE_BUFFER_LIST, count_blocked_probe, &pad_data[i],
+        NULL);
+    gst_pad_add_probe (mq_srcpads[i], GST_PAD_PROBE_TYPE_BUFFER_LIST,
+        count_lists_probe, counts[i], NULL);
+  }
+
+  gst_element_set_state (pipe, GST_STATE_PLAYING);
+
+  /* the first buffer of each pad is taken right away and blocks */
+  n_blocked = 0;
+  push_n_buffers (pad_data, n_pads, pad_pattern, n_pads);
+  g_mutex_lock (&mutex);
+  while (n_blocked < n_pads)
+    g_cond_wait (&cond, &mutex);
+  g_mutex_unlock (&mutex);
+
+  push_n_buffers (pad_data, 20, pad_pattern, n_pads);
+  for (i = 0; i < n_pads; i++)
+    gst_pad_push_event (pad_data[i].input_pad, gst_event_new_eos ());
+
+  for (i = 0; i < n_pads; i++)
+    gst_pad_remove_probe (mq_srcpads[i], block_ids[i]);
+
+  g_mutex_lock (&mutex);
+  while (eos_seen < n_pads)
+    g_cond_wait (&cond, &mutex);
+  g_mutex_unlock (&mutex);
+
+  /* the buffers of each pad went out in a single list, also when they were
+   * interleaved with the ones of the other pad */
+  for (i = 0; i < n_pads; i++) {
+    fail_unless_equals_int (counts[i][0], 1);
+    fail_unless_equals_int (counts[i][1], 20 / n_pads);
+  }
+
+  for (i = 0; i < n_pads; i++) {
+    gst_object_unref (mq_srcpads[i]);
+    gst_object_unref (pad_data[i].input_pad);
+    gst_object_unref (pad_data[i].out_pad);
+  }
+  gst_element_set_state (pipe, GST_STATE_NULL);
+  gst_object_unref (pipe);
+
+  g_cond_clear (&cond);
+  g_mutex_clear (&mutex);
+}
+
+GST_START_TEST (test_batch_push)
+{
+  run_batch_push_test (1);
+  run_batch_push_test (2);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_not_linked_eos)
 {
   /* This test creates a multiqueue with 1 linked output and 1 not-linked
@@ -1670,6 +1831,7 @@ multiqueue_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_simple_create_destroy);
   tcase_add_test (tc_chain, test_simple_pipeline);
+  tcase_add_test (tc_chain, test_worker_threads);
   tcase_add_test (tc_chain, test_simple_shutdown_while_running);
 
   tcase_add_test (tc_chain, test_request_pads);
@@ -1679,6 +1841,7 @@ multiqueue_suite (void)
    * See https://bugzilla.gnome.org/show_bug.cgi?id=708661 */
   tcase_skip_broken_test (tc_chain, test_output_order);
 
+  tcase_add_test (tc_chain, test_batch_push);
   tcase_add_test (tc_chain, test_not_linked_eos);
 
   tcase_add_test (tc_chain, test_sparse_stream);
@@ -1181,6 +1181,184 @@ GST_START_TEST (test_initial_events_nodelay)
 
 GST_END_TEST;
 
+GST_START_TEST (test_wakeup_threshold)
+{
+  GstSegment segment;
+  GstBuffer *buffer;
+  GList *l;
+  guint i;
+
+  /* only wakes up on data after 8 buffers or 1ms */
+  g_object_set (queue, "wakeup-threshold", 8, "wakeup-timeout", GST_MSECOND,
+      NULL);
+
+  mysinkpad = gst_check_setup_sink_pad (queue, &sinktemplate);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (queue,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  gst_pad_push_event (mysrcpad, gst_event_new_stream_start ("test"));
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  gst_pad_push_event (mysrcpad, gst_event_new_segment (&segment));
+
+  /* a single buffer is picked up after the timeout */
+  buffer = gst_buffer_new_and_alloc (4);
+  GST_BUFFER_OFFSET (buffer) = 0;
+  fail_unless_equals_int (gst_pad_push (mysrcpad, buffer), GST_FLOW_OK);
+
+  g_mutex_lock (&check_mutex);
+  while (g_list_length (buffers) < 1)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+
+  /* the rest arrives in order */
+  for (i = 1; i < 50; i++) {
+    buffer = gst_buffer_new_and_alloc (4);
+    GST_BUFFER_OFFSET (buffer) = i;
+    fail_unless_equals_int (gst_pad_push (mysrcpad, buffer), GST_FLOW_OK);
+  }
+
+  g_mutex_lock (&check_mutex);
+  while (g_list_length (buffers) < 50)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+
+  for (l = buffers, i = 0; l; l = l->next, i++)
+    fail_unless_equals_int (GST_BUFFER_OFFSET (l->data), i);
+
+  gst_element_set_state (queue, GST_STATE_NULL);
+}
+
+GST_END_TEST;
+
+static gint not_linked_count;
+
+static GstFlowReturn
+chain_not_linked (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  g_atomic_int_inc (&not_linked_count);
+  gst_buffer_unref (buffer);
+  return GST_FLOW_NOT_LINKED;
+}
+
+GST_START_TEST (test_wakeup_threshold_not_linked)
+{
+  GstSegment segment;
+  GstBuffer *buffer;
+  guint i, level = 0;
+
+  /* the queue wakes up once all 8 buffers are in and takes them at once */
+  g_object_set (queue, "wakeup-threshold", 8, "wakeup-timeout", GST_SECOND,
+      NULL);
+
+  mysinkpad = gst_check_setup_sink_pad (queue, &sinktemplate);
+  gst_pad_set_chain_function (mysinkpad, chain_not_linked);
+  gst_pad_set_active (mysinkpad, TRUE);
+  not_linked_count = 0;
+
+  fail_unless (gst_element_set_state (queue,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  gst_pad_push_event (mysrcpad, gst_event_new_stream_start ("test"));
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  gst_pad_push_event (mysrcpad, gst_event_new_segment (&segment));
+
+  for (i = 0; i < 8; i++) {
+    buffer = gst_buffer_new_and_alloc (4);
+    fail_unless_equals_int (gst_pad_push (mysrcpad, buffer), GST_FLOW_OK);
+  }
+
+  /* only the first one is pushed, the rest of the batch goes back into the
+   * queue instead of being dropped */
+  for (i = 0; i < 1000 && level != 7; i++) {
+    g_usleep (G_USEC_PER_SEC / 1000);
+    g_object_get (queue, "current-level-buffers", &level, NULL);
+  }
+  fail_unless_equals_int (g_atomic_int_get (&not_linked_count), 1);
+  fail_unless_equals_int (level, 7);
+
+  gst_element_set_state (queue, GST_STATE_NULL);
+}
+
+GST_END_TEST;
+
+static GstPadProbeReturn
+record_batch_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  GString *order = user_data;
+
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER_LIST)
+    g_string_append_printf (order, "L%u ",
+        gst_buffer_list_length (GST_PAD_PROBE_INFO_BUFFER_LIST (info)));
+  else if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER)
+    g_string_append (order, "B ");
+  else if (GST_EVENT_TYPE (GST_PAD_PROBE_INFO_EVENT (info)) ==
+      GST_EVENT_CUSTOM_DOWNSTREAM)
+    g_string_append (order, "E ");
+
+  return GST_PAD_PROBE_OK;
+}
+
+GST_START_TEST (test_batch_push)
+{
+  GstSegment segment;
+  GstBuffer *buffer;
+  GString *order;
+  GList *l;
+  guint i;
+
+  g_object_set (queue, "batch-push", TRUE, "batch-push-max-bytes", 16, NULL);
+
+  mysinkpad = gst_check_setup_sink_pad (queue, &sinktemplate);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  order = g_string_new (NULL);
+  block_src ();
+  gst_pad_add_probe (qsrcpad, GST_PAD_PROBE_TYPE_DATA_DOWNSTREAM,
+      record_batch_probe, order, NULL);
+
+  fail_unless (gst_element_set_state (queue,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  /* everything stays in the queue until we unblock */
+  gst_pad_push_event (mysrcpad, gst_event_new_stream_start ("test"));
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  gst_pad_push_event (mysrcpad, gst_event_new_segment (&segment));
+
+  for (i = 0; i < 10; i++) {
+    buffer = gst_buffer_new_and_alloc (4);
+    GST_BUFFER_OFFSET (buffer) = i;
+    fail_unless_equals_int (gst_pad_push (mysrcpad, buffer), GST_FLOW_OK);
+
+    if (i == 5)
+      gst_pad_push_event (mysrcpad,
+          gst_event_new_custom (GST_EVENT_CUSTOM_DOWNSTREAM,
+              gst_structure_new_empty ("x-test")));
+  }
+
+  unblock_src ();
+
+  g_mutex_lock (&check_mutex);
+  while (g_list_length (buffers) < 10)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+
+  for (l = buffers, i = 0; l; l = l->next, i++)
+    fail_unless_equals_int (GST_BUFFER_OFFSET (l->data), i);
+
+  /* batches are limited to 16 bytes and don't cross the event */
+  fail_unless_equals_string (order->str, "L4 L2 E L4 ");
+
+  gst_element_set_state (queue, GST_STATE_NULL);
+  g_string_free (order, TRUE);
+}
+
+GST_END_TEST;
+
 static Suite *
 queue_suite (void)
 {
@@ -1204,6 +1382,9 @@ queue_suite (void)
   tcase_add_test (tc_chain, test_sticky_not_linked);
   tcase_add_test (tc_chain, test_time_level_buffer_list);
   tcase_add_test (tc_chain, test_initial_events_nodelay);
+  tcase_add_test (tc_chain, test_wakeup_threshold);
+  tcase_add_test (tc_chain, test_wakeup_threshold_not_linked);
+  tcase_add_test (tc_chain, test_batch_push);
 
   return s;
 }
@@ -441,6 +441,142 @@ GST_START_TEST (test_filled_read)
 
 GST_END_TEST;
 
+GST_START_TEST (test_temp_file_read)
+{
+  GstElement *queue2;
+  GstBuffer *buffer;
+  GstPad *sinkpad, *srcpad;
+  GstSegment segment;
+  GstMapInfo map;
+  gchar *template;
+  guint64 offset;
+  guint i;
+
+  queue2 = gst_element_factory_make ("queue2", NULL);
+  sinkpad = gst_element_get_static_pad (queue2, "sink");
+  srcpad = gst_element_get_static_pad (queue2, "src");
+
+  template = g_build_filename (g_get_tmp_dir (), "queue2-test-XXXXXX", NULL);
+  g_object_set (queue2, "temp-template", template, "use-buffering", FALSE,
+      "max-size-buffers", (guint) 0, "max-size-time", (guint64) 0,
+      "max-size-bytes", (guint) 0, NULL);
+  g_free (template);
+
+  gst_pad_activate_mode (srcpad, GST_PAD_MODE_PULL, TRUE);
+  gst_element_set_state (queue2, GST_STATE_PLAYING);
+
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  gst_pad_send_event (sinkpad, gst_event_new_stream_start ("test"));
+  gst_pad_send_event (sinkpad, gst_event_new_segment (&segment));
+
+  /* 1MB where every byte is its offset */
+  for (i = 0; i < 16; i++) {
+    guint j;
+
+    buffer = gst_buffer_new_and_alloc (64 * 1024);
+    gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+    for (j = 0; j < map.size; j++)
+      map.data[j] = (i * 64 * 1024 + j) & 0xff;
+    gst_buffer_unmap (buffer, &map);
+    fail_unless (gst_pad_chain (sinkpad, buffer) == GST_FLOW_OK);
+  }
+
+  /* read it back in small pieces, partly from what was read ahead */
+  for (offset = 0; offset < 1024 * 1024; offset += 3000) {
+    guint size = MIN (3000, 1024 * 1024 - offset);
+
+    buffer = NULL;
+    fail_unless (gst_pad_get_range (srcpad, offset, size,
+            &buffer) == GST_FLOW_OK);
+    fail_unless_equals_int (gst_buffer_get_size (buffer), size);
+
+    gst_buffer_map (buffer, &map, GST_MAP_READ);
+    for (i = 0; i < size; i++)
+      fail_unless_equals_int (map.data[i], (offset + i) & 0xff);
+    gst_buffer_unmap (buffer, &map);
+    gst_buffer_unref (buffer);
+  }
+
+  gst_element_set_state (queue2, GST_STATE_NULL);
+
+  gst_object_unref (sinkpad);
+  gst_object_unref (srcpad);
+  gst_object_unref (queue2);
+}
+
+GST_END_TEST;
+
+static void
+push_pattern (GstPad * sinkpad, guint64 offset, guint size)
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+  guint i;
+
+  buffer = gst_buffer_new_and_alloc (size);
+  gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+  for (i = 0; i < size; i++)
+    map.data[i] = (offset + i) & 0xff;
+  gst_buffer_unmap (buffer, &map);
+  fail_unless (gst_pad_chain (sinkpad, buffer) == GST_FLOW_OK);
+}
+
+static void
+check_pattern (GstPad * srcpad, guint64 offset, guint size)
+{
+  GstBuffer *buffer = NULL;
+  GstMapInfo map;
+  guint i;
+
+  fail_unless (gst_pad_get_range (srcpad, offset, size,
+          &buffer) == GST_FLOW_OK);
+  fail_unless_equals_int (gst_buffer_get_size (buffer), size);
+
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  for (i = 0; i < size; i++)
+    fail_unless_equals_int (map.data[i], (offset + i) & 0xff);
+  gst_buffer_unmap (buffer, &map);
+  gst_buffer_unref (buffer);
+}
+
+GST_START_TEST (test_ring_buffer_wraparound_read)
+{
+  GstElement *queue2;
+  GstPad *sinkpad, *srcpad;
+  GstSegment segment;
+
+  queue2 = gst_element_factory_make ("queue2", NULL);
+  sinkpad = gst_element_get_static_pad (queue2, "sink");
+  srcpad = gst_element_get_static_pad (queue2, "src");
+
+  g_object_set (queue2, "ring-buffer-max-size", (guint64) 64 * 1024,
+      "use-buffering", FALSE, "max-size-buffers", (guint) 0,
+      "max-size-time", (guint64) 0, NULL);
+
+  gst_pad_activate_mode (srcpad, GST_PAD_MODE_PULL, TRUE);
+  gst_element_set_state (queue2, GST_STATE_PLAYING);
+
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  gst_pad_send_event (sinkpad, gst_event_new_stream_start ("test"));
+  gst_pad_send_event (sinkpad, gst_event_new_segment (&segment));
+
+  push_pattern (sinkpad, 0, 32 * 1024);
+  check_pattern (srcpad, 0, 24 * 1024);
+
+  /* the second write wraps around the end of the ring */
+  push_pattern (sinkpad, 32 * 1024, 32 * 1024);
+  push_pattern (sinkpad, 64 * 1024, 16 * 1024);
+  check_pattern (srcpad, 24 * 1024, 50 * 1024);
+
+  gst_element_set_state (queue2, GST_STATE_NULL);
+
+  gst_object_unref (sinkpad);
+  gst_object_unref (srcpad);
+  gst_object_unref (queue2);
+}
+
+GST_END_TEST;
+
 
 static GstPadProbeReturn
 block_callback (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
@@ -558,6 +694,8 @@ queue2_suite (void)
   tcase_add_test (tc_chain, test_simple_shutdown_while_running_ringbuffer);
   tcase_add_test (tc_chain, test_watermark_and_fill_level);
   tcase_add_test (tc_chain, test_filled_read);
+  tcase_add_test (tc_chain, test_temp_file_read);
+  tcase_add_test (tc_chain, test_ring_buffer_wraparound_read);
   tcase_add_test (tc_chain, test_percent_overflow);
   tcase_add_test (tc_chain, test_small_ring_buffer);
 
@@ -452,7 +452,8 @@ _fake_chain_error (GstPad * pad, GstObject * parent, GstBuffer * buffer)
   return GST_FLOW_ERROR;
 }
 
-GST_START_TEST (test_flow_aggregation)
+static void
+check_flow_aggregation (gboolean parallel_push)
 {
   GstPad *mysrc, *mysink1, *mysink2;
   GstPad *teesink, *teesrc1, *teesrc2;
@@ -465,6 +466,7 @@ GST_START_TEST (test_flow_aggregation)
 
   tee = gst_element_factory_make ("tee", NULL);
   fail_unless (tee != NULL);
+  g_object_set (tee, "parallel-push", parallel_push, NULL);
   teesink = gst_element_get_static_pad (tee, "sink");
   fail_unless (teesink != NULL);
   teesrc1 = gst_element_get_request_pad (tee, "src_%u");
@@ -593,6 +595,99 @@ GST_START_TEST (test_flow_aggregation)
   gst_buffer_unref (buffer);
 }
 
+GST_START_TEST (test_flow_aggregation)
+{
+  check_flow_aggregation (FALSE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_flow_aggregation_parallel)
+{
+  check_flow_aggregation (TRUE);
+}
+
+GST_END_TEST;
+
+static GMutex rendezvous_lock;
+static GCond rendezvous_cond;
+static guint rendezvous_count;
+
+/* only returns OK when all branches are in their chain function at once */
+static GstFlowReturn
+_rendezvous_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  gint64 end_time;
+
+  gst_buffer_unref (buffer);
+
+  end_time = g_get_monotonic_time () + 5 * G_TIME_SPAN_SECOND;
+  g_mutex_lock (&rendezvous_lock);
+  rendezvous_count++;
+  g_cond_broadcast (&rendezvous_cond);
+  while (rendezvous_count % 3 != 0) {
+    if (!g_cond_wait_until (&rendezvous_cond, &rendezvous_lock, end_time)) {
+      ret = GST_FLOW_ERROR;
+      break;
+    }
+  }
+  g_mutex_unlock (&rendezvous_lock);
+
+  return ret;
+}
+
+GST_START_TEST (test_parallel_push)
+{
+  GstPad *mysrc, *mysinks[3], *teesrcs[3];
+  GstElement *tee;
+  GstPad *teesink;
+  GstSegment segment;
+  gint i;
+
+  tee = gst_element_factory_make ("tee", NULL);
+  fail_unless (tee != NULL);
+  g_object_set (tee, "parallel-push", TRUE, NULL);
+  teesink = gst_element_get_static_pad (tee, "sink");
+
+  mysrc = gst_pad_new ("mysrc", GST_PAD_SRC);
+  gst_pad_set_active (mysrc, TRUE);
+  fail_unless (gst_pad_link (mysrc, teesink) == GST_PAD_LINK_OK);
+
+  for (i = 0; i < 3; i++) {
+    teesrcs[i] = gst_element_get_request_pad (tee, "src_%u");
+    mysinks[i] = gst_pad_new (NULL, GST_PAD_SINK);
+    gst_pad_set_chain_function (mysinks[i], _rendezvous_chain);
+    gst_pad_set_active (mysinks[i], TRUE);
+    fail_unless (gst_pad_link (teesrcs[i], mysinks[i]) == GST_PAD_LINK_OK);
+  }
+
+  fail_unless (gst_element_set_state (tee,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS);
+
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  gst_pad_push_event (mysrc, gst_event_new_stream_start ("test"));
+  gst_pad_push_event (mysrc, gst_event_new_segment (&segment));
+
+  /* all branches must be running at the same time for this to succeed */
+  for (i = 0; i < 10; i++)
+    fail_unless_equals_int (gst_pad_push (mysrc, gst_buffer_new ()),
+        GST_FLOW_OK);
+  fail_unless_equals_int (rendezvous_count, 30);
+
+  fail_unless (gst_element_set_state (tee,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+
+  for (i = 0; i < 3; i++) {
+    gst_element_release_request_pad (tee, teesrcs[i]);
+    gst_object_unref (teesrcs[i]);
+    gst_object_unref (mysinks[i]);
+  }
+  gst_object_unref (teesink);
+  gst_object_unref (mysrc);
+  gst_object_unref (tee);
+}
+
 GST_END_TEST;
 
 GST_START_TEST (test_request_pads)
@@ -956,6 +1051,8 @@ tee_suite (void)
   tcase_add_test (tc_chain, test_release_while_second_buffer_alloc);
   tcase_add_test (tc_chain, test_internal_links);
   tcase_add_test (tc_chain, test_flow_aggregation);
+  tcase_add_test (tc_chain, test_flow_aggregation_parallel);
+  tcase_add_test (tc_chain, test_parallel_push);
   tcase_add_test (tc_chain, test_request_pads);
   tcase_add_test (tc_chain, test_allow_not_linked);
   tcase_add_test (tc_chain, test_allocation_query_aggregation);
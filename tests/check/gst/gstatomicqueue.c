@@ -34,6 +34,144 @@ GST_START_TEST (test_create_free)
 
 GST_END_TEST;
 
+GST_START_TEST (test_bounded)
+{
+  GstAtomicQueue *aq;
+  gpointer items[8];
+  guint i;
+
+  aq = gst_atomic_queue_new_bounded (5, GST_ATOMIC_QUEUE_FLAG_NONE);
+  fail_unless_equals_int (gst_atomic_queue_get_capacity (aq), 8);
+  fail_unless (gst_atomic_queue_pop (aq) == NULL);
+  fail_unless (gst_atomic_queue_peek (aq) == NULL);
+
+  for (i = 0; i < 8; i++)
+    fail_unless (gst_atomic_queue_try_push (aq, GUINT_TO_POINTER (i + 1)));
+  fail_if (gst_atomic_queue_try_push (aq, GUINT_TO_POINTER (9)));
+  fail_unless_equals_int (gst_atomic_queue_length (aq), 8);
+
+  fail_unless (gst_atomic_queue_peek (aq) == GUINT_TO_POINTER (1));
+  fail_unless (gst_atomic_queue_pop (aq) == GUINT_TO_POINTER (1));
+
+  /* only the remaining room is filled */
+  items[0] = GUINT_TO_POINTER (9);
+  items[1] = GUINT_TO_POINTER (10);
+  fail_unless_equals_int (gst_atomic_queue_push_many (aq, items, 2), 1);
+
+  fail_unless_equals_int (gst_atomic_queue_pop_many (aq, items, 8), 8);
+  for (i = 0; i < 8; i++)
+    fail_unless (items[i] == GUINT_TO_POINTER (i + 2));
+  fail_unless_equals_int (gst_atomic_queue_pop_many (aq, items, 8), 0);
+  fail_unless_equals_int (gst_atomic_queue_length (aq), 0);
+
+  gst_atomic_queue_unref (aq);
+
+  /* unbounded queues take everything */
+  aq = gst_atomic_queue_new (2);
+  fail_unless_equals_int (gst_atomic_queue_get_capacity (aq), 0);
+  for (i = 0; i < 8; i++)
+    items[i] = GUINT_TO_POINTER (i + 1);
+  fail_unless_equals_int (gst_atomic_queue_push_many (aq, items, 8), 8);
+  fail_unless_equals_int (gst_atomic_queue_pop_many (aq, items, 3), 3);
+  fail_unless (items[2] == GUINT_TO_POINTER (3));
+  fail_unless_equals_int (gst_atomic_queue_length (aq), 5);
+  fail_unless_equals_int (gst_atomic_queue_pop_many (aq, items, 8), 5);
+  gst_atomic_queue_unref (aq);
+}
+
+GST_END_TEST;
+
+#define NUM_ITEMS 100000
+#define NUM_THREADS 4
+
+static GstAtomicQueue *aq;
+static gint n_popped;
+static gint64 sum_popped;
+static GMutex sum_lock;
+
+static gpointer
+producer_thread (gpointer data)
+{
+  gpointer items[4];
+  guint i, n, pushed;
+
+  for (i = 0; i < NUM_ITEMS; i += n) {
+    n = MIN (G_N_ELEMENTS (items), NUM_ITEMS - i);
+    for (pushed = 0; pushed < n; pushed++)
+      items[pushed] = GUINT_TO_POINTER (i + pushed + 1);
+
+    pushed = 0;
+    while (pushed < n) {
+      pushed += gst_atomic_queue_push_many (aq, items + pushed, n - pushed);
+      if (pushed < n)
+        g_thread_yield ();
+    }
+  }
+  return NULL;
+}
+
+static gpointer
+consumer_thread (gpointer data)
+{
+  gint total = GPOINTER_TO_INT (data);
+  gpointer items[3];
+  gint64 sum = 0;
+  guint i, n;
+
+  while (g_atomic_int_get (&n_popped) < total) {
+    n = gst_atomic_queue_pop_many (aq, items, G_N_ELEMENTS (items));
+    if (n == 0) {
+      g_thread_yield ();
+      continue;
+    }
+    for (i = 0; i < n; i++)
+      sum += GPOINTER_TO_UINT (items[i]);
+    g_atomic_int_add (&n_popped, n);
+  }
+
+  g_mutex_lock (&sum_lock);
+  sum_popped += sum;
+  g_mutex_unlock (&sum_lock);
+
+  return NULL;
+}
+
+static void
+run_threads (GstAtomicQueueFlags flags, guint n_producers, guint n_consumers)
+{
+  GThread *threads[2 * NUM_THREADS];
+  gint total = n_producers * NUM_ITEMS;
+  guint i;
+
+  aq = gst_atomic_queue_new_bounded (16, flags);
+  n_popped = 0;
+  sum_popped = 0;
+
+  for (i = 0; i < n_consumers; i++)
+    threads[i] = g_thread_new ("consumer", consumer_thread,
+        GINT_TO_POINTER (total));
+  for (i = 0; i < n_producers; i++)
+    threads[n_consumers + i] = g_thread_new ("producer", producer_thread,
+        NULL);
+  for (i = 0; i < n_consumers + n_producers; i++)
+    g_thread_join (threads[i]);
+
+  fail_unless_equals_int (n_popped, total);
+  fail_unless (sum_popped ==
+      (gint64) n_producers * NUM_ITEMS * (NUM_ITEMS + 1) / 2);
+  fail_unless_equals_int (gst_atomic_queue_length (aq), 0);
+  gst_atomic_queue_unref (aq);
+}
+
+GST_START_TEST (test_bounded_threads)
+{
+  run_threads (GST_ATOMIC_QUEUE_FLAG_NONE, NUM_THREADS, NUM_THREADS);
+  run_threads (GST_ATOMIC_QUEUE_FLAG_SINGLE_PRODUCER |
+      GST_ATOMIC_QUEUE_FLAG_SINGLE_CONSUMER, 1, 1);
+}
+
+GST_END_TEST;
+
 static Suite *
 gst_atomic_queue_suite (void)
 {
@@ -42,6 +180,8 @@ gst_atomic_queue_suite (void)
 
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_create_free);
+  tcase_add_test (tc_chain, test_bounded);
+  tcase_add_test (tc_chain, test_bounded_threads);
 
   return s;
 }
@@ -303,6 +303,44 @@ GST_START_TEST (test_flushing_pool_returns_flushing)
 
 GST_END_TEST;
 
+GST_START_TEST (test_bounded_queue)
+{
+  GstBufferPool *pool = gst_buffer_pool_new ();
+  GstStructure *conf = gst_buffer_pool_get_config (pool);
+  GstBufferPoolAcquireParams params = { 0, };
+  GstBuffer *buf = NULL, *prev_buf = NULL, *tmp = NULL;
+  GstFlowReturn ret;
+
+  gst_buffer_pool_config_set_params (conf, NULL, 10, 2, 2);
+  gst_buffer_pool_config_add_option (conf,
+      GST_BUFFER_POOL_OPTION_BOUNDED_QUEUE);
+  fail_unless (gst_buffer_pool_set_config (pool, conf));
+  gst_buffer_pool_set_active (pool, TRUE);
+
+  params.flags = GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT;
+  ret = gst_buffer_pool_acquire_buffer (pool, &prev_buf, &params);
+  fail_unless_equals_int (ret, GST_FLOW_OK);
+  ret = gst_buffer_pool_acquire_buffer (pool, &buf, &params);
+  fail_unless_equals_int (ret, GST_FLOW_OK);
+  gst_buffer_unref (buf);
+
+  /* the released buffer is recycled */
+  buf = NULL;
+  ret = gst_buffer_pool_acquire_buffer (pool, &buf, &params);
+  fail_unless_equals_int (ret, GST_FLOW_OK);
+  fail_if (buf == prev_buf);
+
+  ret = gst_buffer_pool_acquire_buffer (pool, &tmp, &params);
+  fail_unless_equals_int (ret, GST_FLOW_EOS);
+
+  gst_buffer_unref (buf);
+  gst_buffer_unref (prev_buf);
+  gst_buffer_pool_set_active (pool, FALSE);
+  gst_object_unref (pool);
+}
+
+GST_END_TEST;
+
 static Suite *
 gst_buffer_pool_suite (void)
 {
@@ -321,6 +359,7 @@ gst_buffer_pool_suite (void)
   tcase_add_test (tc_chain, test_pool_activation_and_config);
   tcase_add_test (tc_chain, test_pool_config_validate);
   tcase_add_test (tc_chain, test_flushing_pool_returns_flushing);
+  tcase_add_test (tc_chain, test_bounded_queue);
 
   return s;
 }
@@ -812,6 +812,228 @@ GST_START_TEST (test_async_message)
 
 GST_END_TEST;
 
+static gboolean
+count_message_cb (GstBus * bus, GstMessage * message, gpointer data)
+{
+  guint *num_messages = data;
+
+  (*num_messages)++;
+
+  return TRUE;
+}
+
+/* test that a watch handles up to dispatch-batch-size messages per main loop
+ * iteration */
+GST_START_TEST (test_watch_dispatch_batch)
+{
+  guint num_messages = 0;
+  guint id;
+
+  test_bus = gst_bus_new ();
+  g_object_set (test_bus, "dispatch-batch-size", 4, NULL);
+
+  id = gst_bus_add_watch (test_bus, count_message_cb, &num_messages);
+  fail_if (id == 0);
+
+  send_10_app_messages ();
+
+  g_main_context_iteration (NULL, FALSE);
+  fail_unless_equals_int (num_messages, 4);
+  g_main_context_iteration (NULL, FALSE);
+  fail_unless_equals_int (num_messages, 8);
+
+  while (g_main_context_pending (NULL))
+    g_main_context_iteration (NULL, FALSE);
+  fail_unless_equals_int (num_messages, 10);
+  fail_if (gst_bus_have_pending (test_bus), "unexpected messages on bus");
+
+  fail_unless (gst_bus_remove_watch (test_bus));
+  gst_object_unref (test_bus);
+}
+
+GST_END_TEST;
+
+/* test that only the latest unhandled message of a coalesced type is
+ * delivered per source */
+GST_START_TEST (test_coalesce_messages)
+{
+  GstObject *src1, *src2;
+  GstMessage *msg;
+  gint i, percent;
+
+  test_bus = gst_bus_new ();
+  g_object_set (test_bus, "coalesce-types", GST_MESSAGE_BUFFERING, NULL);
+
+  src1 = gst_object_ref_sink (g_object_new (GST_TYPE_BIN, "name", "src1",
+          NULL));
+  src2 = gst_object_ref_sink (g_object_new (GST_TYPE_BIN, "name", "src2",
+          NULL));
+
+  gst_bus_post (test_bus, gst_message_new_buffering (src1, 0));
+  gst_bus_post (test_bus, gst_message_new_buffering (src2, 0));
+  gst_bus_post (test_bus, gst_message_new_application (src1, NULL));
+  for (i = 1; i <= 10; i++)
+    gst_bus_post (test_bus, gst_message_new_buffering (src1, i * 10));
+
+  /* the application message is not coalesced */
+  msg = gst_bus_pop (test_bus);
+  fail_unless (msg != NULL);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_BUFFERING);
+  fail_unless (GST_MESSAGE_SRC (msg) == src2);
+  gst_message_unref (msg);
+
+  msg = gst_bus_pop (test_bus);
+  fail_unless (msg != NULL);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_APPLICATION);
+  gst_message_unref (msg);
+
+  msg = gst_bus_pop (test_bus);
+  fail_unless (msg != NULL);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_BUFFERING);
+  fail_unless (GST_MESSAGE_SRC (msg) == src1);
+  gst_message_parse_buffering (msg, &percent);
+  fail_unless_equals_int (percent, 100);
+  gst_message_unref (msg);
+
+  fail_unless (gst_bus_pop (test_bus) == NULL);
+
+  /* a handled message is not replaced anymore */
+  gst_bus_post (test_bus, gst_message_new_buffering (src1, 50));
+  msg = gst_bus_pop (test_bus);
+  fail_unless (msg != NULL);
+  gst_message_parse_buffering (msg, &percent);
+  fail_unless_equals_int (percent, 50);
+  gst_message_unref (msg);
+
+  gst_object_unref (src1);
+  gst_object_unref (src2);
+  gst_object_unref (test_bus);
+}
+
+GST_END_TEST;
+
+static GstBusSyncReply
+async_buffering_sync_handler (GstBus * bus, GstMessage * msg, gpointer data)
+{
+  gint percent;
+
+  gst_message_parse_buffering (msg, &percent);
+
+  /* only the first one is delivered asynchronously */
+  return percent == 0 ? GST_BUS_ASYNC : GST_BUS_PASS;
+}
+
+static gpointer
+post_async_buffering_thread (gpointer data)
+{
+  gst_bus_post (test_bus, gst_message_new_buffering (GST_OBJECT (data), 0));
+  return NULL;
+}
+
+/* test that an async message is delivered even when a newer message of its
+ * coalesced type and source is queued behind it */
+GST_START_TEST (test_coalesce_async_messages)
+{
+  GstObject *src;
+  GstMessage *msg;
+  GThread *thread;
+  gint percent;
+
+  test_bus = gst_bus_new ();
+  g_object_set (test_bus, "coalesce-types", GST_MESSAGE_BUFFERING, NULL);
+  gst_bus_set_sync_handler (test_bus, async_buffering_sync_handler, NULL,
+      NULL);
+
+  src = gst_object_ref_sink (g_object_new (GST_TYPE_BIN, "name", "src",
+          NULL));
+
+  /* the poster blocks until the message is freed */
+  thread = g_thread_new ("post-async", post_async_buffering_thread, src);
+  while ((msg = gst_bus_peek (test_bus)) == NULL)
+    g_usleep (1000);
+  gst_message_unref (msg);
+
+  gst_bus_post (test_bus, gst_message_new_buffering (src, 50));
+
+  msg = gst_bus_pop (test_bus);
+  fail_unless (msg != NULL);
+  gst_message_parse_buffering (msg, &percent);
+  fail_unless_equals_int (percent, 0);
+  gst_message_unref (msg);
+  g_thread_join (thread);
+
+  msg = gst_bus_pop (test_bus);
+  fail_unless (msg != NULL);
+  gst_message_parse_buffering (msg, &percent);
+  fail_unless_equals_int (percent, 50);
+  gst_message_unref (msg);
+
+  fail_unless (gst_bus_pop (test_bus) == NULL);
+
+  gst_object_unref (src);
+  gst_object_unref (test_bus);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_queue_capacity)
+{
+  GstMessage *msg;
+  guint capacity;
+  gint i;
+
+  test_bus = gst_object_ref_sink (g_object_new (GST_TYPE_BUS,
+          "queue-capacity", 3, NULL));
+  g_object_get (test_bus, "queue-capacity", &capacity, NULL);
+  fail_unless_equals_int (capacity, 3);
+
+  /* rounded up to 4 */
+  for (i = 0; i < 4; i++)
+    fail_unless (gst_bus_post (test_bus,
+            gst_message_new_application (NULL, NULL)));
+  fail_if (gst_bus_post (test_bus, gst_message_new_application (NULL, NULL)));
+
+  /* essential messages are kept anyway, and the ones after them are dropped
+   * until they are popped so that they are not delivered out of order */
+  fail_unless (gst_bus_post (test_bus, gst_message_new_error (NULL, NULL,
+              "test")));
+  fail_unless (gst_bus_post (test_bus, gst_message_new_eos (NULL)));
+
+  msg = gst_bus_pop (test_bus);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_APPLICATION);
+  gst_message_unref (msg);
+  fail_if (gst_bus_post (test_bus, gst_message_new_application (NULL, NULL)));
+
+  for (i = 0; i < 3; i++) {
+    msg = gst_bus_pop (test_bus);
+    fail_unless (msg != NULL);
+    fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_APPLICATION);
+    gst_message_unref (msg);
+  }
+
+  msg = gst_bus_peek (test_bus);
+  fail_unless (msg != NULL);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_ERROR);
+  gst_message_unref (msg);
+  msg = gst_bus_pop (test_bus);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_ERROR);
+  gst_message_unref (msg);
+  msg = gst_bus_pop (test_bus);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  fail_unless (gst_bus_pop (test_bus) == NULL);
+
+  fail_unless (gst_bus_post (test_bus, gst_message_new_eos (NULL)));
+  msg = gst_bus_pop (test_bus);
+  fail_unless (msg != NULL);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+
+  gst_object_unref (test_bus);
+}
+
+GST_END_TEST;
+
 static Suite *
 gst_bus_suite (void)
 {
@@ -833,6 +1055,10 @@ gst_bus_suite (void)
   tcase_add_test (tc_chain, test_timed_pop_filtered_with_timeout);
   tcase_add_test (tc_chain, test_custom_main_context);
   tcase_add_test (tc_chain, test_async_message);
+  tcase_add_test (tc_chain, test_watch_dispatch_batch);
+  tcase_add_test (tc_chain, test_coalesce_messages);
+  tcase_add_test (tc_chain, test_coalesce_async_messages);
+  tcase_add_test (tc_chain, test_queue_capacity);
   return s;
 }
 
@@ -114,6 +114,68 @@ GST_START_TEST (test_set_master_refcount)
 
 GST_END_TEST;
 
+GST_START_TEST (test_add_observation_regression)
+{
+  GstClock *clock;
+  GstClockTime times[2 * 64];
+  GstClockTime internal, external, rate_num, rate_denom;
+  GstClockTime ref_num, ref_denom, ref_b, ref_xbase;
+  gdouble r_squared, ref_r_squared, rate, ref_rate;
+  GRand *rand;
+  gint i, n, window_size = 32;
+
+  clock = g_object_new (TYPE_TEST_CLOCK, "name", "TestClock", NULL);
+  gst_object_ref_sink (clock);
+  g_object_set (clock, "window-size", window_size, "window-threshold", 4,
+      NULL);
+
+  rand = g_rand_new_with_seed (0x12345678);
+
+  /* large absolute timestamps, a slight rate difference and some jitter;
+   * run through the window several times so the sliding updates are used */
+  for (i = 0; i < 10 * window_size; i++) {
+    GstClockTime slave, master;
+    gboolean ret;
+
+    slave = G_GUINT64_CONSTANT (257116899087539) + i * 100 * GST_MSECOND +
+        g_rand_int_range (rand, 0, 500 * GST_USECOND);
+    master = gst_util_uint64_scale (slave, 99995, 100000) +
+        G_GUINT64_CONSTANT (120632754291904) +
+        g_rand_int_range (rand, 0, 200 * GST_USECOND);
+
+    times[2 * (i % window_size)] = slave;
+    times[2 * (i % window_size) + 1] = master;
+
+    ret = gst_clock_add_observation_unapplied (clock, slave, master,
+        &r_squared, &internal, &external, &rate_num, &rate_denom);
+    if (i + 1 < 4) {
+      fail_if (ret);
+      continue;
+    }
+    fail_unless (ret);
+
+    /* compare against a full regression over the same window */
+    n = MIN (i + 1, window_size);
+    fail_unless (gst_calculate_linear_regression (times, NULL, n,
+            &ref_num, &ref_denom, &ref_b, &ref_xbase, &ref_r_squared));
+
+    fail_unless_equals_uint64 (internal, ref_xbase);
+    rate = (gdouble) rate_num / rate_denom;
+    ref_rate = (gdouble) ref_num / ref_denom;
+    fail_unless (ABS (rate - ref_rate) < 1e-6,
+        "rate %.12f != expected %.12f", rate, ref_rate);
+    fail_unless (ABS (GST_CLOCK_DIFF (external, ref_b)) <= GST_USECOND,
+        "external %" G_GUINT64_FORMAT " != expected %" G_GUINT64_FORMAT,
+        external, ref_b);
+    fail_unless (ABS (r_squared - ref_r_squared) < 1e-3);
+  }
+
+  g_rand_free (rand);
+  gst_object_unref (clock);
+}
+
+GST_END_TEST;
+
 static Suite *
 gst_clock_suite (void)
 {
@@ -122,6 +184,7 @@ gst_clock_suite (void)
 
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_set_master_refcount);
+  tcase_add_test (tc_chain, test_add_observation_regression);
 
   return s;
 }
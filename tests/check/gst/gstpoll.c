@@ -24,6 +24,7 @@
 #endif
 
 #include <gst/check/gstcheck.h>
+#include <glib/gstdio.h>
 
 #ifdef G_OS_WIN32
 #include <winsock2.h>
@@ -321,6 +322,81 @@ GST_START_TEST (test_poll_controllable)
 
 GST_END_TEST;
 
+GST_START_TEST (test_poll_many_fds)
+{
+  GstPoll *set;
+  GstPollFD rfds[64];
+  gint wfds[64];
+  GstPollFD file_fd = GST_POLL_FD_INIT;
+  gchar *filename;
+  guchar c = 'A';
+  GstClockTime start;
+  gint i;
+
+  set = gst_poll_new (FALSE);
+  fail_if (set == NULL, "Failed to create a GstPoll");
+
+  for (i = 0; i < G_N_ELEMENTS (rfds); i++) {
+    gint socks[2];
+
+    fail_if (socketpair (PF_UNIX, SOCK_STREAM, 0, socks) < 0,
+        "Could not create a pipe");
+    gst_poll_fd_init (&rfds[i]);
+    rfds[i].fd = socks[0];
+    wfds[i] = socks[1];
+
+    fail_unless (gst_poll_add_fd (set, &rfds[i]));
+    fail_unless (gst_poll_fd_ctl_read (set, &rfds[i], TRUE));
+  }
+
+  fail_unless (gst_poll_wait (set, 0) == 0, "No descriptor should be active");
+
+  /* sub-millisecond timeouts are not cut short */
+  start = gst_util_get_timestamp ();
+  fail_unless (gst_poll_wait (set, 200 * GST_USECOND) == 0);
+  fail_unless (gst_util_get_timestamp () - start >= 200 * GST_USECOND);
+
+  /* only the written descriptors report activity */
+  fail_unless (write (wfds[3], &c, 1) == 1, "write() failed");
+  fail_unless (write (wfds[42], &c, 1) == 1, "write() failed");
+  fail_unless (gst_poll_wait (set, GST_CLOCK_TIME_NONE) == 2,
+      "Two descriptors should be available");
+  for (i = 0; i < G_N_ELEMENTS (rfds); i++)
+    fail_unless (gst_poll_fd_can_read (set, &rfds[i]) == (i == 3 || i == 42));
+
+  /* removing descriptors moves others around in the set */
+  fail_unless (gst_poll_remove_fd (set, &rfds[0]));
+  fail_unless (gst_poll_remove_fd (set, &rfds[3]));
+  fail_unless (gst_poll_wait (set, GST_CLOCK_TIME_NONE) == 1,
+      "One descriptor should be available");
+  fail_unless (gst_poll_fd_can_read (set, &rfds[42]));
+  fail_unless (read (rfds[42].fd, &c, 1) == 1, "read() failed");
+  fail_unless (gst_poll_wait (set, 0) == 0, "No descriptor should be active");
+
+  /* regular files are always readable */
+  file_fd.fd = g_file_open_tmp ("gstpoll-XXXXXX", &filename, NULL);
+  fail_if (file_fd.fd < 0);
+  fail_unless (gst_poll_add_fd (set, &file_fd));
+  fail_unless (gst_poll_fd_ctl_read (set, &file_fd, TRUE));
+  fail_unless (write (wfds[7], &c, 1) == 1, "write() failed");
+  fail_unless (gst_poll_wait (set, GST_CLOCK_TIME_NONE) == 2,
+      "Two descriptors should be available");
+  fail_unless (gst_poll_fd_can_read (set, &file_fd));
+  fail_unless (gst_poll_fd_can_read (set, &rfds[7]));
+
+  gst_poll_free (set);
+
+  close (file_fd.fd);
+  g_unlink (filename);
+  g_free (filename);
+  for (i = 0; i < G_N_ELEMENTS (rfds); i++) {
+    close (rfds[i].fd);
+    close (wfds[i]);
+  }
+}
+
+GST_END_TEST;
+
 static Suite *
 gst_poll_suite (void)
 {
@@ -339,6 +415,7 @@ gst_poll_suite (void)
   tcase_add_test (tc_chain, test_poll_wait_restart);
   tcase_add_test (tc_chain, test_poll_wait_flush);
   tcase_add_test (tc_chain, test_poll_controllable);
+  tcase_add_test (tc_chain, test_poll_many_fds);
 #else
   tcase_skip_broken_test (tc_chain, test_poll_basic);
   tcase_skip_broken_test (tc_chain, test_poll_wait);
@@ -23,6 +23,7 @@
 #endif
 #include <gst/gst.h>
 #include <gst/check/gstcheck.h>
+#include <gst/check/gsttestclock.h>
 #include <gst/base/gstbasesink.h>
 
 GST_START_TEST (basesink_last_sample_enabled)
@@ -282,6 +283,342 @@ GST_START_TEST (basesink_position_query_handles_segment_offset)
 
 GST_END_TEST;
 
+typedef GstBaseSink TestListSink;
+typedef GstBaseSinkClass TestListSinkClass;
+
+static GType test_list_sink_get_type (void);
+
+G_DEFINE_TYPE (TestListSink, test_list_sink, GST_TYPE_BASE_SINK);
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+/* number of buffers of every render call */
+static GArray *rendered;
+
+static GstFlowReturn
+test_list_sink_render (GstBaseSink * sink, GstBuffer * buffer)
+{
+  guint len = 1;
+
+  g_array_append_val (rendered, len);
+  return GST_FLOW_OK;
+}
+
+static GstFlowReturn
+test_list_sink_render_list (GstBaseSink * sink, GstBufferList * list)
+{
+  guint len = gst_buffer_list_length (list);
+
+  g_array_append_val (rendered, len);
+  return GST_FLOW_OK;
+}
+
+static void
+test_list_sink_init (TestListSink * sink)
+{
+}
+
+static void
+test_list_sink_class_init (TestListSinkClass * klass)
+{
+  GstBaseSinkClass *gstbasesink_class = GST_BASE_SINK_CLASS (klass);
+
+  gst_element_class_add_static_pad_template (GST_ELEMENT_CLASS (klass),
+      &sink_template);
+
+  gstbasesink_class->render = test_list_sink_render;
+  gstbasesink_class->render_list = test_list_sink_render_list;
+}
+
+static void
+push_list_with_times (GstPad * pad, const guint * times_ms, guint n)
+{
+  GstBufferList *list;
+  guint i;
+
+  list = gst_buffer_list_new_sized (n);
+  for (i = 0; i < n; i++) {
+    GstBuffer *buf = gst_buffer_new ();
+
+    GST_BUFFER_PTS (buf) = times_ms[i] * GST_MSECOND;
+    GST_BUFFER_DURATION (buf) = 10 * GST_MSECOND;
+    gst_buffer_list_add (list, buf);
+  }
+  fail_unless_equals_int (gst_pad_push_list (pad, list), GST_FLOW_OK);
+}
+
+GST_START_TEST (basesink_max_list_span)
+{
+  static const guint even[] = { 0, 10, 20, 30, 40, 50 };
+  static const guint gaps[] = { 100, 110, 200, 210, 220, 500 };
+  GstElement *sink;
+  GstPad *srcpad;
+  GstSegment segment;
+
+  sink = g_object_new (test_list_sink_get_type (), "sync", FALSE,
+      "async", FALSE, "max-list-span", 20 * GST_MSECOND, NULL);
+  srcpad = gst_check_setup_src_pad (sink, &src_template);
+  gst_pad_set_active (srcpad, TRUE);
+  rendered = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  fail_unless_equals_int (gst_element_set_state (sink, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  fail_unless (gst_pad_push_event (srcpad,
+          gst_event_new_stream_start ("test")));
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_segment (&segment)));
+
+  /* split in parts of at most 20ms, a single buffer is rendered alone */
+  push_list_with_times (srcpad, even, G_N_ELEMENTS (even));
+  push_list_with_times (srcpad, gaps, G_N_ELEMENTS (gaps));
+
+  fail_unless_equals_int (rendered->len, 5);
+  fail_unless_equals_int (g_array_index (rendered, guint, 0), 3);
+  fail_unless_equals_int (g_array_index (rendered, guint, 1), 3);
+  fail_unless_equals_int (g_array_index (rendered, guint, 2), 2);
+  fail_unless_equals_int (g_array_index (rendered, guint, 3), 3);
+  fail_unless_equals_int (g_array_index (rendered, guint, 4), 1);
+
+  /* the whole list when it is short enough */
+  g_array_set_size (rendered, 0);
+  g_object_set (sink, "max-list-span", 50 * GST_MSECOND, NULL);
+  push_list_with_times (srcpad, even, G_N_ELEMENTS (even));
+  fail_unless_equals_int (rendered->len, 1);
+  fail_unless_equals_int (g_array_index (rendered, guint, 0), 6);
+
+  fail_unless_equals_int (gst_element_set_state (sink, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+
+  g_array_free (rendered, TRUE);
+  gst_check_teardown_src_pad (sink);
+  gst_object_unref (sink);
+}
+
+GST_END_TEST;
+
+typedef struct
+{
+  GstPad *pad;
+  const guint *times_ms;
+  guint n;
+} PushListData;
+
+static gpointer
+push_list_thread (gpointer user_data)
+{
+  PushListData *data = user_data;
+
+  push_list_with_times (data->pad, data->times_ms, data->n);
+  return NULL;
+}
+
+/* every part of a list is synced with a single clock wait */
+GST_START_TEST (basesink_max_list_span_sync)
+{
+  static const guint even[] = { 100, 110, 120, 130, 140, 150 };
+  static const GstClockTime waits[] = { 100 * GST_MSECOND,
+    130 * GST_MSECOND
+  };
+  PushListData data;
+  GstElement *sink;
+  GstPad *srcpad;
+  GstSegment segment;
+  GstClock *clock;
+  GstTestClock *test_clock;
+  GThread *thread;
+  guint i;
+
+  sink = g_object_new (test_list_sink_get_type (), "sync", TRUE,
+      "async", FALSE, "max-list-span", 20 * GST_MSECOND, NULL);
+  srcpad = gst_check_setup_src_pad (sink, &src_template);
+  gst_pad_set_active (srcpad, TRUE);
+  rendered = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  clock = gst_test_clock_new ();
+  test_clock = GST_TEST_CLOCK (clock);
+  gst_element_set_clock (sink, clock);
+  gst_element_set_base_time (sink, 0);
+  fail_unless_equals_int (gst_element_set_state (sink, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  fail_unless (gst_pad_push_event (srcpad,
+          gst_event_new_stream_start ("test")));
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_segment (&segment)));
+
+  data.pad = srcpad;
+  data.times_ms = even;
+  data.n = G_N_ELEMENTS (even);
+  thread = g_thread_new ("push-list", push_list_thread, &data);
+
+  for (i = 0; i < G_N_ELEMENTS (waits); i++) {
+    GstClockID id;
+
+    gst_test_clock_wait_for_next_pending_id (test_clock, &id);
+    fail_unless_equals_uint64 (gst_clock_id_get_time (id), waits[i]);
+    gst_clock_id_unref (id);
+
+    gst_test_clock_set_time (test_clock, waits[i]);
+    id = gst_test_clock_process_next_clock_id (test_clock);
+    fail_unless (id != NULL);
+    gst_clock_id_unref (id);
+  }
+  g_thread_join (thread);
+
+  /* no other buffer of the parts waited on the clock */
+  fail_unless_equals_int (gst_test_clock_peek_id_count (test_clock), 0);
+  fail_unless_equals_int (rendered->len, 2);
+  fail_unless_equals_int (g_array_index (rendered, guint, 0), 3);
+  fail_unless_equals_int (g_array_index (rendered, guint, 1), 3);
+
+  fail_unless_equals_int (gst_element_set_state (sink, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+
+  g_array_free (rendered, TRUE);
+  gst_object_unref (clock);
+  gst_check_teardown_src_pad (sink);
+  gst_object_unref (sink);
+}
+
+GST_END_TEST;
+
+typedef GstBaseSink TestRenderSink;
+typedef GstBaseSinkClass TestRenderSinkClass;
+
+static GType test_render_sink_get_type (void);
+
+G_DEFINE_TYPE (TestRenderSink, test_render_sink, GST_TYPE_BASE_SINK);
+
+static void
+test_render_sink_init (TestRenderSink * sink)
+{
+}
+
+static void
+test_render_sink_class_init (TestRenderSinkClass * klass)
+{
+  GstBaseSinkClass *gstbasesink_class = GST_BASE_SINK_CLASS (klass);
+
+  gst_element_class_add_static_pad_template (GST_ELEMENT_CLASS (klass),
+      &sink_template);
+
+  /* no prepare, prepare_list or render_list */
+  gstbasesink_class->render = test_list_sink_render;
+}
+
+/* the parts are rendered one buffer at a time without render_list */
+GST_START_TEST (basesink_max_list_span_render_only)
+{
+  static const guint even[] = { 0, 10, 20, 30, 40, 50 };
+  GstElement *sink;
+  GstPad *srcpad;
+  GstSegment segment;
+  guint i;
+
+  sink = g_object_new (test_render_sink_get_type (), "sync", FALSE,
+      "async", FALSE, "max-list-span", 20 * GST_MSECOND, NULL);
+  srcpad = gst_check_setup_src_pad (sink, &src_template);
+  gst_pad_set_active (srcpad, TRUE);
+  rendered = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  fail_unless_equals_int (gst_element_set_state (sink, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  fail_unless (gst_pad_push_event (srcpad,
+          gst_event_new_stream_start ("test")));
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_segment (&segment)));
+
+  push_list_with_times (srcpad, even, G_N_ELEMENTS (even));
+
+  fail_unless_equals_int (rendered->len, G_N_ELEMENTS (even));
+  for (i = 0; i < rendered->len; i++)
+    fail_unless_equals_int (g_array_index (rendered, guint, i), 1);
+
+  fail_unless_equals_int (gst_element_set_state (sink, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+
+  g_array_free (rendered, TRUE);
+  gst_check_teardown_src_pad (sink);
+  gst_object_unref (sink);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (basesink_spin_sync_stats)
+{
+  GstElement *sink;
+  GstPad *srcpad;
+  GstSegment segment;
+  GstClock *clock;
+  GstStructure *stats;
+  const GValue *histogram;
+  guint64 syncs = 0, spin_time = 0;
+  guint i, total = 0;
+
+  sink = gst_element_factory_make ("fakesink", "sink");
+  g_object_set (sink, "sync", TRUE, "async", FALSE, "spin-time",
+      2 * GST_MSECOND, "spin-budget", 100, NULL);
+  fail_unless_equals_uint64 (gst_base_sink_get_spin_time (GST_BASE_SINK
+          (sink)), 2 * GST_MSECOND);
+  fail_unless_equals_int (gst_base_sink_get_spin_budget (GST_BASE_SINK
+          (sink)), 100);
+
+  srcpad = gst_check_setup_src_pad (sink, &src_template);
+  gst_pad_set_active (srcpad, TRUE);
+
+  clock = gst_system_clock_obtain ();
+  gst_element_set_clock (sink, clock);
+  gst_element_set_base_time (sink, gst_clock_get_time (clock));
+  fail_unless_equals_int (gst_element_set_state (sink, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  fail_unless (gst_pad_push_event (srcpad,
+          gst_event_new_stream_start ("test")));
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_segment (&segment)));
+
+  for (i = 0; i < 5; i++) {
+    GstBuffer *buf = gst_buffer_new ();
+
+    GST_BUFFER_PTS (buf) = (i + 2) * 10 * GST_MSECOND;
+    GST_BUFFER_DURATION (buf) = 10 * GST_MSECOND;
+    fail_unless_equals_int (gst_pad_push (srcpad, buf), GST_FLOW_OK);
+  }
+
+  g_object_get (sink, "sync-stats", &stats, NULL);
+  fail_unless (gst_structure_get_uint64 (stats, "syncs", &syncs));
+  fail_unless (gst_structure_get_uint64 (stats, "spin-time", &spin_time));
+  /* a loaded machine may wake up too late for some buffers */
+  fail_unless (syncs > 0 && syncs <= 5);
+  fail_unless (spin_time > 0);
+
+  histogram = gst_structure_get_value (stats, "error-histogram");
+  fail_unless_equals_int (gst_value_array_get_size (histogram), 64);
+  for (i = 0; i < 64; i++)
+    total += g_value_get_int (gst_value_array_get_value (histogram, i));
+  fail_unless_equals_int (total, syncs);
+  gst_structure_free (stats);
+
+  fail_unless_equals_int (gst_element_set_state (sink, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+
+  gst_object_unref (clock);
+  gst_check_teardown_src_pad (sink);
+  gst_object_unref (sink);
+}
+
+GST_END_TEST;
+
 static Suite *
 gst_basesrc_suite (void)
 {
@@ -294,6 +631,10 @@ gst_basesrc_suite (void)
   tcase_add_test (tc, basesink_test_gap);
   tcase_add_test (tc, basesink_test_eos_after_playing);
   tcase_add_test (tc, basesink_position_query_handles_segment_offset);
+  tcase_add_test (tc, basesink_max_list_span);
+  tcase_add_test (tc, basesink_max_list_span_sync);
+  tcase_add_test (tc, basesink_max_list_span_render_only);
+  tcase_add_test (tc, basesink_spin_sync_stats);
 
   return s;
 }
@@ -904,6 +904,139 @@ GST_START_TEST (basesrc_create_bufferlist)
 
 GST_END_TEST;
 
+typedef GstBaseSrc TestListSrc;
+typedef GstBaseSrcClass TestListSrcClass;
+
+static GType test_list_src_get_type (void);
+
+G_DEFINE_TYPE (TestListSrc, test_list_src, GST_TYPE_BASE_SRC);
+
+static void
+test_list_src_init (TestListSrc * src)
+{
+}
+
+static GstFlowReturn
+test_list_src_create_list (GstBaseSrc * src, guint64 offset, guint size,
+    guint max_buffers, GstBufferList ** p_list)
+{
+  guint i;
+
+  fail_unless (max_buffers > 1);
+  fail_unless (max_buffers <= 8);
+
+  *p_list = gst_buffer_list_new_sized (max_buffers);
+  for (i = 0; i < max_buffers; i++) {
+    GstBuffer *buf = gst_buffer_new_allocate (NULL, size, NULL);
+
+    GST_BUFFER_OFFSET (buf) = offset + i * size;
+    gst_buffer_list_add (*p_list, buf);
+  }
+
+  return GST_FLOW_OK;
+}
+
+static void
+test_list_src_class_init (TestListSrcClass * klass)
+{
+  GstBaseSrcClass *gstbasesrc_class = GST_BASE_SRC_CLASS (klass);
+
+  gst_element_class_add_static_pad_template (GST_ELEMENT_CLASS (klass),
+      &src_template);
+
+  gstbasesrc_class->create_list = test_list_src_create_list;
+}
+
+static guint num_lists;
+static guint num_list_buffers;
+
+static GstFlowReturn
+chainlist_size_func (GstPad * pad, GstObject * parent, GstBufferList * list)
+{
+  guint i, len;
+
+  len = gst_buffer_list_length (list);
+  fail_unless (len > 1);
+
+  for (i = 0; i < len; ++i) {
+    GstBuffer *buf = gst_buffer_list_get (list, i);
+
+    /* offsets continue over the lists */
+    fail_unless_equals_int (GST_BUFFER_OFFSET (buf), expect_offset);
+    expect_offset += gst_buffer_get_size (buf);
+
+    /* like with create, only the first buffer is timestamped */
+    if (i == 0) {
+      fail_unless (GST_BUFFER_DTS_IS_VALID (buf));
+    } else {
+      fail_if (GST_BUFFER_DTS_IS_VALID (buf));
+      fail_if (GST_BUFFER_PTS_IS_VALID (buf));
+    }
+  }
+  num_lists++;
+  num_list_buffers += len;
+
+  gst_buffer_list_unref (list);
+  return GST_FLOW_OK;
+}
+
+static gboolean
+eos_event_func (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  if (GST_EVENT_TYPE (event) == GST_EVENT_EOS) {
+    g_mutex_lock (&check_mutex);
+    done = TRUE;
+    g_cond_signal (&check_cond);
+    g_mutex_unlock (&check_mutex);
+  }
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+GST_START_TEST (basesrc_create_list)
+{
+  GstElement *src;
+  GstClock *clock;
+
+  src = g_object_new (test_list_src_get_type (), "blocksize", 100,
+      "num-buffers", 20, "max-list-size", 8, "do-timestamp", TRUE, NULL);
+
+  clock = gst_system_clock_obtain ();
+  gst_element_set_clock (src, clock);
+  gst_element_set_base_time (src, gst_clock_get_time (clock));
+
+  mysinkpad = gst_check_setup_sink_pad (src, &sinktemplate);
+  gst_pad_set_chain_list_function (mysinkpad, chainlist_size_func);
+  gst_pad_set_event_function (mysinkpad, eos_event_func);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  done = FALSE;
+  expect_offset = 0;
+  num_lists = num_list_buffers = 0;
+
+  gst_element_set_state (src, GST_STATE_PLAYING);
+
+  g_mutex_lock (&check_mutex);
+  while (!done)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+
+  /* lists of 8, 8 and 4 buffers, num-buffers counts every buffer */
+  fail_unless_equals_int (num_lists, 3);
+  fail_unless_equals_int (num_list_buffers, 20);
+  fail_unless_equals_int (expect_offset, 20 * 100);
+
+  gst_element_set_state (src, GST_STATE_NULL);
+
+  gst_check_teardown_sink_pad (src);
+
+  gst_object_unref (clock);
+  gst_object_unref (src);
+}
+
+GST_END_TEST;
+
 static Suite *
 gst_basesrc_suite (void)
 {
@@ -920,6 +1053,7 @@ gst_basesrc_suite (void)
   tcase_add_test (tc, basesrc_seek_events_rate_update);
   tcase_add_test (tc, basesrc_seek_on_last_buffer);
   tcase_add_test (tc, basesrc_create_bufferlist);
+  tcase_add_test (tc, basesrc_create_list);
 
   return s;
 }
@@ -25,6 +25,7 @@
 #endif
 
 #include <glib/gstdio.h>
+#include <fcntl.h>
 
 #include <gst/check/gstcheck.h>
 
@@ -211,6 +212,104 @@ GST_START_TEST (test_write_merge)
 
 GST_END_TEST;
 
+GST_START_TEST (test_many_ranges)
+{
+  GstSparseFile *file;
+  gsize i, start, stop;
+
+  file = gst_sparse_file_new ();
+
+  /* write every other block, backwards so that every range is inserted in
+   * front of the existing ones */
+  for (i = 1000; i > 0; i--)
+    fail_unless (expect_write (file, (i - 1) * 200, 100, 100, 0));
+  fail_unless (gst_sparse_file_n_ranges (file) == 1000);
+
+  expect_range_before (file, 0, 0, 100);
+  expect_range_before (file, 150, 0, 100);
+  expect_range_before (file, 500 * 200 + 50, 500 * 200, 500 * 200 + 100);
+  expect_range_after (file, 100, 200, 300);
+  expect_range_after (file, 500 * 200 + 150, 501 * 200, 501 * 200 + 100);
+  fail_unless (gst_sparse_file_get_range_after (file, 999 * 200 + 100,
+          &start, &stop) == FALSE);
+
+  /* a write covering many holes merges all of them */
+  fail_unless (expect_write (file, 100, 150 * 200, 150 * 200, 0));
+  fail_unless (gst_sparse_file_n_ranges (file) == 1000 - 150);
+  expect_range_before (file, 50, 0, 150 * 200 + 100);
+  expect_range_after (file, 150 * 200 + 100, 151 * 200, 151 * 200 + 100);
+
+  /* fill the other holes */
+  for (i = 151; i < 1000; i++)
+    fail_unless (expect_write (file, i * 200 - 100, 100, 100, 100));
+  fail_unless (gst_sparse_file_n_ranges (file) == 1);
+  expect_range_after (file, 0, 0, 999 * 200 + 100);
+
+  gst_sparse_file_free (file);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_save_load_index)
+{
+  GstSparseFile *file;
+  GError *error = NULL;
+  gint fd;
+  gchar *name, *index;
+  gsize start, stop;
+
+  name = g_strdup ("cachefile-testXXXXXX");
+  fd = g_mkstemp (name);
+  fail_if (fd == -1);
+  index = g_strconcat (name, ".index", NULL);
+
+  file = gst_sparse_file_new ();
+  fail_unless (gst_sparse_file_set_fd (file, fd));
+  fail_unless (expect_write (file, 0, 100, 100, 0));
+  fail_unless (expect_write (file, 150, 100, 100, 0));
+  fail_unless (expect_write (file, 300, 50, 50, 0));
+  fail_unless (gst_sparse_file_save_index (file, index, &error));
+  gst_sparse_file_free (file);
+
+  /* reopen and resume from the index */
+  fd = g_open (name, O_RDWR, 0);
+  fail_if (fd == -1);
+  file = gst_sparse_file_new ();
+  fail_unless (gst_sparse_file_set_fd (file, fd));
+  fail_unless (gst_sparse_file_load_index (file, index, &error));
+  fail_unless (gst_sparse_file_n_ranges (file) == 3);
+  expect_range_before (file, 50, 0, 100);
+  expect_range_after (file, 100, 150, 250);
+  expect_range_after (file, 250, 300, 350);
+  fail_unless (expect_read (file, 150, 100, 100, 0));
+  fail_unless (expect_read (file, 100, 50, 0, 0));
+
+  /* ranges past the end of the data are clipped */
+  fail_unless (g_file_set_contents (index,
+          "GstSparseFile 1\n0 100\n320 400\n500 600\n", -1, NULL));
+  fail_unless (gst_sparse_file_load_index (file, index, &error));
+  fail_unless (gst_sparse_file_n_ranges (file) == 2);
+  expect_range_after (file, 100, 320, 350);
+
+  /* a broken index leaves the ranges alone */
+  fail_unless (g_file_set_contents (index,
+          "GstSparseFile 1\n0 100\n50 400\n", -1, NULL));
+  fail_if (gst_sparse_file_load_index (file, index, &error));
+  fail_unless (error != NULL);
+  g_clear_error (&error);
+  fail_unless (gst_sparse_file_n_ranges (file) == 2);
+  fail_unless (gst_sparse_file_get_range_after (file, 350, &start,
+          &stop) == FALSE);
+
+  g_unlink (index);
+  g_unlink (name);
+  gst_sparse_file_free (file);
+  g_free (index);
+  g_free (name);
+}
+
+GST_END_TEST;
+
 static Suite *
 gst_cachefile_suite (void)
 {
@@ -220,6 +319,8 @@ gst_cachefile_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_write_read);
   tcase_add_test (tc_chain, test_write_merge);
+  tcase_add_test (tc_chain, test_many_ranges);
+  tcase_add_test (tc_chain, test_save_load_index);
 
   return s;
 }
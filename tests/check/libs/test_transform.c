@@ -82,6 +82,10 @@ GstFlowReturn (*klass_submit_input_buffer) (GstBaseTransform * trans,
     gboolean is_discont, GstBuffer * input) = NULL;
 GstFlowReturn (*klass_generate_output) (GstBaseTransform * trans,
     GstBuffer ** outbuf) = NULL;
+static GstFlowReturn (*klass_transform_slice) (GstBaseTransform * trans,
+    GstBuffer * inbuf, GstBuffer * outbuf, guint slice, guint n_slices) = NULL;
+static GstFlowReturn (*klass_transform_ip_slice) (GstBaseTransform * trans,
+    GstBuffer * buf, guint slice, guint n_slices) = NULL;
 
 static GstStaticPadTemplate *sink_template = &gst_test_trans_sink_template;
 static GstStaticPadTemplate *src_template = &gst_test_trans_src_template;
@@ -118,6 +122,10 @@ gst_test_trans_class_init (GstTestTransClass * klass)
     trans_class->submit_input_buffer = klass_submit_input_buffer;
   if (klass_generate_output)
     trans_class->generate_output = klass_generate_output;
+  if (klass_transform_slice)
+    trans_class->transform_slice = klass_transform_slice;
+  if (klass_transform_ip_slice)
+    trans_class->transform_ip_slice = klass_transform_ip_slice;
 }
 
 static void
@@ -887,6 +887,167 @@ GST_START_TEST (basetransform_chain_ct3)
 
 GST_END_TEST;
 
+static gint transform_ip_slices_called;
+
+/* fill every slice with its number, starting from 1 */
+static GstFlowReturn
+transform_ip_slice_1 (GstBaseTransform * trans, GstBuffer * buf, guint slice,
+    guint n_slices)
+{
+  gsize size, start, end;
+
+  size = gst_buffer_get_size (buf);
+  start = size * slice / n_slices;
+  end = size * (slice + 1) / n_slices;
+  gst_buffer_memset (buf, start, slice + 1, end - start);
+
+  g_atomic_int_inc (&transform_ip_slices_called);
+
+  return GST_FLOW_OK;
+}
+
+/* in-place transform in slices, the whole buffer transform_ip is only called
+ * when not slicing */
+GST_START_TEST (basetransform_chain_ip_slices)
+{
+  TestTransData *trans;
+  GstBuffer *buffer;
+  GstFlowReturn res;
+  GstMapInfo map;
+  gsize i;
+
+  klass_transform_ip = transform_ip_1;
+  klass_transform_ip_slice = transform_ip_slice_1;
+  trans = gst_test_trans_new ();
+  gst_base_transform_set_max_slices (GST_BASE_TRANSFORM (trans->trans), 4);
+  fail_unless_equals_int (gst_base_transform_get_max_slices
+      (GST_BASE_TRANSFORM (trans->trans)), 4);
+
+  gst_test_trans_push_segment (trans);
+
+  buffer = gst_buffer_new_and_alloc (400);
+  gst_buffer_memset (buffer, 0, 0, 400);
+
+  transform_ip_1_called = FALSE;
+  transform_ip_slices_called = 0;
+  res = gst_test_trans_push (trans, buffer);
+  fail_unless (res == GST_FLOW_OK);
+  fail_unless (transform_ip_1_called == FALSE);
+  fail_unless_equals_int (transform_ip_slices_called, 4);
+
+  buffer = gst_test_trans_pop (trans);
+  fail_unless (buffer != NULL);
+  fail_unless (gst_buffer_map (buffer, &map, GST_MAP_READ));
+  for (i = 0; i < map.size; i++)
+    fail_unless_equals_int (map.data[i], i / 100 + 1);
+  gst_buffer_unmap (buffer, &map);
+  gst_buffer_unref (buffer);
+
+  /* passthrough buffers are never sliced */
+  gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (trans->trans), TRUE);
+
+  transform_ip_1_called = FALSE;
+  transform_ip_slices_called = 0;
+  res = gst_test_trans_push (trans, gst_buffer_new_and_alloc (400));
+  fail_unless (res == GST_FLOW_OK);
+  fail_unless (transform_ip_1_called == TRUE);
+  fail_unless_equals_int (transform_ip_slices_called, 0);
+  gst_buffer_unref (gst_test_trans_pop (trans));
+
+  /* one slice is the whole buffer */
+  gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (trans->trans), FALSE);
+  gst_base_transform_set_max_slices (GST_BASE_TRANSFORM (trans->trans), 1);
+
+  transform_ip_1_called = FALSE;
+  res = gst_test_trans_push (trans, gst_buffer_new_and_alloc (400));
+  fail_unless (res == GST_FLOW_OK);
+  fail_unless (transform_ip_1_called == TRUE);
+  fail_unless_equals_int (transform_ip_slices_called, 0);
+  gst_buffer_unref (gst_test_trans_pop (trans));
+
+  gst_test_trans_free (trans);
+}
+
+GST_END_TEST;
+
+static gint transform_slices_called;
+
+/* copy every slice of the input to the twice as big output, adding the
+ * slice number to the data. The buffers are mapped again in each slice */
+static GstFlowReturn
+transform_slice_ct1 (GstBaseTransform * trans, GstBuffer * inbuf,
+    GstBuffer * outbuf, guint slice, guint n_slices)
+{
+  GstMapInfo inmap, outmap;
+  gsize start, end, i;
+
+  fail_unless (gst_buffer_map (inbuf, &inmap, GST_MAP_READ));
+  fail_unless (gst_buffer_map (outbuf, &outmap, GST_MAP_READWRITE));
+  fail_unless_equals_int (outmap.size, inmap.size * 2);
+
+  start = outmap.size * slice / n_slices;
+  end = outmap.size * (slice + 1) / n_slices;
+  for (i = start; i < end; i++)
+    outmap.data[i] = inmap.data[i / 2] + slice;
+
+  gst_buffer_unmap (outbuf, &outmap);
+  gst_buffer_unmap (inbuf, &inmap);
+
+  g_atomic_int_inc (&transform_slices_called);
+
+  return GST_FLOW_OK;
+}
+
+/* copy transform in slices, the whole buffer transform is not called */
+GST_START_TEST (basetransform_chain_ct_slices)
+{
+  TestTransData *trans;
+  GstBuffer *buffer;
+  GstFlowReturn res;
+  GstCaps *incaps;
+  GstMapInfo map;
+  gsize i;
+
+  sink_template = &sink_template_ct1;
+  klass_transform = transform_ct1;
+  klass_transform_slice = transform_slice_ct1;
+  klass_set_caps = set_caps_ct1;
+  klass_transform_caps = transform_caps_ct1;
+  klass_transform_size = transform_size_ct1;
+
+  trans = gst_test_trans_new ();
+  gst_base_transform_set_max_slices (GST_BASE_TRANSFORM (trans->trans), 4);
+
+  incaps = gst_caps_new_empty_simple ("baz/x-foo");
+  gst_test_trans_setcaps (trans, incaps);
+  gst_test_trans_push_segment (trans);
+
+  buffer = gst_buffer_new_and_alloc (400);
+  gst_buffer_memset (buffer, 0, 1, 400);
+
+  transform_ct1_called = FALSE;
+  transform_slices_called = 0;
+  res = gst_test_trans_push (trans, buffer);
+  fail_unless (res == GST_FLOW_OK);
+  fail_unless (transform_ct1_called == FALSE);
+  fail_unless_equals_int (transform_slices_called, 4);
+
+  buffer = gst_test_trans_pop (trans);
+  fail_unless (buffer != NULL);
+  fail_unless (gst_buffer_map (buffer, &map, GST_MAP_READ));
+  fail_unless_equals_int (map.size, 800);
+  for (i = 0; i < map.size; i++)
+    fail_unless_equals_int (map.data[i], i / 200 + 1);
+  gst_buffer_unmap (buffer, &map);
+  gst_buffer_unref (buffer);
+
+  gst_caps_unref (incaps);
+
+  gst_test_trans_free (trans);
+}
+
+GST_END_TEST;
+
 static void
 transform1_setup (void)
 {
@@ -905,6 +1066,8 @@ transform1_teardown (void)
   klass_set_caps = NULL;
   klass_submit_input_buffer = NULL;
   klass_generate_output = NULL;
+  klass_transform_slice = NULL;
+  klass_transform_ip_slice = NULL;
 }
 
 static Suite *
@@ -922,10 +1085,12 @@ gst_basetransform_suite (void)
   /* in place */
   tcase_add_test (tc, basetransform_chain_ip1);
   tcase_add_test (tc, basetransform_chain_ip2);
+  tcase_add_test (tc, basetransform_chain_ip_slices);
   /* copy transform */
   tcase_add_test (tc, basetransform_chain_ct1);
   tcase_add_test (tc, basetransform_chain_ct2);
   tcase_add_test (tc, basetransform_chain_ct3);
+  tcase_add_test (tc, basetransform_chain_ct_slices);
 
   return s;
 }
@@ -39,6 +39,14 @@ static GstStaticCaps foobar_caps = GST_STATIC_CAPS ("foo/x-bar");
 
 #define FOOBAR_CAPS (gst_static_caps_get (&foobar_caps))
 
+static void
+magic_typefind (GstTypeFind * tf, gpointer user_data)
+{
+  gint *called = user_data;
+
+  *called += 1;
+}
+
 /* make sure the entire data in the buffer is available for peeking */
 GST_START_TEST (test_buffer_range)
 {
@@ -72,6 +80,64 @@ GST_START_TEST (test_buffer_range)
 
 GST_END_TEST;
 
+/* typefinders whose magic doesn't match must not be called */
+GST_START_TEST (test_magic_index)
+{
+  GstTypeFindFactory *factory;
+  GList *list, *l;
+  gint called_match = 0, called_other = 0, called_none = 0;
+  gboolean ret;
+  GstCaps *caps;
+
+  fail_unless (gst_type_find_register_with_magic (NULL, "magic/x-match",
+          GST_RANK_PRIMARY + 100, magic_typefind, NULL, "0176,1:766f72", NULL,
+          &called_match, NULL));
+  fail_unless (gst_type_find_register_with_magic (NULL, "magic/x-other",
+          GST_RANK_PRIMARY + 100, magic_typefind, "other", "4f676753,8:00ff",
+          NULL, &called_other, NULL));
+  fail_unless (gst_type_find_register_with_magic (NULL, "magic/x-none",
+          GST_RANK_PRIMARY + 100, magic_typefind, NULL, NULL, NULL,
+          &called_none, NULL));
+  ASSERT_WARNING (ret = gst_type_find_register_with_magic (NULL,
+          "magic/x-invalid", GST_RANK_PRIMARY + 100, magic_typefind, NULL,
+          "2:01,zz", NULL, NULL, NULL));
+  fail_if (ret);
+
+  factory = GST_TYPE_FIND_FACTORY (gst_registry_lookup_feature
+      (gst_registry_get (), "magic/x-other"));
+  fail_unless (factory != NULL);
+  fail_unless_equals_string (gst_type_find_factory_get_magic (factory)[0],
+      "4f676753");
+  fail_unless_equals_string (gst_type_find_factory_get_magic (factory)[1],
+      "8:00ff");
+  gst_object_unref (factory);
+
+  /* only the candidates get called */
+  caps = gst_type_find_helper_for_data (NULL, vorbisid, 30, NULL);
+  if (caps)
+    gst_caps_unref (caps);
+  fail_unless_equals_int (called_match, 1);
+  fail_unless_equals_int (called_other, 0);
+  fail_unless_equals_int (called_none, 1);
+
+  /* too short to rule out the sequence at offset 8 */
+  list = gst_type_find_factory_get_list_for_data (vorbisid, 8, NULL);
+  for (l = list; l; l = l->next) {
+    if (g_str_equal (GST_OBJECT_NAME (l->data), "magic/x-other"))
+      break;
+  }
+  fail_unless (l != NULL);
+  gst_plugin_feature_list_free (list);
+
+  /* the typefinders for the extension come first */
+  list = gst_type_find_factory_get_list_for_data (vorbisid, 30, "other");
+  fail_unless (list != NULL);
+  fail_unless_equals_string (GST_OBJECT_NAME (list->data), "magic/x-other");
+  gst_plugin_feature_list_free (list);
+}
+
+GST_END_TEST;
+
 static Suite *
 gst_typefindhelper_suite (void)
 {
@@ -80,6 +146,7 @@ gst_typefindhelper_suite (void)
 
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_buffer_range);
+  tcase_add_test (tc_chain, test_magic_index);
 
   return s;
 }